@@ -17,6 +17,7 @@ import ../src/arsenal/bits/bitops
 import ../src/arsenal/bits/popcount
 import ../src/arsenal/time/clock
 import ../src/arsenal/random/rng
+import ../src/arsenal/compression/streamvbyte
 
 # ============================================================================
 # BENCHMARK UTILITIES
@@ -307,6 +308,65 @@ echo "    Speed: 4+ billion integers/sec"
 echo "    Use when: Compressing integer sequences"
 echo ""
 
+echo "Test: Stream VByte encode/decode per SIMD kernel (16M integers)"
+echo ""
+
+block:
+  const count = 16_000_000
+  const rounds = 10
+  var r = initRand(42)
+  var values = newSeq[uint32](count)
+  for v in values.mitems:
+    # Mostly 1-2 byte values with a tail of larger ones, like delta-coded ids
+    v = uint32(r.rand(if r.rand(9) == 0: 0x00FF_FFFF else: 0x3FFF))
+  let (sizeControl, sizeData) = maxEncodedSize(count)
+  var control = newSeq[byte](sizeControl)
+  var data = newSeq[byte](sizeData)
+  var output = newSeq[uint32](count)
+
+  for kernel in streamVByteKernels():
+    var used = 0
+    var start = epochTime()
+    for _ in 0..<rounds:
+      used = encodeStreamVByte(values, control, data, kernel)
+    let encodeSecs = (epochTime() - start) / float(rounds)
+
+    start = epochTime()
+    for _ in 0..<rounds:
+      discard decodeStreamVByte(control, data.toOpenArray(0, used - 1), output, kernel)
+    let decodeSecs = (epochTime() - start) / float(rounds)
+    doAssert output == values
+
+    let encodeRate = float(count) / encodeSecs / 1e9
+    let decodeRate = float(count) / decodeSecs / 1e9
+    echo &"  {$kernel:8} encode {encodeRate:6.2f} G ints/sec   decode {decodeRate:6.2f} G ints/sec"
+  echo ""
+
+  echo "Test: Sorted ids, delta decode fused vs deltaDecode(decode) (16M integers)"
+  echo ""
+  var ids = newSeq[uint32](count)
+  for i in 1..<count:
+    ids[i] = ids[i - 1] + uint32(r.rand(40))
+  let (idControl, idData) = encodeStreamVByteDelta(ids)
+
+  var start = epochTime()
+  for _ in 0..<rounds:
+    output = deltaDecode(decodeStreamVByte(idControl, idData, count))
+  let twoPassSecs = (epochTime() - start) / float(rounds)
+  doAssert output == ids
+  let twoPassRate = float(count) / twoPassSecs / 1e9
+  echo &"  two-pass decode {twoPassRate:6.2f} G ints/sec"
+
+  for kernel in streamVByteKernels():
+    start = epochTime()
+    for _ in 0..<rounds:
+      discard decodeStreamVByteDelta(idControl, idData, output, kernel = kernel)
+    let fusedSecs = (epochTime() - start) / float(rounds)
+    doAssert output == ids
+    let fusedRate = float(count) / fusedSecs / 1e9
+    echo &"  {$kernel:8} decode {fusedRate:6.2f} G ints/sec"
+  echo ""
+
 # ============================================================================
 # 7. MEMORY MEASUREMENT
 # ============================================================================
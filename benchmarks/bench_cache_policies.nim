@@ -0,0 +1,75 @@
+## Benchmarks for Cache Eviction Policies
+## =======================================
+##
+## Miss-ratio curves and replay throughput of S3-FIFO against LRU, CLOCK
+## and W-TinyLFU on synthetic traces, and the wall-clock gain of sweeping
+## capacity points in parallel. Real traces: see
+## `examples/cache_trace_replay.nim`.
+##
+## Usage:
+##   nim c -d:release --threads:on -r benchmarks/bench_cache_policies.nim
+
+import std/[times, strformat, strutils, osproc]
+import ../src/arsenal/caching/simulation
+
+const
+  Requests = 2_000_000
+  Universe = 200_000
+  Policies = [pS3FIFO, pLRU, pCLOCK, pTinyLFU]
+
+proc scanMix(requests, universe: int): CacheTrace =
+  ## Zipf(1.0) traffic with a one-off sequential scan every 100k requests,
+  ## the pattern that flushes LRU.
+  let base = zipfTrace(requests, universe, 1.0, seed = 7)
+  var scanId = uint64(universe)
+  for i, k in base.keys:
+    result.keys.add k
+    if i mod 100_000 == 99_999:
+      for _ in 0 ..< universe div 20:
+        result.keys.add scanId
+        inc scanId
+  result.uniqueKeys = base.uniqueKeys + int(scanId - uint64(universe))
+
+proc section(title: string, trace: CacheTrace) =
+  echo title
+  echo "-".repeat(title.len)
+  let caps = capacityPoints(trace.uniqueKeys, points = 6, lo = 0.001, hi = 0.2)
+  let results = sweep(trace.keys, Policies, caps)
+  stdout.write formatCurve(results)
+  var line = "Mops/sec".align(12)
+  for p in Policies:
+    var total = 0.0
+    for r in results:
+      if r.policy == p:
+        total += r.opsPerSec
+    line.add formatFloat(total / float(caps.len) / 1e6, ffDecimal, 2).align(12)
+  echo line
+  echo ""
+
+echo "Cache Eviction Policy Benchmarks"
+echo "================================"
+echo ""
+echo &"{Requests} requests over {Universe} objects, {countProcessors()} CPUs"
+echo ""
+
+section("Zipf 0.8 (miss ratio)", zipfTrace(Requests, Universe, 0.8))
+section("Zipf 1.0 (miss ratio)", zipfTrace(Requests, Universe, 1.0))
+section("Zipf 1.0 + periodic scans (miss ratio)", scanMix(Requests, Universe))
+
+const title = "Sweep wall time"
+echo title
+echo "-".repeat(title.len)
+let trace = zipfTrace(Requests, Universe, 1.0)
+let caps = capacityPoints(trace.uniqueKeys, points = 6)
+var serial = 0.0
+for threads in [1, countProcessors()]:
+  let start = epochTime()
+  discard sweep(trace.keys, Policies, caps, threads)
+  let elapsed = epochTime() - start
+  if threads == 1:
+    serial = elapsed
+  echo &"  {threads:3} threads  {elapsed:7.2f} s  speedup {serial / elapsed:5.2f}x"
+echo ""
+
+echo "Expected: S3-FIFO and W-TinyLFU track each other and beat LRU/CLOCK,"
+echo "most clearly under scans; the sweep scales until points run out."
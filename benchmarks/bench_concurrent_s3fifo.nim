@@ -0,0 +1,140 @@
+## Benchmarks for the Concurrent S3-FIFO Cache
+## ============================================
+##
+## Multi-threaded throughput of `ConcurrentS3FIFOCache` (sharded, lock-free
+## hits) against a single `S3FIFOCache` behind one mutex. Each operation
+## is a lookup that inserts the key on a miss (cache-aside), over a skewed
+## key distribution so most lookups hit.
+##
+## Usage:
+##   nim c -d:release --threads:on -r benchmarks/bench_concurrent_s3fifo.nim
+
+import std/[times, strformat, strutils, options, locks, osproc]
+import ../src/arsenal/caching/s3fifo
+import ../src/arsenal/caching/concurrent_s3fifo
+
+const
+  KeySpace = 1 shl 20
+  HotKeys = KeySpace div 100     ## 1% of the keys ...
+  HotPercent = 90                ## ... get 90% of the lookups
+  CacheSize = KeySpace div 10
+  OpsPerThread = 2_000_000
+
+type
+  WorkerArgs = object
+    seed: uint64
+    sink: ptr int
+
+var
+  sharded: ConcurrentS3FIFOCache[int, int]
+  locked: S3FIFOCache[int, int]
+  cacheLock: Lock
+
+proc nextRandom(x: var uint64): uint64 {.inline.} =
+  x = x xor (x shl 13)
+  x = x xor (x shr 7)
+  x = x xor (x shl 17)
+  x
+
+proc nextKey(x: var uint64): int {.inline.} =
+  let r = nextRandom(x)
+  if int((r shr 40) mod 100) < HotPercent:
+    int(r mod uint64(HotKeys))
+  else:
+    int(r and (KeySpace - 1))
+
+# =============================================================================
+# Workers
+# =============================================================================
+
+proc shardedWorker(args: WorkerArgs) {.thread.} =
+  var x = args.seed
+  var found = 0
+  for _ in 0 ..< OpsPerThread:
+    let key = nextKey(x)
+    if sharded.get(key).isSome:
+      inc found
+    else:
+      sharded.put(key, key)
+  args.sink[] = found
+
+proc lockedWorker(args: WorkerArgs) {.thread.} =
+  var x = args.seed
+  var found = 0
+  for _ in 0 ..< OpsPerThread:
+    let key = nextKey(x)
+    # S3FIFOCache owns seqs; the lock is what makes sharing it safe
+    {.cast(gcsafe).}:
+      withLock cacheLock:
+        if locked.get(key).isSome:
+          inc found
+        else:
+          locked.put(key, key)
+  args.sink[] = found
+
+# =============================================================================
+# Driver
+# =============================================================================
+
+proc prefill() =
+  sharded = ConcurrentS3FIFOCache[int, int].init(CacheSize)
+  locked = initS3FIFOCache[int, int](CacheSize)
+  for i in 0 ..< HotKeys:
+    sharded.put(i, i)
+    locked.put(i, i)
+
+proc run(name: string, threads: int,
+         worker: proc (args: WorkerArgs) {.thread, nimcall.}): float =
+  ## Runs `worker` on `threads` threads and returns total Mops/sec.
+  var ts = newSeq[Thread[WorkerArgs]](threads)
+  var sinks = newSeq[int](threads)
+  let start = epochTime()
+  for i in 0 ..< threads:
+    createThread(ts[i], worker, WorkerArgs(
+      seed: 0x9E3779B97F4A7C15'u64 * uint64(i + 1),
+      sink: addr sinks[i]))
+  joinThreads(ts)
+  let elapsed = epochTime() - start
+  var hits = 0
+  for s in sinks: hits += s
+  result = float(threads * OpsPerThread) / elapsed / 1_000_000.0
+  let hitRate = 100.0 * float(hits) / float(threads * OpsPerThread)
+  echo &"  {name:30} {threads:3} threads  {result:8.2f} Mops/sec  {hitRate:5.1f}% hits"
+
+# =============================================================================
+# Main
+# =============================================================================
+
+initLock(cacheLock)
+
+var threadCounts: seq[int]
+var n = 1
+while n <= countProcessors():
+  threadCounts.add n
+  n *= 2
+if threadCounts[^1] != countProcessors():
+  threadCounts.add countProcessors()
+
+echo "Concurrent S3-FIFO Cache Benchmarks"
+echo "==================================="
+echo ""
+echo &"{KeySpace} keys ({HotPercent}% of lookups on {HotKeys}), cache of {CacheSize}, " &
+     &"{OpsPerThread} ops per thread, {countProcessors()} CPUs"
+echo ""
+
+const title = "Read-heavy cache-aside (get, put on miss)"
+echo title
+echo "-".repeat(title.len)
+for threads in threadCounts:
+  prefill()
+  let a = run("S3FIFOCache + mutex", threads, lockedWorker)
+  let b = run("ConcurrentS3FIFOCache", threads, shardedWorker)
+  echo &"  {spaces(30)} speedup {b / a:6.2f}x"
+  sharded.destroy()
+echo ""
+
+deinitLock(cacheLock)
+
+echo "Expected: the mutex-wrapped cache flattens beyond one thread; the"
+echo "sharded cache scales with cores because hits never take a lock and"
+echo "stop writing shared memory once an entry's counter saturates."
@@ -0,0 +1,160 @@
+## Benchmarks for the Concurrent Swiss Table
+## ==========================================
+##
+## Multi-threaded throughput of `ConcurrentSwissTable` (sharded, seqlock
+## reads) against a single `SwissTable` behind one mutex, for read-mostly,
+## mixed and insert-only (growing) workloads at increasing thread counts.
+##
+## Usage:
+##   nim c -d:release --threads:on -r benchmarks/bench_concurrent_swiss_table.nim
+
+import std/[times, strformat, strutils, options, locks, osproc]
+import ../src/arsenal/datastructures/hashtables/swiss_table
+import ../src/arsenal/datastructures/hashtables/concurrent_swiss_table
+
+const
+  KeySpace = 1 shl 20
+  OpsPerThread = 2_000_000
+  InsertsPerThread = 500_000
+
+type
+  WorkerArgs = object
+    seed: uint64
+    readPercent: int
+    firstKey: int       ## Insert-only workload: this thread's key range
+    sink: ptr int
+
+var
+  sharded: ConcurrentSwissTable[int, int]
+  locked: SwissTable[int, int]
+  tableLock: Lock
+
+proc nextRandom(x: var uint64): uint64 {.inline.} =
+  x = x xor (x shl 13)
+  x = x xor (x shr 7)
+  x = x xor (x shl 17)
+  x
+
+# =============================================================================
+# Workers
+# =============================================================================
+
+proc shardedMixed(args: WorkerArgs) {.thread.} =
+  var x = args.seed
+  var found = 0
+  for _ in 0 ..< OpsPerThread:
+    let r = nextRandom(x)
+    let key = int(r and (KeySpace - 1))
+    if int((r shr 32) mod 100) < args.readPercent:
+      if sharded.find(key).isSome:
+        inc found
+    else:
+      sharded[key] = int(r shr 20)
+  args.sink[] = found
+
+proc lockedMixed(args: WorkerArgs) {.thread.} =
+  var x = args.seed
+  var found = 0
+  for _ in 0 ..< OpsPerThread:
+    let r = nextRandom(x)
+    let key = int(r and (KeySpace - 1))
+    if int((r shr 32) mod 100) < args.readPercent:
+      withLock tableLock:
+        if locked.find(key).isSome:
+          inc found
+    else:
+      withLock tableLock:
+        locked[key] = int(r shr 20)
+  args.sink[] = found
+
+proc shardedInsert(args: WorkerArgs) {.thread.} =
+  for i in 0 ..< InsertsPerThread:
+    sharded[args.firstKey + i] = i
+
+proc lockedInsert(args: WorkerArgs) {.thread.} =
+  for i in 0 ..< InsertsPerThread:
+    withLock tableLock:
+      locked[args.firstKey + i] = i
+
+# =============================================================================
+# Driver
+# =============================================================================
+
+proc prefill() =
+  sharded = ConcurrentSwissTable[int, int].init(KeySpace)
+  locked = SwissTable[int, int].init(KeySpace)
+  for i in countup(0, KeySpace - 1, 2):   # Half the key space: ~50% hit rate
+    sharded[i] = i
+    locked[i] = i
+
+proc run(name: string, threads: int, readPercent: int, opsPerThread: int,
+         worker: proc (args: WorkerArgs) {.thread, nimcall.}): float =
+  ## Runs `worker` on `threads` threads and returns total Mops/sec.
+  var ts = newSeq[Thread[WorkerArgs]](threads)
+  var sinks = newSeq[int](threads)
+  let start = epochTime()
+  for i in 0 ..< threads:
+    createThread(ts[i], worker, WorkerArgs(
+      seed: 0x9E3779B97F4A7C15'u64 * uint64(i + 1),
+      readPercent: readPercent,
+      firstKey: i * opsPerThread,
+      sink: addr sinks[i]))
+  joinThreads(ts)
+  let elapsed = epochTime() - start
+  result = float(threads * opsPerThread) / elapsed / 1_000_000.0
+  echo &"  {name:30} {threads:3} threads  {result:8.2f} Mops/sec"
+
+proc compare(title: string, readPercent: int, threadCounts: seq[int]) =
+  echo title
+  echo "-".repeat(title.len)
+  for n in threadCounts:
+    prefill()
+    let a = run("SwissTable + mutex", n, readPercent, OpsPerThread, lockedMixed)
+    let b = run("ConcurrentSwissTable", n, readPercent, OpsPerThread, shardedMixed)
+    echo &"  {spaces(30)} speedup {b / a:6.2f}x"
+    sharded.destroy()
+    locked.destroy()
+  echo ""
+
+proc compareGrowth(threadCounts: seq[int]) =
+  echo "Insert-only from empty (every shard resizes under load)"
+  echo "-------------------------------------------------------"
+  for n in threadCounts:
+    sharded = ConcurrentSwissTable[int, int].init()
+    locked = SwissTable[int, int].init()
+    let a = run("SwissTable + mutex", n, 0, InsertsPerThread, lockedInsert)
+    let b = run("ConcurrentSwissTable", n, 0, InsertsPerThread, shardedInsert)
+    echo &"  {spaces(30)} speedup {b / a:6.2f}x, {sharded.reclaim()} retired tables reclaimed"
+    sharded.destroy()
+    locked.destroy()
+  echo ""
+
+# =============================================================================
+# Main
+# =============================================================================
+
+initLock(tableLock)
+
+var threadCounts: seq[int]
+var n = 1
+while n <= countProcessors():
+  threadCounts.add n
+  n *= 2
+if threadCounts[^1] != countProcessors():
+  threadCounts.add countProcessors()
+
+echo "Concurrent Swiss Table Benchmarks"
+echo "================================="
+echo ""
+echo &"{KeySpace} keys, {OpsPerThread} ops per thread, {countProcessors()} CPUs"
+echo ""
+
+compare("Read-mostly (95% lookups, 5% updates)", 95, threadCounts)
+compare("Mixed (50% lookups, 50% updates)", 50, threadCounts)
+compareGrowth(threadCounts)
+
+deinitLock(tableLock)
+
+echo "Expected: the mutex-wrapped table flattens (or drops) beyond one thread;"
+echo "the sharded table scales close to linearly on read-mostly workloads"
+echo "because lookups never write shared memory."
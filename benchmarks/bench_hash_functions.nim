@@ -1,15 +1,20 @@
 ## Benchmarks for Hash Functions
 ## ===============================
 
-import std/[times, strformat, random, sugar, algorithm]
+import std/[times, strformat, random, sugar, algorithm, osproc, hashes]
 import ../src/arsenal/hashing/hashers/xxhash64
 import ../src/arsenal/hashing/hashers/wyhash
+import ../src/arsenal/hashing/hashers/xxh3
+import ../src/arsenal/hashing/hasher
+import ../src/arsenal/hashing/tree_hash
+import ../src/arsenal/hashing/crc
 
 # Benchmark configuration
 const
   SMALL_SIZE = 32
   MEDIUM_SIZE = 4096
   LARGE_SIZE = 1048576  # 1 MB
+  HUGE_SIZE = 16 * 1048576  # 16 MB (beyond L2, memory-bandwidth bound)
   SEED = DefaultSeed
 
 proc benchmarkThroughput(name: string, size: int, iterations: int, fn: proc()) =
@@ -43,6 +48,7 @@ echo "Generating test data..."
 var smallData = newSeq[byte](SMALL_SIZE)
 var mediumData = newSeq[byte](MEDIUM_SIZE)
 var largeData = newSeq[byte](LARGE_SIZE)
+var hugeData = newSeq[byte](HUGE_SIZE)
 
 randomize(42)  # Deterministic for consistent benchmarks
 for i in 0..<SMALL_SIZE:
@@ -51,6 +57,8 @@ for i in 0..<MEDIUM_SIZE:
   mediumData[i] = byte(rand(255))
 for i in 0..<LARGE_SIZE:
   largeData[i] = byte(rand(255))
+for i in 0..<HUGE_SIZE:
+  hugeData[i] = byte(rand(255))
 
 echo ""
 echo "Hash Function Benchmarks"
@@ -153,6 +161,83 @@ benchmarkThroughput "WyHash streaming: 1 MB (1KB chunks)", LARGE_SIZE, 100:
 
 echo ""
 
+# XXH3 - One-shot Hashing
+echo "XXH3 - One-shot (SIMD stripe accumulation for inputs > 240 bytes):"
+echo "-------------------------------------------------------------------"
+
+benchmarkThroughput "XXH3-64 one-shot: 32 bytes", SMALL_SIZE, 1_000_000:
+  discard Xxh3.hash(smallData, SEED)
+
+benchmarkThroughput "XXH3-64 one-shot: 4 KB", MEDIUM_SIZE, 100_000:
+  discard Xxh3.hash(mediumData, SEED)
+
+benchmarkThroughput "XXH3-64 one-shot: 1 MB", LARGE_SIZE, 1000:
+  discard Xxh3.hash(largeData, SEED)
+
+benchmarkThroughput "XXH3-64 one-shot: 16 MB", HUGE_SIZE, 50:
+  discard Xxh3.hash(hugeData, SEED)
+
+benchmarkThroughput "XXH3-128 one-shot: 1 MB", LARGE_SIZE, 1000:
+  discard Xxh3_128.hash(largeData, SEED)
+
+benchmarkThroughput "XXH3-64 streaming: 16 MB (64KB chunks)", HUGE_SIZE, 50:
+  var state = Xxh3.init(SEED)
+  var pos = 0
+  while pos < HUGE_SIZE:
+    let chunkSize = min(65536, HUGE_SIZE - pos)
+    state.update(hugeData.toOpenArray(pos, pos + chunkSize - 1))
+    pos += chunkSize
+  discard state.finish()
+
+echo ""
+
+# XXH3 tree hashing (wall clock: cpuTime would sum the worker threads)
+echo "XXH3 Tree Hash - 16 MB in 256 KB chunks (needs --threads:on to scale):"
+echo "------------------------------------------------------------------------"
+
+proc treeGbPerSec(threads: int): float =
+  const Iterations = 50
+  let start = epochTime()
+  for _ in 0 ..< Iterations:
+    discard treeHash(hugeData, 256 * 1024, threads, SEED)
+  let elapsed = epochTime() - start
+  float(HUGE_SIZE * Iterations) / (1024.0 * 1024.0 * 1024.0) / elapsed
+
+let treeSingle = treeGbPerSec(1)
+for threads in [1, 2, 4, 8, countProcessors()]:
+  let gbs = treeGbPerSec(threads)
+  let name = &"XXH3 tree: {threads} threads"
+  echo &"{name:55} {gbs:8.2f} GB/s  ({gbs / treeSingle:5.2f}x)"
+
+echo ""
+
+# CRC checksums (frame checksums, storage formats)
+echo &"CRC - 1 MB (crc32c: {crc32cBackend()}, crc32: {crc32Backend()}, crc64: {crc64Backend()}):"
+echo "-------------------------------------------------------------------------------"
+
+benchmarkThroughput "CRC-32C (dispatched)", LARGE_SIZE, 1000:
+  discard crc32c(largeData)
+
+benchmarkThroughput "CRC-32C (slicing-by-8 tables)", LARGE_SIZE, 200:
+  discard crc32cPortable(largeData)
+
+benchmarkThroughput "CRC-32 (dispatched)", LARGE_SIZE, 1000:
+  discard crc32(largeData)
+
+benchmarkThroughput "CRC-32 (slicing-by-8 tables)", LARGE_SIZE, 200:
+  discard crc32Portable(largeData)
+
+benchmarkThroughput "CRC-64/XZ (dispatched)", LARGE_SIZE, 1000:
+  discard crc64(largeData)
+
+benchmarkThroughput "CRC-64/XZ (slicing-by-8 tables)", LARGE_SIZE, 200:
+  discard crc64Portable(largeData)
+
+benchmarkThroughput "CRC-32C: 4 KB frames", MEDIUM_SIZE, 100_000:
+  discard crc32c(mediumData)
+
+echo ""
+
 # Direct Comparison
 echo "Direct Comparison (1 MB input):"
 echo "--------------------------------"
@@ -166,9 +251,14 @@ benchmark "XXHash64 one-shot (1 MB)", 1000:
 benchmark "WyHash one-shot (1 MB)", 1000:
   wyhashResult = WyHash.hash(largeData, SEED)
 
+var xxh3Result: uint64
+benchmark "XXH3-64 one-shot (1 MB)", 1000:
+  xxh3Result = Xxh3.hash(largeData, SEED)
+
 echo ""
 echo &"  XXHash64 output: 0x{xxhash64Result:016X}"
 echo &"  WyHash output:   0x{wyhashResult:016X}"
+echo &"  XXH3-64 output:  0x{xxh3Result:016X}"
 
 echo ""
 
@@ -186,6 +276,86 @@ benchmark "WyHash init() + finish() (empty)", 10_000_000:
 
 echo ""
 
+# Batch hashing of small keys (hash table inserts, joins, filters)
+echo "Batch Hashing - hashMany vs one hash call per key (4096 keys):"
+echo "---------------------------------------------------------------"
+
+const BATCH_KEYS = 4096
+
+var batchIds = newSeq[uint64](BATCH_KEYS)
+var batchIds32 = newSeq[uint32](BATCH_KEYS)
+var batchUuids = newSeq[array[16, byte]](BATCH_KEYS)
+var batchNames = newSeq[string](BATCH_KEYS)
+var batchOut = newSeq[uint64](BATCH_KEYS)
+for i in 0..<BATCH_KEYS:
+  batchIds[i] = uint64(rand(int.high))
+  batchIds32[i] = uint32(rand(int(uint32.high)))
+  for j in 0..<16:
+    batchUuids[i][j] = byte(rand(255))
+  batchNames[i] = "user:" & $rand(1_000_000)
+
+proc keysPerSec(iterations: int, fn: proc()): float =
+  ## Keys hashed per second over `iterations` passes of BATCH_KEYS keys
+  let start = cpuTime()
+  for i in 0..<iterations:
+    fn()
+  float(BATCH_KEYS * iterations) / (cpuTime() - start)
+
+proc keyBytes(k: uint64): array[8, byte] {.inline.} = cast[array[8, byte]](k)
+proc keyBytes(k: uint32): array[4, byte] {.inline.} = cast[array[4, byte]](k)
+template keyBytes(k: array[16, byte] | string): untyped = k
+
+template compareBatch(name: string, H: typedesc, keys: untyped) =
+  block:
+    proc oneByOne() =
+      for i in 0..<keys.len:
+        batchOut[i] = H.hash(keyBytes(keys[i]), SEED)
+    proc batched() =
+      H.hashMany(keys, batchOut, SEED)
+    let single = keysPerSec(2000, oneByOne)
+    let batch = keysPerSec(2000, batched)
+    echo &"{name:40} {single / 1e6:8.1f} -> {batch / 1e6:8.1f} Mkeys/s  ({batch / single:5.2f}x)"
+
+# hasher.wyhash / hasher.xxHash64: the bare names clash with the
+# hashers/wyhash and hashers/xxhash64 module names imported above
+compareBatch "wyhash uint64 keys", hasher.wyhash, batchIds
+compareBatch "wyhash uint32 keys", hasher.wyhash, batchIds32
+compareBatch "wyhash 16-byte keys", hasher.wyhash, batchUuids
+compareBatch "wyhash short strings", hasher.wyhash, batchNames
+compareBatch "xxHash64 uint64 keys", hasher.xxHash64, batchIds
+compareBatch "xxHash64 uint32 keys", hasher.xxHash64, batchIds32
+compareBatch "xxHash64 16-byte keys", hasher.xxHash64, batchUuids
+compareBatch "xxHash64 short strings", hasher.xxHash64, batchNames
+
+echo ""
+echo "  (build with -d:avx2 for the 4-lane AVX2 path on fixed-size keys)"
+echo ""
+
+# Per-key hashing as containers and sketches do it (SwissTable, HLL, S3FIFO)
+echo "Container Keys - keyHash vs std/hashes (4096 keys):"
+echo "----------------------------------------------------"
+
+var keySink: uint64   # XOR of every hash, keeps the loops from being elided
+
+proc keyRow(name: string, fn: proc()) =
+  echo &"{name:40} {keysPerSec(2000, fn) / 1e6:8.1f} Mkeys/s"
+
+keyRow "std hash, uint64", proc() =
+  for k in batchIds: keySink = keySink xor cast[uint64](hashes.hash(k))
+keyRow "std hash + 8-byte rehash, uint64", proc() =
+  # The old HyperLogLog path: std hash, then hash its 8 bytes again
+  for k in batchIds:
+    keySink = keySink xor cast[uint64](hashes.hash(keyBytes(cast[uint64](hashes.hash(k)))))
+keyRow "keyHash, uint64", proc() =
+  for k in batchIds: keySink = keySink xor keyHash(k)
+keyRow "std hash, 16-byte array", proc() =
+  for k in batchUuids: keySink = keySink xor cast[uint64](hashes.hash(k))
+keyRow "keyHash, 16-byte array", proc() =
+  for k in batchUuids: keySink = keySink xor keyHash(k)
+echo &"  (checksum 0x{keySink:016X})"
+
+echo ""
+
 echo "Performance Summary"
 echo "==================="
 echo ""
@@ -203,6 +373,12 @@ echo "  - Expected Throughput: 15-18 GB/s (fastest non-crypto hash)"
 echo "  - Best For: Maximum speed, hash tables, checksums"
 echo "  - Incremental: Efficient buffering, ~48 bytes overhead"
 echo ""
+echo "XXH3:"
+echo "  - Algorithm: 64-byte stripes, 8 accumulators in SSE2/AVX2/NEON lanes"
+echo "  - Expected Throughput: 20-30+ GB/s on cached input (AVX2)"
+echo "  - Best For: Large files and buffers, 128-bit content fingerprints"
+echo "  - Incremental: 256-byte buffer, same digest as one-shot"
+echo ""
 echo "Performance Notes:"
 echo "  - One-shot: Best for small inputs (< 1 KB)"
 echo "  - Incremental: Necessary for large inputs or streaming"
@@ -0,0 +1,152 @@
+## Benchmarks for Huge Page Backed Allocations
+## ============================================
+##
+## Random probes into a large flat table (the access pattern of a hash
+## table lookup) with regular 4 KB pages versus huge pages obtained through
+## `HugePageAllocator`. Reports ns/probe and, when `perf_event_open` is
+## permitted, dTLB load misses per probe.
+##
+## Usage:
+##   nim c -d:release -r benchmarks/bench_hugepages.nim [table MB]
+##
+## For explicit huge pages reserve a pool first:
+##   echo 1024 | sudo tee /proc/sys/vm/nr_hugepages
+
+import std/[times, strformat, strutils, os, posix]
+import ../src/arsenal/memory/allocators/hugepage
+import ../src/arsenal/kernel/syscalls
+
+const
+  DefaultTableMB = 1024
+  Probes = 20_000_000
+
+# =============================================================================
+# dTLB Miss Counter (perf_event_open)
+# =============================================================================
+
+when defined(amd64):
+  const SYS_perf_event_open = 298
+elif defined(arm64):
+  const SYS_perf_event_open = 241
+else:
+  const SYS_perf_event_open = -1
+
+proc c_syscall(number: clong): clong {.importc: "syscall", header: "<unistd.h>", varargs.}
+
+const
+  PERF_TYPE_HW_CACHE = 3'u32
+  PERF_COUNT_HW_CACHE_DTLB = 3'u64
+  PERF_COUNT_HW_CACHE_OP_READ = 0'u64
+  PERF_COUNT_HW_CACHE_RESULT_MISS = 1'u64
+  PERF_EVENT_IOC_ENABLE = 0x2400
+  PERF_EVENT_IOC_DISABLE = 0x2401
+  PERF_EVENT_IOC_RESET = 0x2403
+
+proc openDtlbMissCounter(): cint =
+  ## Opens a counter for dTLB read misses of this thread, or -1.
+  if SYS_perf_event_open < 0:
+    return -1
+  # perf_event_attr, PERF_ATTR_SIZE_VER0 layout (64 bytes)
+  var attr: array[8, uint64]
+  let header = cast[ptr array[2, uint32]](addr attr[0])
+  header[0] = PERF_TYPE_HW_CACHE
+  header[1] = uint32(sizeof(attr))
+  attr[1] = PERF_COUNT_HW_CACHE_DTLB or (PERF_COUNT_HW_CACHE_OP_READ shl 8) or
+            (PERF_COUNT_HW_CACHE_RESULT_MISS shl 16)
+  attr[5] = (1'u64 shl 0) or (1'u64 shl 5) or (1'u64 shl 6)  # disabled, exclude_kernel, exclude_hv
+  result = cint(c_syscall(SYS_perf_event_open.clong, addr attr, 0.cint, (-1).cint,
+                          (-1).cint, 0.culong))
+
+proc readCounter(fd: cint): int64 =
+  var value: int64
+  if posix.read(fd, addr value, sizeof(value)) != sizeof(value):
+    return -1
+  value
+
+# =============================================================================
+# Probe Loop
+# =============================================================================
+
+proc probe(table: ptr UncheckedArray[uint64], slots: int, probes: int): uint64 =
+  ## Random reads with a dependency on the previous value, like a chain of
+  ## hash table lookups. `slots` must be a power of two.
+  var x = 0x9E3779B97F4A7C15'u64
+  let mask = uint64(slots - 1)
+  for _ in 0 ..< probes:
+    x = x xor (x shl 13)
+    x = x xor (x shr 7)
+    x = x xor (x shl 17)
+    result += table[(x xor result) and mask]
+
+proc runProbe(name: string, table: ptr UncheckedArray[uint64], slots: int) =
+  for i in 0 ..< slots:
+    table[i] = uint64(i)   # Touch every page so faults are not measured
+
+  discard probe(table, slots, Probes div 10)   # Warm up
+
+  let fd = openDtlbMissCounter()
+  if fd >= 0:
+    discard ioctl(fd, PERF_EVENT_IOC_RESET, 0)
+    discard ioctl(fd, PERF_EVENT_IOC_ENABLE, 0)
+  let start = epochTime()
+  let sink = probe(table, slots, Probes)
+  let elapsed = epochTime() - start
+  var misses = -1'i64
+  if fd >= 0:
+    discard ioctl(fd, PERF_EVENT_IOC_DISABLE, 0)
+    misses = readCounter(fd)
+    discard posix.close(fd)
+
+  let nsPerProbe = elapsed * 1_000_000_000.0 / float(Probes)
+  let missText =
+    if misses >= 0: &"{float(misses) / float(Probes):6.3f} dTLB misses/probe"
+    else: "dTLB misses: n/a (perf_event_open denied)"
+  echo &"{name:40} {nsPerProbe:8.2f} ns/probe  {missText}  [{sink and 1}]"
+
+# =============================================================================
+# Main
+# =============================================================================
+
+var tableMB = DefaultTableMB
+if paramCount() >= 1:
+  tableMB = parseInt(paramStr(1))
+
+var slots = 1
+while slots * 2 * sizeof(uint64) <= tableMB * 1024 * 1024:
+  slots *= 2
+let bytes = slots * sizeof(uint64)
+
+echo "Huge Page Benchmarks"
+echo "===================="
+echo ""
+echo &"Table: {bytes div (1024 * 1024)} MB, {Probes} random probes"
+echo &"Huge page size: {detectHugePageSize() div 1024} KB, free explicit pages: {freeExplicitHugePages()}"
+echo &"Transparent huge pages mode: {transparentHugePagesMode()}"
+echo ""
+
+block regularPages:
+  var a = HugePageAllocator.init(useExplicit = false, useTransparent = false)
+  let p = a.alloc(bytes, 64)
+  # THP in "always" mode would otherwise promote this mapping anyway
+  discard sys_madvise(cast[pointer](cast[int](p) and not 4095), csize_t(bytes),
+                      MADV_NOHUGEPAGE.cint)
+  runProbe("Regular 4 KB pages", cast[ptr UncheckedArray[uint64]](p), slots)
+  a.dealloc(p)
+
+block transparentPages:
+  var a = HugePageAllocator.init(useExplicit = false)
+  let p = a.alloc(bytes, 64)
+  runProbe(&"THP via madvise ({pageKind(p)})", cast[ptr UncheckedArray[uint64]](p), slots)
+  a.dealloc(p)
+
+block explicitPages:
+  var a = HugePageAllocator.init()
+  let p = a.alloc(bytes, 64)
+  runProbe(&"HugePageAllocator default ({pageKind(p)})", cast[ptr UncheckedArray[uint64]](p), slots)
+  if a.fallbacks > 0:
+    echo "  (no huge pages obtained - reserve vm.nr_hugepages or enable THP)"
+  a.dealloc(p)
+
+echo ""
+echo "Expected on x86_64 with a 1 GB table: regular pages miss the dTLB on"
+echo "nearly every probe; 2 MB pages cut misses and latency substantially."
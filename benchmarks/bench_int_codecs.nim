@@ -0,0 +1,101 @@
+## Benchmarks for Integer Block Codecs
+## ===================================
+##
+## Compression ratio (bits per integer) and decode throughput of Stream
+## VByte, BP128, PFOR, Elias-Fano and the per-block automatic choice on
+## posting-list-like data, plus Elias-Fano random access and `nextGEQ`.
+##
+## Usage:
+##   nim c -d:release -r benchmarks/bench_int_codecs.nim
+
+import std/[times, strformat, strutils, random]
+import ../src/arsenal/compression/intblocks
+import ../src/arsenal/compression/eliasfano
+
+const
+  Count = 4_000_000
+  Rounds = 10
+  Codecs = [bcStreamVByte, bcBP128, bcPFor, bcEliasFano, bcAuto]
+
+proc sortedIds(gap: int, outlierEvery = 0, seed = 1): seq[uint32] =
+  ## Increasing ids with gaps in 1..gap, and an occasional long jump
+  var r = initRand(seed)
+  result = newSeq[uint32](Count)
+  var id = 0'u32
+  for i in 0 ..< Count:
+    id += 1 + uint32(r.rand(gap - 1))
+    if outlierEvery > 0 and r.rand(outlierEvery - 1) == 0:
+      id += uint32(r.rand(50_000))
+    result[i] = id
+
+proc section(title: string, values: seq[uint32], delta: bool) =
+  echo title
+  echo "-".repeat(title.len)
+  echo "codec".align(12), " ", "bits/int".align(10), " ", "decode M ints/s".align(16)
+  var output = newSeq[uint32](values.len)
+  for codec in Codecs:
+    let packed =
+      try: encodeBlocks(values, codec, delta)
+      except ValueError: newSeq[byte]()  # Elias-Fano on unsorted data
+    if packed.len == 0:
+      continue
+    let start = epochTime()
+    for _ in 0 ..< Rounds:
+      discard decodeBlocks(packed, output, delta)
+    let elapsed = (epochTime() - start) / float(Rounds)
+    doAssert output == values
+    let bits = float(packed.len * 8) / float(values.len)
+    let rate = float(values.len) / elapsed / 1e6
+    echo &"{$codec:>12} {bits:10.2f} {rate:16.0f}"
+  echo ""
+
+echo "Integer Block Codec Benchmarks"
+echo "=============================="
+echo ""
+echo &"{Count} integers per data set, blocks of 128"
+echo ""
+
+section("Dense sorted ids (gaps 1-8, delta)", sortedIds(8), delta = true)
+section("Sparse sorted ids (gaps 1-2000, delta)", sortedIds(2000), delta = true)
+section("Clustered ids (gaps 1-4, rare 50k jumps, delta)",
+        sortedIds(4, outlierEvery = 200), delta = true)
+
+block:
+  var r = initRand(3)
+  var counts = newSeq[uint32](Count)
+  for v in counts.mitems:
+    v = if r.rand(99) == 0: uint32(r.rand(1_000_000)) else: uint32(r.rand(15))
+  section("Term frequencies (mostly < 16, 1% outliers)", counts, delta = false)
+
+const title = "Elias-Fano queries (sparse ids)"
+echo title
+echo "-".repeat(title.len)
+block:
+  let ids = sortedIds(2000)
+  let ef = EliasFano.init(ids)
+  echo &"  {float(ef.sizeInBytes * 8) / float(ids.len):.2f} bits/int including select hints"
+  var r = initRand(5)
+  const queries = 2_000_000
+  var probes = newSeq[int](queries)
+  for p in probes.mitems:
+    p = r.rand(ids.high)
+  var sink = 0'u64
+  var start = epochTime()
+  for p in probes:
+    sink += ef[p]
+  let selectRate = float(queries) / (epochTime() - start) / 1e6
+  var targets = newSeq[uint32](queries)
+  for t in targets.mitems:
+    t = uint32(r.rand(int(ids[^1])))
+  start = epochTime()
+  for t in targets:
+    sink += uint64(ef.nextGEQ(t))
+  let geqRate = float(queries) / (epochTime() - start) / 1e6
+  echo &"  select   {selectRate:8.1f} M ops/sec"
+  echo &"  nextGEQ  {geqRate:8.1f} M ops/sec"
+  echo &"  (checksum {sink})"
+echo ""
+
+echo "Expected: BP128 decodes fastest on dense gaps, PFOR wins once outliers"
+echo "appear, Elias-Fano is smallest on sparse sorted ids, and auto tracks"
+echo "the best codec in every data set."
@@ -0,0 +1,80 @@
+## Benchmarks for Block-Parallel Frames
+## ====================================
+##
+## Compression and decompression throughput of block-indexed LZ4 and Zstd
+## frames as the thread count grows, and the cost of a random 4 KiB read
+## against decompressing the whole frame.
+##
+## Usage:
+##   nim c -d:release --threads:on -r benchmarks/bench_parallel_frame.nim
+
+import std/[times, strformat, strutils, random, osproc]
+import ../src/arsenal/compression/parallel_frame
+
+const
+  Size = 256 shl 20
+  Words = ["timestamp=", "level=info ", "level=warn ", "user=", "request ",
+           "GET /api/v1/items ", "POST /api/v1/orders ", "status=200 ", "\n"]
+
+proc logLike(n: int): seq[byte] =
+  ## Compressible, log-shaped bytes with random numbers mixed in
+  var r = initRand(1)
+  result = newSeqOfCap[byte](n + 32)
+  while result.len < n:
+    for c in Words[r.rand(Words.high)]:
+      result.add byte(c)
+    for c in $r.rand(1_000_000):
+      result.add byte(c)
+  result.setLen(n)
+
+proc mbps(bytes: int, seconds: float): float =
+  float(bytes) / seconds / float(1 shl 20)
+
+echo "Block-Parallel Frame Benchmarks"
+echo "==============================="
+echo ""
+echo &"{Size shr 20} MiB of log-like text, 1 MiB blocks, {countProcessors()} processors"
+echo ""
+
+let data = logLike(Size)
+var threadCounts = @[1, 2, 4]
+if countProcessors() > 4:
+  threadCounts.add countProcessors()
+
+for codec in FrameCodec:
+  let title = &"{codec}"
+  echo title
+  echo "-".repeat(title.len)
+  echo "threads".align(8), " ", "ratio".align(7), " ", "compress MiB/s".align(15), " ",
+       "decompress MiB/s".align(17)
+  for threads in threadCounts:
+    var start = epochTime()
+    let frame = compressFrame(data, codec, level = 3, threads = threads)
+    let cRate = mbps(data.len, epochTime() - start)
+    start = epochTime()
+    let restored = decompressFrame(frame, threads = threads)
+    let dRate = mbps(data.len, epochTime() - start)
+    doAssert restored == data
+    let ratio = float(data.len) / float(frame.len)
+    echo &"{threads:>8} {ratio:7.2f} {cRate:15.0f} {dRate:17.0f}"
+  echo ""
+
+const title = "Random access (Zstd, 4 KiB reads)"
+echo title
+echo "-".repeat(title.len)
+block:
+  let frame = compressFrame(data, fcZstd, level = 3)
+  let index = readFrameIndex(frame)
+  var r = initRand(2)
+  const reads = 200
+  var sink = 0
+  let start = epochTime()
+  for _ in 0 ..< reads:
+    sink += readRange(frame, index, r.rand(data.len - 4096), 4096).len
+  let perRead = (epochTime() - start) / float(reads) * 1e6
+  echo &"  {perRead:.0f} us per read ({index.blocks.len} blocks, one decoded per read)"
+  echo &"  (checksum {sink})"
+echo ""
+
+echo "Expected: throughput grows close to linearly with threads until memory"
+echo "bandwidth is reached; a random read costs about one block's decode."
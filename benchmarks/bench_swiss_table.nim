@@ -1,8 +1,10 @@
 ## Benchmarks for Swiss Table Hash Map
 ## =====================================
 
-import std/[times, strformat, random, hashes, sugar, algorithm]
+import std/[times, strformat, random, hashes, sugar, algorithm, tables, os]
 import ../src/arsenal/datastructures/hashtables/swiss_table
+import ../src/arsenal/datastructures/hashtables/flat_swiss_table
+import ../src/arsenal/platform/config
 
 proc benchmark(name: string, iterations: int, fn: proc()) =
   ## Run a benchmark and print results
@@ -131,6 +133,48 @@ benchmark "String lookup (1,000 items)", 100000:
 
 echo ""
 
+# Lookup-heavy comparison against std/tables
+echo "Lookup-Heavy Workload vs std/tables (group matching: " & $CompiledVectorIsa & "):"
+echo "--------------------------------------------------------------------"
+
+proc compareLookups(label: string, n: int, hitRatio: float) =
+  ## Same keys, same probe sequence, precomputed so only lookups are timed.
+  const Lookups = 5_000_000
+  var swiss = SwissTable[int, int].init()
+  var stdTable = initTable[int, int]()
+  var r = initRand(7)
+  var keys = newSeq[int](n)
+  for i in 0..<n:
+    keys[i] = r.rand(high(int32))
+    swiss[keys[i]] = i
+    stdTable[keys[i]] = i
+  var probes = newSeq[int](Lookups)
+  for i in 0..<Lookups:
+    probes[i] = if r.rand(1.0) < hitRatio: keys[r.rand(n - 1)] else: -1 - r.rand(high(int32))
+
+  var found = 0
+  var start = cpuTime()
+  for k in probes:
+    if swiss.contains(k): inc found
+  let swissTime = cpuTime() - start
+
+  start = cpuTime()
+  for k in probes:
+    if stdTable.hasKey(k): inc found
+  let stdTime = cpuTime() - start
+
+  let swissNs = swissTime * 1e9 / float(Lookups)
+  let stdNs = stdTime * 1e9 / float(Lookups)
+  echo &"{label:40} swiss {swissNs:6.2f} ns  std/tables {stdNs:6.2f} ns  speedup {stdNs / swissNs:5.2f}x  [{found and 1}]"
+
+compareLookups("1K keys, 100% hit", 1_000, 1.0)
+compareLookups("100K keys, 100% hit", 100_000, 1.0)
+compareLookups("1M keys, 100% hit", 1_000_000, 1.0)
+compareLookups("1M keys, 50% hit", 1_000_000, 0.5)
+compareLookups("1M keys, 0% hit", 1_000_000, 0.0)
+
+echo ""
+
 # Update Benchmarks
 echo "Update Performance:"
 echo "-------------------"
@@ -270,6 +314,77 @@ benchmark "Insert to 87.5% load (capacity 1024)", 1000:
 
 echo ""
 
+# Split Layout & Persistence
+echo "Split Key/Value Layout (1M keys, 64-byte values, 50% misses):"
+echo "--------------------------------------------------------------"
+
+type Payload = array[64, byte]
+const FlatN = 1_000_000
+
+var interleaved = SwissTable[uint64, Payload].init()
+var splitTable = FlatSwissTable[uint64, Payload].init()
+var keySet = FlatSwissSet[uint64].init()
+for i in 0'u64 ..< FlatN.uint64:
+  let k = i * 2  # even keys present, odd keys miss
+  interleaved[k] = default(Payload)
+  splitTable[k] = default(Payload)
+  keySet.incl k
+
+randomize(7)
+var membershipProbes = newSeq[uint64](FlatN)
+for i in 0 ..< FlatN:
+  membershipProbes[i] = uint64(rand(2 * FlatN - 1))
+var membershipHits = 0
+
+benchmark "contains x1M: SwissTable (keys + values in slots)", 5:
+  for k in membershipProbes:
+    if interleaved.contains(k): inc membershipHits
+
+benchmark "contains x1M: FlatSwissTable (separate key array)", 5:
+  for k in membershipProbes:
+    if splitTable.contains(k): inc membershipHits
+
+benchmark "contains x1M: FlatSwissSet (keys only)", 5:
+  for k in membershipProbes:
+    if keySet.contains(k): inc membershipHits
+
+echo ""
+echo "Startup: rebuild by reinsertion vs mmap load:"
+
+let flatPath = getTempDir() / "bench_flat_swiss_table.flat"
+var start = epochTime()
+var rebuilt = FlatSwissTable[uint64, Payload].init()
+for k in splitTable.keys:
+  rebuilt[k] = default(Payload)
+let rebuildMs = (epochTime() - start) * 1000.0
+rebuilt.destroy()
+
+start = epochTime()
+splitTable.save(flatPath)
+let saveMs = (epochTime() - start) * 1000.0
+
+start = epochTime()
+var loaded = FlatSwissTable[uint64, Payload].load(flatPath)
+let loadMs = (epochTime() - start) * 1000.0
+
+start = epochTime()
+for k in membershipProbes:
+  if loaded.contains(k): inc membershipHits
+let firstPassMs = (epochTime() - start) * 1000.0
+
+echo &"  Rebuild {FlatN} entries by insertion:      {rebuildMs:10.2f} ms"
+echo &"  save() ({getFileSize(flatPath) div (1024 * 1024)} MB):                   {saveMs:10.2f} ms"
+echo &"  load() (mmap):                          {loadMs:10.2f} ms"
+echo &"  First 1M lookups on the mapping:        {firstPassMs:10.2f} ms  (page faults included)"
+
+loaded.destroy()
+removeFile(flatPath)
+interleaved.destroy()
+splitTable.destroy()
+keySet.destroy()
+
+echo ""
+
 # Memory Overhead
 echo "Memory Characteristics:"
 echo "-----------------------"
@@ -335,11 +450,10 @@ echo "  - Per-entry overhead: ~17 bytes (1 ctrl + 16 key+value)"
 echo "  - For int->int: 17 bytes vs 16 bytes payload = 106% overhead"
 echo "  - Better for larger values (less relative overhead)"
 echo ""
-echo "SIMD Potential:"
-echo "  - Control byte groups enable SSE2/AVX2 matching"
-echo "  - Can check 16 slots in parallel"
-echo "  - Current implementation: scalar (portable)"
-echo "  - SIMD version: 2-3x faster lookups possible"
+echo "SIMD Group Matching:"
+echo "  - SSE2 (x86_64) / NEON (ARM64): 16 control bytes per compare"
+echo "  - SWAR fallback: 8 control bytes per 64-bit word"
+echo "  - This build: " & $CompiledVectorIsa
 echo ""
 echo "Comparison to std/tables:"
 echo "  - Swiss Table: Better cache locality, SIMD-ready"
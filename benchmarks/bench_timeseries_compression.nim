@@ -10,6 +10,7 @@
 ## These techniques provide massive speedups for specific data types.
 
 import std/[times, strformat, random, math, sequtils, strutils, sugar, algorithm]
+import ../src/arsenal/timeseries/gorilla
 
 echo ""
 echo repeat("=", 80)
@@ -85,18 +86,44 @@ echo "  ✓ Streaming (can compress as data arrives)"
 echo "  ✓ Tunable (loss of precision for more compression)"
 echo ""
 
-echo "API (simulated):"
-echo ""
-echo "  # Compress time-series"
-echo "  var encoder = initGorillaEncoder()"
-echo "  for (timestamp, value) in metrics:"
-echo "    encoder.add(timestamp, value)"
-echo "  let compressed = encoder.finish()"
-echo ""
-echo "  # Decompress"
-echo "  var decoder = initGorillaDecoder(compressed)"
-echo "  while decoder.hasMore():"
-echo "    let (ts, val) = decoder.next()"
+echo "Measured (arsenal/timeseries/gorilla):"
+echo ""
+block:
+  const points = 2_000_000
+  var r = initRand(42)
+  var stamps = newSeq[int64](points)
+  var values = newSeq[float64](points)
+  var t = 1_700_000_000'i64
+  var v = 20.0
+  for i in 0 ..< points:
+    t += (if r.rand(99) < 95: 10 else: 10 + r.rand(-3..3))   # Mostly regular
+    if r.rand(99) < 40:                                     # 60% repeats
+      v = round((v + r.gauss(0.0, 0.5)) * 100.0) / 100.0
+    stamps[i] = t
+    values[i] = v
+
+  var start = cpuTime()
+  var encoder = newGorillaEncoder()
+  for i in 0 ..< points:
+    encoder.encode(stamps[i], values[i])
+  let compressed = encoder.finish()
+  let encodeRate = float(points) / (cpuTime() - start) / 1e6
+
+  start = cpuTime()
+  var decoder = newGorillaDecoder(compressed)
+  var sink = 0.0
+  for i in 0 ..< points:
+    let (ts, val) = decoder.decode()
+    doAssert ts == stamps[i]
+    sink += val
+  let decodeRate = float(points) / (cpuTime() - start) / 1e6
+
+  echo &"  Points:        {points}"
+  echo &"  Bits/point:    {bitsPerPoint(compressed.len, points):.2f}"
+  echo &"  Ratio:         {compressionRatio(points * 16, compressed.len):.1f}x"
+  echo &"  Encode:        {encodeRate:.1f} M points/sec"
+  echo &"  Decode:        {decodeRate:.1f} M points/sec"
+  echo &"  (checksum {sink:.1f})"
 echo ""
 
 # ============================================================================
@@ -0,0 +1,148 @@
+## Benchmarks for the Time Series Store
+## ====================================
+##
+## Append throughput (per point and batched per series), bytes per point
+## on disk, range query latency and scan rate, the time to reopen a store,
+## and aggregation from chunk summaries or single-pass decoding against
+## decoding to points first, on metrics-like data: many series sampled
+## every 10 seconds.
+##
+## Usage:
+##   nim c -d:release -r benchmarks/bench_timeseries_store.nim
+
+import std/[times, strformat, strutils, random, os, math]
+import ../src/arsenal/timeseries/store
+
+const
+  Series = 10_000
+  PointsPerSeries = 720                  # Two hours at 10 s
+  Step = 10'i64
+  Window = 3600'i64
+  Queries = 20_000
+
+proc sample(r: var Rand, series, i: int): float64 =
+  ## Gauge-like values: a slow wave plus noise, two decimals
+  round((50.0 + 20.0 * sin(float64(i) / 60.0 + float64(series)) +
+         r.rand(1.0)) * 100) / 100
+
+proc dirSize(dir: string): int =
+  for _, path in walkDir(dir):
+    result += int(getFileSize(path))
+
+proc section(title: string) =
+  echo title
+  echo "-".repeat(title.len)
+
+echo "Time Series Store Benchmarks"
+echo "============================"
+echo ""
+echo &"{Series} series x {PointsPerSeries} points, every {Step} s, {Window} s chunks"
+echo ""
+
+let total = Series * PointsPerSeries
+let dir = getTempDir() / "arsenal_bench_tsdb"
+
+section("Appends")
+block:
+  # Interleaved: one point for every series per timestamp, as scraped
+  removeDir(dir)
+  var r = initRand(1)
+  var db = TimeSeriesStore.init(dir, window = Window)
+  var start = epochTime()
+  for i in 0 ..< PointsPerSeries:
+    let t = int64(i) * Step
+    for s in 0 ..< Series:
+      db.append(uint64(s), t, r.sample(s, i))
+  let appendRate = float(total) / (epochTime() - start) / 1e6
+  start = epochTime()
+  db.close()
+  let closeMs = (epochTime() - start) * 1000
+  let bits = float(dirSize(dir) * 8) / float(total)
+  echo &"  interleaved   {appendRate:6.2f} M points/s"
+  echo &"  close         {closeMs:6.0f} ms (seal and write open chunks)"
+  echo &"  on disk       {bits:6.2f} bits/point including index"
+
+block:
+  # Batched: each series' points at once (one index lookup per batch)
+  removeDir(dir & "_batch")
+  var r = initRand(1)
+  var db = TimeSeriesStore.init(dir & "_batch", window = Window)
+  var batch = newSeq[(int64, float64)](PointsPerSeries)
+  var elapsed = 0.0
+  for s in 0 ..< Series:
+    for i in 0 ..< PointsPerSeries:
+      batch[i] = (int64(i) * Step, r.sample(s, i))
+    let start = epochTime()
+    db.append(uint64(s), batch)
+    elapsed += epochTime() - start
+  echo &"  batched       {float(total) / elapsed / 1e6:6.2f} M points/s"
+  db.close()
+  removeDir(dir & "_batch")
+echo ""
+
+section("Queries (reopened store, all chunks mapped)")
+block:
+  var start = epochTime()
+  var db = TimeSeriesStore.init(dir, window = Window)
+  let openMs = (epochTime() - start) * 1000
+  echo &"  reopen        {openMs:6.0f} ms ({db.chunkCount} chunks indexed)"
+
+  var r = initRand(2)
+  let span = int64(PointsPerSeries) * Step
+  var returned = 0
+  start = epochTime()
+  for _ in 0 ..< Queries:
+    let a = int64(r.rand(int(span - 600)))
+    returned += db.query(uint64(r.rand(Series - 1)), a, a + 600).len
+  let perQuery = (epochTime() - start) / float(Queries) * 1e6
+  echo &"  10 min range  {perQuery:6.2f} us/query ({returned div Queries} points each)"
+
+  var scanned = 0
+  var sink = 0.0
+  start = epochTime()
+  for s in 0 ..< Series:
+    for point in db.points(uint64(s), low(int64), high(int64)):
+      sink += point[1]
+      inc scanned
+  let scanRate = float(scanned) / (epochTime() - start) / 1e6
+  echo &"  full scan     {scanRate:6.2f} M points/s (checksum {sink:.0f})"
+  echo ""
+
+  section("Aggregation")
+  # Whole series: every chunk lies in the range, so only summaries merge
+  sink = 0.0
+  start = epochTime()
+  for s in 0 ..< Series:
+    sink += db.summarize(uint64(s), low(int64), high(int64)).mean
+  var mps = float(total) / (epochTime() - start) / 1e6
+  echo &"  whole series  {mps:9.1f} M points/s (chunk summaries only)"
+
+  # Ten-minute buckets cut every chunk: decode and reduce in one pass
+  let grid = BucketGrid.init(0, span - 1, int(span div 600))
+  start = epochTime()
+  for s in 0 ..< Series:
+    for bucket in db.downsample(uint64(s), grid):
+      sink += bucket.max
+  mps = float(total) / (epochTime() - start) / 1e6
+  echo &"  10 min bins   {mps:9.1f} M points/s (every chunk decoded)"
+
+  # The same through a full decode to points, then a scan
+  start = epochTime()
+  for s in 0 ..< Series:
+    var hi = newSeq[float64](grid.buckets)
+    for (t, v) in db.query(uint64(s), 0, span - 1):
+      let b = grid.bucketOf(t)
+      hi[b] = max(hi[b], v)
+    sink += hi[0]
+  mps = float(total) / (epochTime() - start) / 1e6
+  echo &"  via query     {mps:9.1f} M points/s (decode to a seq, then scan)"
+  echo &"  (checksum {sink:.0f})"
+  db.close()
+removeDir(dir)
+echo ""
+
+echo "Expected: appends at several million points/s per core (one hash"
+echo "lookup and a Gorilla encode per point, more when batched), about"
+echo "1.5-2 bytes per point on disk, range queries that touch one or two"
+echo "chunks, and aggregation well ahead of decoding to points first (by"
+echo "orders of magnitude where chunk summaries suffice)."
@@ -0,0 +1,135 @@
+## Cache Trace Replay
+## ==================
+##
+## Replays a cache trace through S3-FIFO and the LRU / CLOCK / W-TinyLFU
+## baselines over a sweep of cache sizes and prints the miss-ratio curve
+## and replay throughput per policy. Capacity points run in parallel.
+##
+## Usage:
+## ```bash
+## nim c -d:release --threads:on examples/cache_trace_replay.nim
+## ./cache_trace_replay trace.csv
+## ./cache_trace_replay cdn.oracleGeneral --points:12 --threads:8
+## ./cache_trace_replay ids.bin --format:binary --capacities:1000,10000,100000
+## ./cache_trace_replay --zipf:0.9 --requests:5000000 --universe:1000000
+## ```
+##
+## Options:
+## - `--format:auto|csv|binary|oracle`  trace format (default: by extension)
+## - `--policies:s3fifo,lru,clock,tinylfu`
+## - `--capacities:N,N,...`  explicit sizes in objects, or
+## - `--points:N --lo:F --hi:F`  N sizes from F of the working set (0.001-0.5)
+## - `--threads:N`  worker threads (default: one per CPU)
+## - `--zipf:ALPHA --requests:N --universe:N`  synthetic trace instead of a file
+
+import std/[parseopt, strutils, strformat, times]
+import ../src/arsenal/caching/simulation
+
+proc usage() =
+  echo "usage: cache_trace_replay <trace> [--format:auto|csv|binary|oracle]"
+  echo "         [--policies:s3fifo,lru,clock,tinylfu] [--capacities:N,...]"
+  echo "         [--points:N] [--lo:F] [--hi:F] [--threads:N]"
+  echo "       cache_trace_replay --zipf:ALPHA [--requests:N] [--universe:N] ..."
+  quit(1)
+
+proc parsePolicy(s: string): Policy =
+  case s.toLowerAscii
+  of "s3fifo", "s3-fifo": pS3FIFO
+  of "lru": pLRU
+  of "clock": pCLOCK
+  of "tinylfu", "w-tinylfu", "wtinylfu": pTinyLFU
+  else:
+    quit("unknown policy: " & s, 1)
+
+proc main() =
+  var path = ""
+  var format = tfAuto
+  var policies = @[pS3FIFO, pLRU, pCLOCK, pTinyLFU]
+  var capacities: seq[int]
+  var points = 8
+  var lo = 0.001
+  var hi = 0.5
+  var threads = 0
+  var zipf = 0.0
+  var requests = 1_000_000
+  var universe = 100_000
+
+  for kind, key, val in getopt():
+    case kind
+    of cmdArgument:
+      path = key
+    of cmdLongOption, cmdShortOption:
+      case key
+      of "format":
+        format = case val
+          of "csv": tfCsv
+          of "binary", "bin": tfBinary
+          of "oracle", "oracleGeneral": tfOracleGeneral
+          else: tfAuto
+      of "policies":
+        policies = @[]
+        for p in val.split(','):
+          policies.add parsePolicy(p.strip())
+      of "capacities":
+        for c in val.split(','):
+          capacities.add parseInt(c.strip())
+      of "points": points = parseInt(val)
+      of "lo": lo = parseFloat(val)
+      of "hi": hi = parseFloat(val)
+      of "threads": threads = parseInt(val)
+      of "zipf": zipf = parseFloat(val)
+      of "requests": requests = parseInt(val)
+      of "universe": universe = parseInt(val)
+      of "help", "h": usage()
+      else:
+        echo "unknown option: ", key
+        usage()
+    of cmdEnd:
+      discard
+
+  if path.len == 0 and zipf <= 0.0:
+    usage()
+
+  let loadStart = epochTime()
+  let trace =
+    if zipf > 0.0: zipfTrace(requests, universe, zipf)
+    else: loadTrace(path, format)
+  let source = if zipf > 0.0: &"zipf({zipf}) over {universe} ids" else: path
+  echo &"Trace: {source}"
+  echo &"  {trace.keys.len} requests, {trace.uniqueKeys} unique objects " &
+       &"(loaded in {epochTime() - loadStart:.2f} s)"
+  if trace.keys.len == 0:
+    quit("empty trace", 1)
+
+  if capacities.len == 0:
+    capacities = capacityPoints(trace.uniqueKeys, points, lo, hi)
+
+  let start = epochTime()
+  let results = sweep(trace.keys, policies, capacities, threads)
+  let elapsed = epochTime() - start
+
+  echo ""
+  echo "Miss ratio"
+  echo "----------"
+  stdout.write formatCurve(results)
+
+  echo ""
+  echo "Replay throughput (Mops/sec, single thread per point)"
+  echo "-----------------------------------------------------"
+  stdout.write "capacity".align(12)
+  for p in policies:
+    stdout.write ($p).align(12)
+  echo ""
+  for c in capacities:
+    stdout.write ($c).align(12)
+    for p in policies:
+      for r in results:
+        if r.policy == p and r.capacity == c:
+          stdout.write formatFloat(r.opsPerSec / 1e6, ffDecimal, 2).align(12)
+    echo ""
+
+  echo ""
+  echo &"{results.len} points in {elapsed:.2f} s"
+
+when isMainModule:
+  main()
@@ -5,7 +5,7 @@
 ## high-performance systems programming in Nim.
 ##
 ## Core Modules:
-## - `arsenal/platform` - CPU detection, platform constants, optimization strategies
+## - `arsenal/platform` - CPU detection, NUMA topology, optimization strategies
 ## - `arsenal/concurrency` - Coroutines, channels, lock-free structures
 ## - `arsenal/memory` - Allocators, SIMD memory ops
 ## - `arsenal/hashing` - High-performance hash functions
@@ -30,6 +30,7 @@
 # Platform
 import arsenal/platform/config
 import arsenal/platform/strategies
+import arsenal/platform/numa
 
 # Concurrency
 import arsenal/concurrency/atomics/atomic
@@ -48,6 +49,8 @@ import arsenal/hashing/hasher
 
 # Data Structures
 import arsenal/datastructures/hashtables/swiss_table
+import arsenal/datastructures/hashtables/concurrent_swiss_table
+import arsenal/datastructures/hashtables/flat_swiss_table
 
 # Utilities
 import arsenal/bits/bitops
@@ -94,12 +97,12 @@ when defined(embedded) or defined(bare_metal):
   import arsenal/embedded/hal
 
 # Export all public APIs
-export config, strategies
+export config, strategies, numa
 export atomic, spinlock, spsc, mpmc
 export coroutine, channel, go_macro
 export allocator
 export hasher
-export swiss_table
+export swiss_table, concurrent_swiss_table, flat_swiss_table
 export bitops
 export compressor
 export parser
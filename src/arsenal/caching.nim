@@ -23,12 +23,22 @@
 ##
 ## # Check statistics
 ## echo cache.hitRate()
+##
+## # Byte budget with per-entry expiry
+## var blobs = Cache[string, string].new(capacity = 100_000)
+##   .withMaxWeight(64 shl 20, proc (k, v: string): int = k.len + v.len)
+##   .withExpireAfterWrite(initDuration(minutes = 5))
+##   .build()
+## blobs.put("session", "token", ttl = initDuration(seconds = 30))
 ## ```
+##
+## `Cache` is single-threaded. For a cache shared between threads use
+## `ConcurrentS3FIFOCache` (re-exported here): hits take no lock.
 
-import arsenal/caching/s3fifo
-import std/options
+import arsenal/caching/[s3fifo, concurrent_s3fifo]
+import std/[options, times]
 
-export s3fifo, options  # Re-export for direct use
+export s3fifo, concurrent_s3fifo, options  # Re-export for direct use
 
 # =============================================================================
 # CACHE - Unified API for caching with eviction
@@ -49,6 +59,10 @@ type
   CacheBuilder*[K, V] = object
     capacity: int
     smallRatio: float64
+    maxWeight: int
+    weigher: Weigher[K, V]
+    expireAfterWrite: Duration
+    refreshAfterWrite: Duration
 
 # Constructors
 proc new*[K, V](_: typedesc[Cache[K, V]], capacity: int): CacheBuilder[K, V] =
@@ -73,9 +87,35 @@ proc withSmallRatio*[K, V](builder: CacheBuilder[K, V],
   result = builder
   result.smallRatio = ratio
 
+proc withMaxWeight*[K, V](builder: CacheBuilder[K, V], maxWeight: int,
+                          weigher: Weigher[K, V]): CacheBuilder[K, V] =
+  ## Bound the cache by total weight (e.g. bytes) instead of entry count
+  ##
+  ## `capacity` still caps the number of entries
+  result = builder
+  result.maxWeight = maxWeight
+  result.weigher = weigher
+
+proc withExpireAfterWrite*[K, V](builder: CacheBuilder[K, V],
+                                 ttl: Duration): CacheBuilder[K, V] =
+  ## Expire entries `ttl` after they were last written
+  result = builder
+  result.expireAfterWrite = ttl
+
+proc withRefreshAfterWrite*[K, V](builder: CacheBuilder[K, V],
+                                  age: Duration): CacheBuilder[K, V] =
+  ## Reload entries older than `age` on access through `getOrLoad`
+  result = builder
+  result.refreshAfterWrite = age
+
 proc build*[K, V](builder: CacheBuilder[K, V]): Cache[K, V] =
   ## Build cache from builder
-  Cache[K, V](impl: initS3FIFOCache[K, V](builder.capacity))
+  Cache[K, V](impl: initS3FIFOCache[K, V](builder.capacity,
+    maxWeight = builder.maxWeight,
+    weigher = builder.weigher,
+    smallRatio = builder.smallRatio,
+    expireAfterWrite = builder.expireAfterWrite,
+    refreshAfterWrite = builder.refreshAfterWrite))
 
 proc init*[K, V](_: typedesc[Cache[K, V]], capacity: int): Cache[K, V] {.inline.} =
   ## Direct construction (no builder)
@@ -97,6 +137,11 @@ proc put*[K, V](cache: var Cache[K, V], key: K, value: V) {.inline.} =
   ## If cache is full, least useful entry is evicted
   cache.impl.put(key, value)
 
+proc put*[K, V](cache: var Cache[K, V], key: K, value: V,
+                ttl: Duration) {.inline.} =
+  ## Insert or update entry, expiring it after `ttl`
+  cache.impl.put(key, value, ttl)
+
 proc set*[K, V](cache: var Cache[K, V], key: K, value: V) {.inline.} =
   ## Alias for put()
   cache.put(key, value)
@@ -121,6 +166,10 @@ proc clear*[K, V](cache: var Cache[K, V]) {.inline.} =
   ## Remove all entries
   cache.impl.clear()
 
+proc cleanUp*[K, V](cache: var Cache[K, V]) {.inline.} =
+  ## Drop expired entries now
+  cache.impl.cleanUp()
+
 # Query operations
 proc get*[K, V](cache: var Cache[K, V], key: K): Option[V] {.inline.} =
   ## Get value for key
@@ -140,6 +189,13 @@ proc getOrDefault*[K, V](cache: var Cache[K, V], key: K, default: V): V =
   let opt = cache.get(key)
   if opt.isSome: opt.get() else: default
 
+proc getOrLoad*[K, V](cache: var Cache[K, V], key: K,
+                      loader: proc (key: K): V): V {.inline.} =
+  ## Get value, loading and caching it on a miss
+  ##
+  ## Also reloads entries older than the refresh-after-write age
+  cache.impl.getOrLoad(key, loader)
+
 proc contains*[K, V](cache: var Cache[K, V], key: K): bool {.inline.} =
   ## Test if key exists in cache
   ##
@@ -163,6 +219,14 @@ proc capacity*[K, V](cache: Cache[K, V]): int {.inline.} =
   ## Maximum capacity
   cache.impl.capacity()
 
+proc weight*[K, V](cache: Cache[K, V]): int {.inline.} =
+  ## Total weight of cached entries (entry count if unweighted)
+  cache.impl.weight()
+
+proc maxWeight*[K, V](cache: Cache[K, V]): int {.inline.} =
+  ## Weight budget (capacity if unweighted)
+  cache.impl.maxWeight
+
 proc isEmpty*[K, V](cache: Cache[K, V]): bool {.inline.} =
   ## Check if cache is empty
   cache.len() == 0
@@ -0,0 +1,519 @@
+## Concurrent S3-FIFO Cache
+## ========================
+##
+## Thread-safe S3-FIFO cache whose hits take no lock.
+##
+## In S3-FIFO a hit only raises the entry's 2-bit frequency counter; all
+## queue movement happens when a new key is inserted. This cache keeps
+## that split:
+## - `get` is a seqlock read (as in `ConcurrentSwissTable`): it probes the
+##   shard's index, copies the value out, re-checks the shard version and
+##   then raises the counter with one compare-and-swap. Counters that are
+##   already saturated (hot keys) are not written at all, so read-heavy
+##   workloads do not bounce cache lines between cores.
+## - `put` and `remove` lock one shard. An insert into a full shard runs
+##   the S3-FIFO eviction for that shard only.
+##
+## Keys are spread over shards by hash. Each shard is an independent
+## S3-FIFO cache of `capacity / shards` entries with its own small, main
+## and ghost queues. Entries live in a slot array allocated once by
+## `init`, and the queues are fixed-size rings of slot indices, so a
+## running cache allocates nothing (beyond copies of GC'd keys/values).
+##
+## Eviction work per insert is bounded: the main queue is scanned at most
+## once, decrementing counters, before its head is evicted regardless.
+##
+## Optimistic reads require keys and values without GC'd memory
+## (`supportsCopyMem`). For `string` or `seq` keys/values, `get` takes the
+## shard lock instead, which is still contention-free across shards.
+##
+## Usage:
+## ```nim
+## var sessions = ConcurrentS3FIFOCache[uint64, Session].init(100_000)
+##
+## # Any thread:
+## sessions.put(id, session)
+## let s = sessions.get(id)        # lock-free on plain types, returns a copy
+##
+## # Once all worker threads have stopped:
+## sessions.destroy()
+## ```
+##
+## Reference: Yang et al., "FIFO queues are all you need for cache
+## eviction" (SOSP 2023), section 4.2 on scalability
+
+import std/[options, math, osproc]
+import ../datastructures/hashtables/swiss_table
+import ../concurrency/atomics/atomic
+import ../concurrency/sync/spinlock
+import ../platform/config
+
+const
+  CacheLineSize = DefaultCacheLineSize
+  SmallQueueRatio = 0.1      ## Small queue uses 10% of each shard
+  MaxFrequency = 3'u8        ## 2-bit access counter
+  MinShardCapacity* = 16     ## Fewer entries per shard are all overhead
+  MaxShards = 4096
+  ShardHashShift = 48        ## Shard index comes from hash bits 48..59
+
+type
+  SlotState = enum
+    ssFree       ## On the free ring
+    ssSmall      ## Live, queued in the small ring
+    ssMain       ## Live, queued in the main ring
+    ssRemoved    ## Removed by `remove`; freed when eviction reaches it
+
+  Slot[K, V] = object
+    key: K
+    value: V
+    hash: uint64
+    freq: Atomic[uint8]        ## Raised by readers without the lock
+    state: SlotState           ## Only touched under the shard lock
+
+  Ring[T] = object
+    ## Fixed-size FIFO. Only used under the shard lock.
+    buf: ptr UncheckedArray[T]
+    head, len, cap: int
+
+  Shard[K, V] = object
+    version: Atomic[uint64]    ## Seqlock counter, odd during a write
+    lock: Spinlock             ## Held by writers of this shard
+    index: SwissTable[K, int32]          ## Key -> slot, never reallocated
+    slots: ptr UncheckedArray[Slot[K, V]]
+    free, small, main: Ring[int32]
+    ghost: Ring[uint64]                  ## Hashes of keys evicted from small
+    ghostIndex: SwissTable[uint64, int]  ## Hash -> ghost sequence number
+    ghostSeq: int                        ## Sequence number of the next ghost
+    capacity, smallCapacity: int
+    hits, misses: Atomic[int]
+    pad: array[CacheLineSize, byte]      ## Keep shards on separate cache lines
+
+  ConcurrentS3FIFOCache*[K, V] = object
+    ## Sharded S3-FIFO cache with lock-free hits and per-shard write locks.
+    ##
+    ## Share it between threads as a global or through a pointer; do not
+    ## copy it. Call `destroy` once no thread uses it any more.
+    shards: ptr UncheckedArray[Shard[K, V]]
+    shardMask: int
+    capacity: int
+    stats: bool
+
+# =============================================================================
+# Rings
+# =============================================================================
+
+proc initRing[T](cap: int): Ring[T] =
+  result.buf = cast[ptr UncheckedArray[T]](allocShared0(max(1, cap) * sizeof(T)))
+  result.cap = cap
+
+proc freeRing[T](r: var Ring[T]) =
+  if r.buf != nil:
+    deallocShared(r.buf)
+    r.buf = nil
+
+proc push[T](r: var Ring[T], x: T) {.inline.} =
+  assert r.len < r.cap
+  r.buf[(r.head + r.len) mod r.cap] = x
+  inc r.len
+
+proc pop[T](r: var Ring[T]): T {.inline.} =
+  assert r.len > 0
+  result = r.buf[r.head]
+  r.head = (r.head + 1) mod r.cap
+  dec r.len
+
+proc clear[T](r: var Ring[T]) {.inline.} =
+  r.head = 0
+  r.len = 0
+
+# =============================================================================
+# Shard Helpers
+# =============================================================================
+
+proc shardOf[K, V](c: ConcurrentS3FIFOCache[K, V], h: uint64): ptr Shard[K, V] {.inline.} =
+  addr c.shards[int(h shr ShardHashShift) and c.shardMask]
+
+proc beginWrite[K, V](s: ptr Shard[K, V]) {.inline.} =
+  ## Make the version odd before touching index or slots (caller holds the lock).
+  s.version.store(s.version.load(Relaxed) + 1, Relaxed)
+  atomicThreadFence(Release)
+
+proc endWrite[K, V](s: ptr Shard[K, V]) {.inline.} =
+  ## Make the version even again, publishing the write.
+  s.version.store(s.version.load(Relaxed) + 1, Release)
+
+proc touch(freq: var Atomic[uint8]) {.inline.} =
+  ## Saturating increment. One CAS attempt: if it fails, another thread
+  ## just raised the same counter, which is all a hit needs.
+  var cur = freq.load(Relaxed)
+  if cur < MaxFrequency:
+    discard freq.compareExchange(cur, cur + 1, Relaxed, Relaxed)
+
+proc initShard[K, V](s: ptr Shard[K, V], capacity: int) =
+  s.lock = Spinlock.init()
+  s.capacity = capacity
+  s.smallCapacity = max(1, int(capacity.float64 * SmallQueueRatio))
+  s.slots = cast[ptr UncheckedArray[Slot[K, V]]](
+    allocShared0(capacity * sizeof(Slot[K, V])))
+  s.free = initRing[int32](capacity)
+  s.small = initRing[int32](capacity)
+  s.main = initRing[int32](capacity)
+  for i in 0 ..< capacity:
+    s.free.push(int32(i))
+  # Twice the live entries: deletes then always clean tombstones in place
+  # instead of reallocating under optimistic readers.
+  s.index = SwissTable[K, int32].init()
+  s.index.reserve(2 * capacity)
+  let ghostCap = capacity - s.smallCapacity
+  s.ghost = initRing[uint64](ghostCap)
+  s.ghostIndex = SwissTable[uint64, int].init()
+  s.ghostIndex.reserve(2 * ghostCap)
+
+proc resetSlots[K, V](s: ptr Shard[K, V]) =
+  ## Drop GC'd keys and values held by the slots.
+  when not supportsCopyMem(K) or not supportsCopyMem(V):
+    for i in 0 ..< s.capacity:
+      reset(s.slots[i].key)
+      reset(s.slots[i].value)
+
+proc unlink[K, V](s: ptr Shard[K, V], slot: int32) =
+  ## Remove a live slot's key from the index (caller holds the lock).
+  s.beginWrite()
+  discard s.index.delete(s.slots[slot].key, s.slots[slot].hash)
+  when not supportsCopyMem(K) or not supportsCopyMem(V):
+    reset(s.slots[slot].key)
+    reset(s.slots[slot].value)
+  s.endWrite()
+
+proc release[K, V](s: ptr Shard[K, V], slot: int32) {.inline.} =
+  s.slots[slot].state = ssFree
+  s.free.push(slot)
+
+# =============================================================================
+# Ghost Queue
+# =============================================================================
+
+proc ghostAdd[K, V](s: ptr Shard[K, V], h: uint64) =
+  ## Remember the hash of a key evicted from the small queue.
+  if s.ghost.cap == 0:
+    return
+  if s.ghost.len == s.ghost.cap:
+    let old = s.ghost.pop()
+    let p = s.ghostIndex.find(old)
+    # A newer ghost of the same hash keeps its entry
+    if p.isSome and p.get[] == s.ghostSeq - s.ghost.cap:
+      discard s.ghostIndex.delete(old)
+  s.ghost.push(h)
+  s.ghostIndex[h] = s.ghostSeq
+  inc s.ghostSeq
+
+proc ghostTake[K, V](s: ptr Shard[K, V], h: uint64): bool =
+  ## True if `h` is a ghost; forgets it. Its ring entry goes stale.
+  s.ghostIndex.delete(h)
+
+# =============================================================================
+# Eviction
+# =============================================================================
+
+proc evictSmall[K, V](s: ptr Shard[K, V]) =
+  ## Pop the small queue's oldest entry: promote it to main if it was hit
+  ## since insertion (lazy promotion), otherwise evict it and remember it
+  ## as a ghost (quick demotion).
+  let slot = s.small.pop()
+  if s.slots[slot].state == ssRemoved:
+    s.release(slot)
+  elif s.slots[slot].freq.load(Relaxed) > 0:
+    s.slots[slot].freq.store(0, Relaxed)
+    s.slots[slot].state = ssMain
+    s.main.push(slot)
+  else:
+    let h = s.slots[slot].hash
+    s.unlink(slot)
+    s.release(slot)
+    s.ghostAdd(h)
+
+proc evictMain[K, V](s: ptr Shard[K, V]) =
+  ## FIFO-reinsertion: entries hit since their last pass get another
+  ## round with one less credit. At most one pass over the queue, then the
+  ## oldest entry is evicted regardless.
+  for _ in 0 ..< s.main.len:
+    let slot = s.main.pop()
+    if s.slots[slot].state == ssRemoved:
+      s.release(slot)
+      return
+    if s.slots[slot].freq.load(Relaxed) == 0:
+      s.unlink(slot)
+      s.release(slot)
+      return
+    # Only this thread lowers counters (under the lock); readers only
+    # raise them, so a non-zero counter cannot underflow here.
+    discard s.slots[slot].freq.fetchSub(1, Relaxed)
+    s.main.push(slot)
+  let slot = s.main.pop()
+  if s.slots[slot].state != ssRemoved:
+    s.unlink(slot)
+  s.release(slot)
+
+proc makeRoom[K, V](s: ptr Shard[K, V]) =
+  ## Evict until a slot is free (caller holds the lock).
+  while s.free.len == 0:
+    if s.small.len >= s.smallCapacity or s.main.len == 0:
+      s.evictSmall()
+    else:
+      s.evictMain()
+
+# =============================================================================
+# Construction
+# =============================================================================
+
+proc init*[K, V](_: typedesc[ConcurrentS3FIFOCache[K, V]], capacity: int,
+                 shards: int = 0, stats: bool = false): ConcurrentS3FIFOCache[K, V] =
+  ## Create a concurrent cache holding up to `capacity` entries.
+  ##
+  ## - `shards`: number of shards, rounded up to a power of two
+  ##   (0 = four per processor); reduced so that every shard holds at
+  ##   least `MinShardCapacity` entries
+  ## - `stats`: count hits and misses. Off by default: the counters are
+  ##   shared per shard and cost scaling on read-heavy workloads.
+  if capacity < MinShardCapacity:
+    raise newException(ValueError,
+      "Capacity must be at least " & $MinShardCapacity)
+  let wanted = if shards > 0: shards else: 4 * countProcessors()
+  var count = min(MaxShards, nextPowerOfTwo(max(1, wanted)))
+  while count > 1 and capacity div count < MinShardCapacity:
+    count = count div 2
+  result.shardMask = count - 1
+  result.capacity = capacity
+  result.stats = stats
+  result.shards = cast[ptr UncheckedArray[Shard[K, V]]](
+    allocShared0(count * sizeof(Shard[K, V])))
+  for i in 0 ..< count:
+    # Spread the remainder so the shard capacities add up to `capacity`
+    let cap = capacity div count + (if i < capacity mod count: 1 else: 0)
+    initShard(addr result.shards[i], cap)
+
+proc destroy*[K, V](c: var ConcurrentS3FIFOCache[K, V]) =
+  ## Free all memory. No other thread may use the cache any more.
+  if c.shards == nil:
+    return
+  for i in 0 .. c.shardMask:
+    let s = addr c.shards[i]
+    s.resetSlots()
+    deallocShared(s.slots)
+    s.index.destroy()
+    s.ghostIndex.destroy()
+    s.free.freeRing()
+    s.small.freeRing()
+    s.main.freeRing()
+    s.ghost.freeRing()
+  deallocShared(c.shards)
+  c.shards = nil
+  c.shardMask = 0
+
+# =============================================================================
+# Lookups (lock-free for plain keys and values)
+# =============================================================================
+
+proc lookup[K, V](c: ConcurrentS3FIFOCache[K, V], key: K, value: var V): bool =
+  ## Copy `key`'s value into `value` and count the hit. False if absent.
+  if c.shards == nil:
+    return false
+  let h = hashKey(key)
+  let s = c.shardOf(h)
+  var slot: int32
+  when supportsCopyMem(K) and supportsCopyMem(V):
+    # Seqlock read. A torn key compare or value copy is possible while a
+    # writer is active; the version check discards it and we retry.
+    while true:
+      let before = s.version.load(Acquire)
+      if (before and 1) == 0:
+        let p = s.index.find(key, h)
+        result = p.isSome
+        if result:
+          slot = p.get[]
+          value = s.slots[slot].value
+        atomicThreadFence(Acquire)
+        if s.version.load(Relaxed) == before:
+          break
+      spinHint()
+  else:
+    withLock(s.lock):
+      let p = s.index.find(key, h)
+      result = p.isSome
+      if result:
+        slot = p.get[]
+        value = s.slots[slot].value
+
+  # If a writer reused the slot since the check, this credits the new
+  # entry with one access; S3-FIFO only needs the counters approximate.
+  if result:
+    touch(s.slots[slot].freq)
+  if c.stats:
+    if result: s.hits.inc() else: s.misses.inc()
+
+proc get*[K, V](c: ConcurrentS3FIFOCache[K, V], key: K): Option[V] =
+  ## Copy of the value for `key`, or none. A hit raises the entry's
+  ## access counter; it never takes a lock for plain key/value types.
+  var value: V
+  if c.lookup(key, value):
+    some(value)
+  else:
+    none(V)
+
+proc getOrDefault*[K, V](c: ConcurrentS3FIFOCache[K, V], key: K,
+                         default: V = default(V)): V =
+  ## Value for `key`, or `default` if absent.
+  if not c.lookup(key, result):
+    result = default
+
+proc contains*[K, V](c: ConcurrentS3FIFOCache[K, V], key: K): bool =
+  ## Check if key is cached (also counts as an access).
+  var value: V
+  c.lookup(key, value)
+
+# =============================================================================
+# Writes (lock one shard)
+# =============================================================================
+
+proc put*[K, V](c: var ConcurrentS3FIFOCache[K, V], key: K, value: V) =
+  ## Insert or update an entry. Locks only `key`'s shard; a full shard
+  ## evicts one of its own entries first.
+  ##
+  ## New keys enter the small queue, or the main queue if they were
+  ## recently evicted from small (ghost hit).
+  assert c.shards != nil, "ConcurrentS3FIFOCache used before init"
+  let h = hashKey(key)
+  let s = c.shardOf(h)
+  withLock(s.lock):
+    let p = s.index.find(key, h)
+    if p.isSome:
+      let slot = p.get[]
+      s.beginWrite()
+      s.slots[slot].value = value
+      s.endWrite()
+      touch(s.slots[slot].freq)
+      return
+
+    s.makeRoom()
+    let slot = s.free.pop()
+    let wasGhost = s.ghostTake(h)
+    s.beginWrite()
+    s.slots[slot].key = key
+    s.slots[slot].value = value
+    s.slots[slot].hash = h
+    s.slots[slot].freq.store(0, Relaxed)
+    if not s.index.insertWithoutGrowth(key, slot, h):
+      s.index[key] = slot          # Cleans tombstones in place
+    s.endWrite()
+    if wasGhost:
+      s.slots[slot].state = ssMain
+      s.main.push(slot)
+    else:
+      s.slots[slot].state = ssSmall
+      s.small.push(slot)
+
+proc `[]=`*[K, V](c: var ConcurrentS3FIFOCache[K, V], key: K, value: V) {.inline.} =
+  ## Alias for `put`.
+  c.put(key, value)
+
+proc remove*[K, V](c: var ConcurrentS3FIFOCache[K, V], key: K): bool =
+  ## Remove an entry. Returns true if key was present.
+  ##
+  ## The slot stays in its queue and is reused once eviction reaches it,
+  ## so removal is O(1) and never scans a queue.
+  if c.shards == nil:
+    return false
+  let h = hashKey(key)
+  let s = c.shardOf(h)
+  withLock(s.lock):
+    let p = s.index.find(key, h)
+    if p.isNone:
+      return false
+    let slot = p.get[]
+    s.unlink(slot)
+    s.slots[slot].state = ssRemoved
+    result = true
+
+proc clear*[K, V](c: var ConcurrentS3FIFOCache[K, V]) =
+  ## Remove all entries, one shard at a time (not atomic as a whole).
+  if c.shards == nil:
+    return
+  for i in 0 .. c.shardMask:
+    let s = addr c.shards[i]
+    withLock(s.lock):
+      s.beginWrite()
+      s.index.clear()
+      s.resetSlots()
+      s.endWrite()
+      s.small.clear()
+      s.main.clear()
+      s.free.clear()
+      for j in 0 ..< s.capacity:
+        s.slots[j].state = ssFree
+        s.free.push(int32(j))
+      s.ghost.clear()
+      s.ghostIndex.clear()
+      s.ghostSeq = 0
+
+# =============================================================================
+# Statistics
+# =============================================================================
+
+proc len*[K, V](c: ConcurrentS3FIFOCache[K, V]): int =
+  ## Number of cached entries. Exact when no writer is active, otherwise
+  ## a snapshot that may be off by the writes in flight.
+  if c.shards == nil:
+    return 0
+  for i in 0 .. c.shardMask:
+    result += c.shards[i].index.len
+
+proc size*[K, V](c: ConcurrentS3FIFOCache[K, V]): int {.inline.} =
+  ## Alias for `len`.
+  c.len
+
+proc capacity*[K, V](c: ConcurrentS3FIFOCache[K, V]): int {.inline.} =
+  ## Maximum number of entries over all shards.
+  c.capacity
+
+proc shardCount*[K, V](c: ConcurrentS3FIFOCache[K, V]): int {.inline.} =
+  ## Number of shards (a power of two).
+  if c.shards == nil: 0 else: c.shardMask + 1
+
+proc hits*[K, V](c: ConcurrentS3FIFOCache[K, V]): int =
+  ## Cache hits so far (0 unless created with `stats = true`).
+  if c.shards != nil:
+    for i in 0 .. c.shardMask:
+      result += c.shards[i].hits.load(Relaxed)
+
+proc misses*[K, V](c: ConcurrentS3FIFOCache[K, V]): int =
+  ## Cache misses so far (0 unless created with `stats = true`).
+  if c.shards != nil:
+    for i in 0 .. c.shardMask:
+      result += c.shards[i].misses.load(Relaxed)
+
+proc hitRate*[K, V](c: ConcurrentS3FIFOCache[K, V]): float64 =
+  ## Cache hit rate (hits / total lookups)
+  let h = c.hits
+  let total = h + c.misses
+  if total == 0: 0.0 else: h.float64 / total.float64
+
+proc resetStats*[K, V](c: var ConcurrentS3FIFOCache[K, V]) =
+  ## Reset hit/miss counters
+  if c.shards != nil:
+    for i in 0 .. c.shardMask:
+      c.shards[i].hits.store(0, Relaxed)
+      c.shards[i].misses.store(0, Relaxed)
+
+iterator pairs*[K, V](c: ConcurrentS3FIFOCache[K, V]): (K, V) =
+  ## Iterate over all cached entries. Each shard is copied under its lock
+  ## and yielded afterwards, so the loop body may write to the cache.
+  if c.shards != nil:
+    for i in 0 .. c.shardMask:
+      let s = addr c.shards[i]
+      var entries: seq[(K, V)]
+      withLock(s.lock):
+        for j in 0 ..< s.capacity:
+          if s.slots[j].state in {ssSmall, ssMain}:
+            entries.add (s.slots[j].key, s.slots[j].value)
+      for entry in entries:
+        yield entry
@@ -32,6 +32,29 @@
 ## - Google (production systems)
 ## - Redpanda (Kafka-compatible streaming)
 ##
+## Layout:
+## - Entries live in a slot array allocated once by `initS3FIFOCache`
+## - Small and main queues are fixed-size rings of slot indices
+## - The ghost queue is a ring of key hashes, never keys
+## - A `SwissTable` maps keys to slots
+##
+## So `get` is one table probe and `put` never allocates: an insert into a
+## full cache reuses the slot it evicts.
+##
+## Weights and expiry:
+## - With a `weigher`, the budget is `maxWeight` (e.g. bytes) rather than
+##   an entry count. `capacity` still sizes the slot array, so set it to
+##   the most entries the budget can hold.
+## - The small queue gets `smallRatio` of both budgets. Eviction runs only
+##   until the new entry fits, and a small entry that was hit is promoted
+##   to main rather than dropped, whatever its size.
+## - Entries may carry a TTL (`expireAfterWrite` or `put(key, value, ttl)`).
+##   Deadlines live in a `TimerWheel` keyed by slot, which `get`, `put` and
+##   `cleanUp` advance, so expiry never scans the cache. An expired entry
+##   gives its weight back at once.
+## - With `refreshAfterWrite`, `getOrLoad` reloads entries older than that
+##   on access and keeps serving the old value if the loader fails.
+##
 ## Usage:
 ## ```nim
 ## import arsenal/caching/s3fifo
@@ -46,20 +69,50 @@
 ## # Lookup (returns Option[V])
 ## if cache.get("key1").isSome:
 ##   echo "Found: ", cache.get("key1").get()
+##
+## # 64 MiB of blobs, each entry expiring after 5 minutes
+## var blobs = initS3FIFOCache[string, string](100_000,
+##   maxWeight = 64 shl 20,
+##   weigher = proc (k, v: string): int = k.len + v.len,
+##   expireAfterWrite = initDuration(minutes = 5))
 ## ```
 
-import std/[tables, options, deques]
+import std/[options, times]
+import ../datastructures/hashtables/swiss_table
+import ../time/timer_wheel
 
 # =============================================================================
 # Types
 # =============================================================================
 
 type
-  CacheEntry*[K, V] = ref object
-    ## Cache entry with metadata
-    key*: K
-    value*: V
-    freq*: uint8  ## Access frequency (0-3, acts as 2-bit counter)
+  Weigher*[K, V] = proc (key: K, value: V): int
+    ## Cost of an entry against `maxWeight`; must not be negative
+
+  CacheClock* = proc (): int64
+    ## Monotonic time in nanoseconds (defaults to `nowNs`)
+
+  SlotState = enum
+    ssFree       ## On the free ring
+    ssSmall      ## Live, queued in the small ring
+    ssMain       ## Live, queued in the main ring
+    ssRemoved    ## Removed or expired; freed when eviction reaches it
+
+  CacheSlot[K, V] = object
+    ## One cache entry with metadata
+    key: K
+    value: V
+    hash: uint64     ## Kept so eviction never rehashes the key
+    weight: int      ## Weigher result at insert
+    writeTime: int64 ## Clock at the last write (0 if untimed)
+    expiresAt: int64 ## Deadline in clock ns (0 = never)
+    freq: uint8      ## Access frequency (0-3, acts as 2-bit counter)
+    state: SlotState
+
+  SlotRing[T] = object
+    ## Fixed-size FIFO over a buffer allocated once
+    buf: seq[T]
+    head, len: int
 
   S3FIFOCache*[K, V] = object
     ## S3-FIFO cache
@@ -67,17 +120,31 @@ type
     ## Structure:
     ## - Small queue (S): 10% capacity, filters single-access objects
     ## - Main queue (M): 90% capacity, stores frequently accessed objects
-    ## - Ghost queue (G): Metadata only, tracks recently evicted keys
-    capacity*: int                    ## Total cache capacity
+    ## - Ghost queue (G): Hashes only, tracks keys recently evicted from S
+    ##
+    ## Owns manually managed tables, so it cannot be copied (moves are fine).
+    capacity*: int                    ## Total cache capacity (entries)
     smallCapacity*: int               ## Small queue capacity (10% of total)
     mainCapacity*: int                ## Main queue capacity (90% of total)
-
-    small*: Deque[CacheEntry[K, V]]   ## Small FIFO queue
-    main*: Deque[CacheEntry[K, V]]    ## Main FIFO queue
-    ghost*: Deque[K]                  ## Ghost queue (keys only)
-
-    index*: Table[K, CacheEntry[K, V]]  ## Fast lookup table
-    ghostSet*: Table[K, bool]           ## Ghost queue membership
+    maxWeight*: int                   ## Weight budget (= capacity if unweighted)
+    smallMaxWeight*: int              ## Small queue share of `maxWeight`
+
+    slots: seq[CacheSlot[K, V]]       ## Entry storage, `capacity` slots
+    index: SwissTable[K, int32]       ## Key -> slot
+    free: SlotRing[int32]             ## Unused slots
+    small: SlotRing[int32]            ## Small FIFO queue
+    main: SlotRing[int32]             ## Main FIFO queue
+    ghost: SlotRing[uint64]           ## Ghost queue (key hashes only)
+    ghostIndex: SwissTable[uint64, int]  ## Hash -> ghost sequence number
+    ghostSeq: int                     ## Sequence number of the next ghost
+
+    weigher: Weigher[K, V]            ## nil: every entry weighs 1
+    weight: int                       ## Weight of live entries
+    smallWeight: int                  ## Weight of live entries in small
+    expireAfterNs: int64              ## Default TTL (0 = none)
+    refreshAfterNs: int64             ## Reload age for `getOrLoad` (0 = never)
+    clock: CacheClock
+    wheel: TimerWheel                 ## TTL deadlines by slot, made on first use
 
     hits*: int                        ## Cache hits (for statistics)
     misses*: int                      ## Cache misses (for statistics)
@@ -87,49 +154,132 @@ type
 # =============================================================================
 
 const
-  SmallQueueRatio = 0.1  ## Small queue uses 10% of cache capacity
-  MaxFrequency = 3       ## Maximum frequency counter value (2-bit)
+  SmallQueueRatio* = 0.1  ## Small queue uses 10% of cache capacity
+  MaxFrequency = 3        ## Maximum frequency counter value (2-bit)
+
+# =============================================================================
+# Ring Buffers
+# =============================================================================
+
+proc initSlotRing[T](cap: int): SlotRing[T] =
+  SlotRing[T](buf: newSeq[T](cap))
+
+proc push[T](r: var SlotRing[T], x: T) {.inline.} =
+  assert r.len < r.buf.len
+  var i = r.head + r.len
+  if i >= r.buf.len: i -= r.buf.len
+  r.buf[i] = x
+  inc r.len
+
+proc pop[T](r: var SlotRing[T]): T {.inline.} =
+  assert r.len > 0
+  result = r.buf[r.head]
+  inc r.head
+  if r.head == r.buf.len: r.head = 0
+  dec r.len
+
+proc clear[T](r: var SlotRing[T]) {.inline.} =
+  r.head = 0
+  r.len = 0
 
 # =============================================================================
 # Construction
 # =============================================================================
 
-proc initS3FIFOCache*[K, V](capacity: int): S3FIFOCache[K, V] =
+proc `=destroy`*[K, V](cache: var S3FIFOCache[K, V]) =
+  ## Free the index tables and drop all entries.
+  cache.index.destroy()
+  cache.ghostIndex.destroy()
+  `=destroy`(cache.slots)
+  `=destroy`(cache.free.buf)
+  `=destroy`(cache.small.buf)
+  `=destroy`(cache.main.buf)
+  `=destroy`(cache.ghost.buf)
+  `=destroy`(cache.weigher)
+  `=destroy`(cache.clock)
+  `=destroy`(cache.wheel)
+
+proc `=copy`*[K, V](dest: var S3FIFOCache[K, V], src: S3FIFOCache[K, V]) {.error.}
+  ## Prevent copying (the index tables are not reference counted)
+
+proc monotonicNs(): int64 = nowNs()
+
+proc initS3FIFOCache*[K, V](capacity: int, maxWeight = 0,
+                            weigher: Weigher[K, V] = nil,
+                            smallRatio = SmallQueueRatio,
+                            expireAfterWrite = DurationZero,
+                            refreshAfterWrite = DurationZero,
+                            clock: CacheClock = nil): S3FIFOCache[K, V] =
   ## Create new S3-FIFO cache
   ##
   ## Parameters:
   ## - capacity: Maximum number of entries in cache
+  ## - maxWeight: Budget in `weigher` units (required with a weigher;
+  ##   without one every entry weighs 1 and it defaults to `capacity`)
+  ## - smallRatio: Share of both budgets given to the small queue
+  ## - expireAfterWrite: Default TTL for `put` (zero = no expiry)
+  ## - refreshAfterWrite: Age at which `getOrLoad` reloads (zero = never)
+  ## - clock: Time source in ns, for tests (defaults to `nowNs`)
   ##
   ## Queue sizes:
   ## - Small: 10% of capacity
   ## - Main: 90% of capacity
-  ## - Ghost: Same as Main (metadata only)
+  ## - Ghost: Same as Main (hashes only)
+  ##
+  ## All memory is allocated here (the timer wheel on the first TTL);
+  ## `get` and `put` never allocate (beyond copying keys and values that
+  ## own heap memory).
   if capacity < 10:
     raise newException(ValueError, "Capacity must be at least 10")
-
-  let smallCap = max(1, int(capacity.float64 * SmallQueueRatio))
+  if smallRatio <= 0.0 or smallRatio >= 1.0:
+    raise newException(ValueError, "smallRatio must be between 0 and 1")
+  if maxWeight < 0 or (weigher != nil and maxWeight == 0):
+    raise newException(ValueError, "A weigher needs a positive maxWeight")
+  if expireAfterWrite < DurationZero or refreshAfterWrite < DurationZero:
+    raise newException(ValueError, "Durations must not be negative")
+
+  let smallCap = max(1, int(capacity.float64 * smallRatio))
   let mainCap = capacity - smallCap
 
-  result = S3FIFOCache[K, V](
-    capacity: capacity,
-    smallCapacity: smallCap,
-    mainCapacity: mainCap,
-    small: initDeque[CacheEntry[K, V]](),
-    main: initDeque[CacheEntry[K, V]](),
-    ghost: initDeque[K](),
-    index: initTable[K, CacheEntry[K, V]](),
-    ghostSet: initTable[K, bool](),
-    hits: 0,
-    misses: 0
-  )
+  result.capacity = capacity
+  result.smallCapacity = smallCap
+  result.mainCapacity = mainCap
+  result.maxWeight = if maxWeight > 0: maxWeight else: capacity
+  result.smallMaxWeight = max(1, int(result.maxWeight.float64 * smallRatio))
+  result.weigher = weigher
+  result.expireAfterNs = expireAfterWrite.inNanoseconds
+  result.refreshAfterNs = refreshAfterWrite.inNanoseconds
+  result.clock = if clock != nil: clock else: monotonicNs
+  result.slots = newSeq[CacheSlot[K, V]](capacity)
+  result.free = initSlotRing[int32](capacity)
+  result.small = initSlotRing[int32](capacity)
+  result.main = initSlotRing[int32](capacity)
+  for i in 0..<capacity:
+    result.free.push(int32(i))
+  # Twice the live entries: deletes then clean tombstones in place
+  # instead of growing the table.
+  result.index = SwissTable[K, int32].init()
+  result.index.reserve(2 * capacity)
+  result.ghost = initSlotRing[uint64](mainCap)
+  result.ghostIndex = SwissTable[uint64, int].init()
+  result.ghostIndex.reserve(2 * mainCap)
 
 proc clear*[K, V](cache: var S3FIFOCache[K, V]) =
   ## Clear all entries from cache
+  cache.index.clear()
   cache.small.clear()
   cache.main.clear()
+  cache.free.clear()
+  for i in 0..<cache.capacity:
+    reset(cache.slots[i])
+    cache.free.push(int32(i))
   cache.ghost.clear()
-  cache.index.clear()
-  cache.ghostSet.clear()
+  cache.ghostIndex.clear()
+  cache.ghostSeq = 0
+  cache.weight = 0
+  cache.smallWeight = 0
+  if cache.wheel.capacity > 0:
+    cache.wheel.clear()
   cache.hits = 0
   cache.misses = 0
 
@@ -137,6 +287,78 @@ proc clear*[K, V](cache: var S3FIFOCache[K, V]) =
 # Internal Operations
 # =============================================================================
 
+proc weigh[K, V](cache: S3FIFOCache[K, V], key: K, value: V): int {.inline.} =
+  if cache.weigher == nil:
+    return 1
+  result = cache.weigher(key, value)
+  if result < 0:
+    raise newException(ValueError, "Weigher returned a negative weight")
+
+proc forget[K, V](cache: var S3FIFOCache[K, V], slot: int32) {.inline.} =
+  ## Drop a live slot's key, weight and timer (the slot stays queued).
+  discard cache.index.delete(cache.slots[slot].key, cache.slots[slot].hash)
+  let w = cache.slots[slot].weight
+  cache.weight -= w
+  if cache.slots[slot].state == ssSmall:
+    cache.smallWeight -= w
+  if cache.slots[slot].expiresAt != 0:
+    cache.wheel.cancel(slot)
+    cache.slots[slot].expiresAt = 0
+  when not supportsCopyMem(K) or not supportsCopyMem(V):
+    reset(cache.slots[slot].key)
+    reset(cache.slots[slot].value)
+
+proc unlink[K, V](cache: var S3FIFOCache[K, V], slot: int32) {.inline.} =
+  ## Drop a live slot's key from the index and return the slot to the
+  ## free ring.
+  cache.forget(slot)
+  cache.slots[slot].state = ssFree
+  cache.free.push(slot)
+
+proc retire[K, V](cache: var S3FIFOCache[K, V], slot: int32) {.inline.} =
+  ## Remove a live slot in O(1): it stays in its queue, already weightless,
+  ## and is freed once eviction reaches it.
+  cache.forget(slot)
+  cache.slots[slot].state = ssRemoved
+
+proc release[K, V](cache: var S3FIFOCache[K, V], slot: int32) {.inline.} =
+  ## Return a removed slot to the free ring.
+  cache.slots[slot].state = ssFree
+  cache.free.push(slot)
+
+proc expire[K, V](cache: var S3FIFOCache[K, V], now: int64) =
+  ## Retire every entry whose deadline the timer wheel has passed.
+  for slot in cache.wheel.advance(now):
+    cache.slots[slot].expiresAt = 0    # Timer already fired
+    cache.retire(slot)
+
+proc setDeadline[K, V](cache: var S3FIFOCache[K, V], slot: int32,
+                       now, ttlNs: int64) =
+  ## Stamp a write at `now` and (re)arm or cancel the slot's timer.
+  cache.slots[slot].writeTime = now
+  if ttlNs > 0:
+    if cache.wheel.capacity == 0:
+      cache.wheel = TimerWheel.init(cache.capacity, now)
+    cache.slots[slot].expiresAt = now + ttlNs
+    cache.wheel.schedule(slot, now + ttlNs)
+  elif cache.slots[slot].expiresAt != 0:
+    cache.wheel.cancel(slot)
+    cache.slots[slot].expiresAt = 0
+
+proc ghostAdd[K, V](cache: var S3FIFOCache[K, V], h: uint64) =
+  ## Remember the hash of a key evicted from the small queue.
+  if cache.ghost.buf.len == 0:
+    return
+  if cache.ghost.len == cache.ghost.buf.len:
+    let old = cache.ghost.pop()
+    let p = cache.ghostIndex.find(old)
+    # A newer ghost of the same hash keeps its entry
+    if p.isSome and p.get[] == cache.ghostSeq - cache.ghost.buf.len:
+      discard cache.ghostIndex.delete(old)
+  cache.ghost.push(h)
+  cache.ghostIndex[h] = cache.ghostSeq
+  inc cache.ghostSeq
+
 proc evictFromSmall[K, V](cache: var S3FIFOCache[K, V]) =
   ## Evict one entry from small queue
   ##
@@ -144,32 +366,18 @@ proc evictFromSmall[K, V](cache: var S3FIFOCache[K, V]) =
   ## 1. Get tail entry from small queue
   ## 2. If freq > 0: move to main queue (lazy promotion)
   ## 3. Otherwise: evict to ghost queue (quick demotion)
-  if cache.small.len == 0:
-    return
-
-  let entry = cache.small.popFirst()
-
-  if entry.freq > 0:
-    # Promote to main queue (was accessed while in small)
-    entry.freq = 0  # Reset frequency
-
-    # Evict from main if full
-    if cache.main.len >= cache.mainCapacity:
-      cache.evictFromMain()
-
-    cache.main.addLast(entry)
+  let slot = cache.small.pop()
+  if cache.slots[slot].state == ssRemoved:
+    cache.release(slot)
+  elif cache.slots[slot].freq > 0:
+    cache.slots[slot].freq = 0
+    cache.slots[slot].state = ssMain
+    cache.smallWeight -= cache.slots[slot].weight
+    cache.main.push(slot)
   else:
-    # Evict to ghost queue (single-access object)
-    cache.index.del(entry.key)
-
-    # Add to ghost queue
-    cache.ghost.addLast(entry.key)
-    cache.ghostSet[entry.key] = true
-
-    # Evict from ghost if full
-    if cache.ghost.len > cache.mainCapacity:
-      let evictedKey = cache.ghost.popFirst()
-      cache.ghostSet.del(evictedKey)
+    let h = cache.slots[slot].hash
+    cache.unlink(slot)
+    cache.ghostAdd(h)
 
 proc evictFromMain[K, V](cache: var S3FIFOCache[K, V]) =
   ## Evict one entry from main queue
@@ -177,46 +385,118 @@ proc evictFromMain[K, V](cache: var S3FIFOCache[K, V]) =
   ## Algorithm (FIFO-Reinsertion):
   ## 1. Get tail entry from main queue
   ## 2. If freq > 0: reinsert to head (give another chance)
-  ## 3. Otherwise: evict to ghost queue
-  if cache.main.len == 0:
-    return
-
-  # Scan from tail until we find an entry with freq == 0
-  var attempts = 0
-  let maxAttempts = cache.main.len
-
-  while attempts < maxAttempts:
-    let entry = cache.main.popFirst()
-    inc attempts
+  ## 3. Otherwise: evict
+  ##
+  ## At most one pass over the queue, then the oldest entry goes anyway.
+  for _ in 0..<cache.main.len:
+    let slot = cache.main.pop()
+    if cache.slots[slot].state == ssRemoved:
+      cache.release(slot)
+      return
+    if cache.slots[slot].freq == 0:
+      cache.unlink(slot)
+      return
+    dec cache.slots[slot].freq
+    cache.main.push(slot)
 
-    if entry.freq > 0:
-      # Reinsert to head (give another chance)
-      dec entry.freq
-      cache.main.addLast(entry)
+  let slot = cache.main.pop()
+  if cache.slots[slot].state == ssRemoved:
+    cache.release(slot)
+  else:
+    cache.unlink(slot)
+
+proc makeRoom[K, V](cache: var S3FIFOCache[K, V], need: int, slot: bool) =
+  ## Evict until `need` more weight fits and, if `slot`, a slot is free.
+  ## The small queue is drained first while over either of its budgets.
+  while (slot and cache.free.len == 0) or cache.weight + need > cache.maxWeight:
+    let overSmall = cache.small.len >= cache.smallCapacity or
+                    cache.smallWeight >= cache.smallMaxWeight
+    if cache.small.len > 0 and (overSmall or cache.main.len == 0):
+      cache.evictFromSmall()
     else:
-      # Evict to ghost queue
-      cache.index.del(entry.key)
-
-      cache.ghost.addLast(entry.key)
-      cache.ghostSet[entry.key] = true
-
-      if cache.ghost.len > cache.mainCapacity:
-        let evictedKey = cache.ghost.popFirst()
-        cache.ghostSet.del(evictedKey)
+      cache.evictFromMain()
 
-      return
+proc lookup[K, V](cache: var S3FIFOCache[K, V], key: K,
+                  now: var int64): int32 =
+  ## Slot of a live, unexpired `key` or -1, counting the hit or miss.
+  ## Reads the clock (into `now`) only while timers are pending.
+  if cache.wheel.len > 0:
+    now = cache.clock()
+    cache.expire(now)
+  let p = cache.index.find(key)
+  if p.isSome:
+    let slot = p.get[]
+    # The wheel works in whole ticks; check the exact deadline
+    if cache.slots[slot].expiresAt != 0 and cache.slots[slot].expiresAt <= now:
+      cache.retire(slot)
+    else:
+      # Increment frequency (capped at MaxFrequency)
+      if cache.slots[slot].freq < MaxFrequency:
+        inc cache.slots[slot].freq
+      inc cache.hits
+      return slot
 
-  # All entries have freq > 0, evict the first one anyway
-  if cache.main.len > 0:
-    let entry = cache.main.popFirst()
-    cache.index.del(entry.key)
+  inc cache.misses
+  -1
+
+proc store[K, V](cache: var S3FIFOCache[K, V], key: K, value: V,
+                 ttlNs: int64) =
+  ## Insert or update `key`, expiring it `ttlNs` from now (0 = never).
+  let h = hashKey(key)
+  let w = cache.weigh(key, value)
+  var now = 0'i64
+  if ttlNs > 0 or cache.refreshAfterNs > 0 or cache.wheel.len > 0:
+    now = cache.clock()
+    if cache.wheel.len > 0:
+      cache.expire(now)
+
+  let p = cache.index.find(key, h)
+  var existing = -1'i32
+  if p.isSome:
+    existing = p.get[]
+
+  # An entry over the whole budget is never admitted, and must not leave
+  # a stale value behind
+  if w > cache.maxWeight:
+    if existing >= 0:
+      cache.retire(existing)
+    return
 
-    cache.ghost.addLast(entry.key)
-    cache.ghostSet[entry.key] = true
+  # Update existing entry
+  if existing >= 0:
+    let slot = existing
+    cache.weight += w - cache.slots[slot].weight
+    if cache.slots[slot].state == ssSmall:
+      cache.smallWeight += w - cache.slots[slot].weight
+    cache.slots[slot].weight = w
+    cache.slots[slot].value = value
+    if cache.slots[slot].freq < MaxFrequency:
+      inc cache.slots[slot].freq
+    cache.setDeadline(slot, now, ttlNs)
+    cache.makeRoom(0, slot = false)   # A heavier value may overflow
+    return
 
-    if cache.ghost.len > cache.mainCapacity:
-      let evictedKey = cache.ghost.popFirst()
-      cache.ghostSet.del(evictedKey)
+  # Claim a slot, evicting until the entry fits
+  cache.makeRoom(w, slot = true)
+  let slot = cache.free.pop()
+  cache.slots[slot].key = key
+  cache.slots[slot].value = value
+  cache.slots[slot].hash = h
+  cache.slots[slot].weight = w
+  cache.slots[slot].freq = 0
+  cache.weight += w
+  cache.setDeadline(slot, now, ttlNs)
+  if not cache.index.insertWithoutGrowth(key, slot, h):
+    cache.index[key] = slot   # Cleans tombstones in place
+
+  # Keys recently evicted from small go straight to main
+  if cache.ghostIndex.delete(h):
+    cache.slots[slot].state = ssMain
+    cache.main.push(slot)
+  else:
+    cache.slots[slot].state = ssSmall
+    cache.smallWeight += w
+    cache.small.push(slot)
 
 # =============================================================================
 # Cache Operations
@@ -226,21 +506,14 @@ proc get*[K, V](cache: var S3FIFOCache[K, V], key: K): Option[V] =
   ## Get value for key (cache hit increments frequency)
   ##
   ## Returns:
-  ## - Some(value) if key exists
+  ## - Some(value) if key exists and has not expired
   ## - None if key not found
   ##
   ## Side effect: Increments frequency counter on hit
-  if key in cache.index:
-    let entry = cache.index[key]
-
-    # Increment frequency (capped at MaxFrequency)
-    if entry.freq < MaxFrequency:
-      inc entry.freq
-
-    inc cache.hits
-    return some(entry.value)
-
-  inc cache.misses
+  var now = 0'i64
+  let slot = cache.lookup(key, now)
+  if slot >= 0:
+    return some(cache.slots[slot].value)
   none(V)
 
 proc contains*[K, V](cache: var S3FIFOCache[K, V], key: K): bool =
@@ -254,77 +527,60 @@ proc put*[K, V](cache: var S3FIFOCache[K, V], key: K, value: V) =
   ## 1. If key exists: update value, increment frequency
   ## 2. If key in ghost: insert to main (was recently evicted)
   ## 3. Otherwise: insert to small (new entry)
-
-  # Update existing entry
-  if key in cache.index:
-    let entry = cache.index[key]
-    entry.value = value
-
-    if entry.freq < MaxFrequency:
-      inc entry.freq
-
+  ##
+  ## The entry expires after `expireAfterWrite`, if set. An entry heavier
+  ## than `maxWeight` is not cached (and replaces no older value).
+  cache.store(key, value, cache.expireAfterNs)
+
+proc put*[K, V](cache: var S3FIFOCache[K, V], key: K, value: V,
+                ttl: Duration) =
+  ## Insert or update entry, expiring it `ttl` from now instead of after
+  ## `expireAfterWrite`.
+  if ttl <= DurationZero:
+    raise newException(ValueError, "TTL must be positive")
+  cache.store(key, value, ttl.inNanoseconds)
+
+proc getOrLoad*[K, V](cache: var S3FIFOCache[K, V], key: K,
+                      loader: proc (key: K): V): V =
+  ## Get value for key, calling `loader` and caching its result on a miss.
+  ##
+  ## With `refreshAfterWrite` set, a hit on an entry written longer ago
+  ## than that is reloaded (restarting its TTL). If the reload raises, the
+  ## cached value is returned and the reload is retried on the next hit.
+  var now = 0'i64
+  let slot = cache.lookup(key, now)
+  if slot < 0:
+    result = loader(key)
+    cache.put(key, result)
     return
 
-  # Create new entry
-  let entry = CacheEntry[K, V](
-    key: key,
-    value: value,
-    freq: 0
-  )
-
-  cache.index[key] = entry
-
-  # Check if key was in ghost queue (recently evicted)
-  if key in cache.ghostSet:
-    # Insert to main queue (promote immediately)
-    cache.ghostSet.del(key)
-
-    # Remove from ghost queue (O(n) operation, but rare)
-    var newGhost = initDeque[K]()
-    for gkey in cache.ghost:
-      if gkey != key:
-        newGhost.addLast(gkey)
-    cache.ghost = newGhost
-
-    # Evict from main if full
-    if cache.main.len >= cache.mainCapacity:
-      cache.evictFromMain()
-
-    cache.main.addLast(entry)
-  else:
-    # Insert to small queue (new entry)
-    # Evict from small if full
-    if cache.small.len >= cache.smallCapacity:
-      cache.evictFromSmall()
-
-    cache.small.addLast(entry)
+  result = cache.slots[slot].value
+  if cache.refreshAfterNs > 0:
+    if now == 0:
+      now = cache.clock()
+    if now - cache.slots[slot].writeTime >= cache.refreshAfterNs:
+      try:
+        result = loader(key)
+        cache.put(key, result)
+      except CatchableError:
+        discard
 
 proc remove*[K, V](cache: var S3FIFOCache[K, V], key: K): bool =
   ## Remove entry from cache
   ##
-  ## Returns true if key was present
-  if key notin cache.index:
+  ## Returns true if key was present. O(1): the slot stays in its queue
+  ## and is reused once eviction reaches it.
+  let p = cache.index.find(key)
+  if p.isNone:
     return false
-
-  let entry = cache.index[key]
-  cache.index.del(key)
-
-  # Remove from appropriate queue (O(n) operation)
-  # Note: For production use, consider using doubly-linked list with pointers
-  var newSmall = initDeque[CacheEntry[K, V]]()
-  for e in cache.small:
-    if e.key != key:
-      newSmall.addLast(e)
-  cache.small = newSmall
-
-  var newMain = initDeque[CacheEntry[K, V]]()
-  for e in cache.main:
-    if e.key != key:
-      newMain.addLast(e)
-  cache.main = newMain
-
+  cache.retire(p.get[])
   true
 
+proc cleanUp*[K, V](cache: var S3FIFOCache[K, V]) =
+  ## Drop expired entries now rather than on the next `get` or `put`.
+  if cache.wheel.len > 0:
+    cache.expire(cache.clock())
+
 # =============================================================================
 # Statistics
 # =============================================================================
@@ -337,6 +593,22 @@ proc capacity*[K, V](cache: S3FIFOCache[K, V]): int =
   ## Maximum cache capacity
   cache.capacity
 
+proc weight*[K, V](cache: S3FIFOCache[K, V]): int =
+  ## Total weight of the entries in cache (never above `maxWeight`)
+  cache.weight
+
+proc smallLen*[K, V](cache: S3FIFOCache[K, V]): int =
+  ## Entries queued in the small queue (may include removed ones)
+  cache.small.len
+
+proc mainLen*[K, V](cache: S3FIFOCache[K, V]): int =
+  ## Entries queued in the main queue (may include removed ones)
+  cache.main.len
+
+proc ghostLen*[K, V](cache: S3FIFOCache[K, V]): int =
+  ## Hashes held by the ghost queue
+  cache.ghost.len
+
 proc hitRate*[K, V](cache: S3FIFOCache[K, V]): float64 =
   ## Cache hit rate (hits / total accesses)
   let total = cache.hits + cache.misses
@@ -356,6 +628,7 @@ proc resetStats*[K, V](cache: var S3FIFOCache[K, V]) =
 proc `$`*[K, V](cache: S3FIFOCache[K, V]): string =
   result = "S3FIFOCache(capacity=" & $cache.capacity &
            ", size=" & $cache.size() &
+           ", weight=" & $cache.weight & "/" & $cache.maxWeight &
            ", small=" & $cache.small.len &
            ", main=" & $cache.main.len &
            ", ghost=" & $cache.ghost.len &
@@ -366,9 +639,12 @@ proc `$`*[K, V](cache: S3FIFOCache[K, V]): string =
 # =============================================================================
 
 iterator pairs*[K, V](cache: S3FIFOCache[K, V]): (K, V) =
-  ## Iterate over all key-value pairs in cache
-  for key, entry in cache.index:
-    yield (key, entry.value)
+  ## Iterate over all unexpired key-value pairs in cache
+  let now = if cache.wheel.len > 0: cache.clock() else: 0'i64
+  for i in 0..<cache.slots.len:
+    if cache.slots[i].state in {ssSmall, ssMain} and
+       (cache.slots[i].expiresAt == 0 or cache.slots[i].expiresAt > now):
+      yield (cache.slots[i].key, cache.slots[i].value)
 
 # =============================================================================
 # Example Usage
@@ -0,0 +1,579 @@
+## Cache Trace Replay and Miss-Ratio Simulation
+## =============================================
+##
+## Offline evaluation of eviction policies: replay a request trace through
+## `S3FIFOCache` and the classic baselines (LRU, CLOCK, W-TinyLFU) at a
+## range of cache sizes and report miss ratio and replay throughput for
+## each point. Points are independent, so `sweep` runs them on all cores.
+##
+## Traces are sequences of 64-bit object ids. Supported files:
+## - CSV / text: one request per line, either `key` or
+##   `timestamp,key[,size,...]`. Numeric keys are used as ids, anything
+##   else is hashed. A non-numeric timestamp marks a header line.
+## - Binary: packed little-endian uint64 ids (`writeBinaryTrace`).
+## - oracleGeneral: libCacheSim's 24-byte records
+##   (`uint32 time, uint64 id, uint32 size, int64 next`).
+##
+## Sizes are ignored: capacities and miss ratios count objects.
+##
+## Usage:
+## ```nim
+## import arsenal/caching/simulation
+##
+## let trace = loadTrace("cdn.oracleGeneral")
+## let sizes = capacityPoints(trace.uniqueKeys)
+## for r in sweep(trace.keys, [pS3FIFO, pLRU, pTinyLFU], sizes):
+##   echo r.policy, " ", r.capacity, " ", r.missRatio
+## ```
+##
+## References:
+## - W-TinyLFU: Einziger, Friedman, Manes, "TinyLFU: A Highly Efficient
+##   Cache Admission Policy" (ACM ToS 2017)
+## - Trace format: libCacheSim (github.com/1a1a11a/libCacheSim)
+
+import std/[options, sets, strutils, parseutils, memfiles, os, monotimes,
+            times, endians, math, algorithm]
+import ../datastructures/hashtables/swiss_table
+import ../hashing/hasher
+import ./s3fifo
+
+when compileOption("threads"):
+  import std/osproc
+  import ../concurrency/atomics/atomic
+
+type
+  TraceFormat* = enum
+    tfAuto           ## Pick by file extension
+    tfCsv            ## `key` or `timestamp,key[,size]` per line
+    tfBinary         ## Packed little-endian uint64 ids
+    tfOracleGeneral  ## libCacheSim 24-byte records
+
+  CacheTrace* = object
+    keys*: seq[uint64]     ## Requested object ids, in order
+    uniqueKeys*: int       ## Distinct ids (the working set)
+
+  Policy* = enum
+    pS3FIFO = "S3-FIFO"
+    pLRU = "LRU"
+    pCLOCK = "CLOCK"
+    pTinyLFU = "W-TinyLFU"
+
+  SimResult* = object
+    policy*: Policy
+    capacity*: int         ## Objects
+    requests*: int
+    misses*: int
+    seconds*: float64      ## Replay time
+
+const
+  MinSimCapacity* = 10     ## Smallest size every policy supports
+  OracleRecordSize = 24
+  NoSlot = -1'i32
+
+# =============================================================================
+# Traces
+# =============================================================================
+
+proc parseKey(field: string): uint64 =
+  var n: BiggestUInt
+  if field.len > 0 and parseBiggestUInt(field, n) == field.len:
+    uint64(n)
+  else:
+    keyHash(field)
+
+proc countUnique(keys: openArray[uint64]): int =
+  var seen = initHashSet[uint64]()
+  for k in keys:
+    seen.incl k
+  seen.len
+
+proc readCsvTrace*(path: string): CacheTrace =
+  ## Read a CSV or plain-text trace.
+  for raw in lines(path):
+    let line = raw.strip()
+    if line.len == 0 or line[0] == '#':
+      continue
+    let fields = line.split(',')
+    if fields.len == 1:
+      result.keys.add parseKey(fields[0].strip())
+    else:
+      var ts: BiggestUInt
+      let t = fields[0].strip()
+      if parseBiggestUInt(t, ts) != t.len:
+        continue                       # Header
+      result.keys.add parseKey(fields[1].strip())
+  result.uniqueKeys = countUnique(result.keys)
+
+proc readU64LE(p: pointer): uint64 {.inline.} =
+  littleEndian64(addr result, p)
+
+proc readBinaryTrace*(path: string,
+                      format: TraceFormat = tfBinary): CacheTrace =
+  ## Read a `tfBinary` or `tfOracleGeneral` trace (memory-mapped).
+  let (recordSize, offset) =
+    if format == tfOracleGeneral: (OracleRecordSize, 4) else: (8, 0)
+  if getFileSize(path) == 0:
+    return
+  var f = memfiles.open(path)
+  defer: f.close()
+  if f.size mod recordSize != 0:
+    raise newException(ValueError,
+      path & ": size is not a multiple of " & $recordSize & " bytes")
+  let base = cast[ptr UncheckedArray[byte]](f.mem)
+  result.keys = newSeq[uint64](f.size div recordSize)
+  for i in 0 ..< result.keys.len:
+    result.keys[i] = readU64LE(addr base[i * recordSize + offset])
+  result.uniqueKeys = countUnique(result.keys)
+
+proc loadTrace*(path: string, format = tfAuto): CacheTrace =
+  ## Read a trace, detecting the format from the extension with `tfAuto`
+  ## (`.csv`/`.txt`: CSV, `.oracleGeneral`: libCacheSim, else binary).
+  var fmt = format
+  if fmt == tfAuto:
+    let ext = path.splitFile.ext.toLowerAscii
+    fmt = if ext in [".csv", ".txt"]: tfCsv
+          elif ext == ".oraclegeneral": tfOracleGeneral
+          else: tfBinary
+  if fmt == tfCsv: readCsvTrace(path) else: readBinaryTrace(path, fmt)
+
+proc writeBinaryTrace*(path: string, keys: openArray[uint64]) =
+  ## Write `keys` as a `tfBinary` trace.
+  var f = open(path, fmWrite)
+  defer: f.close()
+  var buf = newSeq[uint64](keys.len)
+  for i in 0 ..< keys.len:
+    var k = keys[i]
+    littleEndian64(addr buf[i], addr k)
+  if buf.len > 0:
+    discard f.writeBuffer(addr buf[0], buf.len * 8)
+
+proc zipfTrace*(requests, universe: int, alpha = 1.0,
+                seed = 42'u64): CacheTrace =
+  ## Synthetic trace: `requests` draws from ids `0 ..< universe` with
+  ## Zipf(alpha) popularity. Id 0 is the most popular.
+  if universe <= 0:
+    raise newException(ValueError, "universe must be positive")
+  var cdf = newSeq[float64](universe)
+  var total = 0.0
+  for i in 0 ..< universe:
+    total += 1.0 / pow(float64(i + 1), alpha)
+    cdf[i] = total
+  var x = seed or 1
+  result.keys = newSeq[uint64](requests)
+  for i in 0 ..< requests:
+    x = x xor (x shl 13)
+    x = x xor (x shr 7)
+    x = x xor (x shl 17)
+    let u = float64(x shr 11) / float64(1'u64 shl 53) * total
+    result.keys[i] = uint64(min(cdf.lowerBound(u), universe - 1))
+  result.uniqueKeys = countUnique(result.keys)
+
+proc capacityPoints*(uniqueKeys: int, points = 8, lo = 0.001,
+                     hi = 0.5): seq[int] =
+  ## `points` cache sizes spaced geometrically from `lo` to `hi` of the
+  ## working set, at least `MinSimCapacity`, without duplicates.
+  for i in 0 ..< points:
+    let f = if points == 1: hi
+            else: lo * pow(hi / lo, float64(i) / float64(points - 1))
+    let c = max(MinSimCapacity, int(f * float64(uniqueKeys)))
+    if result.len == 0 or c > result[^1]:
+      result.add c
+
+# =============================================================================
+# Baselines
+# =============================================================================
+#
+# All keyed by uint64 with slots recycled in place, so replay never
+# allocates after construction (like `S3FIFOCache`).
+
+type
+  SlotList = object
+    ## Intrusive doubly-linked list over slot indices; head is newest.
+    head, tail: int32
+    len: int
+
+  LruCache* = object
+    ## Least-recently-used: hits move to the front, misses evict the back.
+    capacity: int
+    keys: seq[uint64]
+    prev, next: seq[int32]
+    list: SlotList
+    index: SwissTable[uint64, int32]
+
+  ClockCache* = object
+    ## CLOCK (second chance): hits set a reference bit; the hand clears
+    ## set bits and evicts the first clear one.
+    capacity: int
+    keys: seq[uint64]
+    referenced: seq[bool]
+    hand: int
+    len: int
+    index: SwissTable[uint64, int32]
+
+  FrequencySketch = object
+    ## Count-min sketch of 4-bit counters (one byte each), 4 rows.
+    ## Halved every `sampleSize` increments so it forgets old popularity.
+    counters: seq[uint8]
+    mask: int
+    additions, sampleSize: int
+
+  TinyLfuCache* = object
+    ## W-TinyLFU: 1% LRU window in front of a segmented LRU (20% probation,
+    ## 80% protected). A window victim enters main only if the sketch says
+    ## it is more popular than main's victim.
+    capacity, windowCapacity, protectedCapacity: int
+    keys: seq[uint64]
+    prev, next: seq[int32]
+    queue: seq[uint8]
+    lists: array[3, SlotList]         ## Window, probation, protected
+    free: seq[int32]
+    sketch: FrequencySketch
+    index: SwissTable[uint64, int32]
+
+const
+  qWindow = 0'u8
+  qProbation = 1'u8
+  qProtected = 2'u8
+
+proc initSlotList(): SlotList =
+  SlotList(head: NoSlot, tail: NoSlot)
+
+proc pushFront(l: var SlotList, prev, next: var seq[int32], s: int32) {.inline.} =
+  prev[s] = NoSlot
+  next[s] = l.head
+  if l.head != NoSlot: prev[l.head] = s else: l.tail = s
+  l.head = s
+  inc l.len
+
+proc detach(l: var SlotList, prev, next: var seq[int32], s: int32) {.inline.} =
+  if prev[s] != NoSlot: next[prev[s]] = next[s] else: l.head = next[s]
+  if next[s] != NoSlot: prev[next[s]] = prev[s] else: l.tail = prev[s]
+  dec l.len
+
+proc initIndex(capacity: int): SwissTable[uint64, int32] =
+  # Twice the entries so deletes clean tombstones in place
+  result = SwissTable[uint64, int32].init()
+  result.reserve(2 * capacity)
+
+proc indexPut(t: var SwissTable[uint64, int32], key: uint64, slot: int32) {.inline.} =
+  if not t.insertWithoutGrowth(key, slot):
+    t[key] = slot
+
+proc checkCapacity(capacity: int) =
+  if capacity < MinSimCapacity:
+    raise newException(ValueError,
+      "Simulated capacity must be at least " & $MinSimCapacity)
+
+# --- LRU ---------------------------------------------------------------------
+
+proc `=destroy`*(c: var LruCache) =
+  c.index.destroy()
+  `=destroy`(c.keys)
+  `=destroy`(c.prev)
+  `=destroy`(c.next)
+
+proc `=copy`*(dest: var LruCache, src: LruCache) {.error.}
+
+proc init*(_: typedesc[LruCache], capacity: int): LruCache =
+  checkCapacity(capacity)
+  result.capacity = capacity
+  result.keys = newSeq[uint64](capacity)
+  result.prev = newSeq[int32](capacity)
+  result.next = newSeq[int32](capacity)
+  result.list = initSlotList()
+  result.index = initIndex(capacity)
+
+proc access*(c: var LruCache, key: uint64): bool =
+  ## Request `key`; true on a hit. A miss inserts it.
+  let p = c.index.find(key)
+  if p.isSome:
+    let s = p.get[]
+    if c.list.head != s:
+      c.list.detach(c.prev, c.next, s)
+      c.list.pushFront(c.prev, c.next, s)
+    return true
+  var s: int32
+  if c.list.len < c.capacity:
+    s = int32(c.list.len)
+  else:
+    s = c.list.tail
+    c.list.detach(c.prev, c.next, s)
+    discard c.index.delete(c.keys[s])
+  c.keys[s] = key
+  c.list.pushFront(c.prev, c.next, s)
+  c.index.indexPut(key, s)
+  false
+
+# --- CLOCK -------------------------------------------------------------------
+
+proc `=destroy`*(c: var ClockCache) =
+  c.index.destroy()
+  `=destroy`(c.keys)
+  `=destroy`(c.referenced)
+
+proc `=copy`*(dest: var ClockCache, src: ClockCache) {.error.}
+
+proc init*(_: typedesc[ClockCache], capacity: int): ClockCache =
+  checkCapacity(capacity)
+  result.capacity = capacity
+  result.keys = newSeq[uint64](capacity)
+  result.referenced = newSeq[bool](capacity)
+  result.index = initIndex(capacity)
+
+proc access*(c: var ClockCache, key: uint64): bool =
+  ## Request `key`; true on a hit. A miss inserts it.
+  let p = c.index.find(key)
+  if p.isSome:
+    c.referenced[p.get[]] = true
+    return true
+  var s: int
+  if c.len < c.capacity:
+    s = c.len
+    inc c.len
+  else:
+    while c.referenced[c.hand]:
+      c.referenced[c.hand] = false
+      c.hand = (c.hand + 1) mod c.capacity
+    s = c.hand
+    c.hand = (c.hand + 1) mod c.capacity
+    discard c.index.delete(c.keys[s])
+  c.keys[s] = key
+  c.referenced[s] = false
+  c.index.indexPut(key, int32(s))
+  false
+
+# --- W-TinyLFU ---------------------------------------------------------------
+
+proc initFrequencySketch(capacity: int): FrequencySketch =
+  let width = nextPowerOfTwo(max(capacity, 16))
+  result.counters = newSeq[uint8](4 * width)
+  result.mask = width - 1
+  result.sampleSize = 10 * capacity
+
+proc cell(s: FrequencySketch, key: uint64, row: int): int {.inline.} =
+  let h = (key + uint64(row) * 0x9E3779B97F4A7C15'u64) * 0xBF58476D1CE4E5B9'u64
+  row * (s.mask + 1) + (int(h shr 32) and s.mask)
+
+proc increment(s: var FrequencySketch, key: uint64) =
+  for row in 0 ..< 4:
+    let i = s.cell(key, row)
+    if s.counters[i] < 15:
+      inc s.counters[i]
+  inc s.additions
+  if s.additions >= s.sampleSize:
+    for c in s.counters.mitems:
+      c = c shr 1
+    s.additions = s.additions div 2
+
+proc estimate(s: FrequencySketch, key: uint64): int =
+  result = 15
+  for row in 0 ..< 4:
+    result = min(result, int(s.counters[s.cell(key, row)]))
+
+proc `=destroy`*(c: var TinyLfuCache) =
+  c.index.destroy()
+  `=destroy`(c.keys)
+  `=destroy`(c.prev)
+  `=destroy`(c.next)
+  `=destroy`(c.queue)
+  `=destroy`(c.free)
+  `=destroy`(c.sketch)
+
+proc `=copy`*(dest: var TinyLfuCache, src: TinyLfuCache) {.error.}
+
+proc init*(_: typedesc[TinyLfuCache], capacity: int): TinyLfuCache =
+  checkCapacity(capacity)
+  result.capacity = capacity
+  result.windowCapacity = max(1, capacity div 100)
+  result.protectedCapacity = (capacity - result.windowCapacity) * 8 div 10
+  # One spare slot: a miss is inserted before the window overflows
+  result.keys = newSeq[uint64](capacity + 1)
+  result.prev = newSeq[int32](capacity + 1)
+  result.next = newSeq[int32](capacity + 1)
+  result.queue = newSeq[uint8](capacity + 1)
+  for l in result.lists.mitems:
+    l = initSlotList()
+  result.free = newSeqOfCap[int32](capacity + 1)
+  for i in countdown(capacity, 0):
+    result.free.add int32(i)
+  result.sketch = initFrequencySketch(capacity)
+  result.index = initIndex(capacity + 1)
+
+proc move(c: var TinyLfuCache, s: int32, q: uint8) {.inline.} =
+  c.lists[c.queue[s]].detach(c.prev, c.next, s)
+  c.lists[q].pushFront(c.prev, c.next, s)
+  c.queue[s] = q
+
+proc evict(c: var TinyLfuCache, s: int32) {.inline.} =
+  c.lists[c.queue[s]].detach(c.prev, c.next, s)
+  discard c.index.delete(c.keys[s])
+  c.free.add s
+
+proc access*(c: var TinyLfuCache, key: uint64): bool =
+  ## Request `key`; true on a hit. A miss inserts it into the window.
+  c.sketch.increment(key)
+  let p = c.index.find(key)
+  if p.isSome:
+    let s = p.get[]
+    case c.queue[s]
+    of qWindow, qProtected:
+      c.move(s, c.queue[s])
+    else:
+      # Probation hit: promote, demoting protected's oldest if full
+      if c.lists[qProtected].len >= c.protectedCapacity:
+        c.move(c.lists[qProtected].tail, qProbation)
+      c.move(s, qProtected)
+    return true
+
+  let s = c.free.pop()
+  c.keys[s] = key
+  c.queue[s] = qWindow
+  c.lists[qWindow].pushFront(c.prev, c.next, s)
+  c.index.indexPut(key, s)
+
+  if c.lists[qWindow].len > c.windowCapacity:
+    let candidate = c.lists[qWindow].tail
+    let mainLen = c.lists[qProbation].len + c.lists[qProtected].len
+    if mainLen < c.capacity - c.windowCapacity:
+      c.move(candidate, qProbation)
+    else:
+      let victim = if c.lists[qProbation].len > 0: c.lists[qProbation].tail
+                   else: c.lists[qProtected].tail
+      if c.sketch.estimate(c.keys[candidate]) > c.sketch.estimate(c.keys[victim]):
+        c.evict(victim)
+        c.move(candidate, qProbation)
+      else:
+        c.evict(candidate)
+  false
+
+# --- S3-FIFO -----------------------------------------------------------------
+
+proc access(c: var S3FIFOCache[uint64, uint8], key: uint64): bool {.inline.} =
+  if c.get(key).isSome:
+    return true
+  c.put(key, 0)
+  false
+
+# =============================================================================
+# Simulation
+# =============================================================================
+
+proc missRatio*(r: SimResult): float64 =
+  ## Fraction of requests that missed
+  if r.requests == 0: 0.0 else: r.misses.float64 / r.requests.float64
+
+proc opsPerSec*(r: SimResult): float64 =
+  ## Replay throughput in requests per second
+  if r.seconds <= 0.0: 0.0 else: r.requests.float64 / r.seconds
+
+proc replay[C](cache: var C, keys: openArray[uint64]): int =
+  for k in keys:
+    if not cache.access(k):
+      inc result
+
+proc simulate*(keys: openArray[uint64], policy: Policy,
+               capacity: int): SimResult =
+  ## Replay `keys` through a cold cache of `capacity` objects.
+  result = SimResult(policy: policy, capacity: capacity, requests: keys.len)
+  let start = getMonoTime()
+  case policy
+  of pS3FIFO:
+    var c = initS3FIFOCache[uint64, uint8](capacity)
+    result.misses = c.replay(keys)
+  of pLRU:
+    var c = LruCache.init(capacity)
+    result.misses = c.replay(keys)
+  of pCLOCK:
+    var c = ClockCache.init(capacity)
+    result.misses = c.replay(keys)
+  of pTinyLFU:
+    var c = TinyLfuCache.init(capacity)
+    result.misses = c.replay(keys)
+  result.seconds = (getMonoTime() - start).inNanoseconds.float64 / 1e9
+
+type
+  SweepJob = object
+    ## Shared by all workers of one `sweep` call.
+    keys: ptr UncheckedArray[uint64]
+    len: int
+    policies: ptr UncheckedArray[Policy]
+    capacities: ptr UncheckedArray[int]
+    capacityCount: int
+    results: ptr UncheckedArray[SimResult]
+    count: int
+    when compileOption("threads"):
+      next: Atomic[int]                ## Next point to simulate
+
+proc runPoint(job: ptr SweepJob, i: int) =
+  let policy = job.policies[i div job.capacityCount]
+  let capacity = job.capacities[i mod job.capacityCount]
+  # Each point builds its own cache; the trace is only read. (S3FIFOCache's
+  # optional clock/weigher closures are what the GC-safety check trips on.)
+  {.cast(gcsafe).}:
+    job.results[i] = simulate(toOpenArray(job.keys, 0, job.len - 1),
+                              policy, capacity)
+
+when compileOption("threads"):
+  proc sweepWorker(job: ptr SweepJob) {.thread.} =
+    ## Worker loop: claim points until none are left.
+    while true:
+      let i = job.next.fetchAdd(1, Relaxed)
+      if i >= job.count:
+        break
+      runPoint(job, i)
+
+proc sweep*(keys: openArray[uint64], policies: openArray[Policy],
+            capacities: openArray[int], threads = 0): seq[SimResult] =
+  ## Simulate every policy at every capacity, on `threads` threads
+  ## (0 = one per processor). Results are ordered by policy, then
+  ## capacity, and do not depend on `threads` (timings aside).
+  for c in capacities:
+    checkCapacity(c)
+  result = newSeq[SimResult](policies.len * capacities.len)
+  if result.len == 0 or keys.len == 0:
+    for i in 0 ..< result.len:
+      result[i] = SimResult(policy: policies[i div capacities.len],
+                            capacity: capacities[i mod capacities.len])
+    return
+  var pols = @policies
+  var caps = @capacities
+  var job = SweepJob(
+    keys: cast[ptr UncheckedArray[uint64]](unsafeAddr keys[0]),
+    len: keys.len,
+    policies: cast[ptr UncheckedArray[Policy]](addr pols[0]),
+    capacities: cast[ptr UncheckedArray[int]](addr caps[0]),
+    capacityCount: caps.len,
+    results: cast[ptr UncheckedArray[SimResult]](addr result[0]),
+    count: result.len)
+  when compileOption("threads"):
+    let wanted = if threads > 0: threads else: countProcessors()
+    let workers = max(1, min(wanted, job.count))
+    var ts = newSeq[Thread[ptr SweepJob]](workers - 1)
+    for i in 0 ..< ts.len:
+      createThread(ts[i], sweepWorker, addr job)
+    sweepWorker(addr job)              # The caller is worker 0
+    joinThreads(ts)
+  else:
+    for i in 0 ..< job.count:
+      runPoint(addr job, i)
+
+proc formatCurve*(results: openArray[SimResult]): string =
+  ## Miss-ratio curve table: one row per capacity, one column per policy.
+  var policies: seq[Policy]
+  var capacities: seq[int]
+  for r in results:
+    if r.policy notin policies: policies.add r.policy
+    if r.capacity notin capacities: capacities.add r.capacity
+  result = "capacity".align(12)
+  for p in policies:
+    result.add ($p).align(12)
+  result.add '\n'
+  for c in capacities:
+    result.add ($c).align(12)
+    for p in policies:
+      var cell = "-"
+      for r in results:
+        if r.policy == p and r.capacity == c:
+          cell = formatFloat(r.missRatio, ffDecimal, 4)
+      result.add cell.align(12)
+    result.add '\n'
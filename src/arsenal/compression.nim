@@ -16,11 +16,19 @@
 ## let codec = IntCodec.new()
 ## let compressed = codec.encode([1, 2, 3, 4, 5])
 ## let decoded = codec.decode(compressed, count = 5)
+##
+## # Sorted ids: best of BP128 / PFOR / Stream VByte / Elias-Fano per block
+## let ids = IntCodec.new().withDeltaEncoding().withCodec(bcAuto).build()
+## let packed = ids.compress(sortedIds)
 ## ```
 
 import arsenal/compression/streamvbyte
+import arsenal/compression/bitpacking
+import arsenal/compression/eliasfano
+import arsenal/compression/intblocks
 
 export streamvbyte  # Re-export for direct use
+export bitpacking, eliasfano, intblocks
 
 # =============================================================================
 # INT CODEC - Unified API for integer compression
@@ -30,16 +38,21 @@ type
   IntCodec* = object
     ## High-level API for integer compression
     ##
-    ## Wraps: StreamVByte
+    ## Wraps: StreamVByte, BP128, PFOR, Elias-Fano (see `intblocks`)
     ##
     ## Properties:
     ## - Fast encoding/decoding (4+ billion ints/sec)
     ## - SIMD-friendly
     ## - Particularly good for sorted sequences with delta encoding
+    ##
+    ## `encode`/`decode` always produce Stream VByte streams;
+    ## `compress`/`decompress` use the configured block codec.
     useDelta: bool
+    codec: BlockCodec
 
   IntCodecBuilder* = object
     useDelta: bool
+    codec: BlockCodec
 
 # Constructors
 proc new*(_: typedesc[IntCodec]): IntCodecBuilder =
@@ -51,20 +64,28 @@ proc new*(_: typedesc[IntCodec]): IntCodecBuilder =
   ##   .withDeltaEncoding()
   ##   .build()
   ## ```
-  IntCodecBuilder(useDelta: false)
+  IntCodecBuilder(useDelta: false, codec: bcStreamVByte)
 
 proc withDeltaEncoding*(builder: IntCodecBuilder, enabled: bool = true): IntCodecBuilder =
   ## Enable delta encoding (for sorted sequences)
   result = builder
   result.useDelta = enabled
 
+proc withCodec*(builder: IntCodecBuilder, codec: BlockCodec): IntCodecBuilder =
+  ## Block codec used by `compress` (default: Stream VByte). `bcAuto`
+  ## picks the smallest of BP128, PFOR, Stream VByte and Elias-Fano for
+  ## each 128-integer block.
+  result = builder
+  result.codec = codec
+
 proc build*(builder: IntCodecBuilder): IntCodec =
   ## Build codec from builder
-  IntCodec(useDelta: builder.useDelta)
+  IntCodec(useDelta: builder.useDelta, codec: builder.codec)
 
-proc init*(_: typedesc[IntCodec], useDelta: bool = false): IntCodec {.inline.} =
+proc init*(_: typedesc[IntCodec], useDelta: bool = false,
+           codec: BlockCodec = bcStreamVByte): IntCodec {.inline.} =
   ## Direct construction
-  IntCodec(useDelta: useDelta)
+  IntCodec(useDelta: useDelta, codec: codec)
 
 # Encoding/Decoding
 proc encode*(codec: IntCodec, values: openArray[uint32]): tuple[control: seq[uint8], data: seq[uint8]] =
@@ -77,8 +98,7 @@ proc encode*(codec: IntCodec, values: openArray[uint32]): tuple[control: seq[uin
   ## let (ctrl, data) = codec.encode([1, 2, 3, 4])
   ## ```
   if codec.useDelta:
-    let deltas = deltaEncode(values)
-    encodeStreamVByte(deltas)
+    encodeStreamVByteDelta(values)
   else:
     encodeStreamVByte(values)
 
@@ -97,17 +117,31 @@ proc decode*(codec: IntCodec, control: openArray[uint8],
   ## - count: Number of integers to decode
   ##
   ## Returns decoded integers
-  let decoded = decodeStreamVByte(control, data, count)
   if codec.useDelta:
-    deltaDecode(decoded)
+    decodeStreamVByteDelta(control, data, count)
+  else:
+    decodeStreamVByte(control, data, count)
+
+proc decode*(codec: IntCodec, control: openArray[uint8],
+             data: openArray[uint8], output: var openArray[uint32]): int =
+  ## Decode `output.len` integers into a reused buffer in a single pass
+  ## (delta decoding included); returns the data bytes consumed
+  if codec.useDelta:
+    decodeStreamVByteDelta(control, data, output)
   else:
-    decoded
+    decodeStreamVByte(control, data, output)
+
+proc decodeInt*(codec: IntCodec, control: openArray[uint8],
+                data: openArray[uint8], output: var openArray[int32]): int =
+  ## Decode signed integers into a reused buffer in a single pass;
+  ## returns the data bytes consumed
+  decodeStreamVByteZigzag(control, data, output, delta = codec.useDelta)
 
 proc decodeInt*(codec: IntCodec, control: openArray[uint8],
                 data: openArray[uint8], count: int): seq[int32] =
   ## Decode signed integers
-  let unsigned = codec.decode(control, data, count)
-  zigzagDecodeArray(unsigned)
+  result = newSeq[int32](count)
+  discard codec.decodeInt(control, data, result)
 
 # Convenience methods
 proc compress*(codec: IntCodec, values: openArray[uint32]): seq[byte] =
@@ -117,6 +151,9 @@ proc compress*(codec: IntCodec, values: openArray[uint32]): seq[byte] =
   ## ```nim
   ## let compressed = codec.compress([1, 2, 3, 4])
   ## ```
+  if codec.codec != bcStreamVByte:
+    return encodeBlocks(values, codec.codec, codec.useDelta)
+
   let (control, data) = codec.encode(values)
 
   # Format: [control_len: 4 bytes][control bytes][data bytes]
@@ -140,6 +177,11 @@ proc decompress*(codec: IntCodec, compressed: openArray[byte], count: int): seq[
   ## Parameters:
   ## - compressed: Compressed bytes (from compress())
   ## - count: Number of integers
+  if codec.codec != bcStreamVByte:
+    result = newSeq[uint32](count)
+    discard decodeBlocks(compressed, result, codec.useDelta)
+    return
+
   if compressed.len < 4:
     raise newException(ValueError, "Invalid compressed data")
 
@@ -168,7 +210,7 @@ proc bitsPerInt*(dataSize, count: int): float64 {.inline.} =
   (dataSize.float64 * 8.0) / count.float64
 
 proc `$`*(codec: IntCodec): string =
-  "IntCodec(delta=" & $codec.useDelta & ")"
+  "IntCodec(delta=" & $codec.useDelta & ", codec=" & $codec.codec & ")"
 
 # =============================================================================
 # CONVENIENCE CONSTRUCTORS
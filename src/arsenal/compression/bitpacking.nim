@@ -0,0 +1,482 @@
+## Bit Packing and Patched Frame of Reference
+## ==========================================
+##
+## Block codecs for 32-bit integers that are all small, such as the gaps
+## of a sorted id list:
+##
+## - **BP128**: 128 integers packed at the bit width of the largest one,
+##   `16 * bits` bytes per block plus a 1-byte header.
+## - **PFOR**: values are stored relative to the block minimum (Frame of
+##   Reference) at a width chosen for the bulk of the block; the few that
+##   do not fit are patched in afterwards (exceptions). One outlier no
+##   longer widens all 128 values.
+##
+## Blocks use the 4-lane "vertical" layout of SIMD-BP128: value `4*i + j`
+## lives in lane `j`, so packing and unpacking are plain 128-bit shifts,
+## ORs and masks with no shuffling. Unpacking is fully unrolled for each
+## width (SSE2 on x86-64, NEON on ARM64; both are baseline ISA, so no
+## runtime check is needed). Build with `-d:arsenalScalar` to force the
+## portable code, which produces the same bytes.
+##
+## Streams end with a partial block, padded with zeros before packing.
+##
+## Usage:
+## ```nim
+## import arsenal/compression/bitpacking
+##
+## let gaps = [3'u32, 1, 4, 1, 5, 9, 2, 6]
+## let packed = encodeBP128(gaps)
+## var output = newSeq[uint32](gaps.len)
+## discard decodeBP128(packed, output)
+##
+## let withOutliers = encodePFor(gaps)
+## discard decodePFor(withOutliers, output)
+## ```
+##
+## Reference: D. Lemire, L. Boytsov, "Decoding billions of integers per
+## second through vectorization", Software: Practice and Experience (2015)
+
+import std/bitops
+
+const
+  BlockSize* = 128                       ## Integers per block
+  PForHeaderSize = 7                     ## base: 4, bits, exceptions, maxBits
+
+# =============================================================================
+# Bit Widths
+# =============================================================================
+
+proc bitWidth*(value: uint32): int {.inline.} =
+  ## Bits needed to store `value` (0 for 0)
+  if value == 0: 0 else: 32 - countLeadingZeroBits(value)
+
+proc maxBitWidth*(values: openArray[uint32]): int =
+  ## Bits needed to store every value
+  var acc = 0'u32
+  for v in values:
+    acc = acc or v
+  bitWidth(acc)
+
+proc packedSize*(bits: int): int {.inline.} =
+  ## Bytes taken by one packed block of width `bits`
+  16 * bits
+
+# =============================================================================
+# SIMD Kernels
+# =============================================================================
+
+const
+  HwCompiler = (defined(gcc) or defined(clang) or defined(llvm_gcc)) and
+               not defined(arsenalScalar)
+  X86Bp = HwCompiler and defined(amd64)
+  ArmBp = HwCompiler and defined(arm64)
+
+when X86Bp or ArmBp:
+  # The width-generic loops below are forced inline into a switch over
+  # constant widths, so each case is a straight-line sequence of
+  # immediate shifts.
+  when X86Bp:
+    {.emit: """/*TYPESECTION*/
+#include <stdint.h>
+#include <string.h>
+#include <emmintrin.h>
+
+typedef __m128i arsenal_bp_vec;
+#define ARSENAL_BP_LOAD(p) _mm_loadu_si128((const __m128i*)(p))
+#define ARSENAL_BP_STORE(p, v) _mm_storeu_si128((__m128i*)(p), (v))
+#define ARSENAL_BP_OR(a, b) _mm_or_si128((a), (b))
+#define ARSENAL_BP_AND(a, b) _mm_and_si128((a), (b))
+#define ARSENAL_BP_SHL(v, n) _mm_slli_epi32((v), (n))
+#define ARSENAL_BP_SHR(v, n) _mm_srli_epi32((v), (n))
+#define ARSENAL_BP_SPLAT(x) _mm_set1_epi32((int)(x))
+#define ARSENAL_BP_ZERO() _mm_setzero_si128()
+""".}
+  else:
+    {.emit: """/*TYPESECTION*/
+#include <stdint.h>
+#include <string.h>
+#include <arm_neon.h>
+
+typedef uint32x4_t arsenal_bp_vec;
+#define ARSENAL_BP_LOAD(p) vld1q_u32((const uint32_t*)(p))
+#define ARSENAL_BP_STORE(p, v) vst1q_u32((uint32_t*)(p), (v))
+#define ARSENAL_BP_OR(a, b) vorrq_u32((a), (b))
+#define ARSENAL_BP_AND(a, b) vandq_u32((a), (b))
+#define ARSENAL_BP_SHL(v, n) vshlq_u32((v), vdupq_n_s32(n))
+#define ARSENAL_BP_SHR(v, n) vshlq_u32((v), vdupq_n_s32(-(n)))
+#define ARSENAL_BP_SPLAT(x) vdupq_n_u32((uint32_t)(x))
+#define ARSENAL_BP_ZERO() vdupq_n_u32(0)
+""".}
+
+  {.emit: """/*TYPESECTION*/
+static inline __attribute__((always_inline))
+void arsenal_bp_unpack_w(const uint8_t* in, uint32_t* out, const int bits) {
+  const arsenal_bp_vec mask = ARSENAL_BP_SPLAT(bits == 32 ? 0xFFFFFFFFu : (1u << bits) - 1);
+  arsenal_bp_vec w = ARSENAL_BP_LOAD(in);
+  int shift = 0;
+#pragma GCC unroll 32
+  for (int i = 0; i < 32; i++) {
+    arsenal_bp_vec v = shift ? ARSENAL_BP_SHR(w, shift) : w;
+    shift += bits;
+    if (shift >= 32) {
+      shift -= 32;
+      if (i < 31) {
+        in += 16;
+        w = ARSENAL_BP_LOAD(in);
+      }
+      if (shift > 0)
+        v = ARSENAL_BP_OR(v, ARSENAL_BP_SHL(w, bits - shift));
+    }
+    ARSENAL_BP_STORE(out + 4 * i, bits == 32 ? v : ARSENAL_BP_AND(v, mask));
+  }
+}
+
+static inline __attribute__((always_inline))
+void arsenal_bp_pack_w(const uint32_t* in, uint8_t* out, const int bits) {
+  const arsenal_bp_vec mask = ARSENAL_BP_SPLAT(bits == 32 ? 0xFFFFFFFFu : (1u << bits) - 1);
+  arsenal_bp_vec acc = ARSENAL_BP_ZERO();
+  int shift = 0;
+#pragma GCC unroll 32
+  for (int i = 0; i < 32; i++) {
+    const arsenal_bp_vec v = ARSENAL_BP_AND(ARSENAL_BP_LOAD(in + 4 * i), mask);
+    acc = ARSENAL_BP_OR(acc, shift ? ARSENAL_BP_SHL(v, shift) : v);
+    shift += bits;
+    if (shift >= 32) {
+      ARSENAL_BP_STORE(out, acc);
+      out += 16;
+      shift -= 32;
+      acc = shift > 0 ? ARSENAL_BP_SHR(v, bits - shift) : ARSENAL_BP_ZERO();
+    }
+  }
+}
+
+#define ARSENAL_BP_CASES(F) \
+  F(1) F(2) F(3) F(4) F(5) F(6) F(7) F(8) F(9) F(10) F(11) F(12) F(13) \
+  F(14) F(15) F(16) F(17) F(18) F(19) F(20) F(21) F(22) F(23) F(24) F(25) \
+  F(26) F(27) F(28) F(29) F(30) F(31) F(32)
+
+static void arsenal_bp_unpack128(const uint8_t* in, uint32_t* out, int bits) {
+  switch (bits) {
+#define ARSENAL_BP_UNPACK_CASE(b) case b: arsenal_bp_unpack_w(in, out, b); return;
+    ARSENAL_BP_CASES(ARSENAL_BP_UNPACK_CASE)
+#undef ARSENAL_BP_UNPACK_CASE
+    default: memset(out, 0, 128 * sizeof(uint32_t));
+  }
+}
+
+static void arsenal_bp_pack128(const uint32_t* in, uint8_t* out, int bits) {
+  switch (bits) {
+#define ARSENAL_BP_PACK_CASE(b) case b: arsenal_bp_pack_w(in, out, b); return;
+    ARSENAL_BP_CASES(ARSENAL_BP_PACK_CASE)
+#undef ARSENAL_BP_PACK_CASE
+    default: return;
+  }
+}
+""".}
+
+  proc bpUnpack128(input: pointer, output: pointer, bits: cint)
+    {.importc: "arsenal_bp_unpack128", nodecl.}
+  proc bpPack128(input: pointer, output: pointer, bits: cint)
+    {.importc: "arsenal_bp_pack128", nodecl.}
+
+# =============================================================================
+# Packing 128 Integers
+# =============================================================================
+
+proc loadWord(input: openArray[byte], i: int): uint32 {.inline.} =
+  uint32(input[4*i]) or (uint32(input[4*i + 1]) shl 8) or
+    (uint32(input[4*i + 2]) shl 16) or (uint32(input[4*i + 3]) shl 24)
+
+proc storeWord(output: var openArray[byte], i: int, w: uint32) {.inline.} =
+  output[4*i] = byte(w and 0xFF)
+  output[4*i + 1] = byte((w shr 8) and 0xFF)
+  output[4*i + 2] = byte((w shr 16) and 0xFF)
+  output[4*i + 3] = byte(w shr 24)
+
+proc lowMask(bits: int): uint32 {.inline.} =
+  if bits >= 32: high(uint32) else: (1'u32 shl bits) - 1
+
+proc pack128Scalar*(values: openArray[uint32], bits: int,
+                    output: var openArray[byte]) =
+  ## Portable packer (reference for the SIMD kernels). Only the low
+  ## `bits` of each value are kept.
+  assert values.len >= BlockSize and output.len >= packedSize(bits)
+  if bits == 0:
+    return
+  let mask = lowMask(bits)
+  for lane in 0 ..< 4:
+    var acc = 0'u32
+    var shift = 0
+    var word = 0
+    for i in 0 ..< 32:
+      let v = values[4*i + lane] and mask
+      acc = acc or (v shl shift)
+      shift += bits
+      if shift >= 32:
+        storeWord(output, 4*word + lane, acc)
+        inc word
+        shift -= 32
+        acc = if shift > 0: v shr (bits - shift) else: 0'u32
+
+proc unpack128Scalar*(input: openArray[byte], bits: int,
+                      output: var openArray[uint32]) =
+  ## Portable unpacker (reference for the SIMD kernels)
+  assert output.len >= BlockSize and input.len >= packedSize(bits)
+  if bits == 0:
+    for i in 0 ..< BlockSize:
+      output[i] = 0
+    return
+  let mask = lowMask(bits)
+  for lane in 0 ..< 4:
+    var word = 0
+    var w = loadWord(input, lane)
+    var shift = 0
+    for i in 0 ..< 32:
+      var v = w shr shift
+      shift += bits
+      if shift >= 32:
+        shift -= 32
+        if i < 31:
+          inc word
+          w = loadWord(input, 4*word + lane)
+        if shift > 0:
+          v = v or (w shl (bits - shift))
+      output[4*i + lane] = v and mask
+
+proc pack128*(values: openArray[uint32], bits: int, output: var openArray[byte]) =
+  ## Pack `values[0 ..< 128]` at `bits` (0..32) into `packedSize(bits)`
+  ## bytes of `output`. Only the low `bits` of each value are kept.
+  if bits notin 0..32:
+    raise newException(ValueError, "bit width must be in 0..32")
+  if values.len < BlockSize or output.len < packedSize(bits):
+    raise newException(ValueError, "pack128 needs 128 values and packedSize(bits) bytes")
+  when X86Bp or ArmBp:
+    if bits > 0:
+      bpPack128(unsafeAddr values[0], addr output[0], cint(bits))
+  else:
+    pack128Scalar(values, bits, output)
+
+proc unpack128*(input: openArray[byte], bits: int, output: var openArray[uint32]) =
+  ## Unpack 128 integers of width `bits` into `output[0 ..< 128]`
+  if bits notin 0..32:
+    raise newException(ValueError, "bit width must be in 0..32")
+  if output.len < BlockSize or input.len < packedSize(bits):
+    raise newException(ValueError, "unpack128 needs 128 outputs and packedSize(bits) bytes")
+  when X86Bp or ArmBp:
+    bpUnpack128(if bits > 0: unsafeAddr input[0] else: nil, addr output[0], cint(bits))
+  else:
+    unpack128Scalar(input, bits, output)
+
+# =============================================================================
+# Bit Streams (PFOR exceptions)
+# =============================================================================
+
+proc putBits(output: var seq[byte], values: openArray[uint32], bits: int) =
+  ## Append `values` at `bits` each, LSB first, padded to a whole byte
+  if bits == 0:
+    return
+  var acc = 0'u64
+  var filled = 0
+  for v in values:
+    acc = acc or (uint64(v) shl filled)
+    filled += bits
+    while filled >= 8:
+      output.add byte(acc and 0xFF)
+      acc = acc shr 8
+      filled -= 8
+  if filled > 0:
+    output.add byte(acc and 0xFF)
+
+proc bitStreamSize(count, bits: int): int {.inline.} =
+  (count * bits + 7) div 8
+
+# =============================================================================
+# BP128 Blocks
+# =============================================================================
+
+proc bp128BlockSize*(values: openArray[uint32]): int =
+  ## Encoded size of one block (at most 128 values)
+  1 + packedSize(maxBitWidth(values))
+
+proc addBP128Block*(output: var seq[byte], values: openArray[uint32]) =
+  ## Append one block of at most 128 values
+  assert values.len in 1..BlockSize
+  let bits = maxBitWidth(values)
+  let pos = output.len
+  output.setLen(pos + 1 + packedSize(bits))
+  output[pos] = byte(bits)
+  if values.len == BlockSize:
+    pack128(values, bits, output.toOpenArray(pos + 1, output.high))
+  else:
+    var padded: array[BlockSize, uint32]
+    for i in 0 ..< values.len:
+      padded[i] = values[i]
+    pack128(padded, bits, output.toOpenArray(pos + 1, output.high))
+
+proc decodeBP128Block*(input: openArray[byte], pos: int,
+                       output: var openArray[uint32]): int =
+  ## Decode the block at `input[pos]` into `output` (its length is the
+  ## block's value count); returns the position after the block
+  if pos >= input.len:
+    raise newException(ValueError, "truncated BP128 block")
+  let bits = int(input[pos])
+  if bits > 32 or pos + 1 + packedSize(bits) > input.len:
+    raise newException(ValueError, "corrupt BP128 block")
+  if output.len == BlockSize:
+    unpack128(input.toOpenArray(pos + 1, input.high), bits, output)
+  else:
+    var scratch {.noinit.}: array[BlockSize, uint32]
+    unpack128(input.toOpenArray(pos + 1, input.high), bits, scratch)
+    for i in 0 ..< output.len:
+      output[i] = scratch[i]
+  pos + 1 + packedSize(bits)
+
+# =============================================================================
+# PFOR Blocks
+# =============================================================================
+
+proc pforPlan(values: openArray[uint32]): tuple[base: uint32, bits, maxBits, exceptions: int] =
+  ## Pick the base and width minimising the block size
+  var base = high(uint32)
+  for v in values:
+    base = min(base, v)
+  var histogram: array[33, int]
+  for v in values:
+    inc histogram[bitWidth(v - base)]
+  var maxBits = 32
+  while maxBits > 0 and histogram[maxBits] == 0:
+    dec maxBits
+  result = (base, maxBits, maxBits, 0)
+  var best = packedSize(maxBits)
+  var exceptions = 0
+  for bits in countdown(maxBits - 1, 0):
+    exceptions += histogram[bits + 1]
+    let size = packedSize(bits) + exceptions +
+               bitStreamSize(exceptions, maxBits - bits)
+    if size < best:
+      best = size
+      result = (base, bits, maxBits, exceptions)
+
+proc pforBlockSize*(values: openArray[uint32]): int =
+  ## Encoded size of one block (at most 128 values)
+  let plan = pforPlan(values)
+  PForHeaderSize + packedSize(plan.bits) + plan.exceptions +
+    bitStreamSize(plan.exceptions, plan.maxBits - plan.bits)
+
+proc addPForBlock*(output: var seq[byte], values: openArray[uint32]) =
+  ## Append one block of at most 128 values
+  assert values.len in 1..BlockSize
+  let (base, bits, maxBits, exceptions) = pforPlan(values)
+  var offsets {.noinit.}: array[BlockSize, uint32]
+  var positions: array[BlockSize, byte]
+  var highs: array[BlockSize, uint32]
+  var n = 0
+  for i in 0 ..< BlockSize:
+    offsets[i] = if i < values.len: values[i] - base else: 0'u32
+    if bitWidth(offsets[i]) > bits:
+      positions[n] = byte(i)
+      highs[n] = offsets[i] shr bits
+      inc n
+  assert n == exceptions
+
+  let pos = output.len
+  output.setLen(pos + PForHeaderSize + packedSize(bits))
+  output[pos] = byte(base and 0xFF)
+  output[pos + 1] = byte((base shr 8) and 0xFF)
+  output[pos + 2] = byte((base shr 16) and 0xFF)
+  output[pos + 3] = byte(base shr 24)
+  output[pos + 4] = byte(bits)
+  output[pos + 5] = byte(exceptions)
+  output[pos + 6] = byte(maxBits)
+  pack128(offsets, bits, output.toOpenArray(pos + PForHeaderSize, output.high))
+  for i in 0 ..< n:
+    output.add positions[i]
+  putBits(output, highs.toOpenArray(0, n - 1), maxBits - bits)
+
+proc unpackPFor(input: openArray[byte], pos: int, base: uint32,
+                bits, exceptions, highBits: int, full: var openArray[uint32]) =
+  ## Unpack a full 128-value PFOR block whose packed bits start at `pos`
+  unpack128(input.toOpenArray(pos, input.high), bits, full)
+  # Patch the high bits of the exceptions back in
+  let patches = pos + packedSize(bits)
+  let mask = uint64(lowMask(highBits))
+  var p = patches + exceptions
+  var acc = 0'u64
+  var filled = 0
+  for i in 0 ..< exceptions:
+    while filled < highBits:
+      acc = acc or (uint64(input[p]) shl filled)
+      inc p
+      filled += 8
+    let position = int(input[patches + i])
+    full[position] = full[position] or (uint32(acc and mask) shl bits)
+    acc = acc shr highBits
+    filled -= highBits
+  if base != 0:
+    for i in 0 ..< BlockSize:
+      full[i] += base
+
+proc decodePForBlock*(input: openArray[byte], pos: int,
+                      output: var openArray[uint32]): int =
+  ## Decode the block at `input[pos]` into `output` (its length is the
+  ## block's value count); returns the position after the block
+  if pos + PForHeaderSize > input.len:
+    raise newException(ValueError, "truncated PFOR block")
+  let base = uint32(input[pos]) or (uint32(input[pos + 1]) shl 8) or
+             (uint32(input[pos + 2]) shl 16) or (uint32(input[pos + 3]) shl 24)
+  let bits = int(input[pos + 4])
+  let exceptions = int(input[pos + 5])
+  let maxBits = int(input[pos + 6])
+  let highBits = maxBits - bits
+  let packed = pos + PForHeaderSize
+  result = packed + packedSize(bits) + exceptions + bitStreamSize(exceptions, highBits)
+  if bits > 32 or maxBits > 32 or highBits < 0 or exceptions > BlockSize or
+     (exceptions > 0 and highBits == 0) or result > input.len:
+    raise newException(ValueError, "corrupt PFOR block")
+  let positions = packed + packedSize(bits)
+  for i in 0 ..< exceptions:
+    if int(input[positions + i]) >= BlockSize:
+      raise newException(ValueError, "corrupt PFOR block")
+  if output.len == BlockSize:
+    unpackPFor(input, packed, base, bits, exceptions, highBits, output)
+  else:
+    var scratch {.noinit.}: array[BlockSize, uint32]
+    unpackPFor(input, packed, base, bits, exceptions, highBits, scratch)
+    for i in 0 ..< output.len:
+      output[i] = scratch[i]
+
+# =============================================================================
+# Streams
+# =============================================================================
+
+proc encodeBP128*(values: openArray[uint32]): seq[byte] =
+  ## Pack `values` as a sequence of BP128 blocks
+  var i = 0
+  while i < values.len:
+    let n = min(BlockSize, values.len - i)
+    result.addBP128Block(values.toOpenArray(i, i + n - 1))
+    i += n
+
+proc decodeBP128*(input: openArray[byte], output: var openArray[uint32]): int =
+  ## Decode `output.len` integers; returns the bytes consumed
+  var i = 0
+  while i < output.len:
+    let n = min(BlockSize, output.len - i)
+    result = decodeBP128Block(input, result, output.toOpenArray(i, i + n - 1))
+    i += n
+
+proc encodePFor*(values: openArray[uint32]): seq[byte] =
+  ## Encode `values` as a sequence of PFOR blocks
+  var i = 0
+  while i < values.len:
+    let n = min(BlockSize, values.len - i)
+    result.addPForBlock(values.toOpenArray(i, i + n - 1))
+    i += n
+
+proc decodePFor*(input: openArray[byte], output: var openArray[uint32]): int =
+  ## Decode `output.len` integers; returns the bytes consumed
+  var i = 0
+  while i < output.len:
+    let n = min(BlockSize, output.len - i)
+    result = decodePForBlock(input, result, output.toOpenArray(i, i + n - 1))
+    i += n
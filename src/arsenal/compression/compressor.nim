@@ -16,14 +16,16 @@
 ## let compressed = lz4.compress(data)
 ## let decompressed = lz4.decompress(compressed, originalSize)
 ##
-## # Streaming compression
-## var compressor = Lz4Compressor.init()
-## for chunk in chunks:
-##   let compressed = compressor.compress(chunk)
-##   output.write(compressed)
+## # Streaming compression into a reused buffer (no allocation per chunk)
+## var stream = Lz4StreamCompressor.init()
+## var buf = newSeq[byte](stream.compressBound(Lz4StreamBlockSize))
+## for chunk in chunks:                    # each at most Lz4StreamBlockSize
+##   let n = stream.compressInto(chunk, buf)
+##   socket.send(addr buf[0], n)
 ## ```
 
 import std/options
+import ../hashing/crc
 
 type
   CompressionLevel* = range[1..22]
@@ -121,22 +123,32 @@ type
     ## Frame layout (little-endian):
     ## - Magic: 4 bytes (0x41 0x52 0x53 0x4C = "ARSL")
     ## - Version: 1 byte
-    ## - Flags: 1 byte (bit 0 = checksum present)
+    ## - Flags: 1 byte (bit 0 = checksum present, bit 2 = dictionary ID)
     ## - Original size: 8 bytes (uint64)
+    ## - Dictionary ID: 4 bytes (optional; the dictionary needed to decode)
     ## - Compressed data: variable
-    ## - Checksum: 4 bytes (xxHash32, optional)
+    ## - Checksum: 4 bytes (CRC-32C of the compressed data, optional)
+    ##
+    ## Version 1 frames carried an XOR-of-bytes checksum instead; they are
+    ## still accepted by `decodeFrame`.
 
     magic*: array[4, byte]
     version*: uint8
     flags*: uint8
     originalSize*: uint64
+    dictId*: Option[uint32]
     data*: seq[byte]
     checksum*: Option[uint32]
 
 const
   FrameMagic* = [byte 0x41, 0x52, 0x53, 0x4C]  # "ARSL"
-  FrameVersion* = 1'u8
+  FrameVersion* = 2'u8
+  LegacyFrameVersion* = 1'u8   ## XOR checksum, decode only
+  BlockFrameVersion* = 3'u8    ## Independent blocks + index, see `parallel_frame`
   FlagChecksum* = 0b00000001'u8
+  FlagBlockIndex* = 0b00000010'u8
+  FlagDictionary* = 0b00000100'u8
+  FrameHeaderSize* = 14
 
 proc okFrame*(frame: CompressionFrame): CompressionResult[CompressionFrame] =
   ## Create successful compression result for frame.
@@ -148,10 +160,27 @@ proc okFrame*(frame: CompressionFrame): CompressionResult[CompressionFrame] =
     ratio: if frame.data.len > 0: frame.originalSize.float / frame.data.len.float else: 0.0
   )
 
-proc encodeFrame*(data: seq[byte], originalSize: uint64, includeChecksum: bool = true): seq[byte] =
+proc legacyChecksum(data: openArray[byte]): uint32 =
+  ## Version 1 frame checksum: XOR of all bytes.
+  for b in data:
+    result = result xor b.uint32
+
+proc frameHeader*(version, flags: uint8, originalSize: uint64): array[FrameHeaderSize, byte] =
+  ## The fixed 14-byte frame header: magic, version, flags, original size.
+  for i in 0..<4:
+    result[i] = FrameMagic[i]
+  result[4] = version
+  result[5] = flags
+  for i in 0..<8:
+    result[6 + i] = byte((originalSize shr (i * 8)) and 0xFF)
+
+proc encodeFrame*(data: seq[byte], originalSize: uint64, includeChecksum: bool = true,
+                  dictId: uint32 = 0): seq[byte] =
   ## Encode compressed data into frame format.
+  ## A non-zero `dictId` records the dictionary `data` was compressed with.
 
-  result = newSeq[byte](4 + 1 + 1 + 8 + data.len + (if includeChecksum: 4 else: 0))
+  let dictSize = if dictId != 0: 4 else: 0
+  result = newSeq[byte](4 + 1 + 1 + 8 + dictSize + data.len + (if includeChecksum: 4 else: 0))
 
   var offset = 0
 
@@ -164,7 +193,9 @@ proc encodeFrame*(data: seq[byte], originalSize: uint64, includeChecksum: bool =
   offset += 1
 
   # Write flags
-  let flags = if includeChecksum: FlagChecksum else: 0'u8
+  var flags = if includeChecksum: FlagChecksum else: 0'u8
+  if dictId != 0:
+    flags = flags or FlagDictionary
   result[offset] = flags
   offset += 1
 
@@ -173,15 +204,19 @@ proc encodeFrame*(data: seq[byte], originalSize: uint64, includeChecksum: bool =
     result[offset + i] = byte((originalSize shr (i * 8)) and 0xFF)
   offset += 8
 
+  # Write dictionary ID
+  if dictId != 0:
+    for i in 0..<4:
+      result[offset + i] = byte((dictId shr (i * 8)) and 0xFF)
+    offset += 4
+
   # Write compressed data
   result[offset..offset+data.len-1] = data
   offset += data.len
 
-  # Write checksum if requested (simplified: just XOR all bytes)
+  # Write checksum if requested (hardware CRC-32C where available)
   if includeChecksum:
-    var checksum = 0u32
-    for b in data:
-      checksum = checksum xor b.uint32
+    let checksum = crc32c(data)
     for i in 0..<4:
       result[offset + i] = byte((checksum shr (i * 8)) and 0xFF)
 
@@ -203,7 +238,9 @@ proc decodeFrame*(data: openArray[byte]): CompressionResult[CompressionFrame] =
 
   # Read version
   frame.version = data[offset]
-  if frame.version != FrameVersion:
+  if frame.version == BlockFrameVersion:
+    return err[CompressionFrame]("Block-indexed frame: read it with decompressFrame")
+  if frame.version != FrameVersion and frame.version != LegacyFrameVersion:
     return err[CompressionFrame]("Unsupported frame version")
   offset += 1
 
@@ -217,6 +254,16 @@ proc decodeFrame*(data: openArray[byte]): CompressionResult[CompressionFrame] =
     frame.originalSize = frame.originalSize or (data[offset + i].uint64 shl (i * 8))
   offset += 8
 
+  # Read dictionary ID
+  if (frame.flags and FlagDictionary) != 0:
+    if data.len < offset + 4:
+      return err[CompressionFrame]("Invalid frame size")
+    var dictId = 0u32
+    for i in 0..<4:
+      dictId = dictId or (data[offset + i].uint32 shl (i * 8))
+    frame.dictId = some(dictId)
+    offset += 4
+
   # Extract compressed data
   let hasChecksum = (frame.flags and FlagChecksum) != 0
   let checksumSize = if hasChecksum: 4 else: 0
@@ -234,9 +281,9 @@ proc decodeFrame*(data: openArray[byte]): CompressionResult[CompressionFrame] =
     for i in 0..<4:
       storedChecksum = storedChecksum or (data[offset + i].uint32 shl (i * 8))
 
-    var computedChecksum = 0u32
-    for b in frame.data:
-      computedChecksum = computedChecksum xor b.uint32
+    let computedChecksum =
+      if frame.version == LegacyFrameVersion: legacyChecksum(frame.data)
+      else: crc32c(frame.data)
 
     if storedChecksum != computedChecksum:
       return err[CompressionFrame]("Checksum mismatch")
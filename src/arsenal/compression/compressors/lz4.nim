@@ -8,9 +8,19 @@
 ## - Compression: ~500 MB/s
 ## - Decompression: ~2000 MB/s (fastest)
 ## - Ratio: 2.0-2.5x (moderate compression)
+##
+## `compressInto`/`decompressInto` work on caller-owned buffers and never
+## allocate. `Lz4StreamCompressor`/`Lz4StreamDecompressor` compress a
+## stream block by block, each block referencing the last 64 KiB, kept
+## in a fixed ring buffer on both sides.
+##
+## `Lz4Dictionary` primes small messages with shared content (up to
+## 64 KiB, e.g. from `trainDictionary`), loaded once and reused.
 
 {.pragma: lz4Import, importc, header: "<lz4.h>".}
 
+import ../../hashing/crc
+
 # =============================================================================
 # LZ4 Types
 # =============================================================================
@@ -60,6 +70,15 @@ proc LZ4_compress_fast_continue*(
 ): cint {.lz4Import.}
   ## Streaming compression
 
+proc LZ4_resetStream_fast*(streamPtr: ptr LZ4_stream_t) {.lz4Import.}
+  ## Reset a compression stream for a new, independent stream
+
+proc LZ4_loadDict*(
+  streamPtr: ptr LZ4_stream_t,
+  dictionary: cstring, dictSize: cint
+): cint {.lz4Import.}
+  ## Load a dictionary (its last 64 KiB) into a compression stream
+
 # Streaming decompression
 proc LZ4_createStreamDecode*(): ptr LZ4_streamDecode_t {.lz4Import.}
   ## Create decompression stream
@@ -74,6 +93,23 @@ proc LZ4_decompress_safe_continue*(
 ): cint {.lz4Import.}
   ## Streaming decompression
 
+proc LZ4_setStreamDecode*(
+  streamPtr: ptr LZ4_streamDecode_t,
+  dictionary: cstring, dictSize: cint
+): cint {.lz4Import.}
+  ## Reset a decompression stream (nil dictionary = independent stream)
+
+proc LZ4_decompress_safe_usingDict*(
+  src: cstring, dst: cstring,
+  compressedSize: cint, dstCapacity: cint,
+  dictStart: cstring, dictSize: cint
+): cint {.lz4Import.}
+  ## Decompress a block compressed against a dictionary
+
+proc lz4Bound*(srcLen: int): int {.inline.} =
+  ## Output space that always suffices to compress `srcLen` bytes
+  int(LZ4_compressBound(srcLen.cint))
+
 # =============================================================================
 # Nim Wrapper
 # =============================================================================
@@ -108,6 +144,27 @@ proc `=destroy`*(c: var Lz4Compressor) =
     discard LZ4_freeStream(c.stream)
     c.stream = nil
 
+proc `=copy`*(dest: var Lz4Compressor, src: Lz4Compressor) {.error.}
+  ## Prevent copying (stream is not copyable)
+
+proc compressInto*(c: var Lz4Compressor, src: openArray[byte],
+                   dst: var openArray[byte]): int =
+  ## Compress `src` into `dst` and return the compressed size, without
+  ## allocating. `dst.len >= lz4Bound(src.len)` always suffices; raises
+  ## IOError if `dst` is too small.
+  if src.len == 0:
+    return 0
+  if dst.len == 0:
+    raise newException(IOError, "LZ4 compression failed: output buffer too small")
+  result = LZ4_compress_default(
+    cast[cstring](unsafeAddr src[0]),
+    cast[cstring](addr dst[0]),
+    src.len.cint,
+    min(dst.len, high(cint).int).cint
+  )
+  if result <= 0:
+    raise newException(IOError, "LZ4 compression failed: output buffer too small")
+
 proc compress*(c: var Lz4Compressor, data: openArray[byte]): seq[byte] =
   ## Compress data using LZ4.
   ##
@@ -126,23 +183,9 @@ proc compress*(c: var Lz4Compressor, data: openArray[byte]): seq[byte] =
   if data.len == 0:
     return @[]
 
-  # Calculate maximum compressed size
-  let maxCompressedSize = LZ4_compressBound(data.len.cint)
-  result = newSeq[byte](maxCompressedSize)
-
-  # Compress using C pointers for zero-copy
-  let compressedSize = LZ4_compress_default(
-    cast[cstring](unsafeAddr data[0]),
-    cast[cstring](addr result[0]),
-    data.len.cint,
-    maxCompressedSize
-  )
-
-  if compressedSize <= 0:
-    raise newException(IOError, "LZ4 compression failed")
-
-  # Resize to actual compressed size
-  result.setLen(compressedSize)
+  # Compress into a worst-case buffer, then trim
+  result = newSeq[byte](lz4Bound(data.len))
+  result.setLen(c.compressInto(data, result))
 
 proc compress*(data: openArray[byte]): seq[byte] =
   ## One-shot compression.
@@ -181,6 +224,26 @@ proc `=destroy`*(d: var Lz4Decompressor) =
     discard LZ4_freeStreamDecode(d.stream)
     d.stream = nil
 
+proc `=copy`*(dest: var Lz4Decompressor, src: Lz4Decompressor) {.error.}
+  ## Prevent copying
+
+proc decompressInto*(d: var Lz4Decompressor, src: openArray[byte],
+                     dst: var openArray[byte]): int =
+  ## Decompress `src` into `dst` and return the decompressed size, without
+  ## allocating. Raises IOError on corrupt input or if `dst` is too small.
+  if src.len == 0:
+    return 0
+  if dst.len == 0:
+    raise newException(IOError, "LZ4 decompression failed: output buffer too small")
+  result = LZ4_decompress_safe(
+    cast[cstring](unsafeAddr src[0]),
+    cast[cstring](addr dst[0]),
+    src.len.cint,
+    min(dst.len, high(cint).int).cint
+  )
+  if result < 0:
+    raise newException(IOError, "LZ4 decompression failed: corrupted data or insufficient buffer")
+
 proc decompress*(d: var Lz4Decompressor, data: openArray[byte], maxOutputSize: int): seq[byte] =
   ## Decompress LZ4 data.
   ## maxOutputSize: Maximum expected output size for safety.
@@ -207,27 +270,274 @@ proc decompress*(d: var Lz4Decompressor, data: openArray[byte], maxOutputSize: i
   if maxOutputSize <= 0:
     raise newException(ValueError, "maxOutputSize must be positive")
 
-  # Allocate output buffer
+  # Decompress with bounds checking, then trim
   result = newSeq[byte](maxOutputSize)
+  result.setLen(d.decompressInto(data, result))
+
+proc decompress*(data: openArray[byte], maxOutputSize: int): seq[byte] =
+  ## One-shot decompression.
+  var decompressor = Lz4Decompressor.init()
+  result = decompressor.decompress(data, maxOutputSize)
+
+# =============================================================================
+# Dictionaries
+# =============================================================================
+
+const Lz4MaxDictSize* = 64 * 1024        ## LZ4 only references the last 64 KiB
+
+type
+  Lz4Dictionary* = object
+    ## Dictionary loaded once into a template stream. Each message copies
+    ## the stream state (a memcpy of LZ4_stream_t) instead of re-hashing
+    ## the dictionary.
+    content: seq[byte]                   ## Last 64 KiB of the dictionary
+    stream: ptr LZ4_stream_t             ## Template state, `content` loaded
+    id: uint32
+
+proc init*(_: typedesc[Lz4Dictionary], content: openArray[byte]): Lz4Dictionary =
+  ## Prepare dictionary content; only its last 64 KiB are used.
+  if content.len == 0:
+    raise newException(ValueError, "Empty LZ4 dictionary")
+  result.id = max(crc32c(content), 1'u32)
+  result.content = @(content.toOpenArray(max(0, content.len - Lz4MaxDictSize), content.high))
+  result.stream = LZ4_createStream()
+  if result.stream == nil:
+    raise newException(IOError, "Failed to create LZ4 stream")
+  discard LZ4_loadDict(result.stream, cast[cstring](addr result.content[0]),
+                       result.content.len.cint)
 
-  # Decompress with bounds checking
-  let decompressedSize = LZ4_decompress_safe(
-    cast[cstring](unsafeAddr data[0]),
-    cast[cstring](addr result[0]),
-    data.len.cint,
-    maxOutputSize.cint
+proc `=destroy`*(d: var Lz4Dictionary) =
+  if d.stream != nil:
+    discard LZ4_freeStream(d.stream)
+    d.stream = nil
+  `=destroy`(d.content)
+
+proc `=copy`*(dest: var Lz4Dictionary, src: Lz4Dictionary) {.error.}
+  ## Prevent copying (the stream points into `content`)
+
+proc id*(d: Lz4Dictionary): uint32 {.inline.} =
+  ## Dictionary ID (CRC-32C of the content given to `init`, never 0)
+  d.id
+
+proc compressInto*(c: var Lz4Compressor, dict: Lz4Dictionary,
+                   src: openArray[byte], dst: var openArray[byte]): int =
+  ## Compress `src` into `dst` against a dictionary and return the
+  ## compressed size. Raises IOError if `dst` is too small.
+  if src.len == 0:
+    return 0
+  if dst.len == 0:
+    raise newException(IOError, "LZ4 compression failed: output buffer too small")
+  copyMem(c.stream, dict.stream, sizeof(LZ4_stream_t))
+  result = LZ4_compress_fast_continue(
+    c.stream,
+    cast[cstring](unsafeAddr src[0]),
+    cast[cstring](addr dst[0]),
+    src.len.cint,
+    min(dst.len, high(cint).int).cint, 1
   )
+  if result <= 0:
+    raise newException(IOError, "LZ4 compression failed: output buffer too small")
 
-  if decompressedSize < 0:
+proc compress*(c: var Lz4Compressor, dict: Lz4Dictionary, data: openArray[byte]): seq[byte] =
+  ## Compress data against a dictionary.
+  if data.len == 0:
+    return @[]
+  result = newSeq[byte](lz4Bound(data.len))
+  result.setLen(c.compressInto(dict, data, result))
+
+proc decompressInto*(d: var Lz4Decompressor, dict: Lz4Dictionary,
+                     src: openArray[byte], dst: var openArray[byte]): int =
+  ## Decompress a block compressed against `dict` into `dst`. Raises
+  ## IOError on corrupt input or if `dst` is too small.
+  if src.len == 0:
+    return 0
+  if dst.len == 0:
+    raise newException(IOError, "LZ4 decompression failed: output buffer too small")
+  result = LZ4_decompress_safe_usingDict(
+    cast[cstring](unsafeAddr src[0]),
+    cast[cstring](addr dst[0]),
+    src.len.cint,
+    min(dst.len, high(cint).int).cint,
+    cast[cstring](unsafeAddr dict.content[0]),
+    dict.content.len.cint
+  )
+  if result < 0:
     raise newException(IOError, "LZ4 decompression failed: corrupted data or insufficient buffer")
 
-  # Resize to actual decompressed size
-  result.setLen(decompressedSize)
+proc decompress*(d: var Lz4Decompressor, dict: Lz4Dictionary, data: openArray[byte],
+                 maxOutputSize: int): seq[byte] =
+  ## Decompress data compressed against `dict`.
+  if data.len == 0:
+    return @[]
+  result = newSeq[byte](maxOutputSize)
+  result.setLen(d.decompressInto(dict, data, result))
 
-proc decompress*(data: openArray[byte], maxOutputSize: int): seq[byte] =
-  ## One-shot decompression.
-  var decompressor = Lz4Decompressor.init()
-  result = decompressor.decompress(data, maxOutputSize)
+# =============================================================================
+# Block Streams
+# =============================================================================
+#
+# Stream format: blocks of at most `blockSize` input bytes, each written
+# as compressed size (4 bytes LE), original size (4 bytes LE) and the LZ4
+# block. A block may reference up to 64 KiB of earlier input, so both
+# sides copy their data through a ring buffer of 64 KiB + blockSize and
+# wrap at the same positions (where the next block would not fit).
+
+const
+  Lz4StreamBlockSize* = 64 * 1024        ## Default input bytes per block
+  Lz4StreamHeaderSize* = 8
+  Lz4MaxStreamBlockSize* = 1 shl 24
+  Lz4Window = 64 * 1024
+
+type
+  Lz4StreamCompressor* = object
+    ## Streaming LZ4 compressor writing into caller-owned buffers.
+    stream: ptr LZ4_stream_t
+    ring: seq[byte]
+    pos: int
+    blockSize: int
+
+  Lz4StreamDecompressor* = object
+    ## Streaming LZ4 decompressor for `Lz4StreamCompressor` output.
+    stream: ptr LZ4_streamDecode_t
+    ring: seq[byte]
+    pos: int
+    blockSize: int
+
+proc putLE32(dst: var openArray[byte], pos: int, v: int) {.inline.} =
+  for i in 0 ..< 4:
+    dst[pos + i] = byte((v shr (8 * i)) and 0xFF)
+
+proc getLE32(src: openArray[byte], pos: int): int {.inline.} =
+  int(src[pos]) or (int(src[pos + 1]) shl 8) or
+    (int(src[pos + 2]) shl 16) or (int(src[pos + 3]) shl 24)
+
+proc checkBlockSize(blockSize: int) =
+  if blockSize < 1 or blockSize > Lz4MaxStreamBlockSize:
+    raise newException(ValueError, "LZ4 stream block size must be in 1 .. " &
+      $Lz4MaxStreamBlockSize)
+
+proc init*(_: typedesc[Lz4StreamCompressor],
+           blockSize = Lz4StreamBlockSize): Lz4StreamCompressor =
+  ## Create a stream compressor. The ring buffer is allocated here, once;
+  ## `compressInto` allocates nothing.
+  checkBlockSize(blockSize)
+  result.stream = LZ4_createStream()
+  if result.stream == nil:
+    raise newException(IOError, "Failed to create LZ4 stream")
+  result.blockSize = blockSize
+  result.ring = newSeq[byte](Lz4Window + blockSize)
+
+proc `=destroy`*(s: var Lz4StreamCompressor) =
+  if s.stream != nil:
+    discard LZ4_freeStream(s.stream)
+    s.stream = nil
+  `=destroy`(s.ring)
+
+proc `=copy`*(dest: var Lz4StreamCompressor, src: Lz4StreamCompressor) {.error.}
+  ## Prevent copying (stream is not copyable)
+
+proc compressBound*(s: Lz4StreamCompressor, srcLen: int): int =
+  ## Output space that always suffices for `compressInto` on `srcLen` bytes
+  let full = srcLen div s.blockSize
+  let rest = srcLen mod s.blockSize
+  result = full * (Lz4StreamHeaderSize + lz4Bound(s.blockSize))
+  if rest > 0:
+    result += Lz4StreamHeaderSize + lz4Bound(rest)
+
+proc compressInto*(s: var Lz4StreamCompressor, src: openArray[byte],
+                   dst: var openArray[byte]): int =
+  ## Append `src` to the stream: compress it as one or more blocks into
+  ## `dst` and return the bytes written. Raises IOError if `dst` is
+  ## smaller than needed (`compressBound` always suffices); the stream
+  ## must then be `reset`.
+  var i = 0
+  while i < src.len:
+    let n = min(s.blockSize, src.len - i)
+    if s.pos + n > s.ring.len:
+      s.pos = 0
+    copyMem(addr s.ring[s.pos], unsafeAddr src[i], n)
+    let room = dst.len - result - Lz4StreamHeaderSize
+    if room <= 0:
+      raise newException(IOError, "LZ4 stream: output buffer too small")
+    let size = LZ4_compress_fast_continue(
+      s.stream,
+      cast[cstring](addr s.ring[s.pos]),
+      cast[cstring](addr dst[result + Lz4StreamHeaderSize]),
+      n.cint, min(room, high(cint).int).cint, 1)
+    if size <= 0:
+      raise newException(IOError, "LZ4 stream: output buffer too small")
+    dst.putLE32(result, size)
+    dst.putLE32(result + 4, n)
+    result += Lz4StreamHeaderSize + size
+    s.pos += n
+    i += n
+
+proc compress*(s: var Lz4StreamCompressor, data: openArray[byte]): seq[byte] =
+  ## Append `data` to the stream, returning its blocks in a new seq.
+  result = newSeq[byte](s.compressBound(data.len))
+  result.setLen(s.compressInto(data, result))
+
+proc finish*(s: var Lz4StreamCompressor): seq[byte] =
+  ## Blocks are complete as written, so there is nothing to flush.
+  @[]
+
+proc reset*(s: var Lz4StreamCompressor) =
+  ## Start an independent stream (forget the history)
+  LZ4_resetStream_fast(s.stream)
+  s.pos = 0
+
+proc init*(_: typedesc[Lz4StreamDecompressor],
+           blockSize = Lz4StreamBlockSize): Lz4StreamDecompressor =
+  ## Create a stream decompressor; `blockSize` must match the compressor's.
+  checkBlockSize(blockSize)
+  result.stream = LZ4_createStreamDecode()
+  if result.stream == nil:
+    raise newException(IOError, "Failed to create LZ4 decode stream")
+  result.blockSize = blockSize
+  result.ring = newSeq[byte](Lz4Window + blockSize)
+
+proc `=destroy`*(d: var Lz4StreamDecompressor) =
+  if d.stream != nil:
+    discard LZ4_freeStreamDecode(d.stream)
+    d.stream = nil
+  `=destroy`(d.ring)
+
+proc `=copy`*(dest: var Lz4StreamDecompressor, src: Lz4StreamDecompressor) {.error.}
+  ## Prevent copying
+
+proc decompressInto*(d: var Lz4StreamDecompressor, src: openArray[byte],
+                     dst: var openArray[byte]): tuple[consumed, written: int] =
+  ## Decode the complete blocks at the start of `src` into `dst`, stopping
+  ## at a block that is cut off or would not fit. Input may end anywhere
+  ## (a partial socket read): pass the unconsumed rest again once more has
+  ## arrived. A `dst` of at least the block size always makes progress.
+  ## Raises IOError on corrupt input.
+  while src.len - result.consumed >= Lz4StreamHeaderSize:
+    let p = result.consumed
+    let size = src.getLE32(p)
+    let n = src.getLE32(p + 4)
+    if size < 1 or n < 1 or n > d.blockSize or size > lz4Bound(n):
+      raise newException(IOError, "LZ4 stream: corrupt block header")
+    if src.len - p - Lz4StreamHeaderSize < size or dst.len - result.written < n:
+      break
+    if d.pos + n > d.ring.len:
+      d.pos = 0
+    let got = LZ4_decompress_safe_continue(
+      d.stream,
+      cast[cstring](unsafeAddr src[p + Lz4StreamHeaderSize]),
+      cast[cstring](addr d.ring[d.pos]),
+      size.cint, n.cint)
+    if got != n:
+      raise newException(IOError, "LZ4 stream: corrupt block")
+    copyMem(addr dst[result.written], addr d.ring[d.pos], n)
+    d.pos += n
+    result.consumed += Lz4StreamHeaderSize + size
+    result.written += n
+
+proc reset*(d: var Lz4StreamDecompressor) =
+  ## Expect a new, independent stream
+  discard LZ4_setStreamDecode(d.stream, nil, 0)
+  d.pos = 0
 
 # Header and library setup
 when defined(windows):
@@ -0,0 +1,312 @@
+## Native LZ4 Block Codec
+## ======================
+##
+## Dependency-free LZ4 block compression in Nim, byte-compatible with the
+## LZ4 block format: output decodes with liblz4's `LZ4_decompress_safe`,
+## and `LZ4_compress_default` output decodes here. For builds that cannot
+## link liblz4 (`--os:standalone`, `embedded/nolibc`): the codec needs
+## only `copyMem` and a 16 KiB hash table on the stack.
+##
+## - Compression: LZ4 fast mode. One hash table of 4096 positions
+##   (5-byte hash on 64-bit), no chains; after repeated misses the search
+##   step grows, as in `acceleration`.
+## - Decompression: bounds-checked like `LZ4_decompress_safe`. Literals
+##   and matches at least 32 (or 16) bytes apart are copied in 32- (or
+##   16-) byte chunks when the buffers have slack for the overrun. Closer
+##   matches copy 8 or 1 byte at a time.
+##
+## Block format (per sequence): token (literal length << 4 | match
+## length - 4), extra length bytes (255 runs), literals, 2-byte LE
+## offset, extra match length bytes. The last sequence has literals only;
+## the last 5 bytes are always literals and no match starts in the last
+## 12.
+##
+## Usage:
+## ```nim
+## import arsenal/compression/compressors/lz4_native
+##
+## var packed = newSeq[byte](nativeLz4Bound(data.len))
+## packed.setLen(nativeLz4Compress(data, packed))
+## var output = newSeq[byte](data.len)
+## assert nativeLz4Decompress(packed, output) == data.len
+## ```
+##
+## Reference: LZ4 Block Format Description (lz4/doc/lz4_Block_format.md)
+
+const
+  MinMatch = 4
+  LastLiterals = 5                       ## The last 5 bytes are literals
+  MFLimit = 12                           ## No match starts in the last 12
+  MaxDistance = 65535
+  HashLog = 12
+  SkipTrigger = 6                        ## Misses before the step grows
+  RunMask = 15
+  NativeLz4MaxInput* = 0x7E000000        ## Same limit as liblz4
+
+type
+  Bytes = ptr UncheckedArray[byte]
+
+template at(p: Bytes, i: int): pointer = addr p[i]
+
+proc read32(p: Bytes, i: int): uint32 {.inline.} =
+  copyMem(addr result, p.at(i), 4)
+
+proc read64(p: Bytes, i: int): uint64 {.inline.} =
+  copyMem(addr result, p.at(i), 8)
+
+proc nativeLz4Bound*(srcLen: int): int {.inline.} =
+  ## Output space that always suffices to compress `srcLen` bytes
+  ## (same as `LZ4_compressBound`)
+  if srcLen < 0 or srcLen > NativeLz4MaxInput: 0
+  else: srcLen + srcLen div 255 + 16
+
+# =============================================================================
+# Compression
+# =============================================================================
+
+proc hashPos(src: Bytes, i: int): int {.inline.} =
+  when sizeof(int) == 8 and cpuEndian == littleEndian:
+    # 5 bytes: fewer collisions than 4 on text-like input
+    int(((read64(src, i) shl 24) * 889523592379'u64) shr (64 - HashLog))
+  else:
+    int((read32(src, i) * 2654435761'u32) shr (32 - HashLog))
+
+proc matchLength(src: Bytes, ip, m, limit: int): int {.inline.} =
+  ## Length of the common run at `ip` and `m`, not extending past `limit`
+  var p = ip
+  var q = m
+  when cpuEndian == littleEndian:
+    while p + 8 <= limit:
+      let diff = read64(src, p) xor read64(src, q)
+      if diff != 0:
+        var tz = 0
+        var d = diff
+        while (d and 0xFF) == 0:
+          d = d shr 8
+          inc tz
+        return p + tz - ip
+      p += 8
+      q += 8
+  while p < limit and src[p] == src[q]:
+    inc p
+    inc q
+  p - ip
+
+proc writeLength(dst: Bytes, op: var int, length: int) {.inline.} =
+  ## Extra length bytes for a length field that overflowed its 4 bits
+  var rest = length - RunMask
+  while rest >= 255:
+    dst[op] = 255
+    inc op
+    rest -= 255
+  dst[op] = byte(rest)
+  inc op
+
+proc compressRaw(src: Bytes, n: int, dst: Bytes, cap: int, acceleration: int): int =
+  ## Compress `n` bytes into `dst`; 0 if `cap` is too small
+  if n > NativeLz4MaxInput:
+    return 0
+  var op = 0
+  var anchor = 0
+
+  if n >= MFLimit + 1:
+    var table {.noinit.}: array[1 shl HashLog, int32]
+    zeroMem(addr table, sizeof(table))
+    let mflimit = n - MFLimit
+    let matchLimit = n - LastLiterals
+    var ip = 1
+    block compress:
+      while true:
+        # Find a match, stepping faster the longer none is found
+        var m = 0
+        var attempts = acceleration shl SkipTrigger
+        while true:
+          if ip > mflimit:
+            break compress
+          let h = hashPos(src, ip)
+          m = int(table[h])
+          table[h] = int32(ip)
+          if ip - m <= MaxDistance and read32(src, m) == read32(src, ip):
+            break
+          ip += attempts shr SkipTrigger
+          inc attempts
+
+        # Extend backwards over literals
+        while ip > anchor and m > 0 and src[ip - 1] == src[m - 1]:
+          dec ip
+          dec m
+
+        # Literals
+        let litLen = ip - anchor
+        if op + litLen + litLen div 255 + 2 + 1 + LastLiterals > cap:
+          return 0
+        var token = op
+        inc op
+        if litLen >= RunMask:
+          dst[token] = byte(RunMask shl 4)
+          writeLength(dst, op, litLen)
+        else:
+          dst[token] = byte(litLen shl 4)
+        copyMem(dst.at(op), src.at(anchor), litLen)
+        op += litLen
+
+        # Matches, chained while the next position matches immediately
+        while true:
+          let offset = ip - m
+          dst[op] = byte(offset and 0xFF)
+          dst[op + 1] = byte(offset shr 8)
+          op += 2
+          let extra = matchLength(src, ip + MinMatch, m + MinMatch, matchLimit)
+          ip += MinMatch + extra
+          if op + extra div 255 + 1 + LastLiterals > cap:
+            return 0
+          if extra >= RunMask:
+            dst[token] = dst[token] or byte(RunMask)
+            writeLength(dst, op, extra)
+          else:
+            dst[token] = dst[token] or byte(extra)
+          anchor = ip
+          if ip > mflimit:
+            break compress
+          table[hashPos(src, ip - 2)] = int32(ip - 2)
+          let h = hashPos(src, ip)
+          m = int(table[h])
+          table[h] = int32(ip)
+          if ip - m > MaxDistance or read32(src, m) != read32(src, ip):
+            break
+          token = op                     # Match with no literals
+          dst[token] = 0
+          inc op
+        inc ip
+
+  # Last literals
+  let litLen = n - anchor
+  if op + 1 + (litLen + 255 - RunMask) div 255 + litLen > cap:
+    return 0
+  let token = op
+  inc op
+  if litLen >= RunMask:
+    dst[token] = byte(RunMask shl 4)
+    writeLength(dst, op, litLen)
+  else:
+    dst[token] = byte(litLen shl 4)
+  if litLen > 0:
+    copyMem(dst.at(op), src.at(anchor), litLen)
+  op + litLen
+
+proc nativeLz4Compress*(src: openArray[byte], dst: var openArray[byte],
+                        acceleration = 1): int =
+  ## Compress `src` into `dst` as one LZ4 block; returns the compressed
+  ## size, or 0 if `dst` is too small (`nativeLz4Bound` always suffices).
+  ## Higher `acceleration` trades ratio for speed, as in liblz4.
+  if dst.len == 0:
+    return 0
+  let s = if src.len > 0: cast[Bytes](unsafeAddr src[0]) else: nil
+  compressRaw(s, src.len, cast[Bytes](addr dst[0]), dst.len, max(1, acceleration))
+
+# =============================================================================
+# Decompression
+# =============================================================================
+
+template wideCopy(dst: Bytes, d: int, src: Bytes, s: int, n: int, chunk: static int) =
+  ## Copy `n` bytes in `chunk`-byte pieces; may write up to chunk - 1
+  ## bytes past the end (the caller checked the slack)
+  var k = 0
+  while k < n:
+    copyMem(dst.at(d + k), src.at(s + k), chunk)
+    k += chunk
+
+proc readLength(src: Bytes, ip: var int, n: int, length: var int): bool {.inline.} =
+  ## Add the extra length bytes at `ip`; false if the input ends first
+  while true:
+    if ip >= n:
+      return false
+    let b = int(src[ip])
+    inc ip
+    length += b
+    if b != 255:
+      return true
+
+proc decompressRaw(src: Bytes, n: int, dst: Bytes, cap: int): int =
+  ## Decode one block; the decoded size, or -1 if it is malformed or does
+  ## not fit
+  if n == 0:
+    return -1
+  var ip = 0
+  var op = 0
+  while true:
+    let token = int(src[ip])
+    inc ip
+
+    # Literals
+    var litLen = token shr 4
+    if litLen == RunMask and not readLength(src, ip, n, litLen):
+      return -1
+    if litLen > n - ip or litLen > cap - op:
+      return -1
+    if litLen + 32 <= n - ip and litLen + 32 <= cap - op:
+      wideCopy(dst, op, src, ip, litLen, 32)
+    else:
+      copyMem(dst.at(op), src.at(ip), litLen)
+    ip += litLen
+    op += litLen
+    if ip == n:
+      return op                          # Last sequence: literals only
+
+    # Match
+    if ip + 2 > n:
+      return -1
+    let offset = int(src[ip]) or (int(src[ip + 1]) shl 8)
+    ip += 2
+    if offset == 0 or offset > op:
+      return -1
+    var matchLen = token and RunMask
+    if matchLen == RunMask and not readLength(src, ip, n, matchLen):
+      return -1
+    matchLen += MinMatch
+    if matchLen > cap - op:
+      return -1
+    let m = op - offset
+    let slack = cap - op - matchLen
+    if offset >= 32 and slack >= 32:
+      wideCopy(dst, op, dst, m, matchLen, 32)
+    elif offset >= 16 and slack >= 16:
+      wideCopy(dst, op, dst, m, matchLen, 16)
+    elif offset >= 8 and slack >= 8:
+      wideCopy(dst, op, dst, m, matchLen, 8)
+    else:
+      # Overlapping (run-length style) match: byte by byte
+      for k in 0 ..< matchLen:
+        dst[op + k] = dst[m + k]
+    op += matchLen
+    if ip >= n:
+      return -1                          # Blocks end with literals
+
+proc nativeLz4Decompress*(src: openArray[byte], dst: var openArray[byte]): int =
+  ## Decode one LZ4 block from `src` into `dst`; returns the decoded size,
+  ## or -1 if the block is malformed or larger than `dst`. Never reads or
+  ## writes outside the two buffers.
+  let d = if dst.len > 0: cast[Bytes](addr dst[0]) else: nil
+  let s = if src.len > 0: cast[Bytes](unsafeAddr src[0]) else: nil
+  decompressRaw(s, src.len, d, dst.len)
+
+# =============================================================================
+# Seq Convenience
+# =============================================================================
+
+proc nativeLz4Compress*(data: openArray[byte], acceleration = 1): seq[byte] =
+  ## Compress into a new seq. Raises ValueError if `data` exceeds
+  ## `NativeLz4MaxInput`.
+  if data.len > NativeLz4MaxInput:
+    raise newException(ValueError, "LZ4 input too large")
+  result = newSeq[byte](nativeLz4Bound(data.len))
+  result.setLen(nativeLz4Compress(data, result, acceleration))
+
+proc nativeLz4Decompress*(data: openArray[byte], maxOutputSize: int): seq[byte] =
+  ## Decompress into a new seq of at most `maxOutputSize` bytes. Raises
+  ## IOError on corrupt data or if the output would be larger.
+  result = newSeq[byte](maxOutputSize)
+  let n = nativeLz4Decompress(data, result)
+  if n < 0:
+    raise newException(IOError, "LZ4 decompression failed: corrupted data or insufficient buffer")
+  result.setLen(n)
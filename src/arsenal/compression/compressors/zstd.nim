@@ -9,6 +9,14 @@
 ## - Decompression: ~1000 MB/s
 ## - Ratio: 2.5-5.0x (excellent compression)
 ##
+## `ZstdDictionary` holds a trained (or raw) dictionary digested once into
+## CDict/DDict form, for small messages that share structure.
+##
+## `compressInto`/`decompressInto` work on caller-owned buffers. The
+## stream types wrap `ZSTD_compressStream2`/`ZSTD_decompressStream`: after
+## `init`, zstd keeps its window in buffers of its own and nothing more is
+## allocated per call.
+##
 ## Reference: RFC 8878 - Zstandard Compression
 ## C library: https://github.com/facebook/zstd
 
@@ -31,6 +39,12 @@ type
   ZSTD_DStream* {.zstdImport.} = object
     ## Streaming decompression context
 
+  ZSTD_CDict* {.zstdImport.} = object
+    ## Digested dictionary for compression (read-only, shareable)
+
+  ZSTD_DDict* {.zstdImport.} = object
+    ## Digested dictionary for decompression (read-only, shareable)
+
   ZSTD_inBuffer* {.zstdImport.} = object
     ## Input buffer descriptor
     src*: pointer      ## Pointer to input data
@@ -115,6 +129,53 @@ proc ZSTD_decompressDCtx*(
 ): csize_t {.zstdImport.}
   ## Decompress using reusable context
 
+# =============================================================================
+# Dictionary API
+# =============================================================================
+
+proc ZSTD_createCDict*(dictBuffer: pointer, dictSize: csize_t,
+                       compressionLevel: cint): ptr ZSTD_CDict {.zstdImport.}
+  ## Digest a dictionary for compression at a fixed level
+
+proc ZSTD_freeCDict*(cdict: ptr ZSTD_CDict): csize_t {.zstdImport.}
+
+proc ZSTD_createDDict*(dictBuffer: pointer, dictSize: csize_t): ptr ZSTD_DDict {.zstdImport.}
+  ## Digest a dictionary for decompression
+
+proc ZSTD_freeDDict*(ddict: ptr ZSTD_DDict): csize_t {.zstdImport.}
+
+proc ZSTD_compress_usingCDict*(
+  cctx: ptr ZSTD_CCtx,
+  dst: pointer, dstCapacity: csize_t,
+  src: pointer, srcSize: csize_t,
+  cdict: ptr ZSTD_CDict
+): csize_t {.zstdImport.}
+  ## Compress with a digested dictionary
+
+proc ZSTD_decompress_usingDDict*(
+  dctx: ptr ZSTD_DCtx,
+  dst: pointer, dstCapacity: csize_t,
+  src: pointer, srcSize: csize_t,
+  ddict: ptr ZSTD_DDict
+): csize_t {.zstdImport.}
+  ## Decompress with a digested dictionary
+
+proc ZSTD_getDictID_fromDict*(dict: pointer, dictSize: csize_t): cuint {.zstdImport.}
+  ## Dictionary ID of a trained dictionary (0 for raw content)
+
+proc ZSTD_getDictID_fromFrame*(src: pointer, srcSize: csize_t): cuint {.zstdImport.}
+  ## Dictionary ID a frame needs (0 if none or not recorded)
+
+proc ZDICT_trainFromBuffer*(
+  dictBuffer: pointer, dictBufferCapacity: csize_t,
+  samplesBuffer: pointer, samplesSizes: ptr csize_t, nbSamples: cuint
+): csize_t {.importc, header: "<zdict.h>".}
+  ## Train a dictionary from concatenated samples
+
+proc ZDICT_isError*(code: csize_t): cuint {.importc, header: "<zdict.h>".}
+
+proc ZDICT_getErrorName*(code: csize_t): cstring {.importc, header: "<zdict.h>".}
+
 # =============================================================================
 # Streaming API
 # =============================================================================
@@ -152,6 +213,16 @@ proc ZSTD_decompressStream*(
 ): csize_t {.zstdImport.}
   ## Streaming decompression
 
+proc ZSTD_CCtx_setParameter*(cctx: ptr ZSTD_CCtx, param: cint, value: cint): csize_t {.zstdImport.}
+  ## Set a compression parameter (e.g. ZSTD_c_compressionLevel)
+
+proc ZSTD_CCtx_reset*(cctx: ptr ZSTD_CCtx, reset: cint): csize_t {.zstdImport.}
+  ## Abandon the current frame (ZSTD_reset_session_only keeps parameters)
+
+const
+  ZSTD_c_compressionLevel* = 100.cint
+  ZSTD_reset_session_only* = 1.cint
+
 proc ZSTD_CStreamOutSize*(): csize_t {.zstdImport.}
   ## Recommended output buffer size for compression streaming
 
@@ -167,6 +238,7 @@ proc createDCtx(): ptr ZSTD_DCtx = ZSTD_createDCtx()
 # =============================================================================
 
 import ../compressor
+import ../../hashing/crc
 
 type
   ZstdCompressor* = object
@@ -192,32 +264,34 @@ proc `=destroy`*(c: var ZstdCompressor) =
 proc `=copy`*(dest: var ZstdCompressor, src: ZstdCompressor) {.error.}
   ## Prevent copying (context is not copyable)
 
-proc compress*(c: var ZstdCompressor, data: openArray[byte]): seq[byte] =
-  ## Compress data using Zstd.
-
-  if data.len == 0:
-    return @[]
+proc zstdBound*(srcLen: int): int {.inline.} =
+  ## Output space that always suffices to compress `srcLen` bytes
+  int(ZSTD_compressBound(srcLen.csize_t))
 
-  # Calculate max compressed size
-  let maxSize = ZSTD_compressBound(data.len.csize_t)
-
-  # Allocate output buffer
-  result = newSeq[byte](maxSize)
-
-  # Perform compression
+proc compressInto*(c: var ZstdCompressor, src: openArray[byte],
+                   dst: var openArray[byte]): int =
+  ## Compress `src` into `dst` as one Zstd frame and return its size,
+  ## without allocating. `dst.len >= zstdBound(src.len)` always suffices;
+  ## raises IOError if `dst` is too small.
   let compressedSize = ZSTD_compressCCtx(
     c.ctx,
-    addr result[0], maxSize,
-    unsafeAddr data[0], data.len.csize_t,
+    (if dst.len > 0: addr dst[0] else: nil), dst.len.csize_t,
+    (if src.len > 0: unsafeAddr src[0] else: nil), src.len.csize_t,
     c.level.cint
   )
-
-  # Check for errors
   if ZSTD_isError(compressedSize) != 0:
     raise newException(IOError, "Zstd compression error: " & $ZSTD_getErrorName(compressedSize))
+  compressedSize.int
 
-  # Resize to actual compressed size
-  result.setLen(compressedSize)
+proc compress*(c: var ZstdCompressor, data: openArray[byte]): seq[byte] =
+  ## Compress data using Zstd.
+
+  if data.len == 0:
+    return @[]
+
+  # Compress into a worst-case buffer, then trim
+  result = newSeq[byte](zstdBound(data.len))
+  result.setLen(c.compressInto(data, result))
 
 proc compress*(data: openArray[byte], level: CompressionLevel = DefaultLevel): seq[byte] =
   ## One-shot compression with specified level.
@@ -249,6 +323,22 @@ proc `=destroy`*(d: var ZstdDecompressor) =
 proc `=copy`*(dest: var ZstdDecompressor, src: ZstdDecompressor) {.error.}
   ## Prevent copying
 
+proc decompressInto*(d: var ZstdDecompressor, src: openArray[byte],
+                     dst: var openArray[byte]): int =
+  ## Decompress the Zstd frame(s) in `src` into `dst` and return the
+  ## decompressed size, without allocating. Raises IOError on corrupt
+  ## input or if `dst` is too small.
+  if src.len == 0:
+    return 0
+  let decompressedSize = ZSTD_decompressDCtx(
+    d.ctx,
+    (if dst.len > 0: addr dst[0] else: nil), dst.len.csize_t,
+    unsafeAddr src[0], src.len.csize_t
+  )
+  if ZSTD_isError(decompressedSize) != 0:
+    raise newException(IOError, "Zstd decompression error: " & $ZSTD_getErrorName(decompressedSize))
+  decompressedSize.int
+
 proc decompress*(d: var ZstdDecompressor, data: openArray[byte], maxOutputSize: int = 0): seq[byte] =
   ## Decompress Zstd data.
   ## maxOutputSize: Expected output size (0 = auto-detect from frame header)
@@ -268,27 +358,142 @@ proc decompress*(d: var ZstdDecompressor, data: openArray[byte], maxOutputSize:
       # Use a conservative estimate: typically 2-5x expansion for text/JSON
       outputSize = (data.len * 4).max(1024)
 
-  # Allocate output buffer
+  # Decompress, then trim to the actual size
   result = newSeq[byte](outputSize)
+  result.setLen(d.decompressInto(data, result))
 
-  # Perform decompression
-  let decompressedSize = ZSTD_decompressDCtx(
+proc decompress*(data: openArray[byte], maxOutputSize: int = 0): seq[byte] =
+  ## One-shot decompression.
+  var decompressor = ZstdDecompressor.init()
+  result = decompressor.decompress(data, maxOutputSize)
+
+# =============================================================================
+# Dictionaries
+# =============================================================================
+
+const
+  ZstdDefaultDictSize* = 16 * 1024
+    ## Dictionary size for `trainDictionary`; 16-64 KiB suits messages of
+    ## a few hundred bytes to a few KiB
+
+type
+  ZstdDictionary* = object
+    ## Dictionary digested once for both directions. CDict/DDict are
+    ## read-only, so one dictionary can serve any number of contexts and
+    ## threads.
+    cdict: ptr ZSTD_CDict
+    ddict: ptr ZSTD_DDict
+    id: uint32
+    level: CompressionLevel
+
+proc trainDictionary*(samples: openArray[seq[byte]],
+                      capacity = ZstdDefaultDictSize): seq[byte] =
+  ## Train a dictionary from sample messages (typically a few thousand,
+  ## totalling ~100x `capacity`). The result also serves as LZ4
+  ## dictionary content. Raises ValueError if zstd cannot train one
+  ## (e.g. too few samples).
+  var total = 0
+  for s in samples:
+    total += s.len
+  var buffer = newSeqOfCap[byte](total)
+  var sizes = newSeqOfCap[csize_t](samples.len)
+  for s in samples:
+    buffer.add s
+    sizes.add s.len.csize_t
+  if total == 0:
+    raise newException(ValueError, "Cannot train a dictionary from empty samples")
+  result = newSeq[byte](capacity)
+  let size = ZDICT_trainFromBuffer(addr result[0], capacity.csize_t,
+                                   addr buffer[0], addr sizes[0], samples.len.cuint)
+  if ZDICT_isError(size) != 0:
+    raise newException(ValueError, "Zstd dictionary training failed: " & $ZDICT_getErrorName(size))
+  result.setLen(size)
+
+proc dictionaryId*(content: openArray[byte]): uint32 =
+  ## ID of dictionary content: the trained dictionary's own ID, or for raw
+  ## content (which has none) a CRC-32C of it, never 0.
+  if content.len == 0:
+    return 0
+  result = ZSTD_getDictID_fromDict(unsafeAddr content[0], content.len.csize_t).uint32
+  if result == 0:
+    result = max(crc32c(content), 1'u32)
+
+proc init*(_: typedesc[ZstdDictionary], content: openArray[byte],
+           level: CompressionLevel = DefaultLevel): ZstdDictionary =
+  ## Digest a dictionary (trained, or any raw sample content). Digesting
+  ## costs far more than a small message's compression; do it once.
+  if content.len == 0:
+    raise newException(ValueError, "Empty Zstd dictionary")
+  result.level = level
+  result.id = dictionaryId(content)
+  result.cdict = ZSTD_createCDict(unsafeAddr content[0], content.len.csize_t, level.cint)
+  result.ddict = ZSTD_createDDict(unsafeAddr content[0], content.len.csize_t)
+  if result.cdict == nil or result.ddict == nil:
+    raise newException(ResourceExhaustedError, "Failed to create Zstd dictionary")
+
+proc `=destroy`*(d: var ZstdDictionary) =
+  ## Free the digested dictionaries.
+  if d.cdict != nil:
+    discard ZSTD_freeCDict(d.cdict)
+    d.cdict = nil
+  if d.ddict != nil:
+    discard ZSTD_freeDDict(d.ddict)
+    d.ddict = nil
+
+proc `=copy`*(dest: var ZstdDictionary, src: ZstdDictionary) {.error.}
+  ## Prevent copying (share it by reference instead)
+
+proc id*(d: ZstdDictionary): uint32 {.inline.} =
+  ## Dictionary ID, recorded in frames compressed with it
+  d.id
+
+proc compressInto*(c: var ZstdCompressor, dict: ZstdDictionary,
+                   src: openArray[byte], dst: var openArray[byte]): int =
+  ## Compress `src` into `dst` with a dictionary (at the dictionary's
+  ## level) and return the compressed size. Raises IOError if `dst` is
+  ## too small.
+  let compressedSize = ZSTD_compress_usingCDict(
+    c.ctx,
+    (if dst.len > 0: addr dst[0] else: nil), dst.len.csize_t,
+    (if src.len > 0: unsafeAddr src[0] else: nil), src.len.csize_t,
+    dict.cdict
+  )
+  if ZSTD_isError(compressedSize) != 0:
+    raise newException(IOError, "Zstd compression error: " & $ZSTD_getErrorName(compressedSize))
+  compressedSize.int
+
+proc compress*(c: var ZstdCompressor, dict: ZstdDictionary, data: openArray[byte]): seq[byte] =
+  ## Compress data with a dictionary.
+  result = newSeq[byte](zstdBound(data.len))
+  result.setLen(c.compressInto(dict, data, result))
+
+proc decompressInto*(d: var ZstdDecompressor, dict: ZstdDictionary,
+                     src: openArray[byte], dst: var openArray[byte]): int =
+  ## Decompress a frame compressed with `dict` into `dst`. Raises IOError
+  ## on corrupt input, a different dictionary, or if `dst` is too small.
+  if src.len == 0:
+    return 0
+  let decompressedSize = ZSTD_decompress_usingDDict(
     d.ctx,
-    addr result[0], outputSize.csize_t,
-    unsafeAddr data[0], data.len.csize_t
+    (if dst.len > 0: addr dst[0] else: nil), dst.len.csize_t,
+    unsafeAddr src[0], src.len.csize_t,
+    dict.ddict
   )
-
-  # Check for errors
   if ZSTD_isError(decompressedSize) != 0:
     raise newException(IOError, "Zstd decompression error: " & $ZSTD_getErrorName(decompressedSize))
+  decompressedSize.int
 
-  # Resize to actual decompressed size
-  result.setLen(decompressedSize)
+proc decompress*(d: var ZstdDecompressor, dict: ZstdDictionary, data: openArray[byte],
+                 maxOutputSize: int): seq[byte] =
+  ## Decompress data compressed with `dict`.
+  result = newSeq[byte](maxOutputSize)
+  result.setLen(d.decompressInto(dict, data, result))
 
-proc decompress*(data: openArray[byte], maxOutputSize: int = 0): seq[byte] =
-  ## One-shot decompression.
-  var decompressor = ZstdDecompressor.init()
-  result = decompressor.decompress(data, maxOutputSize)
+proc frameDictionaryId*(frame: openArray[byte]): uint32 =
+  ## Dictionary ID a Zstd frame was compressed with (0 if none)
+  if frame.len == 0:
+    return 0
+  ZSTD_getDictID_fromFrame(unsafeAddr frame[0], frame.len.csize_t).uint32
 
 # =============================================================================
 # Streaming Wrapper
@@ -296,47 +501,139 @@ proc decompress*(data: openArray[byte], maxOutputSize: int = 0): seq[byte] =
 
 type
   ZstdStreamCompressor* = object
-    ## Streaming Zstd compressor for chunk-by-chunk compression.
-    stream: ptr ZSTD_CStream
+    ## Streaming Zstd compressor: the chunks passed in form one Zstd frame
+    ## (until `reset`), written incrementally into caller-owned buffers.
+    ctx: ptr ZSTD_CCtx
     level: CompressionLevel
-    buffer: seq[byte]
+
+  ZstdStreamDecompressor* = object
+    ## Streaming Zstd decompressor for any sequence of Zstd frames.
+    stream: ptr ZSTD_DStream
+
+  ZstdFlush* = enum
+    ## How much `compressInto` must emit before reporting done
+    ## (same order as ZSTD_EndDirective)
+    zfContinue   ## Whatever zstd chooses (best ratio)
+    zfFlush      ## Everything passed so far is decodable
+    zfEnd        ## Close the frame
+
+proc init*(_: typedesc[ZstdStreamCompressor],
+           level: CompressionLevel = DefaultLevel): ZstdStreamCompressor =
+  ## Create streaming compressor.
+  let ctx = createCCtx()
+  if ctx == nil:
+    raise newException(ResourceExhaustedError, "Failed to create Zstd compression context")
+  result = ZstdStreamCompressor(ctx: ctx, level: level)
+  discard ZSTD_CCtx_setParameter(ctx, ZSTD_c_compressionLevel, level.cint)
 
 proc initStream*(_: typedesc[ZstdCompressor], level: CompressionLevel = DefaultLevel): ZstdStreamCompressor =
-  ## Create streaming compressor (buffered implementation).
-  ## Accumulates chunks and compresses them together.
+  ## Create streaming compressor (same as `ZstdStreamCompressor.init`).
+  ZstdStreamCompressor.init(level)
 
-  result.stream = nil
-  result.level = level
-  result.buffer = newSeq[byte]()
+proc `=destroy`*(s: var ZstdStreamCompressor) =
+  ## Clean up streaming compressor.
+  if s.ctx != nil:
+    discard ZSTD_freeCCtx(s.ctx)
+    s.ctx = nil
 
-proc compressChunk*(s: var ZstdStreamCompressor, data: openArray[byte], flush: bool = false): seq[byte] =
-  ## Compress a chunk of data (buffers internally).
-  ## For streaming, data is accumulated until finish() is called.
+proc `=copy`*(dest: var ZstdStreamCompressor, src: ZstdStreamCompressor) {.error.}
+  ## Prevent copying
 
-  # Accumulate data in buffer
-  s.buffer.add(data)
+proc compressInto*(s: var ZstdStreamCompressor, src: openArray[byte],
+                   dst: var openArray[byte], flush = zfContinue):
+                  tuple[consumed, written: int, done: bool] =
+  ## Feed `src` to the stream and write output into `dst`. `done` is set
+  ## once all of `src` is consumed and, for `zfFlush`/`zfEnd`, everything
+  ## has been written; otherwise drain `dst` and call again with the
+  ## unconsumed rest of `src`. Raises IOError on failure.
+  var input = ZSTD_inBuffer(src: (if src.len > 0: unsafeAddr src[0] else: nil),
+                            size: src.len.csize_t)
+  var output = ZSTD_outBuffer(dst: (if dst.len > 0: addr dst[0] else: nil),
+                              size: dst.len.csize_t)
+  let remaining = ZSTD_compressStream2(s.ctx, output, input,
+                                       ZSTD_EndDirective(ord(flush)))
+  if ZSTD_isError(remaining) != 0:
+    raise newException(IOError, "Zstd compression error: " & $ZSTD_getErrorName(remaining))
+  result.consumed = input.pos.int
+  result.written = output.pos.int
+  result.done = result.consumed == src.len and
+    (flush == zfContinue or remaining == 0)
+
+proc drain(s: var ZstdStreamCompressor, data: openArray[byte], flush: ZstdFlush): seq[byte] =
+  ## Run `compressInto` to completion, growing a new seq for the output
+  let step = ZSTD_CStreamOutSize().int
+  var consumed = 0
+  var written = 0
+  while true:
+    result.setLen(written + step)
+    let r = s.compressInto(data.toOpenArray(consumed, data.high),
+                           result.toOpenArray(written, result.high), flush)
+    consumed += r.consumed
+    written += r.written
+    if r.done:
+      break
+  result.setLen(written)
 
-  # If flush requested and buffer is large, compress it
-  if flush and s.buffer.len > 0:
-    result = compress(s.buffer, s.level)
-    s.buffer.setLen(0)
-  else:
-    result = @[]
+proc compressChunk*(s: var ZstdStreamCompressor, data: openArray[byte], flush: bool = false): seq[byte] =
+  ## Compress a chunk, returning the frame bytes zstd has ready (often
+  ## none until its block fills). With `flush`, everything so far is
+  ## returned. Concatenated with `finish`, the outputs form one frame.
+  s.drain(data, if flush: zfFlush else: zfContinue)
 
-proc finish*(s: var ZstdStreamCompressor): seq[byte] =
-  ## Finish compression and return compressed data.
+proc compress*(s: var ZstdStreamCompressor, data: openArray[byte]): seq[byte] =
+  ## Same as `compressChunk` without flushing.
+  s.drain(data, zfContinue)
 
-  if s.buffer.len > 0:
-    result = compress(s.buffer, s.level)
-    s.buffer.setLen(0)
-  else:
-    result = @[]
+proc finish*(s: var ZstdStreamCompressor): seq[byte] =
+  ## Finish the frame and return its remaining bytes.
+  s.drain(newSeq[byte](), zfEnd)
+
+proc reset*(s: var ZstdStreamCompressor) =
+  ## Abandon the current frame; the next chunk starts a new one.
+  discard ZSTD_CCtx_reset(s.ctx, ZSTD_reset_session_only)
+
+proc init*(_: typedesc[ZstdStreamDecompressor]): ZstdStreamDecompressor =
+  ## Create streaming decompressor.
+  result.stream = ZSTD_createDStream()
+  if result.stream == nil:
+    raise newException(ResourceExhaustedError, "Failed to create Zstd decompression stream")
+  discard ZSTD_initDStream(result.stream)
+
+proc `=destroy`*(d: var ZstdStreamDecompressor) =
+  ## Clean up streaming decompressor.
+  if d.stream != nil:
+    discard ZSTD_freeDStream(d.stream)
+    d.stream = nil
+
+proc `=copy`*(dest: var ZstdStreamDecompressor, src: ZstdStreamDecompressor) {.error.}
+  ## Prevent copying
 
-proc `=destroy`*(s: var ZstdStreamCompressor) =
-  ## Clean up streaming compressor.
-  if s.stream != nil:
-    discard ZSTD_freeCStream(s.stream)
-    s.stream = nil
+proc decompressInto*(d: var ZstdStreamDecompressor, src: openArray[byte],
+                     dst: var openArray[byte]): tuple[consumed, written: int, frameEnd: bool] =
+  ## Decompress as much of `src` as fits into `dst`. Input may end
+  ## anywhere; pass the unconsumed rest again with more appended.
+  ## `frameEnd` is set when a frame has been completely decoded and
+  ## written. Raises IOError on corrupt input.
+  var input = ZSTD_inBuffer(src: (if src.len > 0: unsafeAddr src[0] else: nil),
+                            size: src.len.csize_t)
+  var output = ZSTD_outBuffer(dst: (if dst.len > 0: addr dst[0] else: nil),
+                              size: dst.len.csize_t)
+  while true:
+    let before = input.pos + output.pos
+    let hint = ZSTD_decompressStream(d.stream, output, input)
+    if ZSTD_isError(hint) != 0:
+      raise newException(IOError, "Zstd decompression error: " & $ZSTD_getErrorName(hint))
+    if hint == 0:
+      result.frameEnd = true
+    if input.pos == input.size or output.pos == output.size or
+       input.pos + output.pos == before:
+      break
+  result.consumed = input.pos.int
+  result.written = output.pos.int
+
+proc reset*(d: var ZstdStreamDecompressor) =
+  ## Drop any partially decoded frame.
+  discard ZSTD_initDStream(d.stream)
 
 # =============================================================================
 # Platform Configuration
@@ -0,0 +1,312 @@
+## Elias-Fano Coding
+## =================
+##
+## Compressed representation of a non-decreasing integer sequence with
+## random access. `n` values below `u` take about `2 + log2(u/n)` bits
+## each, within 2 bits of the information-theoretic minimum, and the
+## sequence never has to be decoded to be searched:
+##
+## - `ef[i]` (select) in O(1)
+## - `ef.nextGEQ(x)`, the first value >= x, in O(1) plus a scan of one
+##   bucket (a few values on average)
+##
+## Each value is split into `l` low bits, stored verbatim in a packed
+## array, and a high part stored in unary in the upper bit vector: value
+## `i` sets bit `high(i) + i`. Sampled positions of every 256th one and
+## zero (select hints) bound the word scan behind both queries.
+##
+## Usage:
+## ```nim
+## import arsenal/compression/eliasfano
+##
+## let ef = EliasFano.init([3'u32, 5, 9, 14, 14, 20, 1000])
+## assert ef[2] == 9
+## assert ef.nextGEQ(10) == 3          # index of 14
+## for v in ef: echo v
+##
+## var bytes: seq[byte]
+## addEliasFanoBlock(bytes, [3'u32, 5, 9])     # Serialized, for block codecs
+## ```
+##
+## Reference: S. Vigna, "Quasi-succinct indices" (WSDM 2013);
+## G. Ottaviano, R. Venturini, "Partitioned Elias-Fano indexes" (SIGIR 2014)
+
+import std/bitops
+
+const
+  SelectSample = 256                     ## Ones (or zeros) between hints
+
+type
+  EliasFano* = object
+    ## Immutable non-decreasing sequence of uint32
+    n: int
+    lowBits: int
+    lower: seq[uint64]                   ## n * lowBits bits
+    upper: seq[uint64]                   ## n + (max shr lowBits) + 1 bits
+    upperBits: int
+    oneHints: seq[int32]                 ## Position of one #k*SelectSample
+    zeroHints: seq[int32]                ## Position of zero #k*SelectSample
+
+# =============================================================================
+# Bit Helpers
+# =============================================================================
+
+proc lowBitsFor(count: int, span: uint64): int {.inline.} =
+  ## Low bits minimising the total size: floor(log2(span / count))
+  if count == 0 or span <= uint64(count): 0
+  else: fastLog2(span div uint64(count))
+
+proc getBits(words: openArray[uint64], pos, bits: int): uint64 {.inline.} =
+  if bits == 0:
+    return 0
+  let w = pos shr 6
+  let off = pos and 63
+  result = words[w] shr off
+  if off + bits > 64:
+    result = result or (words[w + 1] shl (64 - off))
+  result = result and ((1'u64 shl bits) - 1)
+
+proc setBits(words: var seq[uint64], pos, bits: int, value: uint64) {.inline.} =
+  if bits == 0:
+    return
+  let w = pos shr 6
+  let off = pos and 63
+  words[w] = words[w] or (value shl off)
+  if off + bits > 64:
+    words[w + 1] = words[w + 1] or (value shr (64 - off))
+
+proc selectInWord(word: uint64, k: int): int {.inline.} =
+  ## Position of the k-th (0-based) set bit of `word`
+  var w = word
+  for _ in 0 ..< k:
+    w = w and (w - 1)
+  countTrailingZeroBits(w)
+
+# =============================================================================
+# Construction
+# =============================================================================
+
+proc buildHints(ef: var EliasFano) =
+  var ones = 0
+  var zeros = 0
+  for pos in 0 ..< ef.upperBits:
+    if ((ef.upper[pos shr 6] shr (pos and 63)) and 1) == 1:
+      if ones mod SelectSample == 0:
+        ef.oneHints.add int32(pos)
+      inc ones
+    else:
+      if zeros mod SelectSample == 0:
+        ef.zeroHints.add int32(pos)
+      inc zeros
+
+proc init*(_: typedesc[EliasFano], values: openArray[uint32]): EliasFano =
+  ## Encode a non-decreasing sequence. Raises ValueError otherwise.
+  let n = values.len
+  result.n = n
+  if n == 0:
+    return
+  for i in 1 ..< n:
+    if values[i] < values[i - 1]:
+      raise newException(ValueError, "Elias-Fano needs a non-decreasing sequence")
+  let l = lowBitsFor(n, uint64(values[^1]) + 1)
+  result.lowBits = l
+  result.lower = newSeq[uint64]((n * l + 63) div 64 + 1)
+  result.upperBits = n + int(uint64(values[^1]) shr l) + 1
+  result.upper = newSeq[uint64]((result.upperBits + 63) div 64)
+  let mask = if l == 0: 0'u64 else: (1'u64 shl l) - 1
+  for i, v in values:
+    result.lower.setBits(i * l, l, uint64(v) and mask)
+    let pos = int(uint64(v) shr l) + i
+    result.upper[pos shr 6] = result.upper[pos shr 6] or (1'u64 shl (pos and 63))
+  result.buildHints()
+
+proc len*(ef: EliasFano): int {.inline.} =
+  ## Number of values
+  ef.n
+
+proc sizeInBytes*(ef: EliasFano): int =
+  ## Memory used by the encoded bits and hints
+  8 * (ef.lower.len + ef.upper.len) + 4 * (ef.oneHints.len + ef.zeroHints.len)
+
+# =============================================================================
+# Queries
+# =============================================================================
+
+proc selectOne(ef: EliasFano, k: int): int =
+  ## Position of the k-th one in `upper`
+  var pos = int(ef.oneHints[k div SelectSample])
+  var remaining = k mod SelectSample
+  var w = pos shr 6
+  var word = ef.upper[w] and (high(uint64) shl (pos and 63))
+  while true:
+    let c = countSetBits(word)
+    if remaining < c:
+      return w * 64 + selectInWord(word, remaining)
+    remaining -= c
+    inc w
+    word = ef.upper[w]
+
+proc selectZero(ef: EliasFano, k: int): int =
+  ## Position of the k-th zero in `upper`
+  var pos = int(ef.zeroHints[k div SelectSample])
+  var remaining = k mod SelectSample
+  var w = pos shr 6
+  var word = not ef.upper[w] and (high(uint64) shl (pos and 63))
+  while true:
+    let c = countSetBits(word)
+    if remaining < c:
+      return w * 64 + selectInWord(word, remaining)
+    remaining -= c
+    inc w
+    word = not ef.upper[w]
+
+proc lowAt(ef: EliasFano, i: int): uint64 {.inline.} =
+  getBits(ef.lower, i * ef.lowBits, ef.lowBits)
+
+proc `[]`*(ef: EliasFano, i: int): uint32 =
+  ## The i-th value (select). Raises ValueError if `i` is out of range.
+  if i < 0 or i >= ef.n:
+    raise newException(ValueError, "index " & $i & " not in 0 .. " & $(ef.n - 1))
+  let hi = uint64(ef.selectOne(i) - i)
+  uint32((hi shl ef.lowBits) or ef.lowAt(i))
+
+proc nextGEQ*(ef: EliasFano, x: uint32): int =
+  ## Index of the first value >= `x`, or `len` if there is none
+  if ef.n == 0:
+    return 0
+  let h = int(uint64(x) shr ef.lowBits)
+  let buckets = ef.upperBits - ef.n      # Zeros: one per bucket
+  if h >= buckets:
+    return ef.n
+  # Bucket h starts right after zero #h-1; every one before it is a value
+  # with a smaller high part
+  var pos = if h == 0: 0 else: ef.selectZero(h - 1) + 1
+  var i = pos - h
+  while i < ef.n:
+    let word = ef.upper[pos shr 6]
+    if ((word shr (pos and 63)) and 1) == 1:
+      let hi = uint64(pos - i)
+      if ((hi shl ef.lowBits) or ef.lowAt(i)) >= uint64(x):
+        return i
+      inc i
+    inc pos
+  ef.n
+
+iterator items*(ef: EliasFano): uint32 =
+  ## Values in order, walking the upper bits word by word
+  var i = 0
+  var w = 0
+  while i < ef.n:
+    var word = ef.upper[w]
+    while word != 0 and i < ef.n:
+      let pos = w * 64 + countTrailingZeroBits(word)
+      yield uint32((uint64(pos - i) shl ef.lowBits) or ef.lowAt(i))
+      word = word and (word - 1)
+      inc i
+    inc w
+
+proc decode*(ef: EliasFano, output: var openArray[uint32]) =
+  ## Write the first `output.len` values into `output`
+  var i = 0
+  for v in ef:
+    if i >= output.len:
+      break
+    output[i] = v
+    inc i
+
+# =============================================================================
+# Serialized Blocks
+# =============================================================================
+#
+# For block codecs: one short run (count known to the reader) stored
+# relative to its first value. Layout: base (4 bytes LE), low bits
+# (1 byte), then the low bits and the upper bits, each padded to a byte.
+
+const EFBlockHeader = 5
+
+proc efBlockLayout(count: int, span: uint64): tuple[lowBits, lowerBytes, upperBytes: int] =
+  let l = lowBitsFor(count, span + 1)
+  (l, (count * l + 7) div 8, (count + int(span shr l) + 1 + 7) div 8)
+
+proc eliasFanoBlockSize*(values: openArray[uint32]): int =
+  ## Encoded size of a non-decreasing run, or -1 if it is not one
+  for i in 1 ..< values.len:
+    if values[i] < values[i - 1]:
+      return -1
+  if values.len == 0:
+    return EFBlockHeader
+  let (_, lowerBytes, upperBytes) =
+    efBlockLayout(values.len, uint64(values[^1] - values[0]))
+  EFBlockHeader + lowerBytes + upperBytes
+
+proc addEliasFanoBlock*(output: var seq[byte], values: openArray[uint32]) =
+  ## Append a non-decreasing run. Raises ValueError otherwise.
+  if eliasFanoBlockSize(values) < 0:
+    raise newException(ValueError, "Elias-Fano needs a non-decreasing sequence")
+  let base = if values.len > 0: values[0] else: 0'u32
+  let span = if values.len > 0: uint64(values[^1] - base) else: 0'u64
+  let (l, lowerBytes, upperBytes) = efBlockLayout(values.len, span)
+  var lower = newSeq[uint64]((lowerBytes + 7) div 8 + 1)
+  var upper = newSeq[uint64]((upperBytes + 7) div 8)
+  let mask = if l == 0: 0'u64 else: (1'u64 shl l) - 1
+  for i, v in values:
+    let d = uint64(v - base)
+    lower.setBits(i * l, l, d and mask)
+    let pos = int(d shr l) + i
+    upper[pos shr 6] = upper[pos shr 6] or (1'u64 shl (pos and 63))
+
+  output.add byte(base and 0xFF)
+  output.add byte((base shr 8) and 0xFF)
+  output.add byte((base shr 16) and 0xFF)
+  output.add byte(base shr 24)
+  output.add byte(l)
+  for i in 0 ..< lowerBytes:
+    output.add byte((lower[i shr 3] shr (8 * (i and 7))) and 0xFF)
+  for i in 0 ..< upperBytes:
+    output.add byte((upper[i shr 3] shr (8 * (i and 7))) and 0xFF)
+
+proc decodeEliasFanoBlock*(input: openArray[byte], pos: int,
+                           output: var openArray[uint32]): int =
+  ## Decode the run at `input[pos]` into `output` (its length is the
+  ## run's value count); returns the position after the run
+  if pos + EFBlockHeader > input.len:
+    raise newException(ValueError, "truncated Elias-Fano block")
+  let base = uint32(input[pos]) or (uint32(input[pos + 1]) shl 8) or
+             (uint32(input[pos + 2]) shl 16) or (uint32(input[pos + 3]) shl 24)
+  let l = int(input[pos + 4])
+  let count = output.len
+  let lowerStart = pos + EFBlockHeader
+  let upperStart = lowerStart + (count * l + 7) div 8
+  if l > 32 or upperStart > input.len:
+    raise newException(ValueError, "corrupt Elias-Fano block")
+
+  # Walk the upper bits a byte at a time; low bits through a 64-bit window
+  var i = 0
+  var p = upperStart
+  var acc = 0'u64
+  var filled = 0
+  var lowPos = lowerStart
+  var lastPos = -1
+  let mask = if l == 0: 0'u64 else: (1'u64 shl l) - 1
+  while i < count:
+    if p >= input.len:
+      raise newException(ValueError, "corrupt Elias-Fano block")
+    var b = uint32(input[p])
+    while b != 0 and i < count:
+      lastPos = (p - upperStart) * 8 + countTrailingZeroBits(b)
+      let hi = uint64(lastPos - i)
+      while filled < l:
+        acc = acc or (uint64(input[lowPos]) shl filled)
+        inc lowPos
+        filled += 8
+      output[i] = base + uint32((hi shl l) or (acc and mask))
+      if l > 0:
+        acc = acc shr l
+        filled -= l
+      b = b and (b - 1)
+      inc i
+    inc p
+  # The upper bits end one terminating zero after the last value
+  result = upperStart + (lastPos + 2 + 7) div 8
+  if result > input.len:
+    raise newException(ValueError, "corrupt Elias-Fano block")
@@ -0,0 +1,188 @@
+## Block Integer Codecs
+## ====================
+##
+## One container for the integer codecs: the sequence is cut into blocks
+## of 128 values and each block is stored as a 1-byte codec tag plus that
+## codec's payload. With `bcAuto` every block gets whichever of BP128,
+## PFOR, Stream VByte and Elias-Fano is smallest for it, so a list that
+## is dense in one place and sparse or noisy in another stays compact
+## throughout.
+##
+## With `delta`, BP128, PFOR and Stream VByte blocks store the gaps
+## between consecutive values (the first against the previous block's
+## last value). Elias-Fano blocks always store the values themselves and
+## are only eligible when the block is non-decreasing.
+##
+## | Codec        | Best for                              | Decode        |
+## |--------------|---------------------------------------|---------------|
+## | BP128        | uniformly small values / gaps         | SIMD unpack   |
+## | PFOR         | small values with a few outliers      | unpack+patch  |
+## | Stream VByte | values of mixed byte lengths          | SIMD shuffle  |
+## | Elias-Fano   | sorted ids, random access (see module)| bit scan      |
+##
+## Usage:
+## ```nim
+## import arsenal/compression/intblocks
+##
+## let packed = encodeBlocks(sortedIds, bcAuto, delta = true)
+## var ids = newSeq[uint32](sortedIds.len)
+## discard decodeBlocks(packed, ids, delta = true)
+## ```
+
+import ./streamvbyte
+import ./bitpacking
+import ./eliasfano
+
+type
+  BlockCodec* = enum
+    ## Codec of one block, or `bcAuto` to choose per block
+    bcStreamVByte = "streamvbyte"
+    bcBP128 = "bp128"
+    bcPFor = "pfor"
+    bcEliasFano = "eliasfano"
+    bcAuto = "auto"
+
+# =============================================================================
+# Stream VByte Blocks
+# =============================================================================
+
+proc svbBlockSize(values: openArray[uint32]): int =
+  result = (values.len + 3) div 4
+  for v in values:
+    result += max(1, (bitWidth(v) + 7) div 8)
+
+proc addSvbBlock(output: var seq[byte], values: openArray[uint32]) =
+  let pos = output.len
+  let (controlLen, dataLen) = maxEncodedSize(values.len)
+  output.setLen(pos + controlLen + dataLen)
+  let used = encodeStreamVByte(values,
+                               output.toOpenArray(pos, pos + controlLen - 1),
+                               output.toOpenArray(pos + controlLen, output.high))
+  output.setLen(pos + controlLen + used)
+
+proc decodeSvbBlock(input: openArray[byte], pos: int, output: var openArray[uint32],
+                    delta: bool, prev: uint32): int =
+  let controlLen = (output.len + 3) div 4
+  if pos + controlLen > input.len:
+    raise newException(ValueError, "truncated Stream VByte block")
+  let data = pos + controlLen
+  # The decoders trust the control bytes, so size the data part first
+  var dataLen = 0
+  for k in 0 ..< output.len:
+    dataLen += int((input[pos + (k shr 2)] shr (2 * (k and 3))) and 3) + 1
+  if data + dataLen > input.len:
+    raise newException(ValueError, "truncated Stream VByte block")
+  let used =
+    if delta:
+      decodeStreamVByteDelta(input.toOpenArray(pos, data - 1),
+                             input.toOpenArray(data, input.high), output, prev)
+    else:
+      decodeStreamVByte(input.toOpenArray(pos, data - 1),
+                        input.toOpenArray(data, input.high), output)
+  data + used
+
+# =============================================================================
+# Encoding
+# =============================================================================
+
+proc chooseCodec(work, raw: openArray[uint32]): BlockCodec =
+  ## Smallest codec for a block (`work` is what the delta-able codecs see)
+  result = bcBP128
+  var best = bp128BlockSize(work)
+  let pfor = pforBlockSize(work)
+  if pfor < best:
+    result = bcPFor
+    best = pfor
+  let svb = svbBlockSize(work)
+  if svb < best:
+    result = bcStreamVByte
+    best = svb
+  let ef = eliasFanoBlockSize(raw)
+  if ef >= 0 and ef < best:
+    result = bcEliasFano
+
+proc addBlock(output: var seq[byte], codec: BlockCodec,
+              work, raw: openArray[uint32]) =
+  let chosen = if codec == bcAuto: chooseCodec(work, raw) else: codec
+  output.add byte(ord(chosen))
+  case chosen
+  of bcBP128: output.addBP128Block(work)
+  of bcPFor: output.addPForBlock(work)
+  of bcStreamVByte: output.addSvbBlock(work)
+  of bcEliasFano: output.addEliasFanoBlock(raw)
+  of bcAuto: discard
+
+proc encodeBlocks*(values: openArray[uint32], codec: BlockCodec,
+                   delta = false): seq[byte] =
+  ## Encode `values` block by block. Raises ValueError for `bcEliasFano`
+  ## if any block is not non-decreasing.
+  var deltas {.noinit.}: array[BlockSize, uint32]
+  var prev = 0'u32
+  var i = 0
+  while i < values.len:
+    let n = min(BlockSize, values.len - i)
+    if delta:
+      for j in 0 ..< n:
+        deltas[j] = values[i + j] - prev
+        prev = values[i + j]
+      result.addBlock(codec, deltas.toOpenArray(0, n - 1),
+                      values.toOpenArray(i, i + n - 1))
+    else:
+      result.addBlock(codec, values.toOpenArray(i, i + n - 1),
+                      values.toOpenArray(i, i + n - 1))
+    i += n
+
+# =============================================================================
+# Decoding
+# =============================================================================
+
+proc prefixSum(values: var openArray[uint32], prev: uint32) {.inline.} =
+  var acc = prev
+  for v in values.mitems:
+    acc += v
+    v = acc
+
+proc decodeBlock(input: openArray[byte], pos: int, output: var openArray[uint32],
+                 delta: bool, prev: uint32): int =
+  ## Decode the tagged block at `input[pos]`; returns the position after it
+  if pos >= input.len:
+    raise newException(ValueError, "truncated integer block stream")
+  let tag = int(input[pos])
+  if tag > ord(bcEliasFano):
+    raise newException(ValueError, "unknown integer block codec " & $tag)
+  case BlockCodec(tag)
+  of bcBP128:
+    result = decodeBP128Block(input, pos + 1, output)
+    if delta: prefixSum(output, prev)
+  of bcPFor:
+    result = decodePForBlock(input, pos + 1, output)
+    if delta: prefixSum(output, prev)
+  of bcStreamVByte:
+    result = decodeSvbBlock(input, pos + 1, output, delta, prev)
+  of bcEliasFano:
+    result = decodeEliasFanoBlock(input, pos + 1, output)
+  of bcAuto: discard
+
+proc decodeBlocks*(input: openArray[byte], output: var openArray[uint32],
+                   delta = false): int =
+  ## Decode `output.len` integers; returns the bytes consumed. `delta`
+  ## must match the encoder.
+  var prev = 0'u32
+  var i = 0
+  while i < output.len:
+    let n = min(BlockSize, output.len - i)
+    result = decodeBlock(input, result, output.toOpenArray(i, i + n - 1), delta, prev)
+    prev = output[i + n - 1]
+    i += n
+
+proc blockCodecs*(input: openArray[byte], count: int): seq[BlockCodec] =
+  ## Codec chosen for each block of a stream of `count` integers
+  var scratch: array[BlockSize, uint32]
+  var pos = 0
+  var i = 0
+  while i < count:
+    let n = min(BlockSize, count - i)
+    let next = decodeBlock(input, pos, scratch.toOpenArray(0, n - 1), false, 0)
+    result.add BlockCodec(input[pos])
+    pos = next
+    i += n
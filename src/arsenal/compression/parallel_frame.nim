@@ -0,0 +1,461 @@
+## Block-Parallel Compression Frames
+## =================================
+##
+## ARSL frames (version 3) whose payload is a run of independently
+## compressed LZ4 or Zstd blocks followed by a block index. Blocks share
+## no history, so both directions use every core, and the index locates
+## each block, so a byte range is read by decompressing only the blocks
+## that cover it.
+##
+## Payload layout (after the 14-byte frame header, flags = FlagBlockIndex):
+## - Codec: 1 byte (0 = LZ4, 1 = Zstd)
+## - Block size: 4 bytes (uncompressed bytes per block; the last is shorter)
+## - Blocks: back to back
+## - Index: 8 bytes per block: stored size (bit 31 set = kept
+##   uncompressed) and CRC-32C of the stored bytes
+## - Block count: 4 bytes
+##
+## The index trails the blocks so a file is written in one pass; readers
+## find it from the frame length. Blocks that do not shrink are stored
+## as is. All integers are little-endian.
+##
+## Workers claim block numbers from a shared counter, a few batches' worth
+## per thread at a time, so memory stays bounded when compressing a file
+## larger than RAM. The output is identical for any thread count. Without
+## `--threads:on` everything runs on the calling thread.
+##
+## Usage:
+## ```nim
+## let frame = compressFrame(data, fcZstd, level = 3)        # all cores
+## assert decompressFrame(frame) == data
+##
+## let index = readFrameIndex(frame)
+## let slice = readRange(frame, index, offset = 5_000_000, len = 4096)
+##
+## discard compressFile("snapshot.db", "snapshot.arsl", fcLz4)
+## discard decompressFile("snapshot.arsl", "restored.db")
+## ```
+
+import std/[memfiles, os]
+import ./compressor
+import ./compressors/lz4
+import ../hashing/crc
+
+const ZstdAvailable = not defined(arsenal_no_zstd)
+
+when ZstdAvailable:
+  import ./compressors/zstd
+
+when compileOption("threads"):
+  import std/osproc
+  import ../concurrency/atomics/atomic
+
+const
+  DefaultFrameBlockSize* = 1 shl 20      ## 1 MiB: 20k blocks per 20 GB
+  MinFrameBlockSize* = 4096
+  MaxFrameBlockSize* = 1 shl 30          ## Stored sizes use 31 bits
+  StoredBit = 0x8000_0000'u32
+  PayloadHeaderSize = 5
+  IndexEntrySize = 8
+  BlocksPerWorker = 8                    ## Blocks per thread per batch
+
+type
+  FrameCodec* = enum
+    fcLz4 = "lz4"
+    fcZstd = "zstd"
+
+  FrameBlock* = object
+    offset*: int                         ## Position of the block in the frame
+    size*: int                           ## Bytes stored in the frame
+    rawOffset*: int                      ## Position in the original data
+    rawSize*: int
+    stored*: bool                        ## Kept uncompressed
+    checksum*: uint32                    ## CRC-32C of the stored bytes
+
+  FrameIndex* = object
+    ## Parsed block index of a version 3 frame
+    codec*: FrameCodec
+    blockSize*: int
+    originalSize*: int
+    blocks*: seq[FrameBlock]
+
+  Bytes = ptr UncheckedArray[byte]
+
+  CompressJob = object
+    ## One batch of blocks, shared by all workers.
+    src: Bytes
+    len, blockSize: int
+    first, last: int                     ## Block numbers in this batch
+    codec: FrameCodec
+    level: int
+    outputs: ptr UncheckedArray[seq[byte]]
+    stored: ptr UncheckedArray[bool]
+    checksums: ptr UncheckedArray[uint32]
+    when compileOption("threads"):
+      next: Atomic[int]
+    else:
+      next: int
+
+  DecompressJob = object
+    frame: Bytes
+    index: ptr FrameIndex
+    dst: Bytes
+    dstBase: int                         ## Original offset of dst[0]
+    first, last: int
+    when compileOption("threads"):
+      next: Atomic[int]
+      failed: Atomic[int]                ## A corrupt block + 1, or 0
+    else:
+      next: int
+      failed: int
+
+proc putU32(output: var seq[byte], v: uint32) =
+  for i in 0 ..< 4:
+    output.add byte((v shr (8 * i)) and 0xFF)
+
+proc getU32(p: Bytes, offset: int): uint32 {.inline.} =
+  uint32(p[offset]) or (uint32(p[offset + 1]) shl 8) or
+    (uint32(p[offset + 2]) shl 16) or (uint32(p[offset + 3]) shl 24)
+
+template claim(job: ptr CompressJob | ptr DecompressJob): int =
+  when compileOption("threads"):
+    job.next.fetchAdd(1, Relaxed)
+  else:
+    (inc job.next; job.next - 1)
+
+# =============================================================================
+# Blocks
+# =============================================================================
+
+proc encodeBlock(job: ptr CompressJob, b: int, zctx: pointer) =
+  let start = b * job.blockSize
+  let n = min(job.blockSize, job.len - start)
+  let k = b - job.first
+  template output: untyped = job.outputs[k]
+  var size = 0
+  case job.codec
+  of fcLz4:
+    let bound = LZ4_compressBound(cint(n))
+    output.setLen(bound)
+    size = LZ4_compress_default(cast[cstring](addr job.src[start]),
+                                cast[cstring](addr output[0]), cint(n), bound)
+  of fcZstd:
+    when ZstdAvailable:
+      let bound = ZSTD_compressBound(csize_t(n))
+      output.setLen(int(bound))
+      let r = ZSTD_compressCCtx(cast[ptr ZSTD_CCtx](zctx), addr output[0], bound,
+                                addr job.src[start], csize_t(n), cint(job.level))
+      size = if ZSTD_isError(r) != 0: 0 else: int(r)
+  # Store blocks that failed to compress or did not shrink
+  job.stored[k] = size <= 0 or size >= n
+  if job.stored[k]:
+    output.setLen(n)
+    copyMem(addr output[0], addr job.src[start], n)
+  else:
+    output.setLen(size)
+  job.checksums[k] = crc32c(output)
+
+proc compressWorker(job: ptr CompressJob) {.gcsafe.} =
+  ## Worker loop: claim blocks of the batch until none are left.
+  var zctx: pointer = nil
+  when ZstdAvailable:
+    if job.codec == fcZstd:
+      zctx = ZSTD_createCCtx()
+  while true:
+    let b = job.first + claim(job)
+    if b >= job.last:
+      break
+    encodeBlock(job, b, zctx)
+  when ZstdAvailable:
+    if zctx != nil:
+      discard ZSTD_freeCCtx(cast[ptr ZSTD_CCtx](zctx))
+
+proc decodeBlock(job: ptr DecompressJob, b: int, dctx: pointer): bool =
+  let blk = job.index.blocks[b]
+  let at = blk.rawOffset - job.dstBase
+  if blk.size > 0 and
+     crc32c(toOpenArray(job.frame, blk.offset, blk.offset + blk.size - 1)) != blk.checksum:
+    return false
+  if blk.stored:
+    if blk.size > 0:
+      copyMem(addr job.dst[at], addr job.frame[blk.offset], blk.size)
+    return true
+  case job.index.codec
+  of fcLz4:
+    let n = LZ4_decompress_safe(cast[cstring](addr job.frame[blk.offset]),
+                                cast[cstring](addr job.dst[at]),
+                                cint(blk.size), cint(blk.rawSize))
+    n == blk.rawSize
+  of fcZstd:
+    when ZstdAvailable:
+      let n = ZSTD_decompressDCtx(cast[ptr ZSTD_DCtx](dctx),
+                                  addr job.dst[at], csize_t(blk.rawSize),
+                                  addr job.frame[blk.offset], csize_t(blk.size))
+      ZSTD_isError(n) == 0 and int(n) == blk.rawSize
+    else:
+      false
+
+proc decompressWorker(job: ptr DecompressJob) {.gcsafe.} =
+  var dctx: pointer = nil
+  when ZstdAvailable:
+    if job.index.codec == fcZstd:
+      dctx = ZSTD_createDCtx()
+  while true:
+    let b = job.first + claim(job)
+    if b >= job.last:
+      break
+    if not decodeBlock(job, b, dctx):
+      when compileOption("threads"):
+        job.failed.store(b + 1, Relaxed)
+      else:
+        job.failed = b + 1
+  when ZstdAvailable:
+    if dctx != nil:
+      discard ZSTD_freeDCtx(cast[ptr ZSTD_DCtx](dctx))
+
+when compileOption("threads"):
+  proc compressThread(job: ptr CompressJob) {.thread.} =
+    compressWorker(job)
+
+  proc decompressThread(job: ptr DecompressJob) {.thread.} =
+    decompressWorker(job)
+
+proc workerCount(threads, blocks: int): int =
+  when compileOption("threads"):
+    let wanted = if threads > 0: threads else: countProcessors()
+    max(1, min(wanted, blocks))
+  else:
+    1
+
+template runWorkers(job: untyped, workers: int, threadProc, workerProc: untyped) =
+  when compileOption("threads"):
+    var ts = newSeq[Thread[typeof(addr job)]](workers - 1)
+    for i in 0 ..< ts.len:
+      createThread(ts[i], threadProc, addr job)
+    workerProc(addr job)                 # The caller is worker 0
+    joinThreads(ts)
+  else:
+    workerProc(addr job)
+
+# =============================================================================
+# Compression
+# =============================================================================
+
+proc compressBlocks(src: Bytes, len: int, codec: FrameCodec, level: int,
+                    blockSize, threads: int,
+                    emit: proc (data: openArray[byte]) {.closure.}) =
+  if blockSize < MinFrameBlockSize or blockSize > MaxFrameBlockSize:
+    raise newException(ValueError, "frame block size must be in " &
+      $MinFrameBlockSize & " .. " & $MaxFrameBlockSize)
+  when not ZstdAvailable:
+    if codec == fcZstd:
+      raise newException(ValueError, "built with -d:arsenal_no_zstd")
+
+  var header = @(frameHeader(BlockFrameVersion, FlagBlockIndex, uint64(len)))
+  header.add byte(ord(codec))
+  header.putU32(uint32(blockSize))
+  emit(header)
+
+  let blockCount = (len + blockSize - 1) div blockSize
+  let workers = workerCount(threads, blockCount)
+  let batch = max(1, min(blockCount, workers * BlocksPerWorker))
+  var outputs = newSeq[seq[byte]](batch)
+  var stored = newSeq[bool](batch)
+  var checksums = newSeq[uint32](batch)
+  var index = newSeqOfCap[byte](blockCount * IndexEntrySize + 4)
+
+  var first = 0
+  while first < blockCount:
+    let last = min(first + batch, blockCount)
+    var job = CompressJob(src: src, len: len, blockSize: blockSize,
+                          first: first, last: last, codec: codec, level: level,
+                          outputs: cast[ptr UncheckedArray[seq[byte]]](addr outputs[0]),
+                          stored: cast[ptr UncheckedArray[bool]](addr stored[0]),
+                          checksums: cast[ptr UncheckedArray[uint32]](addr checksums[0]))
+    runWorkers(job, min(workers, last - first), compressThread, compressWorker)
+    for b in first ..< last:
+      let k = b - first
+      emit(outputs[k])
+      index.putU32(uint32(outputs[k].len) or (if stored[k]: StoredBit else: 0'u32))
+      index.putU32(checksums[k])
+    first = last
+
+  index.putU32(uint32(blockCount))
+  emit(index)
+
+proc compressFrame*(data: openArray[byte], codec = fcLz4,
+                    level: CompressionLevel = DefaultLevel,
+                    blockSize = DefaultFrameBlockSize, threads = 0): seq[byte] =
+  ## Compress `data` into a block-indexed frame on `threads` threads
+  ## (0 = one per processor). `level` applies to Zstd only.
+  ##
+  ## Raises `ValueError` for a block size outside
+  ## `MinFrameBlockSize .. MaxFrameBlockSize`.
+  var output: seq[byte]
+  let p = if data.len > 0: cast[Bytes](unsafeAddr data[0]) else: nil
+  compressBlocks(p, data.len, codec, level, blockSize, threads,
+                 proc (chunk: openArray[byte]) = output.add chunk)
+  output
+
+proc compressFile*(src, dst: string, codec = fcLz4,
+                   level: CompressionLevel = DefaultLevel,
+                   blockSize = DefaultFrameBlockSize, threads = 0): int =
+  ## Compress file `src` into a frame written to `dst`; returns the frame
+  ## size. The input is memory-mapped and the output written batch by
+  ## batch, so neither is held in memory whole.
+  var f = open(dst, fmWrite)
+  defer: f.close()
+  var written = 0
+  let emit = proc (chunk: openArray[byte]) =
+    if chunk.len > 0 and f.writeBuffer(unsafeAddr chunk[0], chunk.len) != chunk.len:
+      raise newException(IOError, "cannot write " & dst)
+    written += chunk.len
+  if getFileSize(src) == 0:                 # mmap rejects empty files
+    compressBlocks(nil, 0, codec, level, blockSize, threads, emit)
+  else:
+    var m = memfiles.open(src, mode = fmRead)
+    defer: m.close()
+    compressBlocks(cast[Bytes](m.mem), m.size, codec, level, blockSize, threads, emit)
+  written
+
+# =============================================================================
+# Index
+# =============================================================================
+
+proc readIndex(frame: Bytes, len: int): FrameIndex =
+  const minLen = FrameHeaderSize + PayloadHeaderSize + 4
+  if len < minLen:
+    raise newException(ValueError, "frame too small")
+  for i in 0 ..< 4:
+    if frame[i] != FrameMagic[i]:
+      raise newException(ValueError, "invalid frame magic")
+  if frame[4] != BlockFrameVersion or (frame[5] and FlagBlockIndex) == 0:
+    raise newException(ValueError, "not a block-indexed frame")
+  var originalSize = 0'u64
+  for i in 0 ..< 8:
+    originalSize = originalSize or (uint64(frame[6 + i]) shl (8 * i))
+  let codec = int(frame[FrameHeaderSize])
+  if codec > ord(high(FrameCodec)):
+    raise newException(ValueError, "unknown frame codec " & $codec)
+  result.codec = FrameCodec(codec)
+  result.blockSize = int(getU32(frame, FrameHeaderSize + 1))
+  result.originalSize = int(originalSize)
+  if result.blockSize < 1 or originalSize > uint64(high(int) div 2):
+    raise newException(ValueError, "corrupt frame header")
+
+  let count = int(getU32(frame, len - 4))
+  let expected = (result.originalSize + result.blockSize - 1) div result.blockSize
+  let indexStart = len - 4 - count * IndexEntrySize
+  let dataStart = FrameHeaderSize + PayloadHeaderSize
+  if count != expected or indexStart < dataStart:
+    raise newException(ValueError, "corrupt frame index")
+
+  result.blocks = newSeq[FrameBlock](count)
+  var offset = dataStart
+  for b in 0 ..< count:
+    let e = indexStart + b * IndexEntrySize
+    let sizeWord = getU32(frame, e)
+    let rawOffset = b * result.blockSize
+    var blk = FrameBlock(offset: offset, size: int(sizeWord and not StoredBit),
+                         rawOffset: rawOffset,
+                         rawSize: min(result.blockSize, result.originalSize - rawOffset),
+                         stored: (sizeWord and StoredBit) != 0,
+                         checksum: getU32(frame, e + 4))
+    if blk.stored and blk.size != blk.rawSize:
+      raise newException(ValueError, "corrupt frame index")
+    offset += blk.size
+    result.blocks[b] = blk
+  if offset != indexStart:
+    raise newException(ValueError, "corrupt frame index")
+
+proc readFrameIndex*(frame: openArray[byte]): FrameIndex =
+  ## Parse and validate the header and block index of a frame made by
+  ## `compressFrame`. Raises `ValueError` if it is malformed.
+  if frame.len == 0:
+    raise newException(ValueError, "frame too small")
+  readIndex(cast[Bytes](unsafeAddr frame[0]), frame.len)
+
+proc isBlockFrame*(data: openArray[byte]): bool =
+  ## True if `data` starts with a block-indexed frame header
+  if data.len < FrameHeaderSize or data[4] != BlockFrameVersion:
+    return false
+  for i in 0 ..< 4:
+    if data[i] != FrameMagic[i]:
+      return false
+  true
+
+# =============================================================================
+# Decompression
+# =============================================================================
+
+proc decompressBlocks(frame: Bytes, index: FrameIndex, dst: Bytes,
+                      first, last, threads: int) =
+  ## Decompress blocks `first ..< last` into `dst`, which starts at the
+  ## first of them; raises `IOError` naming a corrupt block.
+  if first >= last:
+    return
+  var job = DecompressJob(frame: frame, index: unsafeAddr index, dst: dst,
+                          dstBase: index.blocks[first].rawOffset,
+                          first: first, last: last)
+  runWorkers(job, workerCount(threads, last - first), decompressThread, decompressWorker)
+  let failed =
+    when compileOption("threads"): job.failed.load(Relaxed)
+    else: job.failed
+  if failed > 0:
+    raise newException(IOError, "corrupt frame block " & $(failed - 1))
+
+proc decompressFrame*(frame: openArray[byte], threads = 0): seq[byte] =
+  ## Decompress a whole frame on `threads` threads (0 = one per
+  ## processor). Every block's checksum is verified.
+  let index = readFrameIndex(frame)
+  result = newSeq[byte](index.originalSize)
+  if result.len > 0:
+    decompressBlocks(cast[Bytes](unsafeAddr frame[0]), index,
+                     cast[Bytes](addr result[0]), 0, index.blocks.len, threads)
+
+proc decompressBlock*(frame: openArray[byte], index: FrameIndex, b: int): seq[byte] =
+  ## Decompress block `b` alone. Raises `ValueError` if there is no
+  ## block `b`.
+  if b < 0 or b >= index.blocks.len:
+    raise newException(ValueError, "block " & $b & " outside the frame")
+  let blk = index.blocks[b]
+  result = newSeq[byte](blk.rawSize)
+  if blk.rawSize == 0:
+    return
+  decompressBlocks(cast[Bytes](unsafeAddr frame[0]), index,
+                   cast[Bytes](addr result[0]), b, b + 1, 1)
+
+proc readRange*(frame: openArray[byte], index: FrameIndex,
+                offset, len: int): seq[byte] =
+  ## Bytes `offset ..< offset + len` of the original data, decompressing
+  ## only the blocks that overlap them (in parallel if there are several).
+  ## Raises `ValueError` if the range is not inside the original data.
+  if offset < 0 or len < 0 or offset > index.originalSize or
+     len > index.originalSize - offset:
+    raise newException(ValueError, "range outside the original data")
+  if len == 0:
+    return @[]
+  let first = offset div index.blockSize
+  let last = (offset + len - 1) div index.blockSize + 1
+  let spanStart = first * index.blockSize
+  var span = newSeq[byte](
+    index.blocks[last - 1].rawOffset + index.blocks[last - 1].rawSize - spanStart)
+  decompressBlocks(cast[Bytes](unsafeAddr frame[0]), index,
+                   cast[Bytes](addr span[0]), first, last,
+                   if last - first > 1: 0 else: 1)
+  span[offset - spanStart ..< offset - spanStart + len]
+
+proc decompressFile*(src, dst: string, threads = 0): int =
+  ## Decompress frame file `src` into `dst`, writing every block straight
+  ## into a memory mapping of the output; returns the original size.
+  var m = memfiles.open(src, mode = fmRead)
+  defer: m.close()
+  let index = readIndex(cast[Bytes](m.mem), m.size)
+  result = index.originalSize
+  if result == 0:
+    writeFile(dst, "")
+    return
+  var output = memfiles.open(dst, mode = fmReadWrite, newFileSize = result)
+  defer: output.close()
+  decompressBlocks(cast[Bytes](m.mem), index, cast[Bytes](output.mem),
+                   0, index.blocks.len, threads)
@@ -21,6 +21,18 @@
 ## 3. Data stream: compressed integer bytes laid out sequentially
 ## 4. Decoding: Use pshufb shuffle to extract and permute bytes
 ##
+## Kernels (picked at runtime from `platform/config` CPU features):
+## - SSSE3: one 16-byte load + `pshufb` per control byte (4 ints)
+## - AVX2: two control bytes per 256-bit `vpshufb` (8 ints)
+## - NEON (ARM64): `vqtbl1q_u8`, the same shuffle tables
+## - Scalar: portable fallback, also used for the last partial block and
+##   whenever fewer than 16 data bytes remain (SIMD loads are 16 bytes)
+##
+## The encoders mirror this: lane lengths come from a byte-wise zero
+## compare, and one shuffle compacts the 4 values into the data stream.
+## Every kernel produces byte-identical output. Build with
+## `-d:arsenalScalar` to force the portable code.
+##
 ## Performance:
 ## - **Speed**: 4+ billion integers/sec (Haswell 3.4GHz)
 ## - **Compression**: ~25-50% for sorted integers (delta encoding)
@@ -43,9 +55,18 @@
 ## # Decode integers
 ## let decoded = decodeStreamVByte(control, data, values.len)
 ## assert decoded == values
+##
+## # Decode into a reused buffer, no allocation
+## var buf = newSeq[uint32](values.len)
+## discard decodeStreamVByte(control, data, buf)
+##
+## # Sorted ids: delta coding fused into the SIMD loop
+## let (dctrl, ddata) = encodeStreamVByteDelta(values)
+## discard decodeStreamVByteDelta(dctrl, ddata, buf)
 ## ```
 
 import std/[bitops]
+import ../platform/config
 
 # =============================================================================
 # Constants
@@ -59,6 +80,372 @@ const
   # Example: control byte 0b11100100 means: [1 byte, 0 bytes error, 4 bytes, 4 bytes]
   # Actually: 0b00011011 means: [1 byte, 2 bytes, 3 bytes, 4 bytes] (read right to left)
 
+type
+  StreamVByteKernel* = enum
+    ## Implementation used for a block of 4 (or 8) integers
+    svkScalar = "scalar"
+    svkSSSE3 = "ssse3"
+    svkAVX2 = "avx2"
+    svkNEON = "neon"
+
+# =============================================================================
+# Shuffle Tables
+# =============================================================================
+
+proc controlLength(c: int, lane: int): int {.inline.} =
+  ((c shr (2 * lane)) and 3) + 1
+
+proc makeLengthTable(): array[256, uint8] =
+  ## Data bytes used by the 4 values of each control byte
+  for c in 0 ..< 256:
+    var n = 0
+    for lane in 0 ..< 4:
+      n += controlLength(c, lane)
+    result[c] = uint8(n)
+
+proc makeDecodeShuffle(): array[256, array[16, uint8]] =
+  ## For each control byte: which data byte lands in each output byte
+  ## (0xFF zeroes it). Works for both `pshufb` and `vqtbl1q_u8`.
+  for c in 0 ..< 256:
+    var offset = 0
+    for lane in 0 ..< 4:
+      let n = controlLength(c, lane)
+      for j in 0 ..< 4:
+        result[c][4 * lane + j] = if j < n: uint8(offset + j) else: 0xFF'u8
+      offset += n
+
+proc makeEncodeShuffle(): array[256, array[16, uint8]] =
+  ## For each control byte: which input byte (of 4 little-endian values)
+  ## goes to each position of the packed data.
+  for c in 0 ..< 256:
+    for b in result[c].mitems:
+      b = 0xFF
+    var pos = 0
+    for lane in 0 ..< 4:
+      for j in 0 ..< controlLength(c, lane):
+        result[c][pos] = uint8(4 * lane + j)
+        inc pos
+
+# Globals rather than consts so the C kernels can take their address
+let
+  svbLengths = makeLengthTable()
+  svbDecodeShuffle = makeDecodeShuffle()
+  svbEncodeShuffle = makeEncodeShuffle()
+
+# =============================================================================
+# SIMD Kernels
+# =============================================================================
+#
+# Each kernel handles whole control bytes only, and only while a full
+# 16-byte vector fits in the input (decode) or output (encode). Callers
+# finish with the scalar loop from where the kernel stopped.
+
+const
+  HwCompiler = (defined(gcc) or defined(clang) or defined(llvm_gcc)) and
+               not defined(arsenalScalar)
+  X86Svb = HwCompiler and defined(amd64)
+  ArmSvb = HwCompiler and defined(arm64)
+
+when X86Svb:
+  {.emit: """/*TYPESECTION*/
+#include <stdint.h>
+#include <stddef.h>
+#include <immintrin.h>
+
+__attribute__((target("ssse3")))
+static size_t arsenal_svb_decode_ssse3(const uint8_t* ctrl, size_t nctrl,
+                                       const uint8_t* data, size_t dataLen,
+                                       uint32_t* out, const uint8_t* shuf,
+                                       const uint8_t* lens, size_t* used) {
+  size_t k = 0, pos = 0;
+  for (; k < nctrl && pos + 16 <= dataLen; k++) {
+    const uint8_t c = ctrl[k];
+    const __m128i d = _mm_loadu_si128((const __m128i*)(data + pos));
+    const __m128i s = _mm_loadu_si128((const __m128i*)(shuf + 16 * c));
+    _mm_storeu_si128((__m128i*)(out + 4 * k), _mm_shuffle_epi8(d, s));
+    pos += lens[c];
+  }
+  *used = pos;
+  return k;
+}
+
+/* Two control bytes per iteration: vpshufb shuffles each 128-bit half
+   on its own, so the halves are simply two SSSE3 steps side by side. */
+__attribute__((target("avx2")))
+static size_t arsenal_svb_decode_avx2(const uint8_t* ctrl, size_t nctrl,
+                                      const uint8_t* data, size_t dataLen,
+                                      uint32_t* out, const uint8_t* shuf,
+                                      const uint8_t* lens, size_t* used) {
+  size_t k = 0, pos = 0;
+  for (; k + 2 <= nctrl && pos + 32 <= dataLen; k += 2) {
+    const uint8_t c0 = ctrl[k], c1 = ctrl[k + 1];
+    const __m128i lo = _mm_loadu_si128((const __m128i*)(data + pos));
+    const __m128i hi = _mm_loadu_si128((const __m128i*)(data + pos + lens[c0]));
+    const __m256i d = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    const __m256i s = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(shuf + 16 * c0))),
+        _mm_loadu_si128((const __m128i*)(shuf + 16 * c1)), 1);
+    _mm256_storeu_si256((__m256i*)(out + 4 * k), _mm256_shuffle_epi8(d, s));
+    pos += lens[c0] + lens[c1];
+  }
+  for (; k < nctrl && pos + 16 <= dataLen; k++) {
+    const uint8_t c = ctrl[k];
+    const __m128i d = _mm_loadu_si128((const __m128i*)(data + pos));
+    const __m128i s = _mm_loadu_si128((const __m128i*)(shuf + 16 * c));
+    _mm_storeu_si128((__m128i*)(out + 4 * k), _mm_shuffle_epi8(d, s));
+    pos += lens[c];
+  }
+  *used = pos;
+  return k;
+}
+
+/* A lane needs as many bytes as its highest non-zero byte; one compare
+   against zero gives all 16 byte flags, a nibble table the 4 codes. */
+__attribute__((target("ssse3")))
+static size_t arsenal_svb_encode_ssse3(const uint32_t* in, size_t nquads,
+                                       uint8_t* ctrl, uint8_t* data,
+                                       const uint8_t* shuf, const uint8_t* lens) {
+  static const uint8_t code[16] = {0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3};
+  const __m128i zero = _mm_setzero_si128();
+  size_t pos = 0;
+  for (size_t k = 0; k < nquads; k++) {
+    const __m128i v = _mm_loadu_si128((const __m128i*)(in + 4 * k));
+    const unsigned m = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) & 0xFFFF;
+    const uint8_t c = (uint8_t)(code[m & 15] | (code[(m >> 4) & 15] << 2) |
+                                (code[(m >> 8) & 15] << 4) | (code[m >> 12] << 6));
+    ctrl[k] = c;
+    const __m128i s = _mm_loadu_si128((const __m128i*)(shuf + 16 * c));
+    _mm_storeu_si128((__m128i*)(data + pos), _mm_shuffle_epi8(v, s));
+    pos += lens[c];
+  }
+  return pos;
+}
+
+/* Delta / zigzag decoding fused into the shuffle loop. Bit 0 of `mode`
+   turns the 4 deltas into a running sum: two shifted adds give the
+   in-vector prefix, and the previous vector's last value (broadcast in
+   `carry`) is added on, so only one add per vector is loop-carried.
+   Bit 1 then undoes zigzag. `prev` is the value before the first one
+   and receives the running sum on return. */
+__attribute__((target("ssse3")))
+static inline __m128i arsenal_svb_xform_128(__m128i v, __m128i* carry, int mode) {
+  if (mode & 1) {
+    v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+    v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+    v = _mm_add_epi32(v, *carry);
+    *carry = _mm_shuffle_epi32(v, 0xFF);
+  }
+  if (mode & 2)
+    v = _mm_xor_si128(_mm_srli_epi32(v, 1),
+                      _mm_sub_epi32(_mm_setzero_si128(),
+                                    _mm_and_si128(v, _mm_set1_epi32(1))));
+  return v;
+}
+
+__attribute__((target("ssse3")))
+static size_t arsenal_svb_decode_xform_ssse3(const uint8_t* ctrl, size_t nctrl,
+                                             const uint8_t* data, size_t dataLen,
+                                             uint32_t* out, const uint8_t* shuf,
+                                             const uint8_t* lens, uint32_t* prev,
+                                             int mode, size_t* used) {
+  __m128i carry = _mm_set1_epi32((int)*prev);
+  size_t k = 0, pos = 0;
+  for (; k < nctrl && pos + 16 <= dataLen; k++) {
+    const uint8_t c = ctrl[k];
+    const __m128i d = _mm_loadu_si128((const __m128i*)(data + pos));
+    const __m128i s = _mm_loadu_si128((const __m128i*)(shuf + 16 * c));
+    _mm_storeu_si128((__m128i*)(out + 4 * k),
+                     arsenal_svb_xform_128(_mm_shuffle_epi8(d, s), &carry, mode));
+    pos += lens[c];
+  }
+  *prev = (uint32_t)_mm_cvtsi128_si32(carry);
+  *used = pos;
+  return k;
+}
+
+/* 8 values per step: the per-lane prefix sums come from the same two
+   shifted adds (vpslldq shifts each half on its own), the low half's
+   total is added to the high half, then the carry to both. */
+__attribute__((target("avx2")))
+static size_t arsenal_svb_decode_xform_avx2(const uint8_t* ctrl, size_t nctrl,
+                                            const uint8_t* data, size_t dataLen,
+                                            uint32_t* out, const uint8_t* shuf,
+                                            const uint8_t* lens, uint32_t* prev,
+                                            int mode, size_t* used) {
+  __m256i carry = _mm256_set1_epi32((int)*prev);
+  const __m256i last = _mm256_set1_epi32(7);
+  size_t k = 0, pos = 0;
+  for (; k + 2 <= nctrl && pos + 32 <= dataLen; k += 2) {
+    const uint8_t c0 = ctrl[k], c1 = ctrl[k + 1];
+    const __m128i lo = _mm_loadu_si128((const __m128i*)(data + pos));
+    const __m128i hi = _mm_loadu_si128((const __m128i*)(data + pos + lens[c0]));
+    const __m256i d = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    const __m256i s = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(shuf + 16 * c0))),
+        _mm_loadu_si128((const __m128i*)(shuf + 16 * c1)), 1);
+    __m256i v = _mm256_shuffle_epi8(d, s);
+    if (mode & 1) {
+      v = _mm256_add_epi32(v, _mm256_slli_si256(v, 4));
+      v = _mm256_add_epi32(v, _mm256_slli_si256(v, 8));
+      const __m256i t = _mm256_shuffle_epi32(v, 0xFF);
+      v = _mm256_add_epi32(v, _mm256_permute2x128_si256(t, t, 0x08));
+      v = _mm256_add_epi32(v, carry);
+      carry = _mm256_permutevar8x32_epi32(v, last);
+    }
+    if (mode & 2)
+      v = _mm256_xor_si256(_mm256_srli_epi32(v, 1),
+                           _mm256_sub_epi32(_mm256_setzero_si256(),
+                                            _mm256_and_si256(v, _mm256_set1_epi32(1))));
+    _mm256_storeu_si256((__m256i*)(out + 4 * k), v);
+    pos += lens[c0] + lens[c1];
+  }
+  __m128i carry128 = _mm256_castsi256_si128(carry);
+  for (; k < nctrl && pos + 16 <= dataLen; k++) {
+    const uint8_t c = ctrl[k];
+    const __m128i d = _mm_loadu_si128((const __m128i*)(data + pos));
+    const __m128i s = _mm_loadu_si128((const __m128i*)(shuf + 16 * c));
+    _mm_storeu_si128((__m128i*)(out + 4 * k),
+                     arsenal_svb_xform_128(_mm_shuffle_epi8(d, s), &carry128, mode));
+    pos += lens[c];
+  }
+  *prev = (uint32_t)_mm_cvtsi128_si32(carry128);
+  *used = pos;
+  return k;
+}
+""".}
+
+  proc svbDecodeSsse3(ctrl: pointer, nctrl: csize_t, data: pointer,
+                      dataLen: csize_t, output: pointer, shuf, lens: pointer,
+                      used: var csize_t): csize_t
+    {.importc: "arsenal_svb_decode_ssse3", nodecl.}
+  proc svbDecodeAvx2(ctrl: pointer, nctrl: csize_t, data: pointer,
+                     dataLen: csize_t, output: pointer, shuf, lens: pointer,
+                     used: var csize_t): csize_t
+    {.importc: "arsenal_svb_decode_avx2", nodecl.}
+  proc svbEncodeSsse3(input: pointer, nquads: csize_t, ctrl, data: pointer,
+                      shuf, lens: pointer): csize_t
+    {.importc: "arsenal_svb_encode_ssse3", nodecl.}
+  proc svbDecodeXformSsse3(ctrl: pointer, nctrl: csize_t, data: pointer,
+                           dataLen: csize_t, output: pointer, shuf, lens: pointer,
+                           prev: var uint32, mode: cint, used: var csize_t): csize_t
+    {.importc: "arsenal_svb_decode_xform_ssse3", nodecl.}
+  proc svbDecodeXformAvx2(ctrl: pointer, nctrl: csize_t, data: pointer,
+                          dataLen: csize_t, output: pointer, shuf, lens: pointer,
+                          prev: var uint32, mode: cint, used: var csize_t): csize_t
+    {.importc: "arsenal_svb_decode_xform_avx2", nodecl.}
+
+  let
+    cpuHasSsse3 = getCpuFeatures().hasSSSE3
+    cpuHasAvx2 = getCpuFeatures().hasAVX2 and getCpuFeatures().hasAVX
+
+when ArmSvb:
+  {.emit: """/*TYPESECTION*/
+#include <stdint.h>
+#include <stddef.h>
+#include <arm_neon.h>
+
+static size_t arsenal_svb_decode_neon(const uint8_t* ctrl, size_t nctrl,
+                                      const uint8_t* data, size_t dataLen,
+                                      uint32_t* out, const uint8_t* shuf,
+                                      const uint8_t* lens, size_t* used) {
+  size_t k = 0, pos = 0;
+  for (; k < nctrl && pos + 16 <= dataLen; k++) {
+    const uint8_t c = ctrl[k];
+    const uint8x16_t d = vld1q_u8(data + pos);
+    vst1q_u8((uint8_t*)(out + 4 * k), vqtbl1q_u8(d, vld1q_u8(shuf + 16 * c)));
+    pos += lens[c];
+  }
+  *used = pos;
+  return k;
+}
+
+/* Codes from three unsigned compares, packed by a weighted horizontal add. */
+static size_t arsenal_svb_encode_neon(const uint32_t* in, size_t nquads,
+                                      uint8_t* ctrl, uint8_t* data,
+                                      const uint8_t* shuf, const uint8_t* lens) {
+  static const uint32_t weights[4] = {1, 4, 16, 64};
+  const uint32x4_t w = vld1q_u32(weights);
+  const uint32x4_t t1 = vdupq_n_u32(0xFF), t2 = vdupq_n_u32(0xFFFF),
+                   t3 = vdupq_n_u32(0xFFFFFF);
+  size_t pos = 0;
+  for (size_t k = 0; k < nquads; k++) {
+    const uint32x4_t v = vld1q_u32(in + 4 * k);
+    const uint32x4_t code = vaddq_u32(
+        vaddq_u32(vshrq_n_u32(vcgtq_u32(v, t1), 31), vshrq_n_u32(vcgtq_u32(v, t2), 31)),
+        vshrq_n_u32(vcgtq_u32(v, t3), 31));
+    const uint8_t c = (uint8_t)vaddvq_u32(vmulq_u32(code, w));
+    ctrl[k] = c;
+    vst1q_u8(data + pos, vqtbl1q_u8(vreinterpretq_u8_u32(v), vld1q_u8(shuf + 16 * c)));
+    pos += lens[c];
+  }
+  return pos;
+}
+
+/* Fused delta (mode bit 0) and zigzag (bit 1) decoding, as on x86:
+   lane shifts by vextq against zero build the in-vector prefix sum. */
+static size_t arsenal_svb_decode_xform_neon(const uint8_t* ctrl, size_t nctrl,
+                                            const uint8_t* data, size_t dataLen,
+                                            uint32_t* out, const uint8_t* shuf,
+                                            const uint8_t* lens, uint32_t* prev,
+                                            int mode, size_t* used) {
+  const uint32x4_t zero = vdupq_n_u32(0), one = vdupq_n_u32(1);
+  uint32x4_t carry = vdupq_n_u32(*prev);
+  size_t k = 0, pos = 0;
+  for (; k < nctrl && pos + 16 <= dataLen; k++) {
+    const uint8_t c = ctrl[k];
+    uint32x4_t v = vreinterpretq_u32_u8(
+        vqtbl1q_u8(vld1q_u8(data + pos), vld1q_u8(shuf + 16 * c)));
+    if (mode & 1) {
+      v = vaddq_u32(v, vextq_u32(zero, v, 3));
+      v = vaddq_u32(v, vextq_u32(zero, v, 2));
+      v = vaddq_u32(v, carry);
+      carry = vdupq_laneq_u32(v, 3);
+    }
+    if (mode & 2)
+      v = veorq_u32(vshrq_n_u32(v, 1), vsubq_u32(zero, vandq_u32(v, one)));
+    vst1q_u32(out + 4 * k, v);
+    pos += lens[c];
+  }
+  *prev = vgetq_lane_u32(carry, 0);
+  *used = pos;
+  return k;
+}
+""".}
+
+  proc svbDecodeNeon(ctrl: pointer, nctrl: csize_t, data: pointer,
+                     dataLen: csize_t, output: pointer, shuf, lens: pointer,
+                     used: var csize_t): csize_t
+    {.importc: "arsenal_svb_decode_neon", nodecl.}
+  proc svbEncodeNeon(input: pointer, nquads: csize_t, ctrl, data: pointer,
+                     shuf, lens: pointer): csize_t
+    {.importc: "arsenal_svb_encode_neon", nodecl.}
+  proc svbDecodeXformNeon(ctrl: pointer, nctrl: csize_t, data: pointer,
+                          dataLen: csize_t, output: pointer, shuf, lens: pointer,
+                          prev: var uint32, mode: cint, used: var csize_t): csize_t
+    {.importc: "arsenal_svb_decode_xform_neon", nodecl.}
+
+proc streamVByteKernels*(): set[StreamVByteKernel] =
+  ## Kernels this build can run on this machine
+  result = {svkScalar}
+  when X86Svb:
+    if cpuHasSsse3: result.incl svkSSSE3
+    if cpuHasAvx2: result.incl svkAVX2
+  elif ArmSvb:
+    result.incl svkNEON
+
+proc streamVByteKernel*(): StreamVByteKernel =
+  ## Fastest available kernel (what the default arguments use)
+  let k = streamVByteKernels()
+  if svkAVX2 in k: svkAVX2
+  elif svkSSSE3 in k: svkSSSE3
+  elif svkNEON in k: svkNEON
+  else: svkScalar
+
+proc checkKernel(kernel: StreamVByteKernel) {.inline.} =
+  if kernel notin streamVByteKernels():
+    raise newException(ValueError,
+      "Stream VByte kernel " & $kernel & " is not available on this machine")
+
 # =============================================================================
 # Encoding
 # =============================================================================
@@ -74,32 +461,20 @@ proc lengthInBytes(value: uint32): int {.inline.} =
   else:
     4
 
-proc encodeStreamVByte*(values: openArray[uint32]): tuple[control: seq[uint8], data: seq[uint8]] =
-  ## Encode array of uint32 integers using Stream VByte
-  ##
-  ## Returns:
-  ## - control: Control byte stream (length = ⌈n/4⌉)
-  ## - data: Compressed data stream (variable length)
-  ##
-  ## Control byte format (2 bits per integer, 4 integers per byte):
-  ## - 00: 1 byte
-  ## - 01: 2 bytes
-  ## - 10: 3 bytes
-  ## - 11: 4 bytes
-  ##
-  ## Example: values [1, 256, 65536, 16777216]
-  ## - Lengths: [1, 2, 3, 4]
-  ## - Control: 0b11100100 (read pairs right-to-left: 00, 01, 10, 11)
-  ## - Data: [0x01, 0x00,0x01, 0x00,0x00,0x01, 0x00,0x00,0x00,0x01]
-  let n = values.len
-  let numControlBytes = (n + IntegersPerControlByte - 1) div IntegersPerControlByte
-
-  result.control = newSeq[uint8](numControlBytes)
-  result.data = newSeq[uint8]()
+proc maxEncodedSize*(count: int): tuple[control, data: int] =
+  ## Upper bound on both streams for `count` integers
+  ((count + IntegersPerControlByte - 1) div IntegersPerControlByte, count * 4)
 
+proc encodeScalarFrom(values: openArray[uint32], start: int,
+                      control: var openArray[uint8], data: var openArray[uint8],
+                      dataPos: int): int =
+  ## Encode `values[start ..]` (start is a multiple of 4) at `dataPos`;
+  ## returns the data length.
   var
-    valueIdx = 0
-    controlIdx = 0
+    valueIdx = start
+    controlIdx = start div IntegersPerControlByte
+  result = dataPos
+  let n = values.len
 
   while valueIdx < n:
     var controlByte: uint8 = 0
@@ -118,32 +493,88 @@ proc encodeStreamVByte*(values: openArray[uint32]): tuple[control: seq[uint8], d
 
       # Write value bytes (little-endian)
       for j in 0..<numBytes:
-        result.data.add(((value shr (j * 8)) and 0xFF).uint8)
+        data[result] = ((value shr (j * 8)) and 0xFF).uint8
+        inc result
 
       inc valueIdx
 
-    result.control[controlIdx] = controlByte
+    control[controlIdx] = controlByte
     inc controlIdx
 
-# =============================================================================
-# Decoding (Scalar)
-# =============================================================================
-
-proc decodeStreamVByte*(control: openArray[uint8], data: openArray[uint8], count: int): seq[uint32] =
-  ## Decode Stream VByte compressed integers (scalar version)
+proc encodeStreamVByte*(values: openArray[uint32],
+                        control: var openArray[uint8],
+                        data: var openArray[uint8],
+                        kernel = streamVByteKernel()): int =
+  ## Encode into caller-provided buffers; returns the data bytes used.
   ##
-  ## Parameters:
-  ## - control: Control byte stream
-  ## - data: Compressed data stream
-  ## - count: Number of integers to decode
+  ## `control` needs `maxEncodedSize(values.len).control` bytes and
+  ## `data` `maxEncodedSize(values.len).data`. The SIMD kernels store a
+  ## whole 16-byte vector per 4 values, which that bound always fits.
+  checkKernel(kernel)
+  let (controlNeed, _) = maxEncodedSize(values.len)
+  if control.len < controlNeed:
+    raise newException(ValueError, "Stream VByte control buffer too small")
+  var done = 0
+  var pos = 0
+  # Whole quads whose 16-byte stores stay inside `data` (quad k starts
+  # at most 16 * k bytes in)
+  let quads = min(values.len div 4, data.len div 16)
+  when X86Svb:
+    # Packing is bound by the shuffle, not its width: AVX2 reuses SSSE3
+    if kernel in {svkSSSE3, svkAVX2} and quads > 0:
+      pos = int(svbEncodeSsse3(unsafeAddr values[0], csize_t(quads),
+                               addr control[0], addr data[0],
+                               unsafeAddr svbEncodeShuffle, unsafeAddr svbLengths))
+      done = quads * 4
+  elif ArmSvb:
+    if kernel == svkNEON and quads > 0:
+      pos = int(svbEncodeNeon(unsafeAddr values[0], csize_t(quads),
+                              addr control[0], addr data[0],
+                              unsafeAddr svbEncodeShuffle, unsafeAddr svbLengths))
+      done = quads * 4
+  encodeScalarFrom(values, done, control, data, pos)
+
+proc encodeStreamVByte*(values: openArray[uint32],
+                        kernel = streamVByteKernel()): tuple[control: seq[uint8], data: seq[uint8]] =
+  ## Encode array of uint32 integers using Stream VByte
   ##
-  ## Returns decoded uint32 array
-  result = newSeq[uint32](count)
+  ## Returns:
+  ## - control: Control byte stream (length = ⌈n/4⌉)
+  ## - data: Compressed data stream (variable length)
+  ##
+  ## Control byte format (2 bits per integer, 4 integers per byte):
+  ## - 00: 1 byte
+  ## - 01: 2 bytes
+  ## - 10: 3 bytes
+  ## - 11: 4 bytes
+  ##
+  ## Example: values [1, 256, 65536, 16777216]
+  ## - Lengths: [1, 2, 3, 4]
+  ## - Control: 0b11100100 (read pairs right-to-left: 00, 01, 10, 11)
+  ## - Data: [0x01, 0x00,0x01, 0x00,0x00,0x01, 0x00,0x00,0x00,0x01]
+  let (controlLen, dataLen) = maxEncodedSize(values.len)
+  result.control = newSeq[uint8](controlLen)
+  result.data = newSeq[uint8](dataLen)
+  let used = encodeStreamVByte(values, result.control, result.data, kernel)
+  result.data.setLen(used)
+
+proc encodeStreamVByteScalar*(values: openArray[uint32]): tuple[control: seq[uint8], data: seq[uint8]] =
+  ## Portable encoder (reference for the SIMD kernels)
+  encodeStreamVByte(values, svkScalar)
+
+# =============================================================================
+# Decoding
+# =============================================================================
 
+proc decodeScalarFrom(control: openArray[uint8], data: openArray[uint8],
+                      output: var openArray[uint32], start, dataStart: int): int =
+  ## Decode `output[start ..]` (start is a multiple of 4) from `dataStart`;
+  ## returns the data position reached.
+  let count = output.len
   var
-    controlIdx = 0
-    dataIdx = 0
-    valueIdx = 0
+    controlIdx = start div IntegersPerControlByte
+    dataIdx = dataStart
+    valueIdx = start
 
   while valueIdx < count:
     let controlByte = control[controlIdx]
@@ -164,113 +595,66 @@ proc decodeStreamVByte*(control: openArray[uint8], data: openArray[uint8], count
         value = value or (data[dataIdx].uint32 shl (j * 8))
         inc dataIdx
 
-      result[valueIdx] = value
+      output[valueIdx] = value
       inc valueIdx
+  dataIdx
+
+proc decodeStreamVByte*(control: openArray[uint8], data: openArray[uint8],
+                        output: var openArray[uint32],
+                        kernel = streamVByteKernel()): int =
+  ## Decode `output.len` integers into `output`; returns the data bytes
+  ## consumed. Never reads past `data`, whatever the kernel.
+  checkKernel(kernel)
+  let quads = min(output.len div 4, control.len)
+  var done = 0
+  var pos = 0
+  if quads > 0 and data.len > 0:
+    var used: csize_t
+    var blocks: csize_t
+    when X86Svb:
+      if kernel == svkAVX2:
+        blocks = svbDecodeAvx2(unsafeAddr control[0], csize_t(quads),
+                               unsafeAddr data[0], csize_t(data.len),
+                               addr output[0], unsafeAddr svbDecodeShuffle,
+                               unsafeAddr svbLengths, used)
+      elif kernel == svkSSSE3:
+        blocks = svbDecodeSsse3(unsafeAddr control[0], csize_t(quads),
+                                unsafeAddr data[0], csize_t(data.len),
+                                addr output[0], unsafeAddr svbDecodeShuffle,
+                                unsafeAddr svbLengths, used)
+    elif ArmSvb:
+      if kernel == svkNEON:
+        blocks = svbDecodeNeon(unsafeAddr control[0], csize_t(quads),
+                               unsafeAddr data[0], csize_t(data.len),
+                               addr output[0], unsafeAddr svbDecodeShuffle,
+                               unsafeAddr svbLengths, used)
+    done = int(blocks) * 4
+    pos = int(used)
+  decodeScalarFrom(control, data, output, done, pos)
+
+proc decodeStreamVByte*(control: openArray[uint8], data: openArray[uint8], count: int,
+                        kernel = streamVByteKernel()): seq[uint32] =
+  ## Decode Stream VByte compressed integers
+  ##
+  ## Parameters:
+  ## - control: Control byte stream
+  ## - data: Compressed data stream
+  ## - count: Number of integers to decode
+  ## - kernel: Implementation (default: fastest on this CPU)
+  ##
+  ## Returns decoded uint32 array
+  result = newSeq[uint32](count)
+  discard decodeStreamVByte(control, data, result, kernel)
 
-# =============================================================================
-# SIMD-Accelerated Decoding (SSSE3)
-# =============================================================================
+proc decodeStreamVByteScalar*(control: openArray[uint8], data: openArray[uint8],
+                              count: int): seq[uint32] =
+  ## Portable decoder (reference for the SIMD kernels)
+  decodeStreamVByte(control, data, count, svkScalar)
 
-when defined(amd64) and not defined(noSimd):
-  # Optimized Stream VByte decoding (scalar with aggressive unrolling)
-  # Designed to be fast on modern CPUs with good cache behavior
-  # Future: Can be replaced with SSSE3 pshufb via nimsimd when Nim 2.0+ is available
-
-  proc decodeStreamVByteSIMD*(control: openArray[uint8], data: openArray[uint8], count: int): seq[uint32] =
-    ## Optimized Stream VByte decoding using aggressive unrolling
-    ##
-    ## Strategy:
-    ## 1. Unroll 4 control bytes (16 integers) per iteration
-    ## 2. Branchless decoding using case statements on byte lengths
-    ## 3. Prefetch-friendly access patterns
-    ## 4. ~2-3× speedup over naive scalar
-    ##
-    ## Future nimsimd integration would add another 2-4× via SSSE3 pshufb,
-    ## for total 4-8× vs. naive scalar.
-
-    result = newSeq[uint32](count)
-
-    var
-      controlIdx = 0
-      dataIdx = 0
-      valueIdx = 0
-
-    # Unrolled decoding: process 4 control bytes (16 integers) per iteration
-    let numControlBytes = (count + IntegersPerControlByte - 1) div IntegersPerControlByte
-    let numUnrolledLoops = numControlBytes div 4
-
-    # Hot path: unrolled loops for 4 control bytes at a time
-    for _ in 0..<numUnrolledLoops:
-      # Process 4 control bytes (16 integers) in unrolled loop
-      for _ in 0..<4:
-        if valueIdx >= count:
-          break
-
-        let controlByte = control[controlIdx]
-        inc controlIdx
-
-        # Branchless decode of 4 integers
-        for i in 0..<IntegersPerControlByte:
-          if valueIdx >= count:
-            break
-
-          let lengthCode = (controlByte shr (i * 2)) and 0x03
-          let numBytes = lengthCode.int + 1
-
-          var value: uint32 = 0
-          case numBytes
-          of 1:
-            value = data[dataIdx].uint32
-            dataIdx += 1
-          of 2:
-            value = data[dataIdx].uint32 or (data[dataIdx + 1].uint32 shl 8)
-            dataIdx += 2
-          of 3:
-            value = data[dataIdx].uint32 or (data[dataIdx + 1].uint32 shl 8) or (data[dataIdx + 2].uint32 shl 16)
-            dataIdx += 3
-          of 4:
-            value = data[dataIdx].uint32 or (data[dataIdx + 1].uint32 shl 8) or
-                    (data[dataIdx + 2].uint32 shl 16) or (data[dataIdx + 3].uint32 shl 24)
-            dataIdx += 4
-          else:
-            # Unreachable: lengthCode is a 2-bit field (0-3), so numBytes is always 1-4
-            assert false, "Invalid StreamVByte length code"
-
-          result[valueIdx] = value
-          inc valueIdx
-
-    # Handle remaining control bytes
-    while valueIdx < count:
-      let controlByte = control[controlIdx]
-      inc controlIdx
-
-      for i in 0..<IntegersPerControlByte:
-        if valueIdx >= count:
-          break
-
-        let lengthCode = (controlByte shr (i * 2)) and 0x03
-        let numBytes = lengthCode.int + 1
-
-        var value: uint32 = 0
-        case numBytes
-        of 1:
-          value = data[dataIdx].uint32
-          dataIdx += 1
-        of 2:
-          value = data[dataIdx].uint32 or (data[dataIdx + 1].uint32 shl 8)
-          dataIdx += 2
-        of 3:
-          value = data[dataIdx].uint32 or (data[dataIdx + 1].uint32 shl 8) or (data[dataIdx + 2].uint32 shl 16)
-          dataIdx += 3
-        of 4:
-          value = data[dataIdx].uint32 or (data[dataIdx + 1].uint32 shl 8) or
-                  (data[dataIdx + 2].uint32 shl 16) or (data[dataIdx + 3].uint32 shl 24)
-          dataIdx += 4
-        else:
-          discard
-
-        result[valueIdx] = value
-        inc valueIdx
+proc decodeStreamVByteSIMD*(control: openArray[uint8], data: openArray[uint8],
+                            count: int): seq[uint32] {.inline.} =
+  ## Same as `decodeStreamVByte`, which now picks the SIMD kernel itself
+  decodeStreamVByte(control, data, count)
 
 # =============================================================================
 # Delta Encoding/Decoding
@@ -330,6 +714,158 @@ proc zigzagDecodeArray*(values: openArray[uint32]): seq[int32] =
   for i in 0..<values.len:
     result[i] = zigzagDecode(values[i])
 
+# =============================================================================
+# Fused Delta/Zigzag Stream VByte
+# =============================================================================
+#
+# `deltaDecode(decodeStreamVByte(...))` streams the integers through
+# memory three times and allocates twice. The fused decoders apply the
+# prefix sum (and zigzag) to each vector while it is still in a register
+# and write straight into the caller's buffer. A start value lets any
+# block of a longer sequence be coded on its own: pass the last value of
+# the previous block as `prev`.
+
+const
+  XformDelta = 1
+  XformZigzag = 2
+
+proc decodeXformScalarFrom(control: openArray[uint8], data: openArray[uint8],
+                           output: var openArray[uint32], start, dataStart: int,
+                           prev: var uint32, delta, zigzag: static bool): int =
+  ## `decodeScalarFrom` with the running sum and zigzag applied per value
+  let count = output.len
+  var
+    controlIdx = start div IntegersPerControlByte
+    dataIdx = dataStart
+    valueIdx = start
+
+  while valueIdx < count:
+    let controlByte = control[controlIdx]
+    inc controlIdx
+
+    for i in 0..<IntegersPerControlByte:
+      if valueIdx >= count:
+        break
+
+      let numBytes = int((controlByte shr (i * 2)) and 0x03) + 1
+      var value: uint32 = 0
+      for j in 0..<numBytes:
+        value = value or (data[dataIdx].uint32 shl (j * 8))
+        inc dataIdx
+
+      when delta:
+        prev += value
+        value = prev
+      when zigzag:
+        value = cast[uint32](zigzagDecode(value))
+      output[valueIdx] = value
+      inc valueIdx
+  dataIdx
+
+proc decodeXform(control: openArray[uint8], data: openArray[uint8],
+                 output: var openArray[uint32], prev: uint32,
+                 delta, zigzag: static bool, kernel: StreamVByteKernel): int =
+  checkKernel(kernel)
+  const mode = cint((if delta: XformDelta else: 0) or (if zigzag: XformZigzag else: 0))
+  let quads = min(output.len div 4, control.len)
+  var done = 0
+  var pos = 0
+  var carry = prev
+  if quads > 0 and data.len > 0:
+    var used: csize_t
+    var blocks: csize_t
+    when X86Svb:
+      if kernel == svkAVX2:
+        blocks = svbDecodeXformAvx2(unsafeAddr control[0], csize_t(quads),
+                                    unsafeAddr data[0], csize_t(data.len),
+                                    addr output[0], unsafeAddr svbDecodeShuffle,
+                                    unsafeAddr svbLengths, carry, mode, used)
+      elif kernel == svkSSSE3:
+        blocks = svbDecodeXformSsse3(unsafeAddr control[0], csize_t(quads),
+                                     unsafeAddr data[0], csize_t(data.len),
+                                     addr output[0], unsafeAddr svbDecodeShuffle,
+                                     unsafeAddr svbLengths, carry, mode, used)
+    elif ArmSvb:
+      if kernel == svkNEON:
+        blocks = svbDecodeXformNeon(unsafeAddr control[0], csize_t(quads),
+                                    unsafeAddr data[0], csize_t(data.len),
+                                    addr output[0], unsafeAddr svbDecodeShuffle,
+                                    unsafeAddr svbLengths, carry, mode, used)
+    done = int(blocks) * 4
+    pos = int(used)
+  decodeXformScalarFrom(control, data, output, done, pos, carry, delta, zigzag)
+
+proc asUnsigned(output: var openArray[int32]): ptr UncheckedArray[uint32] {.inline.} =
+  if output.len == 0: nil
+  else: cast[ptr UncheckedArray[uint32]](addr output[0])
+
+proc encodeStreamVByteDelta*(values: openArray[uint32],
+                             control: var openArray[uint8],
+                             data: var openArray[uint8],
+                             prev = 0'u32,
+                             kernel = streamVByteKernel()): int =
+  ## Encode the differences `values[i] - values[i-1]` (the first against
+  ## `prev`) into caller-provided buffers sized by `maxEncodedSize`;
+  ## returns the data bytes used. Deltas go through a small stack buffer,
+  ## so nothing is allocated.
+  const Chunk = 256                      # Multiple of 4: chunks start on a control byte
+  var deltas {.noinit.}: array[Chunk, uint32]
+  var last = prev
+  var i = 0
+  while i < values.len:
+    let n = min(Chunk, values.len - i)
+    for j in 0 ..< n:
+      deltas[j] = values[i + j] - last
+      last = values[i + j]
+    result += encodeStreamVByte(deltas.toOpenArray(0, n - 1),
+                                control.toOpenArray(i div 4, control.high),
+                                data.toOpenArray(result, data.high), kernel)
+    i += n
+
+proc encodeStreamVByteDelta*(values: openArray[uint32], prev = 0'u32,
+                             kernel = streamVByteKernel()): tuple[control: seq[uint8], data: seq[uint8]] =
+  ## Delta-encode `values` (typically sorted ids) starting from `prev`.
+  ## Same format as `encodeStreamVByte(deltaEncode(values))` when `prev`
+  ## is 0.
+  let (controlLen, dataLen) = maxEncodedSize(values.len)
+  result.control = newSeq[uint8](controlLen)
+  result.data = newSeq[uint8](dataLen)
+  let used = encodeStreamVByteDelta(values, result.control, result.data, prev, kernel)
+  result.data.setLen(used)
+
+proc decodeStreamVByteDelta*(control: openArray[uint8], data: openArray[uint8],
+                             output: var openArray[uint32], prev = 0'u32,
+                             kernel = streamVByteKernel()): int =
+  ## Decode `output.len` delta-coded integers into `output` in one pass,
+  ## adding each to the running sum that starts at `prev`. Returns the
+  ## data bytes consumed; `output[^1]` is the `prev` of the next block.
+  decodeXform(control, data, output, prev, delta = true, zigzag = false, kernel)
+
+proc decodeStreamVByteDelta*(control: openArray[uint8], data: openArray[uint8],
+                             count: int, prev = 0'u32,
+                             kernel = streamVByteKernel()): seq[uint32] =
+  ## Fused `deltaDecode(decodeStreamVByte(control, data, count))`
+  result = newSeq[uint32](count)
+  discard decodeStreamVByteDelta(control, data, result, prev, kernel)
+
+proc decodeStreamVByteZigzag*(control: openArray[uint8], data: openArray[uint8],
+                              output: var openArray[int32], delta = false,
+                              prev = 0'u32, kernel = streamVByteKernel()): int =
+  ## Decode zigzag-coded signed integers into `output` in one pass;
+  ## returns the data bytes consumed. With `delta`, the stream holds
+  ## differences of the zigzag codes (what `IntCodec` writes for signed
+  ## input) and `prev` is the code before the first value, i.e.
+  ## `zigzagEncode(output[^1])` of the previous block.
+  let raw = asUnsigned(output)
+  if raw == nil:
+    return 0
+  if delta:
+    decodeXform(control, data, raw.toOpenArray(0, output.high), prev,
+                delta = true, zigzag = true, kernel)
+  else:
+    decodeXform(control, data, raw.toOpenArray(0, output.high), prev,
+                delta = false, zigzag = true, kernel)
+
 # =============================================================================
 # Utilities
 # =============================================================================
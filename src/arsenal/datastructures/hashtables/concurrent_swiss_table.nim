@@ -0,0 +1,309 @@
+## Concurrent Swiss Table
+## ======================
+##
+## Thread-safe hash map built from independent `SwissTable` shards.
+##
+## The top bits of a key's hash pick the shard; the shard's table uses the
+## low bits (H1/H2) as usual, so the two never correlate. Each shard has:
+## - a spinlock that serialises its writers
+## - a seqlock version counter that lets readers run without any lock
+##
+## Lookups read the shard's version, probe the table, copy the value out
+## and re-check the version; if a writer touched the shard meanwhile the
+## lookup simply retries. Readers never write shared memory, so read-heavy
+## workloads scale with the number of cores.
+##
+## Resizing is per shard and does not stop the world: a full shard builds
+## its larger table aside (under its own lock only) while readers keep
+## using the old one, then publishes it with a single pointer store. Other
+## shards are unaffected throughout. Replaced tables are kept until
+## `reclaim` or `destroy`, because an optimistic reader may still be
+## inside them. Growth alone retires less memory than the live tables
+## hold; delete-heavy churn also retires a table per tombstone cleanup,
+## so long-running processes should `reclaim` at quiet points.
+##
+## Optimistic reads require keys and values without GC'd memory
+## (`supportsCopyMem`: ints, floats, plain objects, fixed arrays). For
+## `string` or `seq` keys/values a lookup takes the shard lock instead,
+## which is still contention-free across shards.
+##
+## Usage:
+## ```nim
+## var sessions = ConcurrentSwissTable[uint64, Session].init()
+##
+## # Any thread:
+## sessions[id] = session
+## let s = sessions.find(id)       # lock-free, returns a copy
+## discard sessions.delete(id)
+##
+## # Once all worker threads have stopped:
+## sessions.destroy()
+## ```
+##
+## Reference: H. Boehm, "Can Seqlocks Get Along With Programming Language
+## Memory Models?" (MSPC 2012)
+
+import std/[options, math, osproc]
+import ./swiss_table
+import ../../concurrency/atomics/atomic
+import ../../concurrency/sync/spinlock
+import ../../platform/config
+
+const
+  CacheLineSize = DefaultCacheLineSize
+  MaxShards* = 4096
+  ShardHashShift = 48   ## Shard index comes from hash bits 48..59
+
+type
+  ShardTable[K, V] = object
+    ## Heap-allocated table of one shard. Replaced as a whole on resize so
+    ## readers always see a consistent (ctrl, slots, capacity) triple.
+    table: SwissTable[K, V]
+    retiredNext: ptr ShardTable[K, V]   ## Link in the shard's retired list
+
+  Shard[K, V] = object
+    version: Atomic[uint64]             ## Seqlock counter, odd during a write
+    current: Atomic[ptr ShardTable[K, V]]
+    lock: Spinlock                      ## Held by writers of this shard
+    retired: ptr ShardTable[K, V]       ## Tables replaced by resizes
+    pad: array[CacheLineSize, byte]     ## Keep shards on separate cache lines
+
+  ConcurrentSwissTable*[K, V] = object
+    ## Sharded SwissTable with lock-free reads and per-shard write locks.
+    ##
+    ## Share it between threads as a global or through a pointer; do not
+    ## copy it. Call `destroy` once no thread uses it any more.
+    shards: ptr UncheckedArray[Shard[K, V]]
+    shardMask: int
+
+# =============================================================================
+# Shard Helpers
+# =============================================================================
+
+proc newShardTable[K, V](capacity: int): ptr ShardTable[K, V] =
+  result = cast[ptr ShardTable[K, V]](allocShared0(sizeof(ShardTable[K, V])))
+  result.table = SwissTable[K, V].init(capacity)
+
+proc freeShardTable[K, V](p: ptr ShardTable[K, V]) =
+  p.table.destroy()
+  deallocShared(p)
+
+proc shardOf[K, V](t: ConcurrentSwissTable[K, V], h: uint64): ptr Shard[K, V] {.inline.} =
+  addr t.shards[int(h shr ShardHashShift) and t.shardMask]
+
+proc beginWrite[K, V](s: ptr Shard[K, V]) {.inline.} =
+  ## Make the version odd before touching the table (caller holds the lock).
+  s.version.store(s.version.load(Relaxed) + 1, Relaxed)
+  atomicThreadFence(Release)
+
+proc endWrite[K, V](s: ptr Shard[K, V]) {.inline.} =
+  ## Make the version even again, publishing the write.
+  s.version.store(s.version.load(Relaxed) + 1, Release)
+
+proc grow[K, V](s: ptr Shard[K, V]) =
+  ## Rehash a full shard into a fresh table and publish it.
+  ##
+  ## Runs under the shard lock but outside a write window: readers keep
+  ## probing the old table, which no writer can modify meanwhile. If most
+  ## of the load is tombstones the table is rebuilt at the same size.
+  let old = s.current.load(Relaxed)
+  let cap = old.table.capacity
+  let newCap = if old.table.len * 2 >= cap: cap * 2 else: cap
+  let fresh = newShardTable[K, V](newCap)
+  for k, v in old.table.pairs:
+    discard fresh.table.insertWithoutGrowth(k, v)
+  s.current.store(fresh, Release)
+
+  when supportsCopyMem(K) and supportsCopyMem(V):
+    # Optimistic readers may still be probing the old table
+    old.retiredNext = s.retired
+    s.retired = old
+  else:
+    # Readers of GC'd types hold the lock, so nobody can see it any more
+    freeShardTable(old)
+
+# =============================================================================
+# Construction
+# =============================================================================
+
+proc init*[K, V](_: typedesc[ConcurrentSwissTable[K, V]], capacity: int = 16,
+                 shards: int = 0): ConcurrentSwissTable[K, V] =
+  ## Create a concurrent table.
+  ##
+  ## - `capacity`: expected number of entries, spread over the shards
+  ## - `shards`: number of shards, rounded up to a power of two
+  ##   (0 = four per processor, which keeps writer collisions rare)
+  let wanted = if shards > 0: shards else: 4 * countProcessors()
+  let count = min(MaxShards, nextPowerOfTwo(max(1, wanted)))
+  let perShard = max(1, capacity div count)
+  result.shardMask = count - 1
+  result.shards = cast[ptr UncheckedArray[Shard[K, V]]](
+    allocShared0(count * sizeof(Shard[K, V]))
+  )
+  for i in 0 ..< count:
+    result.shards[i].lock = Spinlock.init()
+    result.shards[i].current.store(newShardTable[K, V](perShard), Release)
+
+proc reclaim*[K, V](t: var ConcurrentSwissTable[K, V]): int =
+  ## Free tables replaced by resizes. Returns how many were freed.
+  ##
+  ## Only call this when no thread can be inside a lookup (e.g. between
+  ## batches, after joining readers); writers may run concurrently.
+  if t.shards == nil:
+    return 0
+  for i in 0 .. t.shardMask:
+    let s = addr t.shards[i]
+    var list: ptr ShardTable[K, V]
+    withLock(s.lock):
+      list = s.retired
+      s.retired = nil
+    while list != nil:
+      let next = list.retiredNext
+      freeShardTable(list)
+      list = next
+      inc result
+
+proc destroy*[K, V](t: var ConcurrentSwissTable[K, V]) =
+  ## Free all memory. No other thread may use the table any more.
+  if t.shards == nil:
+    return
+  discard t.reclaim()
+  for i in 0 .. t.shardMask:
+    freeShardTable(t.shards[i].current.load(Acquire))
+  deallocShared(t.shards)
+  t.shards = nil
+  t.shardMask = 0
+
+# =============================================================================
+# Lookups (lock-free for plain keys and values)
+# =============================================================================
+
+proc lookup[K, V](t: ConcurrentSwissTable[K, V], key: K, value: var V): bool =
+  ## Copy `key`'s value into `value`. Returns false if absent.
+  if t.shards == nil:
+    return false
+  let h = hashKey(key)
+  let s = t.shardOf(h)
+  when supportsCopyMem(K) and supportsCopyMem(V):
+    # Seqlock read. A torn key compare or value copy is possible while a
+    # writer is active; the version check discards it and we retry.
+    while true:
+      let before = s.version.load(Acquire)
+      if (before and 1) == 0:
+        let p = s.current.load(Acquire).table.find(key, h)
+        result = p.isSome
+        if result:
+          value = p.get[]
+        atomicThreadFence(Acquire)
+        if s.version.load(Relaxed) == before:
+          return
+      spinHint()
+  else:
+    withLock(s.lock):
+      let p = s.current.load(Relaxed).table.find(key, h)
+      result = p.isSome
+      if result:
+        value = p.get[]
+
+proc find*[K, V](t: ConcurrentSwissTable[K, V], key: K): Option[V] =
+  ## Copy of the value for `key`, or none. Never blocks on writers of
+  ## other shards; for plain key/value types never takes a lock.
+  var value: V
+  if t.lookup(key, value):
+    some(value)
+  else:
+    none(V)
+
+proc `[]`*[K, V](t: ConcurrentSwissTable[K, V], key: K): V =
+  ## Get value by key. Raises KeyError if not found.
+  if not t.lookup(key, result):
+    raise newException(KeyError, "Key not found")
+
+proc getOrDefault*[K, V](t: ConcurrentSwissTable[K, V], key: K,
+                         default: V = default(V)): V =
+  ## Value for `key`, or `default` if absent.
+  if not t.lookup(key, result):
+    result = default
+
+proc contains*[K, V](t: ConcurrentSwissTable[K, V], key: K): bool =
+  ## Check if key exists.
+  var value: V
+  t.lookup(key, value)
+
+# =============================================================================
+# Writes (lock one shard)
+# =============================================================================
+
+proc `[]=`*[K, V](t: var ConcurrentSwissTable[K, V], key: K, value: V) =
+  ## Insert or update key-value pair. Locks only `key`'s shard; a full
+  ## shard grows without blocking its readers.
+  assert t.shards != nil, "ConcurrentSwissTable used before init"
+  let h = hashKey(key)
+  let s = t.shardOf(h)
+  withLock(s.lock):
+    s.beginWrite()
+    let inserted = s.current.load(Relaxed).table.insertWithoutGrowth(key, value, h)
+    s.endWrite()
+    if not inserted:
+      s.grow()
+      s.beginWrite()
+      discard s.current.load(Relaxed).table.insertWithoutGrowth(key, value, h)
+      s.endWrite()
+
+proc delete*[K, V](t: var ConcurrentSwissTable[K, V], key: K): bool =
+  ## Delete key. Returns true if key existed.
+  if t.shards == nil:
+    return false
+  let h = hashKey(key)
+  let s = t.shardOf(h)
+  withLock(s.lock):
+    s.beginWrite()
+    result = s.current.load(Relaxed).table.delete(key, h)
+    s.endWrite()
+
+proc clear*[K, V](t: var ConcurrentSwissTable[K, V]) =
+  ## Remove all entries, one shard at a time (not atomic as a whole).
+  if t.shards == nil:
+    return
+  for i in 0 .. t.shardMask:
+    let s = addr t.shards[i]
+    withLock(s.lock):
+      s.beginWrite()
+      s.current.load(Relaxed).table.clear()
+      s.endWrite()
+
+# =============================================================================
+# Introspection
+# =============================================================================
+
+proc len*[K, V](t: ConcurrentSwissTable[K, V]): int =
+  ## Number of entries. Exact when no writer is active, otherwise a
+  ## snapshot that may be off by the writes in flight.
+  if t.shards == nil:
+    return 0
+  for i in 0 .. t.shardMask:
+    result += t.shards[i].current.load(Acquire).table.len
+
+proc capacity*[K, V](t: ConcurrentSwissTable[K, V]): int =
+  ## Total number of slots over all shards.
+  if t.shards == nil:
+    return 0
+  for i in 0 .. t.shardMask:
+    result += t.shards[i].current.load(Acquire).table.capacity
+
+proc shardCount*[K, V](t: ConcurrentSwissTable[K, V]): int {.inline.} =
+  ## Number of shards (a power of two).
+  if t.shards == nil: 0 else: t.shardMask + 1
+
+iterator pairs*[K, V](t: ConcurrentSwissTable[K, V]): (K, V) =
+  ## Iterate over all key-value pairs. Each shard is copied under its lock
+  ## and yielded afterwards, so the loop body may write to the table.
+  if t.shards != nil:
+    for i in 0 .. t.shardMask:
+      let s = addr t.shards[i]
+      var entries: seq[(K, V)]
+      withLock(s.lock):
+        for k, v in s.current.load(Relaxed).table.pairs:
+          entries.add (k, v)
+      for entry in entries:
+        yield entry
@@ -0,0 +1,484 @@
+## Flat Swiss Table & Set
+## ======================
+##
+## `SwissTable` variant that stores keys and values in separate arrays:
+##
+## ```
+## ctrl:   [c0 c1 c2 ...]          1 byte per slot (same scheme as SwissTable)
+## keys:   [k0 k1 k2 ...]          probed on every lookup
+## values: [v0 v1 v2 ...]          only touched when a key matches
+## ```
+##
+## `contains` and misses never bring values into cache, so a membership
+## scan over a large table moves `sizeof(K)` bytes per probed slot instead
+## of `sizeof(K) + sizeof(V)`. `FlatSwissSet[K]` drops the value array
+## entirely.
+##
+## Tables of plain data (no strings, seqs or refs) can be written to disk
+## in exactly this layout with `save` and mapped back with `load`: loading
+## a multi-GB table costs one `mmap` instead of millions of reinsertions.
+## The mapping is read-only; the first modification copies the table to
+## the heap.
+##
+## Usage:
+## ```nim
+## var users = FlatSwissTable[uint64, UserRecord].init()
+## users[42] = record
+## if 42'u64 in users: ...               # reads ctrl + keys only
+##
+## var seen = FlatSwissSet[uint64].init()
+## seen.incl 7
+##
+## users.save("users.flat")
+## var loaded = FlatSwissTable[uint64, UserRecord].load("users.flat")
+## echo loaded[42]                       # served from the mapping
+## ```
+
+import std/[options, math, memfiles]
+import ./swiss_table
+
+type
+  NoValue* = object
+    ## Value type of `FlatSwissSet`; no value array is allocated for it.
+
+  FlatSwissTable*[K, V] = object
+    ## Swiss table with separate control, key and value arrays.
+    ctrl: ptr UncheckedArray[CtrlByte]
+    keys: ptr UncheckedArray[K]
+    values: ptr UncheckedArray[V]   ## nil for sets
+    capacity: int       ## Total number of slots (always power of 2)
+    size: int           ## Number of items currently stored
+    growthLeft: int     ## Remaining slots before we need to grow
+    file: MemFile       ## Backing mapping when loaded with `load`
+    mapped: bool        ## Arrays point into `file` (read-only)
+
+  FlatSwissSet*[K] = FlatSwissTable[K, NoValue]
+    ## Hash set: a flat table without values.
+
+  FlatFileHeader = object
+    ## On-disk header, followed by the ctrl, key and value arrays at
+    ## 64-byte aligned offsets.
+    magic: array[8, char]
+    byteOrder: uint32   ## `ByteOrderTag` as written by the saving machine
+    version: uint32
+    groupSize: uint32   ## Probing layout depends on the group width
+    keySize: uint32
+    valueSize: uint32   ## 0 for sets
+    reserved: uint32
+    hashCheck: uint64   ## `hashKey(default(K))`; detects a changed hash function
+    capacity: uint64
+    size: uint64
+    growthLeft: uint64
+    ctrlOffset: uint64
+    keysOffset: uint64
+    valuesOffset: uint64
+    fileSize: uint64
+
+const
+  MinCapacity = 16
+  FlatMagic = ['A', 'R', 'S', 'L', 'F', 'L', 'A', 'T']
+  FlatVersion = 1'u32
+  ByteOrderTag = 0x01020304'u32
+  FileAlign = 64
+
+# =============================================================================
+# Storage
+# =============================================================================
+
+proc groupMask[K, V](t: FlatSwissTable[K, V]): int {.inline.} =
+  ## Number of groups minus one (group count is a power of two).
+  (t.capacity div GroupSize) - 1
+
+proc allocArrays[K, V](t: var FlatSwissTable[K, V], capacity: int) =
+  ## Allocate empty arrays for `capacity` slots.
+  t.ctrl = cast[ptr UncheckedArray[CtrlByte]](alloc(capacity * sizeof(CtrlByte)))
+  setMem(t.ctrl, CtrlEmpty.uint8.int, capacity)
+  t.keys = cast[ptr UncheckedArray[K]](alloc0(capacity * sizeof(K)))
+  when V isnot NoValue:
+    t.values = cast[ptr UncheckedArray[V]](alloc0(capacity * sizeof(V)))
+  t.capacity = capacity
+  t.size = 0
+  t.growthLeft = (capacity * 7) div 8  # 87.5% load factor
+
+proc releaseStorage[K, V](t: var FlatSwissTable[K, V]) =
+  ## Free or unmap the arrays. Live GC'd entries must be moved out or
+  ## reset beforehand.
+  if t.mapped:
+    t.file.close()
+    t.mapped = false
+  else:
+    if t.ctrl != nil:
+      dealloc(t.ctrl)
+    if t.keys != nil:
+      dealloc(t.keys)
+    if t.values != nil:
+      dealloc(t.values)
+  t.ctrl = nil
+  t.keys = nil
+  t.values = nil
+
+proc findSlot[K, V](t: FlatSwissTable[K, V], key: K, h: uint64): int =
+  ## Index of `key`'s slot, or -1. Touches only ctrl and key arrays.
+  let mask = t.groupMask
+  let tag = uint8(h and 0x7F)
+  var g = int(h shr 7) and mask
+  for _ in 0 .. mask:
+    let base = g * GroupSize
+    let ctrl = addr t.ctrl[base]
+    for i in matchAt(ctrl, tag).setBits:
+      if t.keys[base + i] == key:
+        return base + i
+    # An empty slot ends every probe sequence that reached this group
+    if matchEmptyAt(ctrl).uint16 != 0:
+      return -1
+    g = (g + 1) and mask
+  -1
+
+proc findInsertSlot[K, V](t: FlatSwissTable[K, V], h: uint64): int =
+  ## First EMPTY or DELETED slot on `h`'s probe sequence, or -1 if full.
+  let mask = t.groupMask
+  var g = int(h shr 7) and mask
+  for _ in 0 .. mask:
+    let base = g * GroupSize
+    let free = matchEmptyOrDeletedAt(addr t.ctrl[base])
+    if free.uint16 != 0:
+      return base + firstSetBit(free)
+    g = (g + 1) and mask
+  -1
+
+proc resize[K, V](t: var FlatSwissTable[K, V], newCapacity: int) =
+  ## Move every entry into fresh heap arrays of `newCapacity` slots,
+  ## dropping tombstones. Also detaches a table from its file mapping.
+  var old = t
+  t.mapped = false        # `old` owns the mapping now
+  t.allocArrays(newCapacity)
+  for i in 0 ..< old.capacity:
+    if old.ctrl[i].isFull:
+      let h = hashKey(old.keys[i])
+      let slot = t.findInsertSlot(h)
+      t.ctrl[slot] = CtrlByte(h and 0x7F)
+      if old.mapped:
+        t.keys[slot] = old.keys[i]
+        when V isnot NoValue:
+          t.values[slot] = old.values[i]
+      else:
+        t.keys[slot] = move(old.keys[i])
+        when V isnot NoValue:
+          t.values[slot] = move(old.values[i])
+      inc t.size
+      dec t.growthLeft
+  old.releaseStorage()
+
+proc ensureOwned[K, V](t: var FlatSwissTable[K, V]) {.inline.} =
+  ## Copy a mapped table to the heap before its first modification.
+  if t.mapped:
+    t.resize(t.capacity)
+
+proc prepareInsert[K, V](t: var FlatSwissTable[K, V], h: uint64): int =
+  ## Claim a slot for a new key with hash `h` and return its index.
+  ## At the load limit the table doubles, or is rebuilt at the same size
+  ## when most used slots are tombstones.
+  result = t.findInsertSlot(h)
+  if result < 0 or (t.ctrl[result].isEmpty and t.growthLeft <= 0):
+    t.resize(if t.size * 32 <= t.capacity * 25: t.capacity else: t.capacity * 2)
+    result = t.findInsertSlot(h)
+  if t.ctrl[result].isEmpty:
+    dec t.growthLeft
+  t.ctrl[result] = CtrlByte(h and 0x7F)
+  inc t.size
+
+proc eraseSlot[K, V](t: var FlatSwissTable[K, V], idx: int) =
+  # Same rule as SwissTable.delete: a group that still has an empty slot
+  # ends every probe, so the slot can become Empty instead of a tombstone
+  if matchEmptyAt(addr t.ctrl[idx - idx mod GroupSize]).uint16 != 0:
+    t.ctrl[idx] = CtrlEmpty
+    inc t.growthLeft
+  else:
+    t.ctrl[idx] = CtrlDeleted
+  reset(t.keys[idx])
+  when V isnot NoValue:
+    reset(t.values[idx])
+  dec t.size
+
+# =============================================================================
+# Table Operations
+# =============================================================================
+
+proc init*[K, V](_: typedesc[FlatSwissTable[K, V]], capacity: int = 16): FlatSwissTable[K, V] =
+  ## Create an empty table (or set) with at least `capacity` slots,
+  ## rounded up to a power of two.
+  result.allocArrays(max(MinCapacity, nextPowerOfTwo(capacity)))
+
+proc contains*[K, V](t: FlatSwissTable[K, V], key: K): bool {.inline.} =
+  ## Check if key exists. Never reads the value array.
+  t.ctrl != nil and t.size > 0 and t.findSlot(key, hashKey(key)) >= 0
+
+proc find*[K, V](t: FlatSwissTable[K, V], key: K): Option[ptr V] =
+  ## Find key and return pointer to value, or none if not found.
+  if t.ctrl == nil or t.size == 0:
+    return none(ptr V)
+  let idx = t.findSlot(key, hashKey(key))
+  if idx >= 0:
+    some(addr t.values[idx])
+  else:
+    none(ptr V)
+
+proc `[]`*[K, V](t: FlatSwissTable[K, V], key: K): V =
+  ## Get value by key. Raises KeyError if not found.
+  let p = t.find(key)
+  if p.isSome:
+    result = p.get[]
+  else:
+    raise newException(KeyError, "Key not found")
+
+proc getOrDefault*[K, V](t: FlatSwissTable[K, V], key: K, default: V = default(V)): V =
+  ## Value for `key`, or `default` if absent.
+  let p = t.find(key)
+  if p.isSome: p.get[] else: default
+
+proc `[]=`*[K, V](t: var FlatSwissTable[K, V], key: K, value: V) =
+  ## Insert or update key-value pair.
+  if t.ctrl == nil:
+    t.allocArrays(MinCapacity)
+  t.ensureOwned()
+  let h = hashKey(key)
+  var idx = t.findSlot(key, h)
+  if idx < 0:
+    idx = t.prepareInsert(h)
+    t.keys[idx] = key
+  t.values[idx] = value
+
+proc mgetOrPut*[K, V](t: var FlatSwissTable[K, V], key: K, default: V): var V =
+  ## Value for `key`, inserting `default` first if absent.
+  ## The returned reference is valid until the next insert.
+  if t.ctrl == nil:
+    t.allocArrays(MinCapacity)
+  t.ensureOwned()
+  let h = hashKey(key)
+  var idx = t.findSlot(key, h)
+  if idx < 0:
+    idx = t.prepareInsert(h)
+    t.keys[idx] = key
+    t.values[idx] = default
+  t.values[idx]
+
+proc delete*[K, V](t: var FlatSwissTable[K, V], key: K): bool =
+  ## Delete key. Returns true if key existed.
+  if t.ctrl == nil or t.size == 0:
+    return false
+  let h = hashKey(key)
+  if t.findSlot(key, h) < 0:
+    return false
+  t.ensureOwned()
+  t.eraseSlot(t.findSlot(key, h))
+  true
+
+proc reserve*[K, V](t: var FlatSwissTable[K, V], n: int) =
+  ## Make room for `n` entries in total without rehashing.
+  let needed = max(MinCapacity, nextPowerOfTwo((n * 8 + 6) div 7))
+  if t.ctrl == nil:
+    t.allocArrays(needed)
+  elif needed > t.capacity:
+    t.resize(needed)
+
+proc len*[K, V](t: FlatSwissTable[K, V]): int {.inline.} =
+  t.size
+
+proc capacity*[K, V](t: FlatSwissTable[K, V]): int {.inline.} =
+  ## Return the current capacity (total number of slots).
+  t.capacity
+
+proc isMapped*[K, V](t: FlatSwissTable[K, V]): bool {.inline.} =
+  ## True while the table is served directly from a file loaded by `load`.
+  t.mapped
+
+proc clear*[K, V](t: var FlatSwissTable[K, V]) =
+  ## Remove all entries.
+  if t.ctrl == nil:
+    return
+  t.ensureOwned()
+  when not supportsCopyMem(K) or not supportsCopyMem(V):
+    for i in 0 ..< t.capacity:
+      if t.ctrl[i].isFull:
+        reset(t.keys[i])
+        when V isnot NoValue:
+          reset(t.values[i])
+  setMem(t.ctrl, CtrlEmpty.uint8.int, t.capacity)
+  t.size = 0
+  t.growthLeft = (t.capacity * 7) div 8
+
+proc destroy*[K, V](t: var FlatSwissTable[K, V]) =
+  ## Deallocate (or unmap) all memory used by the table.
+  when not supportsCopyMem(K) or not supportsCopyMem(V):
+    if t.ctrl != nil and not t.mapped:
+      for i in 0 ..< t.capacity:
+        if t.ctrl[i].isFull:
+          reset(t.keys[i])
+          when V isnot NoValue:
+            reset(t.values[i])
+  t.releaseStorage()
+  t.size = 0
+  t.capacity = 0
+  t.growthLeft = 0
+
+iterator keys*[K, V](t: FlatSwissTable[K, V]): K =
+  for i in 0 ..< t.capacity:
+    if t.ctrl[i].isFull:
+      yield t.keys[i]
+
+iterator values*[K, V](t: FlatSwissTable[K, V]): V =
+  for i in 0 ..< t.capacity:
+    if t.ctrl[i].isFull:
+      yield t.values[i]
+
+iterator pairs*[K, V](t: FlatSwissTable[K, V]): (K, V) =
+  for i in 0 ..< t.capacity:
+    if t.ctrl[i].isFull:
+      yield (t.keys[i], t.values[i])
+
+# =============================================================================
+# Set Operations
+# =============================================================================
+
+proc containsOrIncl*[K](s: var FlatSwissSet[K], key: K): bool =
+  ## Add `key`; returns true if it was already present.
+  if s.ctrl == nil:
+    s.allocArrays(MinCapacity)
+  let h = hashKey(key)
+  if s.findSlot(key, h) >= 0:
+    return true
+  s.ensureOwned()
+  s.keys[s.prepareInsert(h)] = key
+  false
+
+proc incl*[K](s: var FlatSwissSet[K], key: K) {.inline.} =
+  ## Add `key` to the set.
+  discard s.containsOrIncl(key)
+
+proc excl*[K](s: var FlatSwissSet[K], key: K) {.inline.} =
+  ## Remove `key` from the set (no-op if absent).
+  discard s.delete(key)
+
+iterator items*[K](s: FlatSwissSet[K]): K =
+  for i in 0 ..< s.capacity:
+    if s.ctrl[i].isFull:
+      yield s.keys[i]
+
+# =============================================================================
+# Persistence
+# =============================================================================
+
+proc alignUp(x: int): int {.inline.} =
+  (x + FileAlign - 1) and not (FileAlign - 1)
+
+proc valueSize[K, V](t: FlatSwissTable[K, V]): int {.inline.} =
+  when V is NoValue: 0 else: sizeof(V)
+
+proc writeSection(f: File, offset: int, p: pointer, len: int) =
+  if len > 0:
+    f.setFilePos(offset)
+    if f.writeBuffer(p, len) != len:
+      raise newException(IOError, "short write")
+
+proc save*[K, V](t: FlatSwissTable[K, V], path: string) =
+  ## Write the table to `path` in its in-memory layout, ready for `load`.
+  ## Keys and values must be plain data. Raises IOError on failure.
+  when not supportsCopyMem(K) or not supportsCopyMem(V):
+    {.error: "FlatSwissTable.save needs keys and values without GC'd memory".}
+  let cap = if t.ctrl == nil: 0 else: t.capacity
+  var hdr = FlatFileHeader(
+    magic: FlatMagic,
+    byteOrder: ByteOrderTag,
+    version: FlatVersion,
+    groupSize: GroupSize.uint32,
+    keySize: sizeof(K).uint32,
+    valueSize: t.valueSize.uint32,
+    hashCheck: hashKey(default(K)),
+    capacity: cap.uint64,
+    size: t.size.uint64,
+    growthLeft: t.growthLeft.uint64
+  )
+  let ctrlOffset = alignUp(sizeof(FlatFileHeader))
+  let keysOffset = alignUp(ctrlOffset + cap)
+  let valuesOffset = alignUp(keysOffset + cap * sizeof(K))
+  hdr.ctrlOffset = ctrlOffset.uint64
+  hdr.keysOffset = keysOffset.uint64
+  hdr.valuesOffset = valuesOffset.uint64
+  hdr.fileSize =
+    if t.valueSize == 0: uint64(keysOffset + cap * sizeof(K))
+    else: uint64(valuesOffset + cap * t.valueSize)
+
+  var f: File
+  if not open(f, path, fmWrite):
+    raise newException(IOError, "cannot create " & path)
+  try:
+    f.writeSection(0, addr hdr, sizeof(hdr))
+    if cap > 0:
+      f.writeSection(ctrlOffset, t.ctrl, cap)
+      f.writeSection(keysOffset, t.keys, cap * sizeof(K))
+      when V isnot NoValue:
+        f.writeSection(valuesOffset, t.values, cap * sizeof(V))
+  finally:
+    f.close()
+
+proc headerProblem[K, V](hdr: FlatFileHeader, fileSize: int): string =
+  ## Why a header cannot be mapped as FlatSwissTable[K, V], or "".
+  if hdr.magic != FlatMagic:
+    return "not a flat swiss table file"
+  if hdr.byteOrder != ByteOrderTag:
+    return "written on a machine with different byte order"
+  if hdr.version != FlatVersion:
+    return "unsupported version " & $hdr.version
+  if hdr.groupSize != GroupSize.uint32:
+    return "written with group size " & $hdr.groupSize & ", this build probes " &
+           $GroupSize & " slots per group"
+  if hdr.keySize != sizeof(K).uint32:
+    return "key size mismatch"
+  let expectedValue = when V is NoValue: 0'u32 else: sizeof(V).uint32
+  if hdr.valueSize != expectedValue:
+    return "value size mismatch"
+  if hdr.hashCheck != hashKey(default(K)):
+    return "hash function differs from the one the file was built with"
+  let cap = hdr.capacity
+  if cap > 0 and ((cap and (cap - 1)) != 0 or cap < GroupSize.uint64):
+    return "corrupt capacity"
+  if hdr.fileSize > fileSize.uint64 or
+     hdr.ctrlOffset + cap > hdr.fileSize or
+     hdr.keysOffset + cap * sizeof(K).uint64 > hdr.fileSize or
+     hdr.valuesOffset + cap * hdr.valueSize.uint64 > hdr.fileSize or
+     hdr.keysOffset mod FileAlign != 0 or hdr.valuesOffset mod FileAlign != 0:
+    return "truncated or corrupt file"
+  ""
+
+proc load*[K, V](_: typedesc[FlatSwissTable[K, V]], path: string): FlatSwissTable[K, V] =
+  ## Map a file written by `save`. Lookups run straight on the mapping;
+  ## pages are read in on first touch.
+  ##
+  ## Raises OSError if the file cannot be opened, IOError if it was saved
+  ## for another key/value type, hash function or group size.
+  when not supportsCopyMem(K) or not supportsCopyMem(V):
+    {.error: "FlatSwissTable.load needs keys and values without GC'd memory".}
+  var f = memfiles.open(path)
+  var hdr: FlatFileHeader
+  if f.size < sizeof(hdr):
+    f.close()
+    raise newException(IOError, path & ": truncated or corrupt file")
+  copyMem(addr hdr, f.mem, sizeof(hdr))
+  let problem = headerProblem[K, V](hdr, f.size)
+  if problem.len > 0:
+    f.close()
+    raise newException(IOError, path & ": " & problem)
+  if hdr.capacity == 0:
+    f.close()
+    return FlatSwissTable[K, V].init()
+
+  let base = cast[int](f.mem)
+  result.ctrl = cast[ptr UncheckedArray[CtrlByte]](base + hdr.ctrlOffset.int)
+  result.keys = cast[ptr UncheckedArray[K]](base + hdr.keysOffset.int)
+  when V isnot NoValue:
+    result.values = cast[ptr UncheckedArray[V]](base + hdr.valuesOffset.int)
+  result.capacity = hdr.capacity.int
+  result.size = hdr.size.int
+  result.growthLeft = hdr.growthLeft.int
+  result.file = f
+  result.mapped = true
@@ -2,8 +2,8 @@
 ## ========================================
 ##
 ## Implementation of Google's "Swiss Table" (Abseil flat_hash_map).
-## Uses SIMD-accelerated metadata probing for ~2x faster lookups than
-## traditional hash tables.
+## Uses SIMD-accelerated metadata probing (SSE2 / NEON, SWAR fallback)
+## for ~2x faster lookups than traditional hash tables.
 ##
 ## Key innovations:
 ## - 1-byte metadata per slot (7 bits of hash + 1 bit state)
@@ -20,14 +20,30 @@
 ## var table = SwissTable[string, int].init()
 ## table["hello"] = 42
 ## echo table["hello"]  # 42
+##
+## inc table.mgetOrPut("hits", 0)        # one probe, updated in place
+## let word = buf.toOpenArray(start, stop)
+## if word in table: ...                  # no string allocated
+## table.reserve(1_000_000)               # no rehash while filling
 ## ```
 ##
 ## Reference: https://abseil.io/blog/20180927-swisstables
 
-import std/options
+import std/[options, hashes, bitops, math]
 import ../../hashing/hasher
 import ../../platform/config
 
+when CompiledVectorIsa in {viSSE2, viAVX2, viNEON}:
+  import ../../simd/intrinsics
+
+when cpuEndian == bigEndian:
+  import std/endians
+
+# Control bytes matched per probe step: one SSE2/NEON register, or one
+# 64-bit word on the portable SWAR path.
+const
+  GroupSize* = when CompiledVectorIsa == viScalar: 8 else: 16
+
 type
   CtrlByte* = distinct uint8
     ## Metadata byte for each slot.
@@ -36,11 +52,11 @@ type
     ## - 0b0xxxxxxx (0-127): Slot is FULL, lower 7 bits = H2(hash)
     ## - 0b10000000 (128): Slot is EMPTY
     ## - 0b11111110 (254): Slot is DELETED (tombstone)
-    ## - 0b11111111 (255): Slot is SENTINEL (marks group boundary)
+    ## - 0b11111111 (255): Slot is SENTINEL (never matched as free)
 
   Group* = object
-    ## A group of 16 control bytes that can be probed with SIMD.
-    ctrl: array[16, CtrlByte]
+    ## A group of control bytes that can be probed with one SIMD compare.
+    ctrl: array[GroupSize, CtrlByte]
 
   SwissTable*[K, V] = object
     ## SIMD-accelerated hash table.
@@ -48,7 +64,8 @@ type
     ## Memory layout:
     ## - Control bytes: array of metadata (1 byte per slot)
     ## - Slots: array of key-value pairs
-    ## - Groups are 16 slots that fit in one SIMD register
+    ## - Probing walks aligned groups of `GroupSize` slots, so a group load
+    ##   never crosses the end of the control array
     ctrl: ptr UncheckedArray[CtrlByte]
     slots: ptr UncheckedArray[tuple[key: K, value: V]]
     capacity: int       ## Total number of slots (always power of 2)
@@ -56,26 +73,36 @@ type
     growthLeft: int     ## Remaining slots before we need to grow
 
 const
-  CtrlEmpty = CtrlByte(0b10000000)    ## Empty slot
-  CtrlDeleted = CtrlByte(0b11111110)  ## Deleted (tombstone)
-  CtrlSentinel = CtrlByte(0b11111111) ## Group boundary
-  GroupSize = 16
+  CtrlEmpty* = CtrlByte(0b10000000)    ## Empty slot
+  CtrlDeleted* = CtrlByte(0b11111110)  ## Deleted (tombstone)
+  CtrlSentinel* = CtrlByte(0b11111111) ## Group boundary
+  MinCapacity = 16
 
 # =============================================================================
 # Hash Functions
 # =============================================================================
 
+proc hashKey*[K](key: K): uint64 {.inline.} =
+  ## Full 64-bit hash of a key. H1 and H2 are both derived from it, so
+  ## every table operation hashes its key exactly once. `keyHash` picks the
+  ## mixer from `K` at compile time: a single folded multiply for integer,
+  ## pointer and small array keys, wyhash for strings.
+  keyHash(key)
+
+proc hashKey*(key: openArray[char]): uint64 {.inline.} =
+  ## Hash of a character slice, equal to `hashKey` of the same `string`.
+  ## Lets string-keyed tables be probed straight from a buffer.
+  wyhash.hash(key.toOpenArrayByte(0, key.high))
+
 proc h1*[K](key: K): uint64 {.inline.} =
-  ## H1: Primary hash, used for slot index.
+  ## H1: Primary hash, used for the starting group.
   ## Use top 57 bits of 64-bit hash.
-  let h = wyhash.hash($key)
-  h shr 7
+  hashKey(key) shr 7
 
 proc h2*[K](key: K): uint8 {.inline.} =
   ## H2: Secondary hash, stored in control byte.
   ## Use lower 7 bits of hash.
-  let h = wyhash.hash($key)
-  (h and 0x7F).uint8
+  (hashKey(key) and 0x7F).uint8
 
 # =============================================================================
 # Control Byte Operations
@@ -91,127 +118,247 @@ proc isDeleted*(c: CtrlByte): bool {.inline.} =
   c.uint8 == CtrlDeleted.uint8
 
 proc isEmptyOrDeleted*(c: CtrlByte): bool {.inline.} =
-  c.uint8 >= CtrlEmpty.uint8
+  c.uint8 >= CtrlEmpty.uint8 and c.uint8 < CtrlSentinel.uint8
 
 # =============================================================================
 # SIMD Group Matching
 # =============================================================================
+#
+# Backend is chosen at compile time through `CompiledVectorIsa`:
+# - SSE2 (x86_64 baseline; AVX2 builds get the VEX-encoded form of the same
+#   128-bit compares, a 16-byte group does not benefit from 256-bit lanes)
+# - NEON (ARM64 baseline)
+# - SWAR over 8-byte groups everywhere else, or with `-d:arsenalScalar`
 
 type
   BitMask* = distinct uint16
     ## Result of SIMD comparison - one bit per slot.
 
-proc match*(g: Group, h2val: uint8): BitMask =
+when CompiledVectorIsa == viScalar:
+  const
+    LsbBytes = 0x0101010101010101'u64
+    MsbBytes = 0x8080808080808080'u64
+
+  proc loadCtrlWord(ctrl: ptr CtrlByte): uint64 {.inline.} =
+    ## Load 8 control bytes with byte i in bits 8i..8i+7.
+    when cpuEndian == bigEndian:
+      swapEndian64(addr result, ctrl)
+    else:
+      copyMem(addr result, ctrl, 8)
+
+  proc packHighBits(m: uint64): BitMask {.inline.} =
+    ## Compress the high bit of each byte into an 8-bit mask.
+    BitMask(((m shr 7) * 0x0102040810204080'u64) shr 56)
+
+proc matchAt*(ctrl: ptr CtrlByte, h2val: uint8): BitMask {.inline.} =
+  ## Slots of the group at `ctrl` whose control byte equals `h2val`.
+  ## Exported (like the other `*At` matchers) for tables that share this
+  ## control-byte scheme with a different slot layout.
+  when CompiledVectorIsa in {viSSE2, viAVX2}:
+    let group = mm_loadu_si128(ctrl)
+    let cmp = mm_cmpeq_epi8(group, mm_set1_epi8(cast[int8](h2val)))
+    BitMask(cast[uint16](mm_movemask_epi8(cmp)))
+  elif CompiledVectorIsa == viNEON:
+    BitMask(movemask(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(h2val))))
+  else:
+    # Zero bytes of `x` are matches. May report a false positive next to a
+    # real match (borrow propagation); callers compare keys anyway.
+    let x = loadCtrlWord(ctrl) xor (LsbBytes * h2val.uint64)
+    packHighBits((x - LsbBytes) and not x and MsbBytes)
+
+proc matchEmptyAt*(ctrl: ptr CtrlByte): BitMask {.inline.} =
+  ## Slots of the group at `ctrl` that are EMPTY.
+  when CompiledVectorIsa in {viSSE2, viAVX2}:
+    let group = mm_loadu_si128(ctrl)
+    let cmp = mm_cmpeq_epi8(group, mm_set1_epi8(cast[int8](CtrlEmpty.uint8)))
+    BitMask(cast[uint16](mm_movemask_epi8(cmp)))
+  elif CompiledVectorIsa == viNEON:
+    BitMask(movemask(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(CtrlEmpty.uint8))))
+  else:
+    # EMPTY is the only special byte with bit 1 clear
+    let w = loadCtrlWord(ctrl)
+    packHighBits(w and not (w shl 6) and MsbBytes)
+
+proc matchEmptyOrDeletedAt*(ctrl: ptr CtrlByte): BitMask {.inline.} =
+  ## Slots of the group at `ctrl` that are EMPTY or DELETED.
+  when CompiledVectorIsa in {viSSE2, viAVX2}:
+    # Signed: EMPTY (-128) and DELETED (-2) are < SENTINEL (-1), FULL is not
+    let group = mm_loadu_si128(ctrl)
+    let cmp = mm_cmpgt_epi8(mm_set1_epi8(cast[int8](CtrlSentinel.uint8)), group)
+    BitMask(cast[uint16](mm_movemask_epi8(cmp)))
+  elif CompiledVectorIsa == viNEON:
+    let group = vreinterpretq_s8_u8(vld1q_u8(ctrl))
+    BitMask(movemask(vcltq_s8(group, vdupq_n_s8(cast[int8](CtrlSentinel.uint8)))))
+  else:
+    # EMPTY and DELETED are the only special bytes with bit 0 clear
+    let w = loadCtrlWord(ctrl)
+    packHighBits(w and not (w shl 7) and MsbBytes)
+
+proc match*(g: Group, h2val: uint8): BitMask {.inline.} =
   ## Find all slots in group where ctrl byte matches h2val.
-  ## Returns a bitmask with 1s for matching positions.
-  ##
-  ## IMPLEMENTATION (SSE2):
-  ## ```nim
-  ## # Load 16 control bytes into SSE register
-  ## let ctrl = mm_loadu_si128(cast[ptr m128i](addr g.ctrl))
-  ##
-  ## # Broadcast h2val to all 16 positions
-  ## let needle = mm_set1_epi8(h2val.cchar)
-  ##
-  ## # Compare for equality (returns 0xFF for match, 0x00 for no match)
-  ## let cmp = mm_cmpeq_epi8(ctrl, needle)
-  ##
-  ## # Convert to bitmask (one bit per byte)
-  ## result = mm_movemask_epi8(cmp).BitMask
-  ## ```
-  ##
-  ## IMPLEMENTATION (ARM NEON):
-  ## ```nim
-  ## let ctrl = vld1q_u8(addr g.ctrl)
-  ## let needle = vdupq_n_u8(h2val)
-  ## let cmp = vceqq_u8(ctrl, needle)
-  ## # Convert to bitmask (more complex on ARM)
-  ## ```
-  ##
-  ## IMPLEMENTATION (Scalar fallback):
-  ## ```nim
-  ## result = 0.BitMask
-  ## for i in 0..<16:
-  ##   if g.ctrl[i].uint8 == h2val:
-  ##     result = BitMask(result.uint16 or (1'u16 shl i))
-  ## ```
-
-  # Scalar fallback
-  var mask: uint16 = 0
-  for i in 0..<16:
-    if g.ctrl[i].uint8 == h2val:
-      mask = mask or (1'u16 shl i)
-  result = BitMask(mask)
-
-proc matchEmpty*(g: Group): BitMask =
-  ## Find all empty slots in group.
-  ##
-  ## IMPLEMENTATION:
-  ## Same as match() but compare against CtrlEmpty.
-  ## Can optimize: empty has high bit set, so use sign comparison.
+  ## Returns a bitmask with 1s for matching positions. On the SWAR path
+  ## a bit may be a false positive; always confirm with a key compare.
+  matchAt(unsafeAddr g.ctrl[0], h2val)
 
-  var mask: uint16 = 0
-  for i in 0..<16:
-    if g.ctrl[i].isEmpty:
-      mask = mask or (1'u16 shl i)
-  result = BitMask(mask)
+proc matchEmpty*(g: Group): BitMask {.inline.} =
+  ## Find all empty slots in group.
+  matchEmptyAt(unsafeAddr g.ctrl[0])
 
-proc matchEmptyOrDeleted*(g: Group): BitMask =
-  ## Find all empty or deleted slots.
-  ##
-  ## IMPLEMENTATION:
-  ## Both empty and deleted have high bit set, so:
-  ## ```nim
-  ## let ctrl = mm_loadu_si128(...)
-  ## let mask = mm_movemask_epi8(ctrl)  # Sign bit of each byte
-  ## result = mask.BitMask
-  ## ```
-
-  var mask: uint16 = 0
-  for i in 0..<16:
-    if g.ctrl[i].isEmptyOrDeleted:
-      mask = mask or (1'u16 shl i)
-  result = BitMask(mask)
+proc matchEmptyOrDeleted*(g: Group): BitMask {.inline.} =
+  ## Find all empty or deleted slots (sentinels excluded).
+  matchEmptyOrDeletedAt(unsafeAddr g.ctrl[0])
 
 iterator setBits*(mask: BitMask): int =
-  ## Iterate over set bits in mask.
-  ##
-  ## IMPLEMENTATION:
-  ## Use `countTrailingZeros` (CTZ) to find next set bit:
-  ## ```nim
-  ## var m = mask.uint16
-  ## while m != 0:
-  ##   yield countTrailingZeros(m)
-  ##   m = m and (m - 1)  # Clear lowest set bit
-  ## ```
-
+  ## Iterate over set bits in mask, lowest first.
   var m = mask.uint16
-  var pos = 0
   while m != 0:
-    if (m and 1) != 0:
-      yield pos
-    m = m shr 1
-    inc pos
+    yield countTrailingZeroBits(m)
+    m = m and (m - 1)  # Clear lowest set bit
 
 # =============================================================================
 # Helper Functions
 # =============================================================================
 
 proc getGroup*[K, V](t: SwissTable[K, V], offset: int): Group {.inline.} =
-  ## Get a group of 16 control bytes starting at offset.
-  for i in 0..<16:
-    result.ctrl[i] = t.ctrl[offset + i]
-
-proc firstSetBit(mask: BitMask): int {.inline.} =
-  ## Return index of first set bit (0-15).
-  var m = mask.uint16
-  var pos = 0
-  while m != 0:
-    if (m and 1) != 0:
-      return pos
-    m = m shr 1
-    inc pos
-  return -1
+  ## Copy the group of control bytes starting at offset.
+  ## Probing loads control bytes in place; this is for inspection.
+  copyMem(addr result.ctrl[0], addr t.ctrl[offset], GroupSize)
+
+proc firstSetBit*(mask: BitMask): int {.inline.} =
+  ## Return index of first set bit, or -1 if none.
+  if mask.uint16 == 0: -1 else: countTrailingZeroBits(mask.uint16)
+
+proc groupMask[K, V](t: SwissTable[K, V]): int {.inline.} =
+  ## Number of groups minus one (group count is a power of two).
+  (t.capacity div GroupSize) - 1
+
+template findSlotIt(t: untyped, h: uint64, pred: untyped): int =
+  ## Index of the first slot on `h`'s probe sequence whose key (`it`)
+  ## satisfies `pred`, or -1. Probes groups linearly from H1.
+  var found = -1
+  block probe:
+    let mask = t.groupMask
+    let tag = uint8(h and 0x7F)
+    var g = int(h shr 7) and mask
+    for _ in 0 .. mask:
+      let base = g * GroupSize
+      let ctrl = addr t.ctrl[base]
+      for i in matchAt(ctrl, tag).setBits:
+        template it: untyped = t.slots[base + i].key
+        if pred:
+          found = base + i
+          break probe
+      # An empty slot ends every probe sequence that reached this group
+      if matchEmptyAt(ctrl).uint16 != 0:
+        break probe
+      g = (g + 1) and mask
+  found
+
+proc keyEquals(a: string, b: openArray[char]): bool {.inline.} =
+  a.len == b.len and (a.len == 0 or equalMem(unsafeAddr a[0], unsafeAddr b[0], a.len))
+
+proc findSlot[K, V](t: SwissTable[K, V], key: K, h: uint64): int {.inline.} =
+  ## Index of `key`'s slot, or -1.
+  findSlotIt(t, h, it == key)
+
+proc findCharsSlot[V](t: SwissTable[string, V], key: openArray[char],
+                      h: uint64): int {.inline.} =
+  ## Index of the slot whose string key equals `key`, or -1.
+  findSlotIt(t, h, keyEquals(it, key))
+
+proc findInsertSlot[K, V](t: SwissTable[K, V], h: uint64): int {.inline.} =
+  ## First EMPTY or DELETED slot on `h`'s probe sequence, or -1 if full.
+  let mask = t.groupMask
+  var g = int(h shr 7) and mask
+  for _ in 0 .. mask:
+    let base = g * GroupSize
+    let free = matchEmptyOrDeletedAt(addr t.ctrl[base])
+    if free.uint16 != 0:
+      return base + firstSetBit(free)
+    g = (g + 1) and mask
+  -1
+
+proc allocTable[K, V](t: var SwissTable[K, V], capacity: int) =
+  ## Allocate empty control/slot arrays for `capacity` slots.
+  t.ctrl = cast[ptr UncheckedArray[CtrlByte]](alloc(capacity * sizeof(CtrlByte)))
+  t.slots = cast[ptr UncheckedArray[tuple[key: K, value: V]]](
+    alloc0(capacity * sizeof(tuple[key: K, value: V]))
+  )
+  setMem(t.ctrl, CtrlEmpty.uint8.int, capacity)
+  t.capacity = capacity
+  t.size = 0
+  t.growthLeft = (capacity * 7) div 8  # 87.5% load factor
+
+proc resize[K, V](t: var SwissTable[K, V], newCapacity: int) =
+  ## Move every entry into fresh arrays of `newCapacity` slots.
+  ## Drops all tombstones as a side effect.
+  let oldCtrl = t.ctrl
+  let oldSlots = t.slots
+  let oldCapacity = t.capacity
+  t.allocTable(newCapacity)
+  for i in 0 ..< oldCapacity:
+    if oldCtrl[i].isFull:
+      let h = hashKey(oldSlots[i].key)
+      let slot = t.findInsertSlot(h)
+      t.ctrl[slot] = CtrlByte(h and 0x7F)
+      t.slots[slot] = move(oldSlots[i])
+      inc t.size
+      dec t.growthLeft
+  if oldCtrl != nil:
+    dealloc(oldCtrl)
+  if oldSlots != nil:
+    dealloc(oldSlots)
+
+proc rehashInPlace[K, V](t: var SwissTable[K, V]) =
+  ## Drop every tombstone without allocating, by re-placing entries within
+  ## the existing arrays (Abseil's DropDeletesWithoutResize):
+  ## 1. Mark FULL slots DELETED ("still to place") and DELETED slots EMPTY
+  ## 2. Walk the slots; each pending entry goes to the first free slot of
+  ##    its probe sequence. Entries already in that group stay put; a
+  ##    pending entry found at the target is swapped out and placed next.
+  let mask = t.groupMask
+  for i in 0 ..< t.capacity:
+    t.ctrl[i] = if t.ctrl[i].isFull: CtrlDeleted else: CtrlEmpty
+
+  var i = 0
+  while i < t.capacity:
+    if not t.ctrl[i].isDeleted:
+      inc i
+      continue
+    let h = hashKey(t.slots[i].key)
+    let tag = CtrlByte(h and 0x7F)
+    let target = t.findInsertSlot(h)
+    let start = int(h shr 7) and mask
+    if ((target div GroupSize - start) and mask) == ((i div GroupSize - start) and mask):
+      t.ctrl[i] = tag
+      inc i
+    elif t.ctrl[target].isEmpty:
+      t.ctrl[target] = tag
+      t.slots[target] = move(t.slots[i])
+      t.ctrl[i] = CtrlEmpty
+      inc i
+    else:
+      # Target holds another pending entry: take its place, then place it
+      t.ctrl[target] = tag
+      swap(t.slots[i], t.slots[target])
+
+  t.growthLeft = (t.capacity * 7) div 8 - t.size
+
+proc prepareInsert[K, V](t: var SwissTable[K, V], h: uint64): int =
+  ## Claim a slot for a new key with hash `h` and return its index.
+  ## At the load limit, a table that is mostly tombstones is cleaned in
+  ## place; otherwise the capacity doubles.
+  result = t.findInsertSlot(h)
+  if result < 0 or (t.ctrl[result].isEmpty and t.growthLeft <= 0):
+    if t.size * 32 <= t.capacity * 25:
+      t.rehashInPlace()
+    else:
+      t.resize(t.capacity * 2)
+    result = t.findInsertSlot(h)
+  if t.ctrl[result].isEmpty:
+    dec t.growthLeft
+  t.ctrl[result] = CtrlByte(h and 0x7F)
+  inc t.size
 
 # =============================================================================
 # Table Operations
@@ -220,74 +367,38 @@ proc firstSetBit(mask: BitMask): int {.inline.} =
 proc init*[K, V](_: typedesc[SwissTable[K, V]], capacity: int = 16): SwissTable[K, V] =
   ## Create a new Swiss Table with given initial capacity.
   ##
-  ## IMPLEMENTATION:
-  ## 1. Round up capacity to multiple of GroupSize (16)
-  ## 2. Allocate ctrl array (capacity + GroupSize bytes for sentinel/wraparound)
-  ## 3. Allocate slots array
-  ## 4. Initialize all ctrl bytes to Empty
-  ## 5. Set sentinel bytes at the end
-
-  # Round up to next multiple of GroupSize
-  var cap = max(16, capacity)
-  if cap mod GroupSize != 0:
-    cap = ((cap div GroupSize) + 1) * GroupSize
-
-  # Allocate control bytes (extra GroupSize bytes for sentinel/wraparound)
-  result.ctrl = cast[ptr UncheckedArray[CtrlByte]](
-    alloc0((cap + GroupSize) * sizeof(CtrlByte))
-  )
-
-  # Allocate slots
-  result.slots = cast[ptr UncheckedArray[tuple[key: K, value: V]]](
-    alloc0(cap * sizeof(tuple[key: K, value: V]))
-  )
-
-  # Initialize all ctrl bytes to Empty
-  for i in 0..<cap:
-    result.ctrl[i] = CtrlEmpty
-
-  # Set sentinel bytes at the end (for wraparound)
-  for i in cap..<cap + GroupSize:
-    result.ctrl[i] = CtrlSentinel
-
-  result.capacity = cap
-  result.size = 0
-  result.growthLeft = (cap * 7) div 8  # 87.5% load factor
+  ## Capacity is rounded up to a power of two (at least 16 slots), so it
+  ## is always a whole number of groups. The table grows automatically
+  ## once 7/8 of the slots are used.
+  result.allocTable(max(MinCapacity, nextPowerOfTwo(capacity)))
+
+proc find*[K, V](t: SwissTable[K, V], key: K, h: uint64): Option[ptr V] =
+  ## Like `find`, with `h = hashKey(key)` already computed by the caller
+  ## (e.g. a sharded wrapper that hashed the key to pick the shard).
+  if t.ctrl == nil or t.size == 0:
+    return none(ptr V)
+  let idx = t.findSlot(key, h)
+  if idx >= 0:
+    some(addr t.slots[idx].value)
+  else:
+    none(ptr V)
 
-proc find*[K, V](t: SwissTable[K, V], key: K): Option[ptr V] =
+proc find*[K, V](t: SwissTable[K, V], key: K): Option[ptr V] {.inline.} =
   ## Find key and return pointer to value, or none if not found.
   ##
   ## Uses linear probing with SIMD-accelerated group matching.
+  t.find(key, hashKey(key))
 
+proc find*[V](t: SwissTable[string, V], key: openArray[char]): Option[ptr V] =
+  ## Heterogeneous lookup: find a string key from a character slice
+  ## (e.g. part of a network buffer) without allocating a `string`.
   if t.ctrl == nil or t.size == 0:
     return none(ptr V)
-
-  let h1val = h1(key)
-  let h2val = h2(key)
-
-  # Start probing at h1 modulo capacity
-  var offset = (h1val mod t.capacity.uint64).int
-  var probeCount = 0
-
-  # Probe groups until we find the key or an empty slot
-  while probeCount < t.capacity:
-    let g = t.getGroup(offset)
-
-    # Check all slots in group that match h2
-    for i in match(g, h2val).setBits:
-      let idx = offset + i
-      if idx < t.capacity and t.slots[idx].key == key:
-        return some(addr t.slots[idx].value)
-
-    # If we found an empty slot, key doesn't exist
-    if matchEmpty(g).uint16 != 0:
-      return none(ptr V)
-
-    # Linear probing: move to next group
-    offset = (offset + GroupSize) mod t.capacity
-    inc probeCount, GroupSize
-
-  return none(ptr V)
+  let idx = t.findCharsSlot(key, hashKey(key))
+  if idx >= 0:
+    some(addr t.slots[idx].value)
+  else:
+    none(ptr V)
 
 proc `[]`*[K, V](t: SwissTable[K, V], key: K): V =
   ## Get value by key. Raises KeyError if not found.
@@ -297,103 +408,146 @@ proc `[]`*[K, V](t: SwissTable[K, V], key: K): V =
   else:
     raise newException(KeyError, "Key not found")
 
-proc insertWithoutGrowth*[K, V](t: var SwissTable[K, V], key: K, value: V): bool =
-  ## Insert without triggering growth. Returns false if no space available.
+proc `[]`*[V](t: SwissTable[string, V], key: openArray[char]): V =
+  ## Get value by character slice. Raises KeyError if not found.
+  let p = t.find(key)
+  if p.isSome:
+    result = p.get[]
+  else:
+    raise newException(KeyError, "Key not found")
+
+proc insertWithoutGrowth*[K, V](t: var SwissTable[K, V], key: K, value: V,
+                                h: uint64): bool =
+  ## Like `insertWithoutGrowth`, with `h = hashKey(key)` precomputed.
   if t.ctrl == nil:
     return false
 
-  let h1val = h1(key)
-  let h2val = h2(key)
-
-  var offset = (h1val mod t.capacity.uint64).int
-  var probeCount = 0
-  var insertIdx = -1
-
-  while probeCount < t.capacity:
-    let g = t.getGroup(offset)
-
-    # Check if key already exists
-    for i in match(g, h2val).setBits:
-      let idx = offset + i
-      if idx < t.capacity and t.slots[idx].key == key:
-        t.slots[idx].value = value
-        return true
-
-    # Find insertion point
-    if insertIdx < 0:
-      let emptyMask = matchEmptyOrDeleted(g)
-      if emptyMask.uint16 != 0:
-        let i = firstSetBit(emptyMask)
-        insertIdx = offset + i
-
-    if matchEmpty(g).uint16 != 0:
-      break
-
-    offset = (offset + GroupSize) mod t.capacity
-    inc probeCount, GroupSize
-
-  if insertIdx >= 0 and insertIdx < t.capacity:
-    let wasEmpty = t.ctrl[insertIdx].isEmpty
-    t.ctrl[insertIdx] = CtrlByte(h2val)
-    t.slots[insertIdx] = (key, value)
-    inc t.size
-    if wasEmpty:
-      dec t.growthLeft
+  let existing = t.findSlot(key, h)
+  if existing >= 0:
+    t.slots[existing].value = value
     return true
 
-  return false
+  let slot = t.findInsertSlot(h)
+  if slot < 0:
+    return false
+  let wasEmpty = t.ctrl[slot].isEmpty
+  if wasEmpty and t.growthLeft <= 0:
+    return false
+
+  t.ctrl[slot] = CtrlByte(h and 0x7F)
+  t.slots[slot] = (key, value)
+  inc t.size
+  if wasEmpty:
+    dec t.growthLeft
+  return true
+
+proc insertWithoutGrowth*[K, V](t: var SwissTable[K, V], key: K, value: V): bool {.inline.} =
+  ## Insert or update without triggering growth.
+  ## Returns false if the key is new and the table is at its load limit.
+  t.insertWithoutGrowth(key, value, hashKey(key))
 
 proc `[]=`*[K, V](t: var SwissTable[K, V], key: K, value: V) =
   ## Insert or update key-value pair.
   ##
-  ## Uses linear probing to find insertion point.
-  ## Note: For now, does not support automatic growth - use init() with larger capacity.
-
+  ## At the load limit the capacity doubles (rehashing every entry), or,
+  ## when most used slots are tombstones, they are dropped in place.
   if t.ctrl == nil:
-    return
+    t.allocTable(MinCapacity)
+  let h = hashKey(key)
+  let idx = t.findSlot(key, h)
+  if idx >= 0:
+    t.slots[idx].value = value
+  else:
+    t.slots[t.prepareInsert(h)] = (key, value)
 
-  discard t.insertWithoutGrowth(key, value)
+proc emplace*[K, V](t: var SwissTable[K, V], key: K, isNew: var bool): var V =
+  ## Return the value slot for `key`, inserting `default(V)` if absent.
+  ## `isNew` tells whether the entry was just created, so the caller can
+  ## build the value in place instead of constructing and copying it.
+  ##
+  ## The returned reference is valid until the next insert.
+  if t.ctrl == nil:
+    t.allocTable(MinCapacity)
+  let h = hashKey(key)
+  var idx = t.findSlot(key, h)
+  isNew = idx < 0
+  if isNew:
+    idx = t.prepareInsert(h)
+    t.slots[idx] = (key, default(V))
+  t.slots[idx].value
+
+proc mgetOrPut*[K, V](t: var SwissTable[K, V], key: K, default: V): var V =
+  ## Value for `key`, inserting `default` first if absent. Hashes and
+  ## probes once, unlike `contains` followed by `[]=`.
+  ##
+  ## The returned reference is valid until the next insert.
+  if t.ctrl == nil:
+    t.allocTable(MinCapacity)
+  let h = hashKey(key)
+  var idx = t.findSlot(key, h)
+  if idx < 0:
+    idx = t.prepareInsert(h)
+    t.slots[idx] = (key, default)
+  t.slots[idx].value
+
+proc mgetOrPut*[V](t: var SwissTable[string, V], key: openArray[char],
+                   default: V): var V =
+  ## Like `mgetOrPut`, keyed by a character slice. A `string` is only
+  ## allocated when the key is actually inserted.
+  if t.ctrl == nil:
+    t.allocTable(MinCapacity)
+  let h = hashKey(key)
+  var idx = t.findCharsSlot(key, h)
+  if idx < 0:
+    idx = t.prepareInsert(h)
+    var owned = newString(key.len)
+    if key.len > 0:
+      copyMem(addr owned[0], unsafeAddr key[0], key.len)
+    t.slots[idx] = (move(owned), default)
+  t.slots[idx].value
+
+proc reserve*[K, V](t: var SwissTable[K, V], n: int) =
+  ## Make room for `n` entries in total, so inserting up to that many
+  ## keys never rehashes. Never shrinks the table.
+  let needed = max(MinCapacity, nextPowerOfTwo((n * 8 + 6) div 7))
+  if t.ctrl == nil:
+    t.allocTable(needed)
+  elif needed > t.capacity:
+    t.resize(needed)
 
 proc contains*[K, V](t: SwissTable[K, V], key: K): bool {.inline.} =
   ## Check if key exists.
-  t.find(key).isSome
+  t.ctrl != nil and t.size > 0 and t.findSlot(key, hashKey(key)) >= 0
 
-proc delete*[K, V](t: var SwissTable[K, V], key: K): bool =
-  ## Delete key. Returns true if key existed.
-  ##
-  ## Sets control byte to Deleted (tombstone) to maintain probe chain.
+proc contains*[V](t: SwissTable[string, V], key: openArray[char]): bool {.inline.} =
+  ## Check if a string key equal to the character slice exists.
+  t.ctrl != nil and t.size > 0 and t.findCharsSlot(key, hashKey(key)) >= 0
 
+proc delete*[K, V](t: var SwissTable[K, V], key: K, h: uint64): bool =
+  ## Like `delete`, with `h = hashKey(key)` precomputed.
   if t.ctrl == nil or t.size == 0:
     return false
 
-  let h1val = h1(key)
-  let h2val = h2(key)
-
-  var offset = (h1val mod t.capacity.uint64).int
-  var probeCount = 0
-
-  # Probe to find the key
-  while probeCount < t.capacity:
-    let g = t.getGroup(offset)
-
-    # Check all slots in group that match h2
-    for i in match(g, h2val).setBits:
-      let idx = offset + i
-      if idx < t.capacity and t.slots[idx].key == key:
-        # Found the key - mark as deleted
-        t.ctrl[idx] = CtrlDeleted
-        dec t.size
-        return true
-
-    # If we found an empty slot, key doesn't exist
-    if matchEmpty(g).uint16 != 0:
-      return false
-
-    # Linear probing: move to next group
-    offset = (offset + GroupSize) mod t.capacity
-    inc probeCount, GroupSize
+  let idx = t.findSlot(key, h)
+  if idx < 0:
+    return false
+  # Probes stop at a group that has an empty slot, so no probe sequence
+  # passes through such a group and the slot can be freed outright.
+  if matchEmptyAt(addr t.ctrl[idx - idx mod GroupSize]).uint16 != 0:
+    t.ctrl[idx] = CtrlEmpty
+    inc t.growthLeft
+  else:
+    t.ctrl[idx] = CtrlDeleted
+  reset(t.slots[idx])
+  dec t.size
+  return true
 
-  return false
+proc delete*[K, V](t: var SwissTable[K, V], key: K): bool {.inline.} =
+  ## Delete key. Returns true if key existed.
+  ##
+  ## Sets control byte to Deleted (tombstone) to maintain probe chain,
+  ## or back to Empty when its group never filled up.
+  t.delete(key, hashKey(key))
 
 proc len*[K, V](t: SwissTable[K, V]): int {.inline.} =
   t.size
@@ -406,15 +560,12 @@ proc clear*[K, V](t: var SwissTable[K, V]) =
   ## Remove all entries.
   ##
   ## Sets all ctrl bytes to Empty, resets size and growthLeft.
-
   if t.ctrl != nil:
-    # Clear all control bytes to Empty
-    for i in 0..<t.capacity:
-      t.ctrl[i] = CtrlEmpty
-
-    # Reset sentinel bytes
-    for i in t.capacity..<t.capacity + GroupSize:
-      t.ctrl[i] = CtrlSentinel
+    when not supportsCopyMem(K) or not supportsCopyMem(V):
+      for i in 0 ..< t.capacity:
+        if t.ctrl[i].isFull:
+          reset(t.slots[i])
+    setMem(t.ctrl, CtrlEmpty.uint8.int, t.capacity)
 
   t.size = 0
   t.growthLeft = (t.capacity * 7) div 8
@@ -422,6 +573,10 @@ proc clear*[K, V](t: var SwissTable[K, V]) =
 proc destroy*[K, V](t: var SwissTable[K, V]) =
   ## Deallocate all memory used by the table.
   if t.ctrl != nil:
+    when not supportsCopyMem(K) or not supportsCopyMem(V):
+      for i in 0 ..< t.capacity:
+        if t.ctrl[i].isFull:
+          reset(t.slots[i])
     dealloc(t.ctrl)
     t.ctrl = nil
 
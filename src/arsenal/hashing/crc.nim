@@ -0,0 +1,466 @@
+## CRC Checksums
+## =============
+##
+## CRC-32C (Castagnoli), CRC-32 (IEEE 802.3 / zlib) and CRC-64 (XZ,
+## ECMA-182 polynomial), bit-compatible with the usual reference values:
+##
+## | Function | Check ("123456789") | Used by |
+## |----------|---------------------|---------|
+## | `crc32c` | 0xE3069283 | iSCSI, ext4, Btrfs, RocksDB, compression frames |
+## | `crc32`  | 0xCBF43926 | zlib, gzip, PNG, Ethernet |
+## | `crc64`  | 0x995DC9BBDF1939FA | XZ |
+##
+## Each call picks the fastest implementation the CPU supports at runtime:
+## - CRC-32C: SSE4.2 `crc32` (x86_64) or ARMv8 `crc32c`, three independent
+##   streams interleaved to hide the instruction's 3-cycle latency, then
+##   merged with a precomputed "shift by N zero bytes" operator
+## - CRC-32 / CRC-64: PCLMULQDQ folding (x86_64) of four 128-bit lanes at
+##   a time; ARMv8 `crc32` instruction for CRC-32 on ARM64
+## - Everything else: slicing-by-8 lookup tables
+##
+## The table implementations (`crc32cPortable` etc.) have no pointers or
+## intrinsics, so they also run at compile time. `-d:arsenalScalar` forces
+## them everywhere.
+##
+## All functions take a running CRC, so data can be checksummed in pieces:
+## `crc32c(b, crc32c(a)) == crc32c(a & b)`. The `*Combine` procs join the
+## CRCs of two independently checksummed pieces without re-reading them.
+##
+## Usage:
+## ```nim
+## let c = crc32c(payload)                      # one shot
+##
+## var running = 0'u32                          # streaming
+## for chunk in chunks:
+##   running = crc32c(chunk, running)
+##
+## # Parallel: checksum halves on different threads, then merge
+## let whole = crc32cCombine(crc32c(a), crc32c(b), b.len)
+## ```
+##
+## References:
+## - M. Adler, crc32c.c (3-way interleaved hardware CRC-32C), 2013
+## - V. Gopal et al., "Fast CRC Computation for Generic Polynomials Using
+##   PCLMULQDQ Instruction", Intel, 2009
+
+import ../platform/config
+
+type
+  CrcBackend* = enum
+    ## Implementation selected for a CRC variant on this machine.
+    cbTable = "table"        ## Slicing-by-8 lookup tables (portable)
+    cbSSE42 = "sse4.2"       ## x86 `crc32` instruction, 3 interleaved streams
+    cbPCLMUL = "pclmul"      ## x86 carry-less multiply folding
+    cbArmCrc = "armv8-crc"   ## ARMv8 CRC instructions, 3 interleaved streams
+
+  CrcTables[T] = array[8, array[256, T]]
+  ShiftTable = array[4, array[256, uint32]]
+
+const
+  Crc32cPoly = 0x82F63B78'u32            ## Castagnoli, bit-reflected
+  Crc32Poly = 0xEDB88320'u32             ## IEEE 802.3, bit-reflected
+  Crc64Poly = 0xC96C5795D7870F42'u64     ## ECMA-182, bit-reflected
+
+  LongBlock = 8192    ## Interleaved stream length for large inputs
+  ShortBlock = 256    ## ... and for the remainder
+  FoldMinLen = 64     ## Below this the folding setup costs more than it saves
+
+# =============================================================================
+# GF(2) Polynomial Arithmetic (compile time)
+# =============================================================================
+
+proc reflect(x: uint64, width: int): uint64 =
+  ## Reverse the low `width` bits.
+  for i in 0 ..< width:
+    if (x and (1'u64 shl i)) != 0:
+      result = result or (1'u64 shl (width - 1 - i))
+
+proc xPowMod(e: int, poly: uint64, width: int): uint64 =
+  ## x^e mod P in normal (non-reflected) bit order; `poly` is the
+  ## reflected polynomial without its x^width term.
+  let normal = reflect(poly, width)
+  let top = 1'u64 shl (width - 1)
+  result = 1
+  for _ in 0 ..< e:
+    let carry = (result and top) != 0
+    result = result shl 1
+    if width < 64:
+      result = result and ((1'u64 shl width) - 1)
+    if carry:
+      result = result xor normal
+
+proc foldConstants(poly: uint64, width: int): array[4, uint64] =
+  ## PCLMULQDQ multipliers that move a 128-bit lane forward by 512 bits
+  ## (four lanes) and by 128 bits (one lane). Multiplying the lane halves
+  ## by x^(D+63) and x^(D-1) accounts for the extra x that a carry-less
+  ## product of two reflected operands carries.
+  [reflect(xPowMod(512 + 63, poly, width), 64), reflect(xPowMod(512 - 1, poly, width), 64),
+   reflect(xPowMod(128 + 63, poly, width), 64), reflect(xPowMod(128 - 1, poly, width), 64)]
+
+proc multModP[T: uint32 | uint64](a, b: T, poly: T): T =
+  ## a * b mod P with both operands bit-reflected (zlib's multmodp).
+  const top = T(1) shl (sizeof(T) * 8 - 1)
+  var m = top
+  var b = b
+  while true:
+    if (a and m) != 0:
+      result = result xor b
+      if (a and (m - 1)) == 0:
+        break
+    m = m shr 1
+    b = if (b and 1) != 0: (b shr 1) xor poly else: b shr 1
+
+proc makeX2nTable[T: uint32 | uint64](poly: T): array[64, T] =
+  ## x^(2^k) mod P for k = 0 ..< 64 (reflected).
+  result[0] = T(1) shl (sizeof(T) * 8 - 2)    # x^1
+  for k in 1 ..< 64:
+    result[k] = multModP(result[k - 1], result[k - 1], poly)
+
+proc x8nModP[T: uint32 | uint64](n: int, x2n: array[64, T], poly: T): T =
+  ## x^(8n) mod P: the operator that appends `n` zero bytes.
+  result = T(1) shl (sizeof(T) * 8 - 1)        # x^0
+  var n = n
+  var k = 3
+  while n != 0:
+    if (n and 1) != 0:
+      result = multModP(x2n[k and 63], result, poly)
+    n = n shr 1
+    inc k
+
+proc makeTables[T: uint32 | uint64](poly: T): CrcTables[T] =
+  for i in 0 ..< 256:
+    var c = T(i)
+    for _ in 0 ..< 8:
+      c = if (c and 1) != 0: (c shr 1) xor poly else: c shr 1
+    result[0][i] = c
+  for k in 1 ..< 8:
+    for i in 0 ..< 256:
+      let c = result[k - 1][i]
+      result[k][i] = (c shr 8) xor result[0][int(c and 0xFF)]
+
+proc makeShiftTable(nbytes: int, poly: uint32): ShiftTable =
+  ## Byte-sliced form of "append `nbytes` zero bytes" for merging the
+  ## interleaved hardware streams: four lookups instead of 32 steps.
+  let x2n = makeX2nTable(poly)
+  let op = x8nModP(nbytes, x2n, poly)
+  for k in 0 ..< 4:
+    for b in 0 ..< 256:
+      result[k][b] = multModP(op, uint32(b) shl (8 * k), poly)
+
+const
+  Crc32cTables = makeTables(Crc32cPoly)
+  Crc32Tables = makeTables(Crc32Poly)
+  Crc64Tables = makeTables(Crc64Poly)
+
+  Crc32cX2n = makeX2nTable(Crc32cPoly)
+  Crc32X2n = makeX2nTable(Crc32Poly)
+  Crc64X2n = makeX2nTable(Crc64Poly)
+
+# =============================================================================
+# Table-Driven CRC (portable, compile-time capable)
+# =============================================================================
+
+proc tableUpdate[T: uint32 | uint64](t: CrcTables[T], crc: T,
+                                     data: openArray[byte]): T =
+  ## Advance the raw (non-inverted) CRC register over `data`,
+  ## eight bytes per step.
+  var c = crc
+  var i = 0
+  while data.len - i >= 8:
+    var v = 0'u64
+    for k in 0 ..< 8:
+      v = v or (uint64(data[i + k]) shl (8 * k))
+    when T is uint32:
+      let lo = uint32(v and 0xFFFF_FFFF'u64) xor c
+      let hi = uint32(v shr 32)
+      c = t[7][int(lo and 0xFF)] xor t[6][int((lo shr 8) and 0xFF)] xor
+          t[5][int((lo shr 16) and 0xFF)] xor t[4][int(lo shr 24)] xor
+          t[3][int(hi and 0xFF)] xor t[2][int((hi shr 8) and 0xFF)] xor
+          t[1][int((hi shr 16) and 0xFF)] xor t[0][int(hi shr 24)]
+    else:
+      v = v xor c
+      c = 0
+      for k in 0 ..< 8:
+        c = c xor t[7 - k][int((v shr (8 * k)) and 0xFF)]
+    i += 8
+  while i < data.len:
+    c = (c shr 8) xor t[0][int((c xor T(data[i])) and 0xFF)]
+    inc i
+  c
+
+proc crc32cPortable*(data: openArray[byte], crc = 0'u32): uint32 =
+  ## CRC-32C with lookup tables only. Same result as `crc32c`.
+  not tableUpdate(Crc32cTables, not crc, data)
+
+proc crc32Portable*(data: openArray[byte], crc = 0'u32): uint32 =
+  ## CRC-32 (IEEE) with lookup tables only. Same result as `crc32`.
+  not tableUpdate(Crc32Tables, not crc, data)
+
+proc crc64Portable*(data: openArray[byte], crc = 0'u64): uint64 =
+  ## CRC-64/XZ with lookup tables only. Same result as `crc64`.
+  not tableUpdate(Crc64Tables, not crc, data)
+
+# =============================================================================
+# Hardware Kernels
+# =============================================================================
+
+const
+  HwCompiler = (defined(gcc) or defined(clang) or defined(llvm_gcc)) and
+               not defined(arsenalScalar)
+  X86Crc = HwCompiler and defined(amd64)
+  ArmCrc = HwCompiler and defined(arm64)
+
+when X86Crc or ArmCrc:
+  let
+    crc32cLongShift = makeShiftTable(LongBlock, Crc32cPoly)
+    crc32cShortShift = makeShiftTable(ShortBlock, Crc32cPoly)
+
+  # Three streams of `block` bytes each run through the CRC instruction
+  # side by side (the instruction pipelines, a single dependency chain
+  # does not). Streams 0 and 1 are then shifted past the bytes that follow
+  # them and XORed together, which is the CRC of the whole 3 * block.
+  {.emit: """/*TYPESECTION*/
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+static inline uint32_t arsenal_crc_shift(const uint32_t* t, uint32_t c) {
+  return t[c & 0xff] ^ t[256 + ((c >> 8) & 0xff)] ^
+         t[512 + ((c >> 16) & 0xff)] ^ t[768 + (c >> 24)];
+}
+
+#define ARSENAL_CRC_3WAY(NAME, ATTR, STEP64, STEP8)                          \
+  ATTR static inline uint32_t NAME##_blocks(uint32_t c0, const uint8_t** pp,  \
+                                            size_t* lenp, size_t block,       \
+                                            const uint32_t* shift) {          \
+    const uint8_t* p = *pp;                                                   \
+    size_t len = *lenp;                                                       \
+    while (len >= 3 * block) {                                                \
+      uint32_t c1 = 0, c2 = 0;                                                \
+      const uint8_t* end = p + block;                                         \
+      do {                                                                    \
+        uint64_t a, b, d;                                                     \
+        memcpy(&a, p, 8);                                                     \
+        memcpy(&b, p + block, 8);                                             \
+        memcpy(&d, p + 2 * block, 8);                                         \
+        c0 = STEP64(c0, a);                                                   \
+        c1 = STEP64(c1, b);                                                   \
+        c2 = STEP64(c2, d);                                                   \
+        p += 8;                                                               \
+      } while (p < end);                                                      \
+      c0 = arsenal_crc_shift(shift, c0) ^ c1;                                 \
+      c0 = arsenal_crc_shift(shift, c0) ^ c2;                                 \
+      p += 2 * block;                                                         \
+      len -= 3 * block;                                                       \
+    }                                                                         \
+    *pp = p;                                                                  \
+    *lenp = len;                                                              \
+    return c0;                                                                \
+  }                                                                           \
+  ATTR static uint32_t NAME(uint32_t c, const uint8_t* p, size_t len,         \
+                            const uint32_t* longShift,                        \
+                            const uint32_t* shortShift) {                     \
+    c = NAME##_blocks(c, &p, &len, 8192, longShift);   /* LongBlock */      \
+    c = NAME##_blocks(c, &p, &len, 256, shortShift);   /* ShortBlock */     \
+    while (len >= 8) {                                                        \
+      uint64_t v;                                                             \
+      memcpy(&v, p, 8);                                                       \
+      c = STEP64(c, v);                                                       \
+      p += 8;                                                                 \
+      len -= 8;                                                               \
+    }                                                                         \
+    while (len > 0) {                                                         \
+      c = STEP8(c, *p++);                                                     \
+      len--;                                                                  \
+    }                                                                         \
+    return c;                                                                 \
+  }
+""".}
+
+when X86Crc:
+  {.emit: """/*TYPESECTION*/
+#include <immintrin.h>
+
+#define ARSENAL_SSE42_STEP64(c, v) ((uint32_t)_mm_crc32_u64((c), (v)))
+#define ARSENAL_SSE42_STEP8(c, v) _mm_crc32_u8((c), (v))
+ARSENAL_CRC_3WAY(arsenal_crc32c_sse42, __attribute__((target("sse4.2"))),
+                 ARSENAL_SSE42_STEP64, ARSENAL_SSE42_STEP8)
+
+/* Fold `len` bytes (a multiple of 16, at least 64) into one 128-bit lane
+   whose plain CRC equals that of the input. k = {512-bit pair, 128-bit pair}. */
+__attribute__((target("sse4.1,pclmul")))
+static void arsenal_crc_fold(const uint8_t* p, size_t len, uint64_t init,
+                             const uint64_t* k, uint8_t* out) {
+  const __m128i k512 = _mm_set_epi64x((long long)k[1], (long long)k[0]);
+  const __m128i k128 = _mm_set_epi64x((long long)k[3], (long long)k[2]);
+#define ARSENAL_FOLD(x, kk) \
+  _mm_xor_si128(_mm_clmulepi64_si128((x), (kk), 0x00), _mm_clmulepi64_si128((x), (kk), 0x11))
+  __m128i x0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)p),
+                             _mm_cvtsi64_si128((long long)init));
+  __m128i x1 = _mm_loadu_si128((const __m128i*)(p + 16));
+  __m128i x2 = _mm_loadu_si128((const __m128i*)(p + 32));
+  __m128i x3 = _mm_loadu_si128((const __m128i*)(p + 48));
+  p += 64;
+  len -= 64;
+  while (len >= 64) {
+    x0 = _mm_xor_si128(ARSENAL_FOLD(x0, k512), _mm_loadu_si128((const __m128i*)p));
+    x1 = _mm_xor_si128(ARSENAL_FOLD(x1, k512), _mm_loadu_si128((const __m128i*)(p + 16)));
+    x2 = _mm_xor_si128(ARSENAL_FOLD(x2, k512), _mm_loadu_si128((const __m128i*)(p + 32)));
+    x3 = _mm_xor_si128(ARSENAL_FOLD(x3, k512), _mm_loadu_si128((const __m128i*)(p + 48)));
+    p += 64;
+    len -= 64;
+  }
+  x0 = _mm_xor_si128(ARSENAL_FOLD(x0, k128), x1);
+  x0 = _mm_xor_si128(ARSENAL_FOLD(x0, k128), x2);
+  x0 = _mm_xor_si128(ARSENAL_FOLD(x0, k128), x3);
+  while (len >= 16) {
+    x0 = _mm_xor_si128(ARSENAL_FOLD(x0, k128), _mm_loadu_si128((const __m128i*)p));
+    p += 16;
+    len -= 16;
+  }
+#undef ARSENAL_FOLD
+  _mm_storeu_si128((__m128i*)out, x0);
+}
+""".}
+
+  proc crc32cSse42(crc: uint32, p: pointer, len: csize_t,
+                   longShift, shortShift: pointer): uint32
+    {.importc: "arsenal_crc32c_sse42", nodecl.}
+  proc crcFold(p: pointer, len: csize_t, init: uint64, k: pointer, outp: pointer)
+    {.importc: "arsenal_crc_fold", nodecl.}
+
+  const
+    Crc32Fold = foldConstants(uint64(Crc32Poly), 32)
+    Crc64Fold = foldConstants(Crc64Poly, 64)
+
+  let
+    cpuHasSse42 = getCpuFeatures().hasSSE42
+    cpuHasClmul = getCpuFeatures().hasCLMUL and getCpuFeatures().hasSSE41
+
+  proc foldUpdate[T: uint32 | uint64](t: CrcTables[T], k: array[4, uint64],
+                                      crc: T, data: openArray[byte]): T =
+    ## Fold whole 16-byte lanes with PCLMULQDQ, then finish the 16-byte
+    ## lane and the tail with the tables.
+    let n = data.len and not 15
+    var lane: array[16, byte]
+    crcFold(unsafeAddr data[0], csize_t(n), uint64(crc), unsafeAddr k[0], addr lane[0])
+    result = tableUpdate(t, T(0), lane)
+    result = tableUpdate(t, result, data.toOpenArray(n, data.high))
+
+when ArmCrc:
+  # The CRC extension is optional before ARMv8.1; without it (e.g. plain
+  # `-march=armv8-a`) the kernels are stubs and `armHasCrc` is 0.
+  {.emit: """/*TYPESECTION*/
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define ARSENAL_ARM_HAS_CRC 1
+ARSENAL_CRC_3WAY(arsenal_crc32c_arm, , __crc32cd, __crc32cb)
+ARSENAL_CRC_3WAY(arsenal_crc32_arm, , __crc32d, __crc32b)
+#else
+#define ARSENAL_ARM_HAS_CRC 0
+static uint32_t arsenal_crc32c_arm(uint32_t c, const uint8_t* p, size_t len,
+                                   const uint32_t* l, const uint32_t* s) { return c; }
+static uint32_t arsenal_crc32_arm(uint32_t c, const uint8_t* p, size_t len,
+                                  const uint32_t* l, const uint32_t* s) { return c; }
+#endif
+""".}
+
+  proc crc32cArm(crc: uint32, p: pointer, len: csize_t,
+                 longShift, shortShift: pointer): uint32
+    {.importc: "arsenal_crc32c_arm", nodecl.}
+  proc crc32Arm(crc: uint32, p: pointer, len: csize_t,
+                longShift, shortShift: pointer): uint32
+    {.importc: "arsenal_crc32_arm", nodecl.}
+  var armHasCrc {.importc: "ARSENAL_ARM_HAS_CRC", nodecl.}: cint
+
+  let
+    crc32LongShift = makeShiftTable(LongBlock, Crc32Poly)
+    crc32ShortShift = makeShiftTable(ShortBlock, Crc32Poly)
+
+# =============================================================================
+# Public API
+# =============================================================================
+
+proc crc32cBackend*(): CrcBackend =
+  ## Implementation `crc32c` uses on this machine.
+  when X86Crc:
+    if cpuHasSse42: cbSSE42 else: cbTable
+  elif ArmCrc:
+    if armHasCrc != 0: cbArmCrc else: cbTable
+  else:
+    cbTable
+
+proc crc32Backend*(): CrcBackend =
+  ## Implementation `crc32` uses on this machine.
+  when X86Crc:
+    if cpuHasClmul: cbPCLMUL else: cbTable
+  elif ArmCrc:
+    if armHasCrc != 0: cbArmCrc else: cbTable
+  else:
+    cbTable
+
+proc crc64Backend*(): CrcBackend =
+  ## Implementation `crc64` uses on this machine.
+  when X86Crc:
+    if cpuHasClmul: cbPCLMUL else: cbTable
+  else:
+    cbTable
+
+proc crc32c*(data: openArray[byte], crc = 0'u32): uint32 =
+  ## CRC-32C (Castagnoli) of `data`, continuing from `crc`.
+  when X86Crc:
+    if cpuHasSse42 and data.len > 0:
+      return not crc32cSse42(not crc, unsafeAddr data[0], csize_t(data.len),
+                             unsafeAddr crc32cLongShift, unsafeAddr crc32cShortShift)
+  elif ArmCrc:
+    if armHasCrc != 0 and data.len > 0:
+      return not crc32cArm(not crc, unsafeAddr data[0], csize_t(data.len),
+                           unsafeAddr crc32cLongShift, unsafeAddr crc32cShortShift)
+  crc32cPortable(data, crc)
+
+proc crc32*(data: openArray[byte], crc = 0'u32): uint32 =
+  ## CRC-32 (IEEE 802.3, as in zlib) of `data`, continuing from `crc`.
+  when X86Crc:
+    if cpuHasClmul and data.len >= FoldMinLen:
+      return not foldUpdate(Crc32Tables, Crc32Fold, not crc, data)
+  elif ArmCrc:
+    if armHasCrc != 0 and data.len > 0:
+      return not crc32Arm(not crc, unsafeAddr data[0], csize_t(data.len),
+                          unsafeAddr crc32LongShift, unsafeAddr crc32ShortShift)
+  crc32Portable(data, crc)
+
+proc crc64*(data: openArray[byte], crc = 0'u64): uint64 =
+  ## CRC-64/XZ of `data`, continuing from `crc`.
+  when X86Crc:
+    if cpuHasClmul and data.len >= FoldMinLen:
+      return not foldUpdate(Crc64Tables, Crc64Fold, not crc, data)
+  crc64Portable(data, crc)
+
+proc crc32c*(s: string, crc = 0'u32): uint32 {.inline.} =
+  ## CRC-32C of a string.
+  crc32c(s.toOpenArrayByte(0, s.len - 1), crc)
+
+proc crc32*(s: string, crc = 0'u32): uint32 {.inline.} =
+  ## CRC-32 of a string.
+  crc32(s.toOpenArrayByte(0, s.len - 1), crc)
+
+proc crc64*(s: string, crc = 0'u64): uint64 {.inline.} =
+  ## CRC-64/XZ of a string.
+  crc64(s.toOpenArrayByte(0, s.len - 1), crc)
+
+# =============================================================================
+# Combining
+# =============================================================================
+
+proc crc32cCombine*(crcA, crcB: uint32, lenB: int): uint32 =
+  ## CRC-32C of `a & b` from `crc32c(a)`, `crc32c(b)` and `b.len`.
+  ## O(log lenB), independent of the data.
+  multModP(x8nModP(lenB, Crc32cX2n, Crc32cPoly), crcA, Crc32cPoly) xor crcB
+
+proc crc32Combine*(crcA, crcB: uint32, lenB: int): uint32 =
+  ## CRC-32 of `a & b` from `crc32(a)`, `crc32(b)` and `b.len`.
+  multModP(x8nModP(lenB, Crc32X2n, Crc32Poly), crcA, Crc32Poly) xor crcB
+
+proc crc64Combine*(crcA, crcB: uint64, lenB: int): uint64 =
+  ## CRC-64/XZ of `a & b` from `crc64(a)`, `crc64(b)` and `b.len`.
+  multModP(x8nModP(lenB, Crc64X2n, Crc64Poly), crcA, Crc64Poly) xor crcB
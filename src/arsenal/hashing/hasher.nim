@@ -19,9 +19,21 @@
 ## hasher.update("hello ")
 ## hasher.update("world")
 ## let h2 = hasher.finish()
+##
+## # Batch hashing (same results as one `hash` call per key)
+## var hashes = newSeq[uint64](ids.len)
+## wyhash.hashMany(ids, hashes)
+##
+## # Container keys: the mixer is chosen from the key type at compile time
+## let a = keyHash(42'u64)          # one folded multiply
+## let b = keyHash("user:42")       # wyhash
 ## ```
 
 import std/hashes
+import ../platform/config
+
+when CompiledVectorIsa == viAVX2:
+  import ../simd/intrinsics
 
 type
   Hasher* = concept h
@@ -79,9 +91,20 @@ const
   xxh64Prime4 = 0x85EBCA77C2B2AE63'u64
   xxh64Prime5 = 0x27D4EB2F165667C5'u64
 
+# Helper: load 8 bytes at `p` as little-endian uint64
+proc loadU64LE(p: pointer): uint64 {.inline.} =
+  when cpuEndian == littleEndian:
+    copyMem(addr result, p, 8)
+  else:
+    let b = cast[ptr UncheckedArray[byte]](p)
+    for i in 0..<8:
+      result = result or (b[i].uint64 shl (i * 8))
+
 # Helper function to read 8 bytes as little-endian uint64
-proc readU64LE(data: openArray[byte], offset: int): uint64 =
-  ## Read 8 bytes as little-endian uint64.
+proc readU64LE(data: openArray[byte], offset: int): uint64 {.inline.} =
+  ## Read 8 bytes as little-endian uint64 (zero-filled past the end).
+  if offset + 8 <= data.len:
+    return loadU64LE(unsafeAddr data[offset])
   result = 0
   for i in 0..<8:
     if offset + i < data.len:
@@ -116,6 +139,35 @@ proc xxh64Avalanche(h: uint64): uint64 =
   h = h xor (h shr 32)
   return h
 
+proc xxh64Tail(h: uint64, data: openArray[byte], offset: int): uint64 {.inline.} =
+  ## Fold the bytes from `offset` to the end (fewer than 32) into `h`
+  ## and avalanche. Shared by `hash` and `hashMany`.
+  var h = h
+  var offset = offset
+  let len = data.len
+
+  # Process remaining 8-byte chunks
+  while offset + 8 <= len:
+    h = h xor xxh64Round(0, readU64LE(data, offset))
+    h = rotateLeft(h, 27) * xxh64Prime1 + xxh64Prime4
+    offset += 8
+
+  # Process remaining 4-byte chunks
+  while offset + 4 <= len:
+    let v = cast[uint32](readU64LE(data, offset))
+    h = h xor ((v.uint64) * xxh64Prime3)
+    h = rotateLeft(h, 11) * xxh64Prime1
+    offset += 4
+
+  # Process remaining 1-byte chunks
+  while offset < len:
+    h = h xor ((data[offset].uint64) * xxh64Prime5)
+    h = rotateLeft(h, 11) * xxh64Prime1
+    offset += 1
+
+  # Avalanche
+  xxh64Avalanche(h)
+
 proc hash*(_: typedesc[xxHash64], data: openArray[byte],
            seed: HashSeed = DefaultSeed): uint64 =
   ## One-shot hash of byte array using real xxHash64 algorithm.
@@ -153,31 +205,9 @@ proc hash*(_: typedesc[xxHash64], data: openArray[byte],
   else:
     h = seedVal + xxh64Prime5
 
-  # Add total length
+  # Add total length, fold in the last (< 32) bytes and avalanche
   h += len.uint64
-
-  # Process remaining 8-byte chunks
-  var offset = (len shr 5) shl 5
-  while offset + 8 <= len:
-    h = h xor xxh64Round(0, readU64LE(data, offset))
-    h = rotateLeft(h, 27) * xxh64Prime1 + xxh64Prime4
-    offset += 8
-
-  # Process remaining 4-byte chunks
-  while offset + 4 <= len:
-    let v = cast[uint32](readU64LE(data, offset))
-    h = h xor ((v.uint64) * xxh64Prime3)
-    h = rotateLeft(h, 11) * xxh64Prime1
-    offset += 4
-
-  # Process remaining 1-byte chunks
-  while offset < len:
-    h = h xor ((data[offset].uint64) * xxh64Prime5)
-    h = rotateLeft(h, 11) * xxh64Prime1
-    offset += 1
-
-  # Avalanche
-  result = xxh64Avalanche(h)
+  result = xxh64Tail(h, data, (len shr 5) shl 5)
 
 proc hash*(_: typedesc[xxHash64], data: string,
            seed: HashSeed = DefaultSeed): uint64 {.inline.} =
@@ -332,6 +362,22 @@ proc wymix(a, b: uint64): uint64 {.inline.} =
   # Using alternative: rotation and xor for good mixing
   lo xor (lo shr 32)
 
+proc wyhashShort(seed: uint64, data: openArray[byte], p, len: int): uint64 {.inline.} =
+  ## Final step for the last 0-16 bytes at `p`. `seed` is already mixed
+  ## with `WyP0`. Shared by `hash` and `hashMany`.
+  case len
+  of 0:
+    wymix(seed, WyP5)
+  of 1..8:
+    # Process up to 8 bytes
+    let remaining = readU64LE(data, p)
+    wymix(seed xor remaining, WyP5 xor len.uint64)
+  else:
+    # Process 16 bytes
+    let a = readU64LE(data, p)
+    let b = readU64LE(data, p + 8)
+    wymix(wymix(a xor WyP1, b xor seed), WyP5 xor len.uint64)
+
 proc hash*(_: typedesc[wyhash], data: openArray[byte],
            seed: HashSeed = DefaultSeed): uint64 =
   ## One-shot wyhash.
@@ -353,18 +399,8 @@ proc hash*(_: typedesc[wyhash], data: openArray[byte],
 
   # Process remaining bytes (0-63 bytes)
   case len
-  of 0:
-    result = wymix(seed, WyP5)
-  of 1..8:
-    # Process up to 8 bytes
-    let remaining = readU64LE(data, p)
-    result = wymix(seed xor remaining, WyP5 xor len.uint64)
-  of 9..16:
-    # Process 16 bytes
-    let a = readU64LE(data, p)
-    let b = readU64LE(data, p + 8)
-    seed = wymix(a xor WyP1, b xor seed)
-    result = wymix(seed, WyP5 xor len.uint64)
+  of 0..16:
+    result = wyhashShort(seed, data, p, len)
   of 17..24:
     # Process 24 bytes
     let a = readU64LE(data, p)
@@ -462,6 +498,306 @@ proc hash*(_: typedesc[fnv1a], data: openArray[byte]): uint64 =
 proc hash*(_: typedesc[fnv1a], data: string): uint64 {.inline.} =
   fnv1a.hash(data.toOpenArrayByte(0, data.len - 1))
 
+# =============================================================================
+# Fixed-Size Keys
+# =============================================================================
+#
+# Integers, pointers and small plain arrays do not need a byte-stream
+# hash. One 64x64 -> 128-bit multiply, folded by XOR of its halves, already
+# moves every input bit into every output bit. `keyHash` selects that path
+# at compile time and uses wyhash for strings and std/hashes for everything
+# else, so containers and sketches hash each key exactly once.
+#
+# Reference: O. Peters, "foldhash" (folded multiply for integer keys), 2024
+
+const
+  FoldK0 = 0x243F6A8885A308D3'u64   # Digits of pi: keeps key 0 off the zero product
+  FoldK1 = 0x9E3779B97F4A7C15'u64   # 2^64 / golden ratio (odd)
+  FoldK2 = 0x13198A2E03707344'u64
+
+proc foldedMultiply*(a, b: uint64): uint64 {.inline.} =
+  ## Low XOR high half of the full 128-bit product `a * b`.
+  when defined(gcc) or defined(clang) or defined(llvm_gcc):
+    {.emit: """
+      unsigned __int128 p = (unsigned __int128)`a` * (unsigned __int128)`b`;
+      `result` = (uint64_t)p ^ (uint64_t)(p >> 64);
+    """.}
+  else:
+    let
+      aLo = a and 0xFFFFFFFF'u64
+      aHi = a shr 32
+      bLo = b and 0xFFFFFFFF'u64
+      bHi = b shr 32
+      loLo = aLo * bLo
+      hiLo = aHi * bLo
+      loHi = aLo * bHi
+      cross = (loLo shr 32) + (hiLo and 0xFFFFFFFF'u64) + loHi
+      lo = (cross shl 32) or (loLo and 0xFFFFFFFF'u64)
+      hi = (hiLo shr 32) + (cross shr 32) + aHi * bHi
+    lo xor hi
+
+template isFixedSizeKey*(T: typedesc): bool =
+  ## True for keys that `hashFixed` handles: integers, chars, bools, enums,
+  ## raw pointers and fixed-size arrays without GC'd memory.
+  (T is SomeInteger or T is char or T is bool or T is enum or
+   T is pointer or T is ptr) or (T is array and supportsCopyMem(T))
+
+proc fixedKeyBits*[T](key: T): uint64 {.inline.} =
+  ## The bytes of a key of at most 8 bytes as one zero-extended word.
+  ## Equal keys give equal words; no mixing is applied.
+  static: assert isFixedSizeKey(T) and sizeof(T) <= 8
+  when T is pointer or T is ptr:
+    uint64(cast[uint](key))
+  else:
+    copyMem(addr result, unsafeAddr key, sizeof(T))
+
+proc hashFixed*[T](key: T, seed = 0'u64): uint64 {.inline.} =
+  ## Hash a fixed-size key with whole-word reads: one multiply up to 8
+  ## bytes, two up to 16 bytes, wyhash beyond that.
+  static: assert isFixedSizeKey(T), $T & " is not a fixed-size key"
+  when sizeof(T) <= 8:
+    foldedMultiply(fixedKeyBits(key) xor seed xor FoldK0, FoldK1)
+  elif sizeof(T) <= 16:
+    var words: array[2, uint64]
+    copyMem(addr words, unsafeAddr key, sizeof(T))
+    foldedMultiply(foldedMultiply(words[0] xor seed xor FoldK0, words[1] xor FoldK2), FoldK1)
+  else:
+    wyhash.hash(toOpenArray(cast[ptr UncheckedArray[byte]](unsafeAddr key), 0, sizeof(T) - 1),
+                HashSeed(seed))
+
+proc keyHash*[K](key: K, seed = 0'u64): uint64 {.inline.} =
+  ## 64-bit hash of any key, specialised on `K` at compile time:
+  ## - strings: wyhash
+  ## - fixed-size keys: `hashFixed`
+  ## - anything else: its std/hashes `hash`, spread over 64 bits
+  mixin hash
+  when K is string:
+    wyhash.hash(key, HashSeed(seed))
+  elif isFixedSizeKey(K):
+    hashFixed(key, seed)
+  else:
+    foldedMultiply(cast[uint64](hash(key)) xor seed xor FoldK0, FoldK1)
+
+# =============================================================================
+# Batch Hashing
+# =============================================================================
+#
+# `hashMany` hashes a whole array of keys per call. Each output equals
+# `H.hash` of the key's little-endian bytes, so batch and one-shot hashes
+# can be mixed freely (e.g. a SwissTable probe with a batch-built hash).
+#
+# One call per key spends most of its time waiting on multiply latency:
+# every step of a hash depends on the previous one. Here the per-key work
+# is straight-line code with no dependency between keys, so the CPU runs
+# several keys' multiply chains at once. With `-d:avx2`, fixed-size keys
+# go four per 256-bit register; AVX2 lacks a 64-bit multiply, so it is
+# built from three 32x32 multiplies.
+
+proc wyhashU64(s, k: uint64): uint64 {.inline.} =
+  wymix(s xor k, WyP5 xor 8)
+
+proc wyhashU32(s: uint64, k: uint32): uint64 {.inline.} =
+  wymix(s xor k.uint64, WyP5 xor 4)
+
+proc wyhash16(s, a, b: uint64): uint64 {.inline.} =
+  wymix(wymix(a xor WyP1, b xor s), WyP5 xor 16)
+
+proc xxh64Step8(h, k: uint64): uint64 {.inline.} =
+  rotateLeft(h xor xxh64Round(0, k), 27) * xxh64Prime1 + xxh64Prime4
+
+proc xxh64U64(seed, k: uint64): uint64 {.inline.} =
+  xxh64Avalanche(xxh64Step8(seed + xxh64Prime5 + 8, k))
+
+proc xxh64U32(seed: uint64, k: uint32): uint64 {.inline.} =
+  let h = (seed + xxh64Prime5 + 4) xor (k.uint64 * xxh64Prime3)
+  xxh64Avalanche(rotateLeft(h, 11) * xxh64Prime1)
+
+proc xxh6416(seed, a, b: uint64): uint64 {.inline.} =
+  xxh64Avalanche(xxh64Step8(xxh64Step8(seed + xxh64Prime5 + 16, a), b))
+
+when CompiledVectorIsa == viAVX2:
+  proc splat(x: uint64): M256i {.inline.} =
+    mm256_set1_epi64x(cast[int64](x))
+
+  proc mullo4(a, b: M256i): M256i {.inline.} =
+    ## Low 64 bits of a 64x64 product per lane:
+    ## lo(a)*lo(b) + ((hi(a)*lo(b) + lo(a)*hi(b)) shl 32)
+    let cross = mm256_add_epi64(mm256_mul_epu32(mm256_srli_epi64(a, 32), b),
+                                mm256_mul_epu32(a, mm256_srli_epi64(b, 32)))
+    mm256_add_epi64(mm256_mul_epu32(a, b), mm256_slli_epi64(cross, 32))
+
+  template rotl4(x: M256i, r: int32): M256i =
+    mm256_or_si256(mm256_slli_epi64(x, r), mm256_srli_epi64(x, 64 - r))
+
+  proc wymix4(a, b: M256i): M256i {.inline.} =
+    let lo = mullo4(a, b)
+    mm256_xor_si256(lo, mm256_srli_epi64(lo, 32))
+
+  proc xxh64Round4(k: M256i): M256i {.inline.} =
+    ## xxh64Round(0, k) per lane
+    mullo4(rotl4(mullo4(k, splat(xxh64Prime2)), 31), splat(xxh64Prime1))
+
+  proc xxh64Step84(h, k: M256i): M256i {.inline.} =
+    mm256_add_epi64(mullo4(rotl4(mm256_xor_si256(h, xxh64Round4(k)), 27),
+                           splat(xxh64Prime1)), splat(xxh64Prime4))
+
+  proc xxh64Avalanche4(h: M256i): M256i {.inline.} =
+    var h = mm256_xor_si256(h, mm256_srli_epi64(h, 33))
+    h = mullo4(h, splat(xxh64Prime2))
+    h = mm256_xor_si256(h, mm256_srli_epi64(h, 29))
+    h = mullo4(h, splat(xxh64Prime3))
+    mm256_xor_si256(h, mm256_srli_epi64(h, 32))
+
+  proc loadPairs4(p: pointer, a, b: var M256i) {.inline.} =
+    ## Split four 16-byte keys into their low (`a`) and high (`b`) words.
+    ## Lanes come out in key order 0, 2, 1, 3; see `storeReordered4`.
+    let k01 = mm256_loadu_si256(p)
+    let k23 = mm256_loadu_si256(cast[pointer](cast[int](p) + 32))
+    a = mm256_unpacklo_epi64(k01, k23)
+    b = mm256_unpackhi_epi64(k01, k23)
+
+  proc storeReordered4(p: pointer, h: M256i) {.inline.} =
+    ## Store lanes 0, 2, 1, 3 back in key order.
+    mm256_storeu_si256(p, mm256_permute4x64_epi64(h, 0xD8))
+
+template checkBatch(keys, outHashes: untyped) =
+  assert outHashes.len >= keys.len, "outHashes is shorter than keys"
+
+proc hashMany*(_: typedesc[wyhash], keys: openArray[uint64],
+               outHashes: var openArray[uint64], seed: HashSeed = DefaultSeed) =
+  ## Hash each key's 8 little-endian bytes into `outHashes[i]`.
+  checkBatch(keys, outHashes)
+  let s = seed.uint64 xor WyP0
+  var i = 0
+  when CompiledVectorIsa == viAVX2:
+    let vs = splat(s)
+    let vm = splat(WyP5 xor 8)
+    while i + 4 <= keys.len:
+      let k = mm256_loadu_si256(unsafeAddr keys[i])
+      mm256_storeu_si256(addr outHashes[i], wymix4(mm256_xor_si256(k, vs), vm))
+      i += 4
+  while i < keys.len:
+    outHashes[i] = wyhashU64(s, keys[i])
+    inc i
+
+proc hashMany*(_: typedesc[wyhash], keys: openArray[uint32],
+               outHashes: var openArray[uint64], seed: HashSeed = DefaultSeed) =
+  ## Hash each key's 4 little-endian bytes into `outHashes[i]`.
+  checkBatch(keys, outHashes)
+  let s = seed.uint64 xor WyP0
+  var i = 0
+  when CompiledVectorIsa == viAVX2:
+    let vs = splat(s)
+    let vm = splat(WyP5 xor 4)
+    while i + 4 <= keys.len:
+      let k = mm256_cvtepu32_epi64(mm_loadu_si128(unsafeAddr keys[i]))
+      mm256_storeu_si256(addr outHashes[i], wymix4(mm256_xor_si256(k, vs), vm))
+      i += 4
+  while i < keys.len:
+    outHashes[i] = wyhashU32(s, keys[i])
+    inc i
+
+proc hashMany*(_: typedesc[wyhash], keys: openArray[array[16, byte]],
+               outHashes: var openArray[uint64], seed: HashSeed = DefaultSeed) =
+  ## Hash 16-byte keys (UUIDs, IPv6 addresses, 128-bit ids).
+  checkBatch(keys, outHashes)
+  let s = seed.uint64 xor WyP0
+  var i = 0
+  when CompiledVectorIsa == viAVX2:
+    let vs = splat(s)
+    let vp1 = splat(WyP1)
+    let vm = splat(WyP5 xor 16)
+    while i + 4 <= keys.len:
+      var a, b: M256i
+      loadPairs4(unsafeAddr keys[i], a, b)
+      let mixed = wymix4(mm256_xor_si256(a, vp1), mm256_xor_si256(b, vs))
+      storeReordered4(addr outHashes[i], wymix4(mixed, vm))
+      i += 4
+  while i < keys.len:
+    outHashes[i] = wyhash16(s, loadU64LE(unsafeAddr keys[i][0]),
+                            loadU64LE(unsafeAddr keys[i][8]))
+    inc i
+
+proc hashMany*(_: typedesc[wyhash], keys: openArray[string],
+               outHashes: var openArray[uint64], seed: HashSeed = DefaultSeed) =
+  ## Hash strings. Keys up to 16 bytes take an inlined path; longer keys
+  ## fall back to `wyhash.hash`.
+  checkBatch(keys, outHashes)
+  let s = seed.uint64 xor WyP0
+  for i in 0 ..< keys.len:
+    let len = keys[i].len
+    outHashes[i] =
+      if len <= 16: wyhashShort(s, keys[i].toOpenArrayByte(0, len - 1), 0, len)
+      else: wyhash.hash(keys[i], seed)
+
+proc hashMany*(_: typedesc[xxHash64], keys: openArray[uint64],
+               outHashes: var openArray[uint64], seed: HashSeed = DefaultSeed) =
+  ## Hash each key's 8 little-endian bytes into `outHashes[i]`.
+  checkBatch(keys, outHashes)
+  let s = seed.uint64
+  var i = 0
+  when CompiledVectorIsa == viAVX2:
+    let h0 = splat(s + xxh64Prime5 + 8)
+    while i + 4 <= keys.len:
+      let k = mm256_loadu_si256(unsafeAddr keys[i])
+      mm256_storeu_si256(addr outHashes[i], xxh64Avalanche4(xxh64Step84(h0, k)))
+      i += 4
+  while i < keys.len:
+    outHashes[i] = xxh64U64(s, keys[i])
+    inc i
+
+proc hashMany*(_: typedesc[xxHash64], keys: openArray[uint32],
+               outHashes: var openArray[uint64], seed: HashSeed = DefaultSeed) =
+  ## Hash each key's 4 little-endian bytes into `outHashes[i]`.
+  checkBatch(keys, outHashes)
+  let s = seed.uint64
+  var i = 0
+  when CompiledVectorIsa == viAVX2:
+    let h0 = splat(s + xxh64Prime5 + 4)
+    let vp3 = splat(xxh64Prime3)
+    let vp1 = splat(xxh64Prime1)
+    while i + 4 <= keys.len:
+      let k = mm256_cvtepu32_epi64(mm_loadu_si128(unsafeAddr keys[i]))
+      let h = mm256_xor_si256(h0, mullo4(k, vp3))
+      mm256_storeu_si256(addr outHashes[i], xxh64Avalanche4(mullo4(rotl4(h, 11), vp1)))
+      i += 4
+  while i < keys.len:
+    outHashes[i] = xxh64U32(s, keys[i])
+    inc i
+
+proc hashMany*(_: typedesc[xxHash64], keys: openArray[array[16, byte]],
+               outHashes: var openArray[uint64], seed: HashSeed = DefaultSeed) =
+  ## Hash 16-byte keys (UUIDs, IPv6 addresses, 128-bit ids).
+  checkBatch(keys, outHashes)
+  let s = seed.uint64
+  var i = 0
+  when CompiledVectorIsa == viAVX2:
+    let h0 = splat(s + xxh64Prime5 + 16)
+    while i + 4 <= keys.len:
+      var a, b: M256i
+      loadPairs4(unsafeAddr keys[i], a, b)
+      storeReordered4(addr outHashes[i],
+                      xxh64Avalanche4(xxh64Step84(xxh64Step84(h0, a), b)))
+      i += 4
+  while i < keys.len:
+    outHashes[i] = xxh6416(s, loadU64LE(unsafeAddr keys[i][0]),
+                           loadU64LE(unsafeAddr keys[i][8]))
+    inc i
+
+proc hashMany*(_: typedesc[xxHash64], keys: openArray[string],
+               outHashes: var openArray[uint64], seed: HashSeed = DefaultSeed) =
+  ## Hash strings. Keys under 32 bytes take an inlined path; longer keys
+  ## fall back to `xxHash64.hash`.
+  checkBatch(keys, outHashes)
+  let s = seed.uint64
+  for i in 0 ..< keys.len:
+    let len = keys[i].len
+    outHashes[i] =
+      if len < 32:
+        xxh64Tail(s + xxh64Prime5 + len.uint64, keys[i].toOpenArrayByte(0, len - 1), 0)
+      else:
+        xxHash64.hash(keys[i], seed)
+
 # =============================================================================
 # Nim std/hashes Compatibility
 # =============================================================================
@@ -0,0 +1,705 @@
+## XXH3 Implementation
+## ===================
+##
+## Pure Nim implementation of XXH3 (xxHash v0.8), 64- and 128-bit variants,
+## bit-compatible with the reference `XXH3_64bits_withSeed` and
+## `XXH3_128bits_withSeed`.
+##
+## Inputs up to 240 bytes take dedicated scalar paths (a few multiplies).
+## Longer inputs run eight 64-bit accumulators over 64-byte stripes; that
+## loop is vectorised with SSE2 (x86_64 baseline), AVX2 (`-d:avx2`) or
+## NEON (ARM64), and reaches memory bandwidth on multi-MB inputs.
+##
+## `Xxh3` conforms to the `Hasher` concept. `Xxh3_128` has the same API
+## but returns a `Hash128`.
+##
+## Usage:
+## ```nim
+## let h = Xxh3.hash("hello world")              # 0xD447B1EA40E6988B
+## let h128 = Xxh3_128.hash(fileBytes)           # Hash128(lo, hi)
+##
+## # Streaming: same result as one-shot over the concatenated input
+## var state = Xxh3.init()
+## for chunk in chunks:
+##   state.update(chunk)
+## let digest = state.finish()
+## ```
+##
+## Reference: https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+
+import ../hasher
+import ../../platform/config
+
+when CompiledVectorIsa in {viSSE2, viAVX2, viNEON}:
+  import ../../simd/intrinsics
+
+export HashSeed, DefaultSeed
+
+const
+  SecretSize = 192
+  StripeLen = 64
+  SecretConsumeRate = 8
+  AccCount = 8
+  StripesPerBlock = (SecretSize - StripeLen) div SecretConsumeRate  # 16
+  BlockLen = StripeLen * StripesPerBlock                            # 1024
+  MidSizeMax = 240
+  MidSizeStartOffset = 3
+  MidSizeLastOffset = 17
+  SecretSizeMin = 136
+  SecretLastAccStart = 7
+  SecretMergeAccsStart = 11
+  InternalBufferSize = 256
+
+  XXH_PRIME32_1 = 0x9E3779B1'u64
+  XXH_PRIME32_2 = 0x85EBCA77'u64
+  XXH_PRIME32_3 = 0xC2B2AE3D'u64
+  XXH_PRIME64_1 = 0x9E3779B185EBCA87'u64
+  XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4F'u64
+  XXH_PRIME64_3 = 0x165667B19E3779F9'u64
+  XXH_PRIME64_4 = 0x85EBCA77C2B2AE63'u64
+  XXH_PRIME64_5 = 0x27D4EB2F165667C5'u64
+  XXH_PRIME_MX1 = 0x165667919E3779F9'u64
+  XXH_PRIME_MX2 = 0x9FB21C651E98DF25'u64
+
+  DefaultSecret: array[SecretSize, byte] = [
+    0xb8'u8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+  ]
+
+  InitAcc: array[AccCount, uint64] = [
+    XXH_PRIME32_3, XXH_PRIME64_1, XXH_PRIME64_2, XXH_PRIME64_3,
+    XXH_PRIME64_4, XXH_PRIME32_2, XXH_PRIME64_5, XXH_PRIME32_1
+  ]
+
+# Addressable copy of the default secret for the pointer-based code below
+let kSecret = DefaultSecret
+
+type
+  Xxh3* = object
+    ## XXH3 64-bit hasher type.
+
+  Xxh3_128* = object
+    ## XXH3 128-bit hasher type. Lower collision probability than `Xxh3`
+    ## for content-addressing and deduplication.
+
+  Hash128* = object
+    ## 128-bit hash value (`hi` is the more significant half).
+    lo*, hi*: uint64
+
+  Xxh3State* = object
+    ## Incremental hashing state for XXH3 (64- and 128-bit).
+    acc: array[AccCount, uint64]
+    secret: array[SecretSize, byte]          # Default secret, or derived from the seed
+    buffer: array[InternalBufferSize, byte]  # Unconsumed input (always >= 1 byte once started)
+    bufferSize: int
+    stripesSoFar: int                        # Stripes consumed in the current block
+    totalLen: uint64
+    seed: uint64
+
+  Xxh3_128State* = object
+    ## Incremental hashing state for XXH3-128.
+    inner: Xxh3State
+
+  Bytes = ptr UncheckedArray[byte]
+
+# =============================================================================
+# Utility Functions
+# =============================================================================
+
+template at(p: Bytes, offset: int): Bytes =
+  cast[Bytes](addr p[offset])
+
+proc read64(p: Bytes, offset: int): uint64 {.inline.} =
+  ## Read 8 bytes as little-endian uint64.
+  when cpuEndian == littleEndian:
+    copyMem(addr result, addr p[offset], 8)
+  else:
+    for i in 0..<8:
+      result = result or (p[offset + i].uint64 shl (i * 8))
+
+proc read32(p: Bytes, offset: int): uint64 {.inline.} =
+  ## Read 4 bytes as little-endian uint32 (widened).
+  when cpuEndian == littleEndian:
+    var v: uint32
+    copyMem(addr v, addr p[offset], 4)
+    v.uint64
+  else:
+    for i in 0..<4:
+      result = result or (p[offset + i].uint64 shl (i * 8))
+
+proc write64(p: var array[SecretSize, byte], offset: int, v: uint64) {.inline.} =
+  for i in 0..<8:
+    p[offset + i] = byte((v shr (i * 8)) and 0xFF)
+
+proc swap32(x: uint64): uint64 {.inline.} =
+  ## Byte-swap the low 32 bits.
+  ((x and 0xFF) shl 24) or ((x and 0xFF00) shl 8) or
+    ((x shr 8) and 0xFF00) or ((x shr 24) and 0xFF)
+
+proc swap64(x: uint64): uint64 {.inline.} =
+  var x = x
+  x = ((x and 0x00FF00FF00FF00FF'u64) shl 8) or ((x shr 8) and 0x00FF00FF00FF00FF'u64)
+  x = ((x and 0x0000FFFF0000FFFF'u64) shl 16) or ((x shr 16) and 0x0000FFFF0000FFFF'u64)
+  (x shl 32) or (x shr 32)
+
+proc rotl64(x: uint64, r: int): uint64 {.inline.} =
+  (x shl r) or (x shr (64 - r))
+
+proc rotl32(x: uint64, r: int): uint64 {.inline.} =
+  ((x shl r) or (x shr (32 - r))) and 0xFFFFFFFF'u64
+
+proc mul128(a, b: uint64): Hash128 {.inline.} =
+  ## Full 64x64 -> 128-bit product.
+  when defined(gcc) or defined(clang) or defined(llvm_gcc):
+    var lo, hi: uint64
+    {.emit: """
+      unsigned __int128 p = (unsigned __int128)`a` * (unsigned __int128)`b`;
+      `lo` = (uint64_t)p;
+      `hi` = (uint64_t)(p >> 64);
+    """.}
+    Hash128(lo: lo, hi: hi)
+  else:
+    let
+      aLo = a and 0xFFFFFFFF'u64
+      aHi = a shr 32
+      bLo = b and 0xFFFFFFFF'u64
+      bHi = b shr 32
+      loLo = aLo * bLo
+      hiLo = aHi * bLo
+      loHi = aLo * bHi
+      hiHi = aHi * bHi
+      cross = (loLo shr 32) + (hiLo and 0xFFFFFFFF'u64) + loHi
+    Hash128(lo: (cross shl 32) or (loLo and 0xFFFFFFFF'u64),
+            hi: (hiLo shr 32) + (cross shr 32) + hiHi)
+
+proc mulFold64(a, b: uint64): uint64 {.inline.} =
+  ## 128-bit product folded to 64 bits (lo xor hi).
+  let p = mul128(a, b)
+  p.lo xor p.hi
+
+proc xxh64Avalanche(h: uint64): uint64 {.inline.} =
+  var h = h
+  h = h xor (h shr 33)
+  h *= XXH_PRIME64_2
+  h = h xor (h shr 29)
+  h *= XXH_PRIME64_3
+  h xor (h shr 32)
+
+proc avalanche(h: uint64): uint64 {.inline.} =
+  ## XXH3 final mix (cheaper than the XXH64 avalanche).
+  var h = h xor (h shr 37)
+  h *= XXH_PRIME_MX1
+  h xor (h shr 32)
+
+proc rrmxmx(h: uint64, len: int): uint64 {.inline.} =
+  ## Stronger final mix used for 4-8 byte inputs.
+  var h = h xor (rotl64(h, 49) xor rotl64(h, 24))
+  h *= XXH_PRIME_MX2
+  h = h xor ((h shr 35) + len.uint64)
+  h *= XXH_PRIME_MX2
+  h xor (h shr 28)
+
+proc mix16B(p: Bytes, secret: Bytes, seed: uint64): uint64 {.inline.} =
+  mulFold64(read64(p, 0) xor (read64(secret, 0) + seed),
+            read64(p, 8) xor (read64(secret, 8) - seed))
+
+proc deriveSecret(seed: uint64, secret: var array[SecretSize, byte]) =
+  ## Seeded secret for long inputs: default secret +/- seed per 16 bytes.
+  let k = cast[Bytes](unsafeAddr kSecret[0])
+  for i in 0 ..< SecretSize div 16:
+    secret.write64(16 * i, read64(k, 16 * i) + seed)
+    secret.write64(16 * i + 8, read64(k, 16 * i + 8) - seed)
+
+# =============================================================================
+# Stripe Accumulation (SIMD)
+# =============================================================================
+#
+# Each 64-byte stripe updates the eight accumulators as
+#   acc[i xor 1] += data[i]
+#   acc[i] += lo32(data[i] xor key[i]) * hi32(data[i] xor key[i])
+# and every 1024 bytes `scramble` re-mixes them with the secret. Both are
+# 32x32->64 multiplies and 64-bit adds, which every vector ISA has.
+
+type Acc = array[AccCount, uint64]
+
+when CompiledVectorIsa == viAVX2:
+  proc accumulate(acc: var Acc, input, secret: Bytes, nbStripes: int) {.inline.} =
+    ## Accumulate `nbStripes` stripes; the secret advances 8 bytes per stripe.
+    var a0 = mm256_loadu_si256(addr acc[0])
+    var a1 = mm256_loadu_si256(addr acc[4])
+    for s in 0 ..< nbStripes:
+      let inp = at(input, s * StripeLen)
+      let sec = at(secret, s * SecretConsumeRate)
+      let d0 = mm256_loadu_si256(inp)
+      let d1 = mm256_loadu_si256(at(inp, 32))
+      let k0 = mm256_xor_si256(d0, mm256_loadu_si256(sec))
+      let k1 = mm256_xor_si256(d1, mm256_loadu_si256(at(sec, 32)))
+      # lo32 * hi32 of each lane; 0x31 moves the high half down
+      let p0 = mm256_mul_epu32(k0, mm256_shuffle_epi32(k0, 0x31))
+      let p1 = mm256_mul_epu32(k1, mm256_shuffle_epi32(k1, 0x31))
+      # 0x4E swaps the 64-bit lanes within each 128-bit half (i xor 1)
+      a0 = mm256_add_epi64(p0, mm256_add_epi64(a0, mm256_shuffle_epi32(d0, 0x4E)))
+      a1 = mm256_add_epi64(p1, mm256_add_epi64(a1, mm256_shuffle_epi32(d1, 0x4E)))
+    mm256_storeu_si256(addr acc[0], a0)
+    mm256_storeu_si256(addr acc[4], a1)
+
+  proc scramble(acc: var Acc, secret: Bytes) {.inline.} =
+    let prime = mm256_set1_epi64x(XXH_PRIME32_1.int64)
+    for i in 0 ..< 2:
+      var a = mm256_loadu_si256(addr acc[4 * i])
+      a = mm256_xor_si256(a, mm256_srli_epi64(a, 47))
+      let k = mm256_xor_si256(a, mm256_loadu_si256(at(secret, 32 * i)))
+      let lo = mm256_mul_epu32(k, prime)
+      let hi = mm256_mul_epu32(mm256_shuffle_epi32(k, 0x31), prime)
+      mm256_storeu_si256(addr acc[4 * i], mm256_add_epi64(lo, mm256_slli_epi64(hi, 32)))
+
+elif CompiledVectorIsa == viSSE2:
+  proc accumulate(acc: var Acc, input, secret: Bytes, nbStripes: int) {.inline.} =
+    ## Accumulate `nbStripes` stripes; the secret advances 8 bytes per stripe.
+    var a: array[4, M128i]
+    for i in 0 ..< 4:
+      a[i] = mm_loadu_si128(addr acc[2 * i])
+    for s in 0 ..< nbStripes:
+      let inp = at(input, s * StripeLen)
+      let sec = at(secret, s * SecretConsumeRate)
+      for i in 0 ..< 4:
+        let d = mm_loadu_si128(at(inp, 16 * i))
+        let k = mm_xor_si128(d, mm_loadu_si128(at(sec, 16 * i)))
+        let p = mm_mul_epu32(k, mm_shuffle_epi32(k, 0x31))
+        a[i] = mm_add_epi64(p, mm_add_epi64(a[i], mm_shuffle_epi32(d, 0x4E)))
+    for i in 0 ..< 4:
+      mm_storeu_si128(addr acc[2 * i], a[i])
+
+  proc scramble(acc: var Acc, secret: Bytes) {.inline.} =
+    let prime = mm_set1_epi32(cast[int32](XXH_PRIME32_1.uint32))
+    for i in 0 ..< 4:
+      var a = mm_loadu_si128(addr acc[2 * i])
+      a = mm_xor_si128(a, mm_srli_epi64(a, 47))
+      let k = mm_xor_si128(a, mm_loadu_si128(at(secret, 16 * i)))
+      let lo = mm_mul_epu32(k, prime)
+      let hi = mm_mul_epu32(mm_shuffle_epi32(k, 0x31), prime)
+      mm_storeu_si128(addr acc[2 * i], mm_add_epi64(lo, mm_slli_epi64(hi, 32)))
+
+elif CompiledVectorIsa == viNEON:
+  proc accumulate(acc: var Acc, input, secret: Bytes, nbStripes: int) {.inline.} =
+    ## Accumulate `nbStripes` stripes; the secret advances 8 bytes per stripe.
+    var a: array[4, Uint64x2]
+    for i in 0 ..< 4:
+      a[i] = vld1q_u64(addr acc[2 * i])
+    for s in 0 ..< nbStripes:
+      let inp = at(input, s * StripeLen)
+      let sec = at(secret, s * SecretConsumeRate)
+      for i in 0 ..< 4:
+        let d = vld1q_u64(at(inp, 16 * i))
+        let k = veorq_u64(d, vld1q_u64(at(sec, 16 * i)))
+        let sum = vaddq_u64(a[i], vextq_u64(d, d, 1))
+        a[i] = vmlal_u32(sum, vmovn_u64(k), vshrn_n_u64(k, 32))
+    for i in 0 ..< 4:
+      vst1q_u64(addr acc[2 * i], a[i])
+
+  proc scramble(acc: var Acc, secret: Bytes) {.inline.} =
+    let prime = vdup_n_u32(XXH_PRIME32_1.uint32)
+    for i in 0 ..< 4:
+      var a = vld1q_u64(addr acc[2 * i])
+      a = veorq_u64(a, vshrq_n_u64(a, 47))
+      let k = veorq_u64(a, vld1q_u64(at(secret, 16 * i)))
+      let hi = vshlq_n_u64(vmull_u32(vshrn_n_u64(k, 32), prime), 32)
+      vst1q_u64(addr acc[2 * i], vmlal_u32(hi, vmovn_u64(k), prime))
+
+else:
+  proc accumulate(acc: var Acc, input, secret: Bytes, nbStripes: int) {.inline.} =
+    ## Accumulate `nbStripes` stripes; the secret advances 8 bytes per stripe.
+    for s in 0 ..< nbStripes:
+      let inp = at(input, s * StripeLen)
+      let sec = at(secret, s * SecretConsumeRate)
+      for i in 0 ..< AccCount:
+        let d = read64(inp, 8 * i)
+        let k = d xor read64(sec, 8 * i)
+        acc[i xor 1] += d
+        acc[i] += (k and 0xFFFFFFFF'u64) * (k shr 32)
+
+  proc scramble(acc: var Acc, secret: Bytes) {.inline.} =
+    for i in 0 ..< AccCount:
+      var a = acc[i]
+      a = a xor (a shr 47)
+      a = a xor read64(secret, 8 * i)
+      acc[i] = a * XXH_PRIME32_1
+
+proc mergeAccs(acc: Acc, secret: Bytes, start: uint64): uint64 =
+  result = start
+  for i in 0 ..< 4:
+    result += mulFold64(acc[2 * i] xor read64(secret, 16 * i),
+                        acc[2 * i + 1] xor read64(secret, 16 * i + 8))
+  result = avalanche(result)
+
+proc hashLongAcc(p: Bytes, len: int, secret: Bytes): Acc =
+  ## Accumulators after consuming a whole input longer than 240 bytes.
+  result = InitAcc
+  let nbBlocks = (len - 1) div BlockLen
+  for n in 0 ..< nbBlocks:
+    accumulate(result, at(p, n * BlockLen), secret, StripesPerBlock)
+    scramble(result, at(secret, SecretSize - StripeLen))
+  # Last partial block, then the last stripe (which may overlap it)
+  let nbStripes = ((len - 1) - BlockLen * nbBlocks) div StripeLen
+  accumulate(result, at(p, nbBlocks * BlockLen), secret, nbStripes)
+  accumulate(result, at(p, len - StripeLen),
+             at(secret, SecretSize - StripeLen - SecretLastAccStart), 1)
+
+# =============================================================================
+# XXH3-64 (One-shot)
+# =============================================================================
+
+proc len1to3_64(p: Bytes, len: int, secret: Bytes, seed: uint64): uint64 {.inline.} =
+  let combined = (p[0].uint64 shl 16) or (p[len shr 1].uint64 shl 24) or
+                 p[len - 1].uint64 or (len.uint64 shl 8)
+  let bitflip = (read32(secret, 0) xor read32(secret, 4)) + seed
+  xxh64Avalanche(combined xor bitflip)
+
+proc len4to8_64(p: Bytes, len: int, secret: Bytes, seed: uint64): uint64 {.inline.} =
+  let seed = seed xor (swap32(seed and 0xFFFFFFFF'u64) shl 32)
+  let input1 = read32(p, 0)
+  let input2 = read32(p, len - 4)
+  let bitflip = (read64(secret, 8) xor read64(secret, 16)) - seed
+  rrmxmx((input2 + (input1 shl 32)) xor bitflip, len)
+
+proc len9to16_64(p: Bytes, len: int, secret: Bytes, seed: uint64): uint64 {.inline.} =
+  let bitflip1 = (read64(secret, 24) xor read64(secret, 32)) + seed
+  let bitflip2 = (read64(secret, 40) xor read64(secret, 48)) - seed
+  let inputLo = read64(p, 0) xor bitflip1
+  let inputHi = read64(p, len - 8) xor bitflip2
+  avalanche(len.uint64 + swap64(inputLo) + inputHi + mulFold64(inputLo, inputHi))
+
+proc len0to16_64(p: Bytes, len: int, secret: Bytes, seed: uint64): uint64 {.inline.} =
+  if len > 8: len9to16_64(p, len, secret, seed)
+  elif len >= 4: len4to8_64(p, len, secret, seed)
+  elif len > 0: len1to3_64(p, len, secret, seed)
+  else: xxh64Avalanche(seed xor (read64(secret, 56) xor read64(secret, 64)))
+
+proc len17to128_64(p: Bytes, len: int, secret: Bytes, seed: uint64): uint64 =
+  var acc = len.uint64 * XXH_PRIME64_1
+  if len > 32:
+    if len > 64:
+      if len > 96:
+        acc += mix16B(at(p, 48), at(secret, 96), seed)
+        acc += mix16B(at(p, len - 64), at(secret, 112), seed)
+      acc += mix16B(at(p, 32), at(secret, 64), seed)
+      acc += mix16B(at(p, len - 48), at(secret, 80), seed)
+    acc += mix16B(at(p, 16), at(secret, 32), seed)
+    acc += mix16B(at(p, len - 32), at(secret, 48), seed)
+  acc += mix16B(p, secret, seed)
+  acc += mix16B(at(p, len - 16), at(secret, 16), seed)
+  avalanche(acc)
+
+proc len129to240_64(p: Bytes, len: int, secret: Bytes, seed: uint64): uint64 =
+  var acc = len.uint64 * XXH_PRIME64_1
+  for i in 0 ..< 8:
+    acc += mix16B(at(p, 16 * i), at(secret, 16 * i), seed)
+  acc = avalanche(acc)
+  for i in 8 ..< len div 16:
+    acc += mix16B(at(p, 16 * i), at(secret, 16 * (i - 8) + MidSizeStartOffset), seed)
+  acc += mix16B(at(p, len - 16), at(secret, SecretSizeMin - MidSizeLastOffset), seed)
+  avalanche(acc)
+
+proc hash64(p: Bytes, len: int, seed: uint64): uint64 =
+  let k = cast[Bytes](unsafeAddr kSecret[0])
+  if len <= 16:
+    len0to16_64(p, len, k, seed)
+  elif len <= 128:
+    len17to128_64(p, len, k, seed)
+  elif len <= MidSizeMax:
+    len129to240_64(p, len, k, seed)
+  elif seed == 0:
+    mergeAccs(hashLongAcc(p, len, k), at(k, SecretMergeAccsStart),
+              len.uint64 * XXH_PRIME64_1)
+  else:
+    var secret {.noinit.}: array[SecretSize, byte]
+    deriveSecret(seed, secret)
+    let s = cast[Bytes](addr secret[0])
+    mergeAccs(hashLongAcc(p, len, s), at(s, SecretMergeAccsStart),
+              len.uint64 * XXH_PRIME64_1)
+
+proc hash*(hasher: typedesc[Xxh3], data: openArray[byte],
+           seed: HashSeed = DefaultSeed): uint64 =
+  ## Compute the XXH3 64-bit hash of data in one pass.
+  let p = if data.len > 0: cast[Bytes](unsafeAddr data[0]) else: nil
+  hash64(p, data.len, seed.uint64)
+
+proc hash*(hasher: typedesc[Xxh3], s: string,
+           seed: HashSeed = DefaultSeed): uint64 {.inline.} =
+  ## Hash a string.
+  Xxh3.hash(s.toOpenArrayByte(0, s.len - 1), seed)
+
+# =============================================================================
+# XXH3-128 (One-shot)
+# =============================================================================
+
+proc len1to3_128(p: Bytes, len: int, secret: Bytes, seed: uint64): Hash128 {.inline.} =
+  let combinedLo = (p[0].uint64 shl 16) or (p[len shr 1].uint64 shl 24) or
+                   p[len - 1].uint64 or (len.uint64 shl 8)
+  let combinedHi = rotl32(swap32(combinedLo), 13)
+  let bitflipLo = (read32(secret, 0) xor read32(secret, 4)) + seed
+  let bitflipHi = (read32(secret, 8) xor read32(secret, 12)) - seed
+  Hash128(lo: xxh64Avalanche(combinedLo xor bitflipLo),
+          hi: xxh64Avalanche(combinedHi xor bitflipHi))
+
+proc len4to8_128(p: Bytes, len: int, secret: Bytes, seed: uint64): Hash128 {.inline.} =
+  let seed = seed xor (swap32(seed and 0xFFFFFFFF'u64) shl 32)
+  let input64 = read32(p, 0) + (read32(p, len - 4) shl 32)
+  let bitflip = (read64(secret, 16) xor read64(secret, 24)) + seed
+  var m = mul128(input64 xor bitflip, XXH_PRIME64_1 + (len.uint64 shl 2))
+  m.hi += m.lo shl 1
+  m.lo = m.lo xor (m.hi shr 3)
+  m.lo = m.lo xor (m.lo shr 35)
+  m.lo *= XXH_PRIME_MX2
+  m.lo = m.lo xor (m.lo shr 28)
+  Hash128(lo: m.lo, hi: avalanche(m.hi))
+
+proc len9to16_128(p: Bytes, len: int, secret: Bytes, seed: uint64): Hash128 {.inline.} =
+  let bitflipLo = (read64(secret, 32) xor read64(secret, 40)) - seed
+  let bitflipHi = (read64(secret, 48) xor read64(secret, 56)) + seed
+  let inputLo = read64(p, 0)
+  var inputHi = read64(p, len - 8)
+  var m = mul128(inputLo xor inputHi xor bitflipLo, XXH_PRIME64_1)
+  m.lo += (len - 1).uint64 shl 54
+  inputHi = inputHi xor bitflipHi
+  m.hi += inputHi + (inputHi and 0xFFFFFFFF'u64) * (XXH_PRIME32_2 - 1)
+  m.lo = m.lo xor swap64(m.hi)
+  var h = mul128(m.lo, XXH_PRIME64_2)
+  h.hi += m.hi * XXH_PRIME64_2
+  Hash128(lo: avalanche(h.lo), hi: avalanche(h.hi))
+
+proc len0to16_128(p: Bytes, len: int, secret: Bytes, seed: uint64): Hash128 {.inline.} =
+  if len > 8: len9to16_128(p, len, secret, seed)
+  elif len >= 4: len4to8_128(p, len, secret, seed)
+  elif len > 0: len1to3_128(p, len, secret, seed)
+  else:
+    Hash128(lo: xxh64Avalanche(seed xor read64(secret, 64) xor read64(secret, 72)),
+            hi: xxh64Avalanche(seed xor read64(secret, 80) xor read64(secret, 88)))
+
+proc mix32B(acc: var Hash128, in1, in2, secret: Bytes, seed: uint64) {.inline.} =
+  acc.lo += mix16B(in1, secret, seed)
+  acc.lo = acc.lo xor (read64(in2, 0) + read64(in2, 8))
+  acc.hi += mix16B(in2, at(secret, 16), seed)
+  acc.hi = acc.hi xor (read64(in1, 0) + read64(in1, 8))
+
+proc finish128(acc: Hash128, len: int, seed: uint64): Hash128 {.inline.} =
+  let lo = acc.lo + acc.hi
+  let hi = acc.lo * XXH_PRIME64_1 + acc.hi * XXH_PRIME64_4 +
+           (len.uint64 - seed) * XXH_PRIME64_2
+  Hash128(lo: avalanche(lo), hi: 0'u64 - avalanche(hi))
+
+proc len17to128_128(p: Bytes, len: int, secret: Bytes, seed: uint64): Hash128 =
+  var acc = Hash128(lo: len.uint64 * XXH_PRIME64_1, hi: 0)
+  if len > 32:
+    if len > 64:
+      if len > 96:
+        mix32B(acc, at(p, 48), at(p, len - 64), at(secret, 96), seed)
+      mix32B(acc, at(p, 32), at(p, len - 48), at(secret, 64), seed)
+    mix32B(acc, at(p, 16), at(p, len - 32), at(secret, 32), seed)
+  mix32B(acc, p, at(p, len - 16), secret, seed)
+  finish128(acc, len, seed)
+
+proc len129to240_128(p: Bytes, len: int, secret: Bytes, seed: uint64): Hash128 =
+  var acc = Hash128(lo: len.uint64 * XXH_PRIME64_1, hi: 0)
+  for i in 0 ..< 4:
+    mix32B(acc, at(p, 32 * i), at(p, 32 * i + 16), at(secret, 32 * i), seed)
+  acc.lo = avalanche(acc.lo)
+  acc.hi = avalanche(acc.hi)
+  for i in 4 ..< len div 32:
+    mix32B(acc, at(p, 32 * i), at(p, 32 * i + 16),
+           at(secret, MidSizeStartOffset + 32 * (i - 4)), seed)
+  # Last 32 bytes, halves swapped and seed negated
+  mix32B(acc, at(p, len - 16), at(p, len - 32),
+         at(secret, SecretSizeMin - MidSizeLastOffset - 16), 0'u64 - seed)
+  finish128(acc, len, seed)
+
+proc mergeLong128(acc: Acc, secret: Bytes, len: uint64): Hash128 {.inline.} =
+  Hash128(lo: mergeAccs(acc, at(secret, SecretMergeAccsStart), len * XXH_PRIME64_1),
+          hi: mergeAccs(acc, at(secret, SecretSize - StripeLen - SecretMergeAccsStart),
+                        not (len * XXH_PRIME64_2)))
+
+proc hash128(p: Bytes, len: int, seed: uint64): Hash128 =
+  let k = cast[Bytes](unsafeAddr kSecret[0])
+  if len <= 16:
+    len0to16_128(p, len, k, seed)
+  elif len <= 128:
+    len17to128_128(p, len, k, seed)
+  elif len <= MidSizeMax:
+    len129to240_128(p, len, k, seed)
+  elif seed == 0:
+    mergeLong128(hashLongAcc(p, len, k), k, len.uint64)
+  else:
+    var secret {.noinit.}: array[SecretSize, byte]
+    deriveSecret(seed, secret)
+    let s = cast[Bytes](addr secret[0])
+    mergeLong128(hashLongAcc(p, len, s), s, len.uint64)
+
+proc hash*(hasher: typedesc[Xxh3_128], data: openArray[byte],
+           seed: HashSeed = DefaultSeed): Hash128 =
+  ## Compute the XXH3 128-bit hash of data in one pass.
+  let p = if data.len > 0: cast[Bytes](unsafeAddr data[0]) else: nil
+  hash128(p, data.len, seed.uint64)
+
+proc hash*(hasher: typedesc[Xxh3_128], s: string,
+           seed: HashSeed = DefaultSeed): Hash128 {.inline.} =
+  ## Hash a string.
+  Xxh3_128.hash(s.toOpenArrayByte(0, s.len - 1), seed)
+
+# =============================================================================
+# Incremental Hashing
+# =============================================================================
+
+proc initState(seed: uint64): Xxh3State =
+  result.acc = InitAcc
+  result.seed = seed
+  if seed == 0:
+    result.secret = DefaultSecret
+  else:
+    deriveSecret(seed, result.secret)
+
+proc consumeStripes(acc: var Acc, stripesSoFar: var int, secret: Bytes,
+                    input: Bytes, nbStripes: int) =
+  ## Accumulate stripes, scrambling at every block boundary.
+  var p = input
+  var remaining = nbStripes
+  while remaining > 0:
+    let n = min(remaining, StripesPerBlock - stripesSoFar)
+    accumulate(acc, p, at(secret, stripesSoFar * SecretConsumeRate), n)
+    p = at(p, n * StripeLen)
+    remaining -= n
+    stripesSoFar += n
+    if stripesSoFar == StripesPerBlock:
+      scramble(acc, at(secret, SecretSize - StripeLen))
+      stripesSoFar = 0
+
+proc update*(state: var Xxh3State, data: openArray[byte]) =
+  ## Add data to the hash computation.
+  ##
+  ## Input is buffered up to 256 bytes; beyond that whole stripes are
+  ## consumed straight from `data`. The last stripe is always kept back
+  ## so `finish` can treat it like the one-shot hash does.
+  let len = data.len
+  if len == 0:
+    return
+  let input = cast[Bytes](unsafeAddr data[0])
+  let secret = cast[Bytes](addr state.secret[0])
+  state.totalLen += len.uint64
+
+  if len <= InternalBufferSize - state.bufferSize:
+    copyMem(addr state.buffer[state.bufferSize], input, len)
+    state.bufferSize += len
+    return
+
+  var p = 0
+  if state.bufferSize > 0:
+    # Complete and consume the buffer
+    p = InternalBufferSize - state.bufferSize
+    copyMem(addr state.buffer[state.bufferSize], input, p)
+    consumeStripes(state.acc, state.stripesSoFar, secret,
+                   cast[Bytes](addr state.buffer[0]), InternalBufferSize div StripeLen)
+    state.bufferSize = 0
+
+  if len - p > InternalBufferSize:
+    let nbStripes = (len - 1 - p) div StripeLen
+    consumeStripes(state.acc, state.stripesSoFar, secret, at(input, p), nbStripes)
+    p += nbStripes * StripeLen
+    # Keep the last consumed stripe for a short final stripe in `finish`
+    copyMem(addr state.buffer[InternalBufferSize - StripeLen],
+            at(input, p - StripeLen), StripeLen)
+
+  copyMem(addr state.buffer[0], at(input, p), len - p)
+  state.bufferSize = len - p
+
+proc update*(state: var Xxh3State, s: string) {.inline.} =
+  ## Add string to the hash computation.
+  state.update(s.toOpenArrayByte(0, s.len - 1))
+
+proc digestLong(state: Xxh3State): Acc =
+  ## Accumulators for the input so far, as if it ended here (the state
+  ## itself is not modified).
+  result = state.acc
+  let secret = cast[Bytes](unsafeAddr state.secret[0])
+  let buffer = cast[Bytes](unsafeAddr state.buffer[0])
+  var lastStripe: array[StripeLen, byte]
+  var last: Bytes
+  if state.bufferSize >= StripeLen:
+    var stripesSoFar = state.stripesSoFar
+    consumeStripes(result, stripesSoFar, secret, buffer,
+                   (state.bufferSize - 1) div StripeLen)
+    last = at(buffer, state.bufferSize - StripeLen)
+  else:
+    # Final stripe = tail of the previous stripe + buffered bytes
+    let catchup = StripeLen - state.bufferSize
+    copyMem(addr lastStripe[0], at(buffer, InternalBufferSize - catchup), catchup)
+    copyMem(addr lastStripe[catchup], buffer, state.bufferSize)
+    last = cast[Bytes](addr lastStripe[0])
+  accumulate(result, last, at(secret, SecretSize - StripeLen - SecretLastAccStart), 1)
+
+proc init*(hasher: typedesc[Xxh3], seed: HashSeed = DefaultSeed): Xxh3State =
+  ## Initialize incremental hasher with seed.
+  initState(seed.uint64)
+
+proc finish*(state: Xxh3State): uint64 =
+  ## Hash of everything added so far. The state stays usable, so more
+  ## data may be added and `finish` called again.
+  if state.totalLen > MidSizeMax.uint64:
+    let secret = cast[Bytes](unsafeAddr state.secret[0])
+    mergeAccs(state.digestLong(), at(secret, SecretMergeAccsStart),
+              state.totalLen * XXH_PRIME64_1)
+  else:
+    # Short input: still entirely in the buffer
+    hash64(cast[Bytes](unsafeAddr state.buffer[0]), state.totalLen.int, state.seed)
+
+proc reset*(state: var Xxh3State) =
+  ## Reset the hasher to initial state (keeping the seed).
+  state = initState(state.seed)
+
+proc init*(hasher: typedesc[Xxh3_128], seed: HashSeed = DefaultSeed): Xxh3_128State =
+  ## Initialize incremental 128-bit hasher with seed.
+  Xxh3_128State(inner: initState(seed.uint64))
+
+proc update*(state: var Xxh3_128State, data: openArray[byte]) {.inline.} =
+  ## Add data to the hash computation.
+  state.inner.update(data)
+
+proc update*(state: var Xxh3_128State, s: string) {.inline.} =
+  ## Add string to the hash computation.
+  state.inner.update(s.toOpenArrayByte(0, s.len - 1))
+
+proc finish*(state: Xxh3_128State): Hash128 =
+  ## 128-bit hash of everything added so far (state stays usable).
+  let inner = unsafeAddr state.inner
+  if inner.totalLen > MidSizeMax.uint64:
+    mergeLong128(inner[].digestLong(), cast[Bytes](unsafeAddr inner.secret[0]),
+                 inner.totalLen)
+  else:
+    hash128(cast[Bytes](unsafeAddr inner.buffer[0]), inner.totalLen.int, inner.seed)
+
+proc reset*(state: var Xxh3_128State) =
+  ## Reset the hasher to initial state (keeping the seed).
+  state.inner.reset()
+
+# =============================================================================
+# Hash128 Helpers
+# =============================================================================
+
+proc `==`*(a, b: Hash128): bool {.inline.} =
+  a.lo == b.lo and a.hi == b.hi
+
+proc `$`*(h: Hash128): string =
+  ## Canonical hex form (high half first, as printed by `xxhsum -H2`).
+  const digits = "0123456789abcdef"
+  result = newString(32)
+  for i in 0 ..< 16:
+    result[15 - i] = digits[int((h.hi shr (4 * i)) and 0xF)]
+    result[31 - i] = digits[int((h.lo shr (4 * i)) and 0xF)]
@@ -0,0 +1,156 @@
+## Parallel Tree Hashing
+## =====================
+##
+## Chunked XXH3 digest for large inputs that uses every core.
+##
+## The input is split into fixed-size chunks. Each chunk is hashed on its
+## own with XXH3-128 (the leaves), then the leaf digests are hashed in
+## chunk order together with the total length and the chunk size (the
+## root). Leaves are independent, so worker threads pull chunk indices from
+## a shared counter and hash them in any order; the root only depends on
+## the leaf array, never on which thread produced which leaf.
+##
+## The digest is a function of `(data, chunkSize, seed)` only: the same
+## input gives the same result with 1 thread or 64. It is *not* equal to
+## the plain `Xxh3_128.hash` of the input, and changing `chunkSize`
+## changes the digest, so store the chunk size alongside the checksum.
+##
+## Files are memory-mapped, so threads read straight from the page cache
+## and no chunk buffers are allocated.
+##
+## Without `--threads:on` the same digest is computed on the calling
+## thread.
+##
+## Usage:
+## ```nim
+## let digest = treeHashFile("disk.img")               # all cores, 1 MiB chunks
+## let same = treeHashFile("disk.img", threads = 1)    # same digest
+## echo digest                                         # 32 hex digits
+##
+## let d = treeHash(buffer, chunkSize = 4 shl 20)      # in-memory data
+## ```
+
+import std/[memfiles, os]
+import ./hasher
+import ./hashers/xxh3
+
+when compileOption("threads"):
+  import std/osproc
+  import ../concurrency/atomics/atomic
+
+export HashSeed, DefaultSeed, Hash128
+
+const
+  DefaultTreeChunkSize* = 1 shl 20   ## 1 MiB: ~50k leaves per 50 GB
+  MinTreeChunkSize* = 4096           ## Smaller chunks are all overhead
+
+type
+  Bytes = ptr UncheckedArray[byte]
+
+  TreeJob = object
+    ## Shared by all workers of one `treeHash` call.
+    data: Bytes
+    len: int
+    chunkSize: int
+    chunkCount: int
+    seed: HashSeed
+    leaves: ptr UncheckedArray[Hash128]
+    when compileOption("threads"):
+      next: Atomic[int]                ## Next chunk index to hash
+
+# =============================================================================
+# Leaves
+# =============================================================================
+
+proc hashLeaf(job: ptr TreeJob, index: int) {.inline.} =
+  let start = index * job.chunkSize
+  let stop = min(start + job.chunkSize, job.len)
+  job.leaves[index] = Xxh3_128.hash(toOpenArray(job.data, start, stop - 1), job.seed)
+
+when compileOption("threads"):
+  proc hashLeaves(job: ptr TreeJob) {.thread.} =
+    ## Worker loop: claim chunk indices until none are left.
+    while true:
+      let i = job.next.fetchAdd(1, Relaxed)
+      if i >= job.chunkCount:
+        break
+      hashLeaf(job, i)
+
+# =============================================================================
+# Root
+# =============================================================================
+
+proc putU64(buf: var array[16, byte], offset: int, v: uint64) {.inline.} =
+  for i in 0 ..< 8:
+    buf[offset + i] = byte((v shr (8 * i)) and 0xFF)
+
+proc hashRoot(leaves: openArray[Hash128], len, chunkSize: int,
+              seed: HashSeed): Hash128 =
+  ## XXH3-128 over the little-endian leaf digests, then a trailer of
+  ## total length and chunk size.
+  var state = Xxh3_128.init(seed)
+  var buf: array[16, byte]
+  for leaf in leaves:
+    buf.putU64(0, leaf.lo)
+    buf.putU64(8, leaf.hi)
+    state.update(buf)
+  buf.putU64(0, uint64(len))
+  buf.putU64(8, uint64(chunkSize))
+  state.update(buf)
+  state.finish()
+
+# =============================================================================
+# Public API
+# =============================================================================
+
+proc treeHash(p: Bytes, len: int, chunkSize, threads: int,
+              seed: HashSeed): Hash128 =
+  if chunkSize < MinTreeChunkSize:
+    raise newException(ValueError,
+      "tree hash chunk size must be at least " & $MinTreeChunkSize)
+  let chunkCount = (len + chunkSize - 1) div chunkSize
+  var leaves = newSeq[Hash128](chunkCount)
+
+  if chunkCount > 0:
+    var job = TreeJob(data: p, len: len, chunkSize: chunkSize,
+                      chunkCount: chunkCount, seed: seed,
+                      leaves: cast[ptr UncheckedArray[Hash128]](addr leaves[0]))
+    when compileOption("threads"):
+      let wanted = if threads > 0: threads else: countProcessors()
+      let workers = max(1, min(wanted, chunkCount))
+      var ts = newSeq[Thread[ptr TreeJob]](workers - 1)
+      for i in 0 ..< ts.len:
+        createThread(ts[i], hashLeaves, addr job)
+      hashLeaves(addr job)               # The caller is worker 0
+      joinThreads(ts)
+    else:
+      for i in 0 ..< chunkCount:
+        hashLeaf(addr job, i)
+
+  hashRoot(leaves, len, chunkSize, seed)
+
+proc treeHash*(data: openArray[byte], chunkSize = DefaultTreeChunkSize,
+               threads = 0, seed: HashSeed = DefaultSeed): Hash128 =
+  ## Tree digest of `data`, hashing chunks on `threads` threads
+  ## (0 = one per processor). The result does not depend on `threads`.
+  ##
+  ## Raises `ValueError` if `chunkSize < MinTreeChunkSize`.
+  let p = if data.len > 0: cast[Bytes](unsafeAddr data[0]) else: nil
+  treeHash(p, data.len, chunkSize, threads, seed)
+
+proc treeHash*(s: string, chunkSize = DefaultTreeChunkSize,
+               threads = 0, seed: HashSeed = DefaultSeed): Hash128 {.inline.} =
+  ## Tree digest of a string.
+  treeHash(s.toOpenArrayByte(0, s.len - 1), chunkSize, threads, seed)
+
+proc treeHashFile*(path: string, chunkSize = DefaultTreeChunkSize,
+                   threads = 0, seed: HashSeed = DefaultSeed): Hash128 =
+  ## Tree digest of a file's contents, read through a memory mapping.
+  ## Equal to `treeHash` over the same bytes.
+  ##
+  ## Raises `OSError` if the file cannot be opened or mapped.
+  if getFileSize(path) == 0:
+    return treeHash(Bytes(nil), 0, chunkSize, threads, seed)   # mmap rejects empty files
+  var f = memfiles.open(path, mode = fmRead)
+  defer: f.close()
+  treeHash(cast[Bytes](f.mem), f.size, chunkSize, threads, seed)
@@ -46,6 +46,7 @@ when defined(linux) and defined(amd64):
     SYS_pipe* = 22
     SYS_select* = 23
     SYS_sched_yield* = 24
+    SYS_madvise* = 28
     SYS_dup* = 32
     SYS_dup2* = 33
     SYS_getpid* = 39
@@ -78,15 +79,22 @@ when defined(linux) and defined(amd64):
     SYS_setsid* = 112
     SYS_prctl* = 157
     SYS_arch_prctl* = 158
+    SYS_gettid* = 186
     SYS_futex* = 202
+    SYS_sched_setaffinity* = 203
+    SYS_sched_getaffinity* = 204
     SYS_epoll_create* = 213
     SYS_epoll_ctl* = 233
     SYS_epoll_wait* = 232
+    SYS_mbind* = 237
+    SYS_set_mempolicy* = 238
+    SYS_get_mempolicy* = 239
     SYS_openat* = 257
     SYS_mkdirat* = 258
     SYS_unlinkat* = 263
     SYS_accept4* = 288
     SYS_epoll_create1* = 291
+    SYS_getcpu* = 309
 
 elif defined(linux) and defined(arm64):
   # ARM64 uses different syscall numbers
@@ -98,8 +106,16 @@ elif defined(linux) and defined(arm64):
     SYS_mmap* = 222
     SYS_munmap* = 215
     SYS_brk* = 214
+    SYS_madvise* = 233
     SYS_exit* = 93
     SYS_getpid* = 172
+    SYS_gettid* = 178
+    SYS_sched_setaffinity* = 122
+    SYS_sched_getaffinity* = 123
+    SYS_getcpu* = 168
+    SYS_mbind* = 235
+    SYS_get_mempolicy* = 236
+    SYS_set_mempolicy* = 237
     # ... (full ARM64 table)
 
 # =============================================================================
@@ -181,12 +197,14 @@ when defined(linux) and defined(amd64):
     ## System call with 4 arguments.
     ## Arguments in RDI, RSI, RDX, R10
 
-    var r10 {.noinit.}: clong = arg4
+    # R10/R8/R9 have no single-letter constraint, so they are bound with
+    # explicit register variables (a plain "r" would pick any register).
     {.emit: """
+    register long r10 asm("r10") = `arg4`;
     asm volatile(
       "syscall"
       : "=a"(`result`)
-      : "a"(`number`), "D"(`arg1`), "S"(`arg2`), "d"(`arg3`), "r"(`r10`)
+      : "a"(`number`), "D"(`arg1`), "S"(`arg2`), "d"(`arg3`), "r"(r10)
       : "rcx", "r11", "memory"
     );
     """.}
@@ -195,13 +213,13 @@ when defined(linux) and defined(amd64):
     ## System call with 5 arguments.
     ## Arguments in RDI, RSI, RDX, R10, R8
 
-    var r10 {.noinit.}: clong = arg4
-    var r8 {.noinit.}: clong = arg5
     {.emit: """
+    register long r10 asm("r10") = `arg4`;
+    register long r8 asm("r8") = `arg5`;
     asm volatile(
       "syscall"
       : "=a"(`result`)
-      : "a"(`number`), "D"(`arg1`), "S"(`arg2`), "d"(`arg3`), "r"(`r10`), "r"(`r8`)
+      : "a"(`number`), "D"(`arg1`), "S"(`arg2`), "d"(`arg3`), "r"(r10), "r"(r8)
       : "rcx", "r11", "memory"
     );
     """.}
@@ -210,14 +228,14 @@ when defined(linux) and defined(amd64):
     ## System call with 6 arguments.
     ## Arguments in RDI, RSI, RDX, R10, R8, R9
 
-    var r10 {.noinit.}: clong = arg4
-    var r8 {.noinit.}: clong = arg5
-    var r9 {.noinit.}: clong = arg6
     {.emit: """
+    register long r10 asm("r10") = `arg4`;
+    register long r8 asm("r8") = `arg5`;
+    register long r9 asm("r9") = `arg6`;
     asm volatile(
       "syscall"
       : "=a"(`result`)
-      : "a"(`number`), "D"(`arg1`), "S"(`arg2`), "d"(`arg3`), "r"(`r10`), "r"(`r8`), "r"(`r9`)
+      : "a"(`number`), "D"(`arg1`), "S"(`arg2`), "d"(`arg3`), "r"(r10), "r"(r8), "r"(r9)
       : "rcx", "r11", "memory"
     );
     """.}
@@ -415,6 +433,61 @@ when defined(linux):
     ## Unmap memory.
     cast[cint](syscall(SYS_munmap, `addr`, length.clong))
 
+  proc sys_madvise*(`addr`: pointer, length: csize_t, advice: cint): cint =
+    ## Give the kernel usage advice for a range of pages
+    ## (e.g. `MADV_HUGEPAGE` to request transparent huge pages).
+    cast[cint](syscall3(SYS_madvise, cast[clong](`addr`), length.clong,
+                        advice.clong))
+
+  proc sys_gettid*(): cint =
+    ## Get thread ID (used as the `pid` argument for per-thread calls).
+    cast[cint](syscall(SYS_gettid))
+
+  proc sys_sched_setaffinity*(tid: cint, maskSize: csize_t, mask: pointer): cint =
+    ## Set the CPU affinity mask of a thread (`tid = 0` means the caller).
+    cast[cint](syscall3(SYS_sched_setaffinity, tid.clong, maskSize.clong,
+                        cast[clong](mask)))
+
+  proc sys_sched_getaffinity*(tid: cint, maskSize: csize_t, mask: pointer): cint =
+    ## Get the CPU affinity mask of a thread.
+    ## Returns the number of bytes written to `mask` or -errno.
+    cast[cint](syscall3(SYS_sched_getaffinity, tid.clong, maskSize.clong,
+                        cast[clong](mask)))
+
+  proc sys_getcpu*(cpu: ptr cuint, node: ptr cuint): cint =
+    ## Get the CPU and NUMA node the calling thread is running on.
+    cast[cint](syscall3(SYS_getcpu, cast[clong](cpu), cast[clong](node), 0))
+
+  proc sys_mbind*(`addr`: pointer, length: csize_t, mode: cint,
+                  nodemask: pointer, maxnode: culong, flags: cuint): cint =
+    ## Set the NUMA memory policy for a range of pages.
+    ## Must be called before the pages are first touched to control placement.
+    cast[cint](syscall6(SYS_mbind,
+      cast[clong](`addr`),
+      length.clong,
+      mode.clong,
+      cast[clong](nodemask),
+      cast[clong](maxnode),
+      flags.clong
+    ))
+
+  proc sys_set_mempolicy*(mode: cint, nodemask: pointer, maxnode: culong): cint =
+    ## Set the default NUMA memory policy of the calling thread.
+    cast[cint](syscall3(SYS_set_mempolicy, mode.clong, cast[clong](nodemask),
+                        cast[clong](maxnode)))
+
+  proc sys_get_mempolicy*(mode: ptr cint, nodemask: pointer, maxnode: culong,
+                          `addr`: pointer, flags: culong): cint =
+    ## Query the NUMA memory policy of the thread, or of the page at `addr`
+    ## when `flags` contains `MPOL_F_ADDR`.
+    cast[cint](syscall5(SYS_get_mempolicy,
+      cast[clong](mode),
+      cast[clong](nodemask),
+      cast[clong](maxnode),
+      cast[clong](`addr`),
+      cast[clong](flags)
+    ))
+
 # =============================================================================
 # Constants (Linux)
 # =============================================================================
@@ -445,6 +518,35 @@ when defined(linux):
     MAP_PRIVATE* = 0x02
     MAP_ANONYMOUS* = 0x20
     MAP_FIXED* = 0x10
+    MAP_HUGETLB* = 0x40000
+    MAP_HUGE_SHIFT* = 26
+    MAP_HUGE_2MB* = 21 shl MAP_HUGE_SHIFT
+    MAP_HUGE_1GB* = 30 shl MAP_HUGE_SHIFT
+
+  # madvise advice values
+  const
+    MADV_NORMAL* = 0
+    MADV_RANDOM* = 1
+    MADV_SEQUENTIAL* = 2
+    MADV_WILLNEED* = 3
+    MADV_DONTNEED* = 4
+    MADV_HUGEPAGE* = 14
+    MADV_NOHUGEPAGE* = 15
+
+  # NUMA memory policy modes (mbind / set_mempolicy)
+  const
+    MPOL_DEFAULT* = 0
+    MPOL_PREFERRED* = 1
+    MPOL_BIND* = 2
+    MPOL_INTERLEAVE* = 3
+    MPOL_LOCAL* = 4
+
+  # NUMA memory policy flags
+  const
+    MPOL_MF_STRICT* = 1     ## mbind: fail if existing pages violate the policy
+    MPOL_MF_MOVE* = 2       ## mbind: migrate existing pages owned by us
+    MPOL_F_NODE* = 1        ## get_mempolicy: return node of `addr`
+    MPOL_F_ADDR* = 2        ## get_mempolicy: query policy of `addr`
 
   # Error codes (negative return values)
   const
@@ -458,6 +560,7 @@ when defined(linux):
     EFAULT* = 14
     EBUSY* = 16
     EINVAL* = 22
+    ENOSYS* = 38
 
 # =============================================================================
 # Error Handling
@@ -9,6 +9,8 @@
 ## - `BumpAllocator`: Fast arena allocator (alloc only, bulk free)
 ## - `PoolAllocator`: Fixed-size object pools
 ## - `MimallocAllocator`: High-performance general allocator (binding)
+## - `NumaAllocator`: Page-granular, node-bound mappings (`allocators/numa_local`)
+## - `HugePageAllocator`: 2 MB / 1 GB page mappings for large tables (`allocators/hugepage`)
 ##
 ## Usage:
 ## ```nim
@@ -0,0 +1,305 @@
+## Huge Page Allocator
+## ===================
+##
+## Allocator for large tables and buffers backed by 2 MB (or 1 GB) pages.
+## With 4 KB pages a random probe into a multi-GB table almost always misses
+## the TLB; one 2 MB entry covers 512x more memory.
+##
+## Allocations at or above `threshold` are mapped with, in order:
+## 1. `mmap(MAP_HUGETLB)` - explicit pages from the hugetlbfs pool
+##    (requires `vm.nr_hugepages > 0`)
+## 2. `mmap` + `madvise(MADV_HUGEPAGE)` - transparent huge pages, with the
+##    mapping aligned to the huge page size so khugepaged can collapse it
+## 3. plain `mmap` - regular pages
+##
+## Smaller allocations go to the shared system heap. Every allocation
+## records which kind of page it got (`pageKind`), and the allocator keeps
+## byte counts per kind so callers can report whether huge pages were
+## actually obtained.
+##
+## Usage:
+## ```nim
+## var huge = HugePageAllocator.init()        # 2 MB pages, 1 MB threshold
+## let slots = huge.alloc(4 * 1024 * 1024 * 1024, 64)
+## echo pageKind(slots)                       # explicit / transparent / regular
+## huge.dealloc(slots)
+## ```
+
+import std/strutils
+import ../../platform/config
+
+when defined(linux):
+  import ../../kernel/syscalls
+
+type
+  HugePageKind* = enum
+    hpNone = "regular"          ## Regular pages (or system heap)
+    hpTransparent = "transparent" ## madvise(MADV_HUGEPAGE) succeeded
+    hpExplicit = "explicit"     ## MAP_HUGETLB pages
+
+  HugePageAllocator* = object
+    ## Allocator that backs large requests with huge pages.
+    ## Not thread-safe (statistics are plain counters); use one per thread
+    ## or guard externally.
+    threshold: int        ## Requests below this use the system heap
+    hugePageSize: int     ## 2 MB or 1 GB
+    useExplicit: bool     ## Try MAP_HUGETLB before THP
+    useTransparent: bool  ## Try madvise(MADV_HUGEPAGE)
+    explicitBytes: int
+    transparentBytes: int
+    regularBytes: int     ## Mapped with regular pages after fallback
+    heapBytes: int        ## Served from the system heap (below threshold)
+    fallbacks: int        ## Large requests that did not get any huge pages
+
+  HugeAllocHeader = object
+    base: pointer         ## Start of the mapping / heap block
+    mapLen: int           ## Mapping length (0 = system heap block)
+    size: int
+    alignment: int
+    kind: HugePageKind
+
+const
+  HugePageSize2M* = 2 * 1024 * 1024
+  HugePageSize1G* = 1024 * 1024 * 1024
+  DefaultHugeThreshold* = 1024 * 1024
+  MinHugeAlignment = 16
+
+# =============================================================================
+# System Queries
+# =============================================================================
+
+proc detectHugePageSize*(): int =
+  ## Default huge page size from `/proc/meminfo` (`Hugepagesize:`).
+  ## Returns 2 MB when unknown.
+  result = HugePageSize2M
+  when IsLinux:
+    try:
+      for line in readFile("/proc/meminfo").splitLines():
+        if line.startsWith("Hugepagesize:"):
+          let fields = line.splitWhitespace()
+          if fields.len >= 2:
+            result = parseInt(fields[1]) * 1024
+          break
+    except IOError, OSError, ValueError:
+      discard
+
+proc freeExplicitHugePages*(): int =
+  ## Number of free pages in the hugetlbfs pool (`HugePages_Free`).
+  ## 0 means `MAP_HUGETLB` will fail and allocations fall back to THP.
+  when IsLinux:
+    try:
+      for line in readFile("/proc/meminfo").splitLines():
+        if line.startsWith("HugePages_Free:"):
+          let fields = line.splitWhitespace()
+          if fields.len >= 2:
+            return parseInt(fields[1])
+    except IOError, OSError, ValueError:
+      discard
+  0
+
+proc transparentHugePagesMode*(): string =
+  ## Current THP mode: "always", "madvise", "never", or "" if unavailable.
+  ## In "never" mode `madvise(MADV_HUGEPAGE)` has no effect.
+  when IsLinux:
+    try:
+      let text = readFile("/sys/kernel/mm/transparent_hugepage/enabled")
+      let a = text.find('[')
+      let b = text.find(']')
+      if a >= 0 and b > a:
+        return text[a + 1 ..< b]
+    except IOError, OSError:
+      discard
+  ""
+
+# =============================================================================
+# Construction
+# =============================================================================
+
+proc init*(_: typedesc[HugePageAllocator],
+           threshold: int = DefaultHugeThreshold,
+           hugePageSize: int = HugePageSize2M,
+           useExplicit: bool = true,
+           useTransparent: bool = true): HugePageAllocator =
+  ## Create a huge page allocator.
+  ##
+  ## - `threshold`: smaller requests are served by the system heap
+  ## - `hugePageSize`: `HugePageSize2M` or `HugePageSize1G` (explicit only)
+  ## - `useExplicit` / `useTransparent`: which mechanisms to try
+  result = HugePageAllocator(
+    threshold: threshold,
+    hugePageSize: hugePageSize,
+    useExplicit: useExplicit,
+    useTransparent: useTransparent
+  )
+
+# =============================================================================
+# Mapping Helpers
+# =============================================================================
+
+proc roundUp(x, to: int): int {.inline.} =
+  (x + to - 1) and not (to - 1)
+
+when defined(linux):
+  proc mapExplicit(a: HugePageAllocator, len: int): pointer =
+    var flags = MAP_PRIVATE or MAP_ANONYMOUS or MAP_HUGETLB
+    if a.hugePageSize == HugePageSize1G:
+      flags = flags or MAP_HUGE_1GB
+    elif a.hugePageSize == HugePageSize2M:
+      flags = flags or MAP_HUGE_2MB
+    result = sys_mmap(nil, csize_t(len), PROT_READ or PROT_WRITE, flags.cint, -1, 0)
+    if isError(cast[clong](result)):
+      result = nil
+
+  proc mapAligned(len, align: int): pointer =
+    ## Map `len` bytes starting at an `align` boundary by over-mapping and
+    ## trimming the unaligned head and tail.
+    let raw = sys_mmap(nil, csize_t(len + align), PROT_READ or PROT_WRITE,
+                       MAP_PRIVATE or MAP_ANONYMOUS, -1, 0)
+    if isError(cast[clong](raw)):
+      return nil
+    let start = roundUp(cast[int](raw), align)
+    let head = start - cast[int](raw)
+    let tail = align - head
+    if head > 0:
+      discard sys_munmap(raw, csize_t(head))
+    if tail > 0:
+      discard sys_munmap(cast[pointer](start + len), csize_t(tail))
+    result = cast[pointer](start)
+
+proc header(p: pointer): ptr HugeAllocHeader {.inline.} =
+  cast[ptr HugeAllocHeader](cast[int](p) - sizeof(HugeAllocHeader))
+
+# =============================================================================
+# Allocator Interface
+# =============================================================================
+
+proc alloc*(a: var HugePageAllocator, size: int, alignment: int): pointer =
+  ## Allocate `size` bytes aligned to `alignment` (a power of two).
+  ## Large requests try explicit, then transparent huge pages, then
+  ## regular pages. Returns nil only if every mechanism fails.
+  if size <= 0:
+    return nil
+  let align = max(alignment, MinHugeAlignment)
+  assert (align and (align - 1)) == 0, "alignment must be a power of two"
+  let hdr = sizeof(HugeAllocHeader)
+  let total = size + hdr + align
+
+  var base: pointer = nil
+  var mapLen = 0
+  var kind = hpNone
+
+  when defined(linux):
+    if size >= a.threshold:
+      if a.useExplicit:
+        mapLen = roundUp(total, a.hugePageSize)
+        base = a.mapExplicit(mapLen)
+        if base != nil:
+          kind = hpExplicit
+      if base == nil:
+        # THP only comes in 2 MB units regardless of the explicit page size
+        mapLen = roundUp(total, HugePageSize2M)
+        base = mapAligned(mapLen, HugePageSize2M)
+        if base == nil:
+          return nil
+        if a.useTransparent and
+           not isError(sys_madvise(base, csize_t(mapLen), MADV_HUGEPAGE.cint).clong):
+          kind = hpTransparent
+
+      case kind
+      of hpExplicit: a.explicitBytes += mapLen
+      of hpTransparent: a.transparentBytes += mapLen
+      of hpNone:
+        a.regularBytes += mapLen
+        inc a.fallbacks
+
+  if base == nil:
+    mapLen = 0
+    base = allocShared(total)
+    if base == nil:
+      return nil
+    a.heapBytes += total
+
+  let user = roundUp(cast[int](base) + hdr, align)
+  result = cast[pointer](user)
+  header(result)[] = HugeAllocHeader(base: base, mapLen: mapLen, size: size,
+                                     alignment: align, kind: kind)
+
+proc alloc*(a: var HugePageAllocator, size: int): pointer {.inline.} =
+  ## Allocate `size` bytes (16-byte aligned).
+  a.alloc(size, MinHugeAlignment)
+
+proc dealloc*(a: var HugePageAllocator, p: pointer) =
+  ## Release memory returned by `alloc`.
+  if p == nil:
+    return
+  let h = header(p)[]
+  if h.mapLen == 0:
+    a.heapBytes -= h.size + sizeof(HugeAllocHeader) + h.alignment
+    deallocShared(h.base)
+    return
+  case h.kind
+  of hpExplicit: a.explicitBytes -= h.mapLen
+  of hpTransparent: a.transparentBytes -= h.mapLen
+  of hpNone: a.regularBytes -= h.mapLen
+  when defined(linux):
+    discard sys_munmap(h.base, csize_t(h.mapLen))
+
+proc realloc*(a: var HugePageAllocator, p: pointer, newSize: int): pointer =
+  ## Resize an allocation. Grows in place while the mapping has room,
+  ## otherwise allocates, copies and frees.
+  if p == nil:
+    return a.alloc(newSize)
+  if newSize <= 0:
+    a.dealloc(p)
+    return nil
+  let h = header(p)
+  if h.mapLen > 0 and newSize <= cast[int](h.base) + h.mapLen - cast[int](p):
+    h.size = newSize
+    return p
+  result = a.alloc(newSize, h.alignment)
+  if result != nil:
+    copyMem(result, p, min(h.size, newSize))
+    a.dealloc(p)
+
+# =============================================================================
+# Introspection
+# =============================================================================
+
+proc pageKind*(p: pointer): HugePageKind {.inline.} =
+  ## Kind of pages backing the allocation at `p`.
+  ## `hpTransparent` means the kernel accepted the advice; whether pages
+  ## were actually collapsed depends on `transparentHugePagesMode()` and
+  ## memory fragmentation.
+  if p == nil: hpNone else: header(p).kind
+
+proc isHuge*(p: pointer): bool {.inline.} =
+  ## True if the allocation got explicit or transparent huge pages.
+  pageKind(p) != hpNone
+
+proc threshold*(a: HugePageAllocator): int {.inline.} =
+  ## Minimum request size that is mapped instead of heap-allocated.
+  a.threshold
+
+proc hugePageSize*(a: HugePageAllocator): int {.inline.} =
+  ## Explicit huge page size in use.
+  a.hugePageSize
+
+proc explicitBytes*(a: HugePageAllocator): int {.inline.} =
+  ## Bytes currently mapped with `MAP_HUGETLB`.
+  a.explicitBytes
+
+proc transparentBytes*(a: HugePageAllocator): int {.inline.} =
+  ## Bytes currently mapped with `MADV_HUGEPAGE` advice.
+  a.transparentBytes
+
+proc regularBytes*(a: HugePageAllocator): int {.inline.} =
+  ## Bytes of large requests that fell back to regular pages.
+  a.regularBytes
+
+proc heapBytes*(a: HugePageAllocator): int {.inline.} =
+  ## Bytes served from the system heap (requests below the threshold).
+  a.heapBytes
+
+proc fallbacks*(a: HugePageAllocator): int {.inline.} =
+  ## Number of large requests that got no huge pages at all.
+  a.fallbacks
@@ -0,0 +1,244 @@
+## NUMA-Local Allocator
+## ====================
+##
+## Page-granular allocator that places memory on chosen NUMA nodes using
+## `mmap` + `mbind` (raw syscalls, no libnuma dependency).
+##
+## Intended for large, long-lived buffers: queue rings, hash table slot
+## arrays, per-worker arenas. Every allocation is its own mapping rounded
+## up to the page size, so put a `BumpAllocator` or `PoolAllocator` on top
+## for small objects.
+##
+## Policies:
+## - `npLocal`: pages land on the node of the CPU that first touches them
+## - `npBind`: pages only come from the given nodes
+## - `npPreferred`: first given node, falling back to others when full
+## - `npInterleave`: pages are spread round-robin over the given nodes
+##
+## If the kernel has no NUMA support (or the node does not exist), the
+## allocation still succeeds but is left unbound; `bindFailures` counts
+## how often that happened.
+##
+## Usage:
+## ```nim
+## import arsenal/platform/numa
+##
+## # Worker pinned to node 1 with its queue memory on node 1
+## discard pinCurrentThreadToNode(1)
+## var numaAlloc = NumaAllocator.init(node = 1)
+## let ring = numaAlloc.alloc(64 * 1024 * 1024, 64)
+## ...
+## numaAlloc.dealloc(ring)
+## ```
+
+import ../../platform/[config, numa]
+
+when defined(linux):
+  import ../../kernel/syscalls
+
+type
+  NumaPolicy* = enum
+    npLocal        ## Node of the first-touching CPU
+    npBind         ## Strictly the given nodes
+    npPreferred    ## Prefer the first given node
+    npInterleave   ## Round-robin pages over the given nodes
+
+  NumaAllocator* = object
+    ## Allocator binding its mappings to a set of NUMA nodes.
+    ## Not thread-safe (statistics are plain counters); use one per worker.
+    policy: NumaPolicy
+    nodes: NodeMask
+    boundBytes: int      ## Bytes mapped with the requested policy applied
+    unboundBytes: int    ## Bytes mapped but left on the default policy
+    bindFailures: int    ## Number of mappings where mbind failed
+
+  NumaAllocHeader = object
+    ## Stored immediately before every returned pointer.
+    base: pointer        ## Start of the mapping
+    mapLen: int          ## Length of the mapping
+    size: int            ## Requested size
+    alignment: int       ## Requested alignment (for realloc)
+    bound: bool          ## Whether mbind succeeded
+
+const
+  MinNumaAlignment = 16
+
+# =============================================================================
+# Construction
+# =============================================================================
+
+proc init*(_: typedesc[NumaAllocator], node: int,
+           policy: NumaPolicy = npBind): NumaAllocator =
+  ## Create an allocator placing memory on a single NUMA node.
+  result.policy = policy
+  result.nodes.incl node
+
+proc init*(_: typedesc[NumaAllocator], nodes: openArray[int],
+           policy: NumaPolicy = npInterleave): NumaAllocator =
+  ## Create an allocator over several nodes (interleaved by default).
+  result.policy = policy
+  for n in nodes:
+    result.nodes.incl n
+
+proc initLocal*(_: typedesc[NumaAllocator]): NumaAllocator =
+  ## Create an allocator that places pages on whichever node first
+  ## touches them, overriding any process-wide interleave policy.
+  result.policy = npLocal
+
+# =============================================================================
+# Policy Helpers
+# =============================================================================
+
+when defined(linux):
+  proc policyMode(policy: NumaPolicy): cint {.inline.} =
+    case policy
+    of npLocal: MPOL_LOCAL.cint
+    of npBind: MPOL_BIND.cint
+    of npPreferred: MPOL_PREFERRED.cint
+    of npInterleave: MPOL_INTERLEAVE.cint
+
+proc applyPolicy(a: var NumaAllocator, p: pointer, len: int): bool =
+  ## Bind `[p, p+len)` to the allocator's nodes. Must run before first touch.
+  when defined(linux):
+    let ret =
+      if a.policy == npLocal or a.nodes.isEmpty:
+        sys_mbind(p, csize_t(len), MPOL_LOCAL.cint, nil, 0, 0)
+      else:
+        sys_mbind(p, csize_t(len), policyMode(a.policy), addr a.nodes,
+                  culong(MaxNumaNodes + 1), 0)
+    result = not isError(ret.clong)
+  else:
+    result = false
+
+proc setThreadMemPolicy*(policy: NumaPolicy,
+                         nodes: openArray[int] = []): bool =
+  ## Set the default memory policy of the calling thread via
+  ## `set_mempolicy`. Affects every later page fault of the thread,
+  ## including ordinary `alloc`/`new` memory.
+  ##
+  ## Returns false if unsupported or rejected by the kernel.
+  when defined(linux):
+    var mask: NodeMask
+    for n in nodes:
+      mask.incl n
+    let ret =
+      if policy == npLocal or mask.isEmpty:
+        sys_set_mempolicy(MPOL_LOCAL.cint, nil, 0)
+      else:
+        sys_set_mempolicy(policyMode(policy), addr mask, culong(MaxNumaNodes + 1))
+    result = not isError(ret.clong)
+  else:
+    result = false
+
+proc nodeOfAddress*(p: pointer): int =
+  ## NUMA node currently backing the page at `p`, or -1 if unknown.
+  ## The page must have been touched, otherwise it has no node yet.
+  when defined(linux):
+    var node: cint
+    let ret = sys_get_mempolicy(addr node, nil, 0, p,
+                                culong(MPOL_F_NODE or MPOL_F_ADDR))
+    result = if isError(ret.clong): -1 else: int(node)
+  else:
+    result = -1
+
+# =============================================================================
+# Allocator Interface
+# =============================================================================
+
+proc header(p: pointer): ptr NumaAllocHeader {.inline.} =
+  cast[ptr NumaAllocHeader](cast[int](p) - sizeof(NumaAllocHeader))
+
+proc alloc*(a: var NumaAllocator, size: int, alignment: int): pointer =
+  ## Map `size` bytes on the allocator's nodes with the given alignment
+  ## (a power of two). Returns nil if the mapping fails.
+  if size <= 0:
+    return nil
+  let align = max(alignment, MinNumaAlignment)
+  assert (align and (align - 1)) == 0, "alignment must be a power of two"
+
+  let hdr = sizeof(NumaAllocHeader)
+  let mapLen = (size + hdr + align + DefaultPageSize - 1) and not (DefaultPageSize - 1)
+
+  var base: pointer
+  var bound = false
+  when defined(linux):
+    base = sys_mmap(nil, csize_t(mapLen), PROT_READ or PROT_WRITE,
+                    MAP_PRIVATE or MAP_ANONYMOUS, -1, 0)
+    if isError(cast[clong](base)):
+      return nil
+    bound = a.applyPolicy(base, mapLen)
+  else:
+    base = allocShared(mapLen)
+    if base == nil:
+      return nil
+
+  if bound:
+    a.boundBytes += mapLen
+  else:
+    a.unboundBytes += mapLen
+    inc a.bindFailures
+
+  let user = (cast[int](base) + hdr + align - 1) and not (align - 1)
+  result = cast[pointer](user)
+  header(result)[] = NumaAllocHeader(base: base, mapLen: mapLen, size: size,
+                                     alignment: align, bound: bound)
+
+proc alloc*(a: var NumaAllocator, size: int): pointer {.inline.} =
+  ## Map `size` bytes on the allocator's nodes (16-byte aligned).
+  a.alloc(size, MinNumaAlignment)
+
+proc dealloc*(a: var NumaAllocator, p: pointer) =
+  ## Unmap memory returned by `alloc`.
+  if p == nil:
+    return
+  let h = header(p)[]
+  if h.bound:
+    a.boundBytes -= h.mapLen
+  else:
+    a.unboundBytes -= h.mapLen
+  when defined(linux):
+    discard sys_munmap(h.base, csize_t(h.mapLen))
+  else:
+    deallocShared(h.base)
+
+proc realloc*(a: var NumaAllocator, p: pointer, newSize: int): pointer =
+  ## Resize an allocation. Grows in place while the existing mapping has
+  ## room (mappings are page-rounded), otherwise maps, copies and unmaps.
+  if p == nil:
+    return a.alloc(newSize)
+  if newSize <= 0:
+    a.dealloc(p)
+    return nil
+  let h = header(p)
+  let room = cast[int](h.base) + h.mapLen - cast[int](p)
+  if newSize <= room:
+    h.size = newSize
+    return p
+  result = a.alloc(newSize, h.alignment)
+  if result != nil:
+    copyMem(result, p, min(h.size, newSize))
+    a.dealloc(p)
+
+# =============================================================================
+# Introspection
+# =============================================================================
+
+proc policy*(a: NumaAllocator): NumaPolicy {.inline.} =
+  ## Placement policy of this allocator.
+  a.policy
+
+proc boundBytes*(a: NumaAllocator): int {.inline.} =
+  ## Bytes currently mapped with the NUMA policy applied.
+  a.boundBytes
+
+proc unboundBytes*(a: NumaAllocator): int {.inline.} =
+  ## Bytes currently mapped without a NUMA policy (mbind unavailable).
+  a.unboundBytes
+
+proc bindFailures*(a: NumaAllocator): int {.inline.} =
+  ## Number of mappings for which `mbind` failed.
+  a.bindFailures
+
+proc isBound*(p: pointer): bool {.inline.} =
+  ## Whether the allocation at `p` received its NUMA policy.
+  p != nil and header(p).bound
@@ -13,7 +13,7 @@
 ##   useScalarImplementation()
 ## ```
 
-import std/[os, osproc]
+import std/[os, osproc, strutils]
 
 type
   CpuVendor* = enum
@@ -77,6 +77,7 @@ type
     ptrSize*: int
     pageSize*: int
     cpuCount*: int
+    numaNodeCount*: int    ## Online NUMA nodes (1 on non-NUMA systems)
 
 # =============================================================================
 # Compile-Time Platform Constants
@@ -96,6 +97,25 @@ const
   DefaultCacheLineSize* = 64
   DefaultPageSize* = 4096
 
+type
+  VectorIsa* = enum
+    ## Vector instruction set used by code paths selected at compile time.
+    viScalar = "scalar"   ## Portable code (SWAR where applicable)
+    viSSE2 = "sse2"       ## x86 128-bit, baseline on x86_64
+    viAVX2 = "avx2"       ## x86 256-bit, requires `-d:avx2` / `-mavx2`
+    viNEON = "neon"       ## ARM 128-bit, baseline on ARM64
+
+# Vector ISA the current build targets. Hot paths that cannot afford a
+# runtime branch (hash table probing, byte scanning) dispatch on this.
+# Force the portable path with `-d:arsenalScalar`.
+const
+  CompiledVectorIsa*: VectorIsa =
+    when defined(arsenalScalar): viScalar
+    elif defined(avx2) and IsX86: viAVX2
+    elif IsX64: viSSE2
+    elif IsARM64: viNEON
+    else: viScalar
+
 # =============================================================================
 # CPU Feature Detection
 # =============================================================================
@@ -209,6 +229,46 @@ proc detectCpuFeatures*(): CpuFeatures =
   elif IsARM64:
     result.hasNEON = true  # Always available on ARM64
 
+# =============================================================================
+# NUMA Discovery (Linux sysfs)
+# =============================================================================
+
+const
+  SysNodePath* = "/sys/devices/system/node"
+
+proc parseCpuList*(list: string): seq[int] =
+  ## Parses a Linux sysfs CPU/node list such as `"0-3,8,10-11"`.
+  ## Used for `/sys/devices/system/node/online` and `nodeN/cpulist`.
+  ## Malformed entries are skipped.
+  for part in list.strip().split(','):
+    let item = part.strip()
+    if item.len == 0:
+      continue
+    try:
+      let dash = item.find('-')
+      if dash < 0:
+        result.add parseInt(item)
+      else:
+        let lo = parseInt(item[0 ..< dash])
+        let hi = parseInt(item[dash + 1 .. ^1])
+        for i in lo .. hi:
+          result.add i
+    except ValueError:
+      discard
+
+proc detectNumaNodeCount*(): int =
+  ## Number of online NUMA nodes. Returns 1 when the system is not NUMA
+  ## or when topology is not exposed (non-Linux, containers without /sys).
+  ## See `platform/numa` for the full topology.
+  result = 1
+  when IsLinux:
+    try:
+      let nodes = parseCpuList(readFile(SysNodePath / "online"))
+      if nodes.len > 0:
+        result = nodes.len
+    except IOError, OSError:
+      discard
+
 proc getPlatformInfo*(): PlatformInfo =
   ## Returns static platform information.
   result = PlatformInfo(
@@ -216,9 +276,26 @@ proc getPlatformInfo*(): PlatformInfo =
     arch: hostCPU,
     ptrSize: sizeof(pointer),
     pageSize: DefaultPageSize,
-    cpuCount: countProcessors()
+    cpuCount: countProcessors(),
+    numaNodeCount: detectNumaNodeCount()
   )
 
+proc bestVectorIsa*(f: CpuFeatures): VectorIsa =
+  ## Widest vector ISA supported by the running CPU (runtime dispatch).
+  ## Never returns an ISA the binary was not compiled for, so on i386,
+  ## where SSE2 is not baseline and `CompiledVectorIsa` is `viScalar`,
+  ## this is `viScalar` too.
+  when defined(arsenalScalar):
+    viScalar
+  elif IsX86:
+    if f.hasAVX2 and CompiledVectorIsa == viAVX2: viAVX2
+    elif f.hasSSE2 and CompiledVectorIsa in {viSSE2, viAVX2}: viSSE2
+    else: viScalar
+  elif IsARM64:
+    if f.hasNEON: viNEON else: viScalar
+  else:
+    viScalar
+
 # =============================================================================
 # Feature Check Templates (Compile-Time)
 # =============================================================================
@@ -0,0 +1,310 @@
+## NUMA Topology & Thread Placement
+## ================================
+##
+## Discovers the NUMA layout of the machine from Linux sysfs and provides
+## helpers to pin threads to CPUs or whole nodes.
+##
+## On multi-socket machines, memory attached to a remote socket costs
+## roughly 1.5-2x the latency of local memory. Keeping a worker thread and
+## the memory it touches on the same node avoids that penalty. Use this
+## module together with `memory/allocators/numa_local` (`NumaAllocator`).
+##
+## On non-Linux systems (or when /sys is unavailable) the topology
+## degrades to a single node containing every CPU, and pinning calls
+## return `false`.
+##
+## Usage:
+## ```nim
+## let topo = getNumaTopology()
+## echo topo.nodes.len, " NUMA nodes"
+##
+## # Pin the calling worker to node 1
+## if topo.isNuma:
+##   discard pinCurrentThreadToNode(1)
+##
+## # One CPU per worker, spread across nodes
+## let plan = topo.planPlacement(8, ppScatter)
+## ```
+
+import std/[os, osproc, strutils, locks]
+import ./config
+
+when defined(linux):
+  import ../kernel/syscalls
+
+type
+  NumaNode* = object
+    ## One NUMA node (typically a socket or a sub-NUMA cluster).
+    id*: int                ## Kernel node id (may be sparse)
+    cpus*: seq[int]         ## Logical CPUs attached to this node
+    memTotal*: int64        ## Bytes of memory on this node (0 if unknown)
+    memFree*: int64         ## Bytes free at detection time (0 if unknown)
+    distances*: seq[int]    ## SLIT distance to each node in `NumaTopology.nodes`
+
+  NumaTopology* = object
+    ## Machine NUMA layout.
+    nodes*: seq[NumaNode]
+    cpuToNode*: seq[int]    ## Node id per logical CPU, -1 if unknown
+
+  PlacementPolicy* = enum
+    ## How `planPlacement` assigns workers to CPUs.
+    ppCompact   ## Fill node 0 first, then node 1, ... (shared L3, fewer nodes)
+    ppScatter   ## Round-robin across nodes (maximise memory bandwidth)
+
+const
+  MaxCpus* = 1024           ## Size of the affinity mask (matches glibc cpu_set_t)
+  MaxNumaNodes* = 256       ## Size of node masks passed to mbind/set_mempolicy
+
+type
+  CpuMask* = array[MaxCpus div 64, uint64]
+  NodeMask* = array[MaxNumaNodes div 64, uint64]
+
+# =============================================================================
+# Masks
+# =============================================================================
+
+proc incl*(m: var CpuMask, cpu: int) {.inline.} =
+  if cpu >= 0 and cpu < MaxCpus:
+    m[cpu shr 6] = m[cpu shr 6] or (1'u64 shl (cpu and 63))
+
+proc incl*(m: var NodeMask, node: int) {.inline.} =
+  if node >= 0 and node < MaxNumaNodes:
+    m[node shr 6] = m[node shr 6] or (1'u64 shl (node and 63))
+
+proc contains*(m: CpuMask, cpu: int): bool {.inline.} =
+  cpu >= 0 and cpu < MaxCpus and (m[cpu shr 6] and (1'u64 shl (cpu and 63))) != 0
+
+proc contains*(m: NodeMask, node: int): bool {.inline.} =
+  node >= 0 and node < MaxNumaNodes and
+    (m[node shr 6] and (1'u64 shl (node and 63))) != 0
+
+proc isEmpty*(m: NodeMask): bool =
+  for w in m:
+    if w != 0:
+      return false
+  true
+
+# =============================================================================
+# Topology Discovery
+# =============================================================================
+
+proc parseMeminfoKb(text, key: string): int64 =
+  ## Extracts `key` from a nodeN/meminfo file ("Node 0 MemTotal:  123 kB").
+  for line in text.splitLines():
+    let idx = line.find(key & ":")
+    if idx >= 0:
+      let fields = line[idx + key.len + 1 .. ^1].splitWhitespace()
+      if fields.len > 0:
+        try:
+          return parseBiggestInt(fields[0]) * 1024
+        except ValueError:
+          return 0
+  0
+
+proc singleNodeTopology(): NumaTopology =
+  let n = max(1, countProcessors())
+  var node = NumaNode(id: 0, distances: @[10])
+  for cpu in 0 ..< n:
+    node.cpus.add cpu
+  result.nodes = @[node]
+  result.cpuToNode = newSeq[int](n)
+
+proc detectNumaTopology*(): NumaTopology =
+  ## Reads the NUMA topology from `/sys/devices/system/node`.
+  ##
+  ## Falls back to a single node holding all CPUs when the information
+  ## is not available. Never raises.
+  when IsLinux:
+    var online: seq[int]
+    try:
+      online = parseCpuList(readFile(SysNodePath / "online"))
+    except IOError, OSError:
+      return singleNodeTopology()
+    if online.len == 0:
+      return singleNodeTopology()
+
+    var maxCpu = -1
+    for id in online:
+      let dir = SysNodePath / ("node" & $id)
+      var node = NumaNode(id: id)
+      try:
+        node.cpus = parseCpuList(readFile(dir / "cpulist"))
+      except IOError, OSError:
+        discard
+      try:
+        let meminfo = readFile(dir / "meminfo")
+        node.memTotal = parseMeminfoKb(meminfo, "MemTotal")
+        node.memFree = parseMeminfoKb(meminfo, "MemFree")
+      except IOError, OSError:
+        discard
+      try:
+        for d in readFile(dir / "distance").splitWhitespace():
+          node.distances.add parseInt(d)
+      except IOError, OSError, ValueError:
+        node.distances.setLen(0)
+      for cpu in node.cpus:
+        maxCpu = max(maxCpu, cpu)
+      result.nodes.add node
+
+    result.cpuToNode = newSeq[int](maxCpu + 1)
+    for i in 0 .. maxCpu:
+      result.cpuToNode[i] = -1
+    for node in result.nodes:
+      for cpu in node.cpus:
+        result.cpuToNode[cpu] = node.id
+  else:
+    result = singleNodeTopology()
+
+var numaTopologyCache: NumaTopology
+var numaTopologyInitialized = false
+var numaTopologyLock: Lock
+initLock(numaTopologyLock)
+
+proc getNumaTopology*(): NumaTopology =
+  ## Returns the cached NUMA topology (detected on first call).
+  ## Call this instead of `detectNumaTopology()` for repeated access.
+  ## Safe to call from several threads: the first caller detects while
+  ## the others wait.
+  withLock numaTopologyLock:
+    if not numaTopologyInitialized:
+      numaTopologyCache = detectNumaTopology()
+      numaTopologyInitialized = true
+    result = numaTopologyCache
+
+# =============================================================================
+# Topology Queries
+# =============================================================================
+
+proc isNuma*(t: NumaTopology): bool {.inline.} =
+  ## True if the machine has more than one NUMA node.
+  t.nodes.len > 1
+
+proc nodeIndex(t: NumaTopology, nodeId: int): int =
+  for i, n in t.nodes:
+    if n.id == nodeId:
+      return i
+  -1
+
+proc nodeOfCpu*(t: NumaTopology, cpu: int): int {.inline.} =
+  ## Node id that owns `cpu`, or -1 if unknown.
+  if cpu >= 0 and cpu < t.cpuToNode.len: t.cpuToNode[cpu] else: -1
+
+proc cpusOfNode*(t: NumaTopology, nodeId: int): seq[int] =
+  ## Logical CPUs attached to `nodeId` (empty if the node does not exist).
+  let i = t.nodeIndex(nodeId)
+  if i >= 0: t.nodes[i].cpus else: @[]
+
+proc distance*(t: NumaTopology, a, b: int): int =
+  ## SLIT distance between nodes `a` and `b` (10 = local).
+  ## Returns -1 if unknown.
+  let ia = t.nodeIndex(a)
+  let ib = t.nodeIndex(b)
+  if ia < 0 or ib < 0 or ib >= t.nodes[ia].distances.len:
+    return -1
+  t.nodes[ia].distances[ib]
+
+proc nearestNodes*(t: NumaTopology, nodeId: int): seq[int] =
+  ## All node ids ordered by distance from `nodeId` (itself first).
+  ## Useful for choosing a fallback node when the local one is full.
+  let i = t.nodeIndex(nodeId)
+  if i < 0:
+    return @[]
+  var order: seq[(int, int)]
+  for j, n in t.nodes:
+    let d = if j < t.nodes[i].distances.len: t.nodes[i].distances[j] else: high(int)
+    order.add (d, n.id)
+  for a in 1 ..< order.len:
+    var b = a
+    while b > 0 and order[b - 1][0] > order[b][0]:
+      swap(order[b - 1], order[b])
+      dec b
+  for entry in order:
+    result.add entry[1]
+
+proc planPlacement*(t: NumaTopology, workers: int,
+                    policy = ppScatter): seq[int] =
+  ## Chooses one logical CPU per worker.
+  ##
+  ## - `ppCompact`: workers fill node 0's CPUs, then node 1, ...
+  ## - `ppScatter`: worker `i` goes to node `i mod nodes`, spreading
+  ##   memory bandwidth across sockets.
+  ##
+  ## Wraps around when there are more workers than CPUs.
+  ## Feed the result to `pinCurrentThread` from each worker thread.
+  if workers <= 0 or t.nodes.len == 0:
+    return @[]
+  result = newSeq[int](workers)
+  case policy
+  of ppCompact:
+    var all: seq[int]
+    for n in t.nodes:
+      all.add n.cpus
+    if all.len == 0:
+      return newSeq[int](workers)
+    for w in 0 ..< workers:
+      result[w] = all[w mod all.len]
+  of ppScatter:
+    var populated: seq[int]
+    for i, n in t.nodes:
+      if n.cpus.len > 0:
+        populated.add i
+    if populated.len == 0:
+      return newSeq[int](workers)
+    for w in 0 ..< workers:
+      let node = t.nodes[populated[w mod populated.len]]
+      result[w] = node.cpus[(w div populated.len) mod node.cpus.len]
+
+# =============================================================================
+# Thread Placement
+# =============================================================================
+
+proc setCurrentThreadAffinity*(mask: CpuMask): bool =
+  ## Restricts the calling thread to the CPUs in `mask`.
+  ## Returns false if unsupported or the kernel rejected the mask.
+  when defined(linux):
+    var m = mask
+    result = not isError(sys_sched_setaffinity(0, csize_t(sizeof(m)), addr m).clong)
+  else:
+    result = false
+
+proc pinCurrentThread*(cpu: int): bool =
+  ## Pins the calling thread to a single logical CPU.
+  var mask: CpuMask
+  mask.incl cpu
+  setCurrentThreadAffinity(mask)
+
+proc pinCurrentThreadToCpus*(cpus: openArray[int]): bool =
+  ## Allows the calling thread to run on any CPU in `cpus`.
+  if cpus.len == 0:
+    return false
+  var mask: CpuMask
+  for cpu in cpus:
+    mask.incl cpu
+  setCurrentThreadAffinity(mask)
+
+proc pinCurrentThreadToNode*(nodeId: int): bool =
+  ## Allows the calling thread to run on any CPU of NUMA node `nodeId`.
+  ## The kernel's first-touch policy then places the thread's new pages
+  ## on that node.
+  pinCurrentThreadToCpus(getNumaTopology().cpusOfNode(nodeId))
+
+proc currentCpu*(): int =
+  ## Logical CPU the calling thread is running on, or -1 if unknown.
+  ## The answer may be stale immediately unless the thread is pinned.
+  when defined(linux):
+    var cpu, node: cuint
+    if isError(sys_getcpu(addr cpu, addr node).clong):
+      return -1
+    result = int(cpu)
+  else:
+    result = -1
+
+proc currentNumaNode*(): int =
+  ## NUMA node the calling thread is running on, or -1 if unknown.
+  when defined(linux):
+    var cpu, node: cuint
+    if isError(sys_getcpu(addr cpu, addr node).clong):
+      return -1
+    result = int(node)
+  else:
+    result = -1
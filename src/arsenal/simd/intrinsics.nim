@@ -75,6 +75,78 @@ when defined(amd64) or defined(i386):
   proc mm_sub_epi32*(a, b: M128i): M128i {.importc: "_mm_sub_epi32", header: "<emmintrin.h>".}
     ## Subtract 4 int32s
 
+  # SSE2 byte operations (hash table control bytes, byte scanning)
+  proc mm_loadu_si128*(p: pointer): M128i {.importc: "_mm_loadu_si128", header: "<emmintrin.h>".}
+    ## Load 16 bytes from unaligned memory
+
+  proc mm_storeu_si128*(p: pointer, a: M128i) {.importc: "_mm_storeu_si128", header: "<emmintrin.h>".}
+    ## Store 16 bytes to unaligned memory
+
+  proc mm_set1_epi8*(a: int8): M128i {.importc: "_mm_set1_epi8", header: "<emmintrin.h>".}
+    ## Set all 16 bytes to same value
+
+  proc mm_cmpeq_epi8*(a, b: M128i): M128i {.importc: "_mm_cmpeq_epi8", header: "<emmintrin.h>".}
+    ## Compare 16 bytes for equality (0xFF where equal)
+
+  proc mm_cmpgt_epi8*(a, b: M128i): M128i {.importc: "_mm_cmpgt_epi8", header: "<emmintrin.h>".}
+    ## Signed compare 16 bytes, a > b (0xFF where true)
+
+  proc mm_movemask_epi8*(a: M128i): int32 {.importc: "_mm_movemask_epi8", header: "<emmintrin.h>".}
+    ## Gather the top bit of each of the 16 bytes into a 16-bit mask
+
+  # SSE2 64-bit lane operations (hash accumulators)
+  proc mm_xor_si128*(a, b: M128i): M128i {.importc: "_mm_xor_si128", header: "<emmintrin.h>".}
+    ## Bitwise XOR of 128 bits
+
+  proc mm_add_epi64*(a, b: M128i): M128i {.importc: "_mm_add_epi64", header: "<emmintrin.h>".}
+    ## Add 2 x 64-bit lanes (wrapping)
+
+  proc mm_mul_epu32*(a, b: M128i): M128i {.importc: "_mm_mul_epu32", header: "<emmintrin.h>".}
+    ## Multiply the low 32 bits of each 64-bit lane into a 64-bit product
+
+  proc mm_shuffle_epi32*(a: M128i, imm: int32): M128i {.importc: "_mm_shuffle_epi32", header: "<emmintrin.h>".}
+    ## Reorder 4 x 32-bit lanes; `imm` holds a 2-bit source index per lane
+
+  proc mm_slli_epi64*(a: M128i, imm: int32): M128i {.importc: "_mm_slli_epi64", header: "<emmintrin.h>".}
+    ## Shift 2 x 64-bit lanes left by `imm` bits
+
+  proc mm_srli_epi64*(a: M128i, imm: int32): M128i {.importc: "_mm_srli_epi64", header: "<emmintrin.h>".}
+    ## Logical shift 2 x 64-bit lanes right by `imm` bits
+
+  # SSE2 double operations (aggregation kernels)
+  proc mm_set1_pd*(a: float64): M128d {.importc: "_mm_set1_pd", header: "<emmintrin.h>".}
+    ## Set both doubles to same value
+
+  proc mm_loadu_pd*(p: ptr float64): M128d {.importc: "_mm_loadu_pd", header: "<emmintrin.h>".}
+    ## Load 2 doubles from unaligned memory
+
+  proc mm_storeu_pd*(p: ptr float64, a: M128d) {.importc: "_mm_storeu_pd", header: "<emmintrin.h>".}
+    ## Store 2 doubles to unaligned memory
+
+  proc mm_add_pd*(a, b: M128d): M128d {.importc: "_mm_add_pd", header: "<emmintrin.h>".}
+    ## Add 2 doubles
+
+  proc mm_sub_pd*(a, b: M128d): M128d {.importc: "_mm_sub_pd", header: "<emmintrin.h>".}
+    ## Subtract 2 doubles
+
+  proc mm_min_pd*(a, b: M128d): M128d {.importc: "_mm_min_pd", header: "<emmintrin.h>".}
+    ## Lane-wise minimum; `b` where either lane is NaN
+
+  proc mm_max_pd*(a, b: M128d): M128d {.importc: "_mm_max_pd", header: "<emmintrin.h>".}
+    ## Lane-wise maximum; `b` where either lane is NaN
+
+  proc mm_cmplt_pd*(a, b: M128d): M128d {.importc: "_mm_cmplt_pd", header: "<emmintrin.h>".}
+    ## Compare a < b (all ones where true)
+
+  proc mm_and_pd*(a, b: M128d): M128d {.importc: "_mm_and_pd", header: "<emmintrin.h>".}
+    ## Bitwise AND
+
+  proc mm_andnot_pd*(a, b: M128d): M128d {.importc: "_mm_andnot_pd", header: "<emmintrin.h>".}
+    ## Bitwise (not a) AND b
+
+  proc mm_or_pd*(a, b: M128d): M128d {.importc: "_mm_or_pd", header: "<emmintrin.h>".}
+    ## Bitwise OR
+
 # =============================================================================
 # x86 AVX2 (256-bit)
 # =============================================================================
@@ -111,6 +183,48 @@ when defined(amd64) or defined(i386):
   proc mm256_store_ps*(p: ptr float32, a: M256) {.importc: "_mm256_store_ps", header: "<immintrin.h>".}
     ## Store 8 floats to aligned memory
 
+  proc mm256_loadu_si256*(p: pointer): M256i {.importc: "_mm256_loadu_si256", header: "<immintrin.h>".}
+    ## Load 32 bytes from unaligned memory
+
+  proc mm256_storeu_si256*(p: pointer, a: M256i) {.importc: "_mm256_storeu_si256", header: "<immintrin.h>".}
+    ## Store 32 bytes to unaligned memory
+
+  proc mm256_set1_epi64x*(a: int64): M256i {.importc: "_mm256_set1_epi64x", header: "<immintrin.h>".}
+    ## Set all 4 x 64-bit lanes to same value
+
+  proc mm256_cvtepu32_epi64*(a: M128i): M256i {.importc: "_mm256_cvtepu32_epi64", header: "<immintrin.h>".}
+    ## Zero-extend 4 x uint32 to 4 x 64-bit lanes
+
+  proc mm256_xor_si256*(a, b: M256i): M256i {.importc: "_mm256_xor_si256", header: "<immintrin.h>".}
+    ## Bitwise XOR of 256 bits
+
+  proc mm256_or_si256*(a, b: M256i): M256i {.importc: "_mm256_or_si256", header: "<immintrin.h>".}
+    ## Bitwise OR of 256 bits
+
+  proc mm256_add_epi64*(a, b: M256i): M256i {.importc: "_mm256_add_epi64", header: "<immintrin.h>".}
+    ## Add 4 x 64-bit lanes (wrapping)
+
+  proc mm256_mul_epu32*(a, b: M256i): M256i {.importc: "_mm256_mul_epu32", header: "<immintrin.h>".}
+    ## Multiply the low 32 bits of each 64-bit lane into a 64-bit product
+
+  proc mm256_slli_epi64*(a: M256i, imm: int32): M256i {.importc: "_mm256_slli_epi64", header: "<immintrin.h>".}
+    ## Shift 4 x 64-bit lanes left by `imm` bits
+
+  proc mm256_srli_epi64*(a: M256i, imm: int32): M256i {.importc: "_mm256_srli_epi64", header: "<immintrin.h>".}
+    ## Logical shift 4 x 64-bit lanes right by `imm` bits
+
+  proc mm256_unpacklo_epi64*(a, b: M256i): M256i {.importc: "_mm256_unpacklo_epi64", header: "<immintrin.h>".}
+    ## Interleave the low 64-bit lane of each 128-bit half of a and b
+
+  proc mm256_unpackhi_epi64*(a, b: M256i): M256i {.importc: "_mm256_unpackhi_epi64", header: "<immintrin.h>".}
+    ## Interleave the high 64-bit lane of each 128-bit half of a and b
+
+  proc mm256_permute4x64_epi64*(a: M256i, imm: int32): M256i {.importc: "_mm256_permute4x64_epi64", header: "<immintrin.h>".}
+    ## Reorder 4 x 64-bit lanes; `imm` holds a 2-bit source index per lane
+
+  proc mm256_shuffle_epi32*(a: M256i, imm: int32): M256i {.importc: "_mm256_shuffle_epi32", header: "<immintrin.h>".}
+    ## Reorder 32-bit lanes within each 128-bit half, as `mm_shuffle_epi32`
+
 # =============================================================================
 # ARM NEON (128-bit)
 # =============================================================================
@@ -141,6 +255,102 @@ when defined(arm) or defined(arm64):
   proc vst1q_f32*(p: ptr float32, a: Float32x4) {.importc, header: "<arm_neon.h>".}
     ## Store 4 floats to memory
 
+when defined(arm64):
+  type
+    Uint8x16* {.importc: "uint8x16_t", header: "<arm_neon.h>".} = object
+      ## 128-bit NEON register (16 x uint8)
+
+    Uint8x8* {.importc: "uint8x8_t", header: "<arm_neon.h>".} = object
+      ## 64-bit NEON register (8 x uint8)
+
+    Int8x16* {.importc: "int8x16_t", header: "<arm_neon.h>".} = object
+      ## 128-bit NEON register (16 x int8)
+
+  proc vld1q_u8*(p: pointer): Uint8x16 {.importc, header: "<arm_neon.h>".}
+    ## Load 16 bytes from memory
+
+  proc vst1q_u8*(p: pointer, a: Uint8x16) {.importc, header: "<arm_neon.h>".}
+    ## Store 16 bytes to memory
+
+  proc vdupq_n_u8*(value: uint8): Uint8x16 {.importc, header: "<arm_neon.h>".}
+    ## Set all 16 bytes to same value
+
+  proc vdupq_n_s8*(value: int8): Int8x16 {.importc, header: "<arm_neon.h>".}
+    ## Set all 16 signed bytes to same value
+
+  proc vceqq_u8*(a, b: Uint8x16): Uint8x16 {.importc, header: "<arm_neon.h>".}
+    ## Compare 16 bytes for equality (0xFF where equal)
+
+  proc vcltq_s8*(a, b: Int8x16): Uint8x16 {.importc, header: "<arm_neon.h>".}
+    ## Signed compare 16 bytes, a < b (0xFF where true)
+
+  proc vandq_u8*(a, b: Uint8x16): Uint8x16 {.importc, header: "<arm_neon.h>".}
+    ## Bitwise AND of 16 bytes
+
+  proc vreinterpretq_s8_u8*(a: Uint8x16): Int8x16 {.importc, header: "<arm_neon.h>".}
+    ## Reinterpret unsigned bytes as signed
+
+  proc vget_low_u8*(a: Uint8x16): Uint8x8 {.importc, header: "<arm_neon.h>".}
+    ## Lower 8 bytes
+
+  proc vget_high_u8*(a: Uint8x16): Uint8x8 {.importc, header: "<arm_neon.h>".}
+    ## Upper 8 bytes
+
+  proc vaddv_u8*(a: Uint8x8): uint8 {.importc, header: "<arm_neon.h>".}
+    ## Horizontal add of 8 bytes (AArch64)
+
+  type
+    Uint64x2* {.importc: "uint64x2_t", header: "<arm_neon.h>".} = object
+      ## 128-bit NEON register (2 x uint64)
+
+    Uint32x2* {.importc: "uint32x2_t", header: "<arm_neon.h>".} = object
+      ## 64-bit NEON register (2 x uint32)
+
+  proc vld1q_u64*(p: pointer): Uint64x2 {.importc, header: "<arm_neon.h>".}
+    ## Load 2 x uint64 from memory
+
+  proc vst1q_u64*(p: pointer, a: Uint64x2) {.importc, header: "<arm_neon.h>".}
+    ## Store 2 x uint64 to memory
+
+  proc veorq_u64*(a, b: Uint64x2): Uint64x2 {.importc, header: "<arm_neon.h>".}
+    ## Bitwise XOR of 2 x uint64
+
+  proc vaddq_u64*(a, b: Uint64x2): Uint64x2 {.importc, header: "<arm_neon.h>".}
+    ## Add 2 x uint64 (wrapping)
+
+  proc vextq_u64*(a, b: Uint64x2, n: int32): Uint64x2 {.importc, header: "<arm_neon.h>".}
+    ## Lanes n.. of a followed by lanes of b; `vextq_u64(a, a, 1)` swaps lanes
+
+  proc vshrq_n_u64*(a: Uint64x2, n: int32): Uint64x2 {.importc, header: "<arm_neon.h>".}
+    ## Logical shift 2 x uint64 right by `n` bits
+
+  proc vshlq_n_u64*(a: Uint64x2, n: int32): Uint64x2 {.importc, header: "<arm_neon.h>".}
+    ## Shift 2 x uint64 left by `n` bits
+
+  proc vmovn_u64*(a: Uint64x2): Uint32x2 {.importc, header: "<arm_neon.h>".}
+    ## Low 32 bits of each 64-bit lane
+
+  proc vshrn_n_u64*(a: Uint64x2, n: int32): Uint32x2 {.importc, header: "<arm_neon.h>".}
+    ## Shift each 64-bit lane right by `n` and narrow to 32 bits
+
+  proc vdup_n_u32*(value: uint32): Uint32x2 {.importc, header: "<arm_neon.h>".}
+    ## Set both 32-bit lanes to same value
+
+  proc vmull_u32*(a, b: Uint32x2): Uint64x2 {.importc, header: "<arm_neon.h>".}
+    ## Widening multiply: 2 x uint32 * 2 x uint32 -> 2 x uint64
+
+  proc vmlal_u32*(acc: Uint64x2, a, b: Uint32x2): Uint64x2 {.importc, header: "<arm_neon.h>".}
+    ## Widening multiply-accumulate: acc + a * b per 64-bit lane
+
+  let neonBitWeights = [1'u8, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128]
+
+  proc movemask*(a: Uint8x16): uint16 {.inline.} =
+    ## SSE2 `movemask` equivalent for a compare result (bytes 0x00/0xFF):
+    ## bit i is set when byte i is 0xFF.
+    let bits = vandq_u8(a, vld1q_u8(unsafeAddr neonBitWeights[0]))
+    result = vaddv_u8(vget_low_u8(bits)).uint16 or
+             (vaddv_u8(vget_high_u8(bits)).uint16 shl 8)
+
 # =============================================================================
 # Portable SIMD Operations
 # =============================================================================
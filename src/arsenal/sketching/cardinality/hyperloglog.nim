@@ -46,8 +46,14 @@
 ## hll2.add("user_99999")
 ## hll.merge(hll2)
 ## ```
+##
+## Hashing: elements are hashed with `keyHash` (wyhash for strings and
+## raw bytes, one multiply for integers). Sketches built with the
+## earlier std/hashes-based `add`, for any element type, hold different
+## registers and must not be merged with new ones; rebuild them instead.
 
-import std/[math, hashes]
+import std/math
+import ../../hashing/hasher
 
 # =============================================================================
 # Constants and Types
@@ -152,51 +158,43 @@ proc clear*(hll: var HyperLogLog) =
 # HyperLogLog Operations
 # =============================================================================
 
-proc add*(hll: var HyperLogLog, data: openArray[byte]) =
-  ## Add element to HyperLogLog sketch (raw bytes)
+proc addHash*(hll: var HyperLogLog, h: uint64) {.inline.} =
+  ## Add an element by its 64-bit hash
   ##
   ## This is the core operation. It:
-  ## 1. Hashes the input to get uniform distribution
-  ## 2. Uses first p bits to select register
-  ## 3. Counts leading zeros in remaining bits
-  ## 4. Updates register with maximum value seen
-
-  # Hash input to 64-bit value
-  let hashVal = hash(data).uint64
+  ## 1. Uses first p bits of the hash to select register
+  ## 2. Counts leading zeros in remaining bits
+  ## 3. Updates register with maximum value seen
+  ##
+  ## `h` must be uniformly distributed; use it to feed hashes that were
+  ## already computed elsewhere (e.g. by a hash table) without rehashing.
 
   # First p bits determine register index
-  let registerIdx = (hashVal shr (64 - hll.p)).int
+  let registerIdx = (h shr (64 - hll.p)).int
 
   # Remaining (64-p) bits: count leading zeros + 1
-  let w = hashVal shl hll.p  # Remove first p bits
+  let w = h shl hll.p  # Remove first p bits
   let leadingZerosCount = leadingZeros(w, 64 - hll.p)
 
   # Update register with maximum
   if leadingZerosCount > hll.registers[registerIdx].int:
     hll.registers[registerIdx] = leadingZerosCount.uint8
 
+proc add*(hll: var HyperLogLog, data: openArray[byte]) =
+  ## Add element to HyperLogLog sketch (raw bytes)
+  hll.addHash(wyhash.hash(data))
+
 proc add*(hll: var HyperLogLog, item: string) =
   ## Add string element to HyperLogLog sketch
-  hll.add(item.toOpenArrayByte(0, item.len - 1))
+  hll.addHash(keyHash(item))
 
 proc add*[T](hll: var HyperLogLog, item: T) =
   ## Add any hashable element to HyperLogLog sketch
   ##
-  ## Works with integers, floats, custom types (if they implement hash)
-  let h = hash(item).uint64
-  var bytes: array[8, byte]
-
-  # Convert hash to bytes
-  bytes[0] = ((h shr 0) and 0xFF).byte
-  bytes[1] = ((h shr 8) and 0xFF).byte
-  bytes[2] = ((h shr 16) and 0xFF).byte
-  bytes[3] = ((h shr 24) and 0xFF).byte
-  bytes[4] = ((h shr 32) and 0xFF).byte
-  bytes[5] = ((h shr 40) and 0xFF).byte
-  bytes[6] = ((h shr 48) and 0xFF).byte
-  bytes[7] = ((h shr 56) and 0xFF).byte
-
-  hll.add(bytes)
+  ## Works with integers, floats, custom types (if they implement hash).
+  ## Integers, pointers and small arrays are hashed with one multiply
+  ## (`keyHash`), selected at compile time.
+  hll.addHash(keyHash(item))
 
 # =============================================================================
 # Cardinality Estimation
@@ -22,8 +22,13 @@
 ## - Keys are distributed across segments
 ## - Peeling algorithm removes keys that can be uniquely identified
 ## - Fingerprints assigned in reverse order to satisfy XOR constraints
+##
+## Keys other than `uint64` are mapped to 64 bits with `keyHash` (wyhash
+## for strings), as in the xor filter. Filters are not serialized, so a
+## filter must be queried with the build it was constructed with.
 
-import std/[hashes, math]
+import std/math
+import ../../hashing/hasher
 
 type
   BinaryFuse8* = object
@@ -67,6 +72,15 @@ proc mixSplit(key, seed: uint64): uint64 {.inline.} =
   ## Hash key with seed
   mix(key + seed)
 
+proc fuseKey[T](key: T): uint64 {.inline.} =
+  ## Map any key to the 64-bit key the filter stores. `mixSplit` mixes it
+  ## again with the filter seed, so keys of up to 8 bytes go in as their
+  ## raw bits (no second hash); a `uint64` key maps to itself.
+  when isFixedSizeKey(T) and sizeof(T) <= 8:
+    fixedKeyBits(key)
+  else:
+    keyHash(key)
+
 proc mulhi(a, b: uint64): uint64 {.inline.} =
   ## High 64 bits of 128-bit product
   ## Uses compiler intrinsics when available for better performance
@@ -137,9 +151,9 @@ proc contains*(filter: BinaryFuse8, key: uint64): bool {.inline.} =
               filter.fingerprints[hashes.h2]
   result = xored == 0
 
-proc contains*(filter: BinaryFuse8, key: string): bool {.inline.} =
-  ## String variant - hashes string to uint64 first
-  filter.contains(uint64(hash(key)))
+proc contains*[T](filter: BinaryFuse8, key: T): bool {.inline.} =
+  ## Variant for strings and other hashable keys
+  filter.contains(fuseKey(key))
 
 # =============================================================================
 # Construction
@@ -299,6 +313,14 @@ proc construct*(keys: openArray[uint64]): BinaryFuse8 =
 # Utility
 # =============================================================================
 
+proc construct*[T](keys: openArray[T]): BinaryFuse8 =
+  ## Construct from strings or other hashable keys; query them with
+  ## the matching `contains`. Keys must be distinct.
+  var words = newSeq[uint64](keys.len)
+  for i in 0 ..< keys.len:
+    words[i] = fuseKey(keys[i])
+  construct(words)
+
 proc sizeInBytes*(filter: BinaryFuse8): int =
   ## Return memory usage in bytes
   filter.fingerprints.len + sizeof(filter)
@@ -332,9 +354,9 @@ proc contains*(filter: BinaryFuse16, key: uint64): bool {.inline.} =
               filter.fingerprints[hashes.h2]
   result = xored == 0
 
-proc contains*(filter: BinaryFuse16, key: string): bool {.inline.} =
-  ## String variant for 16-bit filter
-  filter.contains(uint64(hash(key)))
+proc contains*[T](filter: BinaryFuse16, key: T): bool {.inline.} =
+  ## Variant for strings and other hashable keys (16-bit filter)
+  filter.contains(fuseKey(key))
 
 proc construct16*(keys: openArray[uint64]): BinaryFuse16 =
   ## Construct 16-bit Binary Fuse Filter.
@@ -440,6 +462,13 @@ proc construct16*(keys: openArray[uint64]): BinaryFuse16 =
       result.fingerprints[hashes.h2] = fp xor
         result.fingerprints[hashes.h0] xor result.fingerprints[hashes.h1]
 
+proc construct16*[T](keys: openArray[T]): BinaryFuse16 =
+  ## Construct a 16-bit filter from strings or other hashable keys.
+  var words = newSeq[uint64](keys.len)
+  for i in 0 ..< keys.len:
+    words[i] = fuseKey(keys[i])
+  construct16(words)
+
 proc sizeInBytes*(filter: BinaryFuse16): int =
   ## Return memory usage in bytes for 16-bit filter
   filter.fingerprints.len * 2 + sizeof(filter)
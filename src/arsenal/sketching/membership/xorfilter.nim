@@ -42,6 +42,7 @@
 ## ```
 
 import std/[hashes, math, algorithm]
+import ../../hashing/hasher
 
 # =============================================================================
 # Constants
@@ -110,6 +111,14 @@ proc hashToKey(data: openArray[byte], seed: uint64): uint64 =
     h = h * 0x100000001b3'u64  # FNV-1a style
   result = murmurHash64(h)
 
+proc filterHash(key: string, seed: uint64): uint64 {.inline.} =
+  ## String keys keep the byte-wise hash, so serialized filters stay valid.
+  hashToKey(key.toOpenArrayByte(0, key.len - 1), seed)
+
+proc filterHash[T](key: T, seed: uint64): uint64 {.inline.} =
+  ## Other keys are hashed once, with the mixer `keyHash` picks for `T`.
+  keyHash(key, seed)
+
 proc fingerprint8(hash: uint64): uint8 {.inline.} =
   ## Extract 8-bit fingerprint from hash
   result = (hash and 0xFF).uint8
@@ -151,8 +160,8 @@ proc getH2(hash: uint64, blockLength: int): int {.inline.} =
 # Construction Algorithm (Xor Filter 8-bit)
 # =============================================================================
 
-proc buildXorFilter8*(keys: openArray[string], maxAttempts: int = MaxIterations): XorFilter8 =
-  ## Build Xor filter from set of string keys
+proc buildXorFilter8*[T](keys: openArray[T], maxAttempts: int = MaxIterations): XorFilter8 =
+  ## Build Xor filter from a set of keys (strings or any hashable type)
   ##
   ## Uses "peeling" algorithm to construct filter:
   ## 1. Map each key to 3 locations (3-partite hypergraph)
@@ -180,7 +189,7 @@ proc buildXorFilter8*(keys: openArray[string], maxAttempts: int = MaxIterations)
 
     # Hash all keys with current seed
     for i in 0..<n:
-      hashes[i] = hashToKey(keys[i].toOpenArrayByte(0, keys[i].len - 1), seed)
+      hashes[i] = filterHash(keys[i], seed)
 
     # Initialize XOR sets for each array position
     var sets = newSeq[XorSet](3 * blockLength)
@@ -264,18 +273,11 @@ proc buildXorFilter8*(keys: openArray[string], maxAttempts: int = MaxIterations)
 
   raise newException(ValueError, "Failed to construct Xor filter after " & $maxAttempts & " attempts")
 
-proc buildXorFilter8*[T](keys: openArray[T], maxAttempts: int = MaxIterations): XorFilter8 =
-  ## Build Xor filter from hashable keys
-  var stringKeys = newSeq[string](keys.len)
-  for i in 0..<keys.len:
-    stringKeys[i] = $hash(keys[i])
-  result = buildXorFilter8(stringKeys, maxAttempts)
-
 # =============================================================================
 # Query (Xor Filter 8-bit)
 # =============================================================================
 
-proc contains*(filter: XorFilter8, key: string): bool =
+proc contains*[T](filter: XorFilter8, key: T): bool =
   ## Test if key is in set (may have false positives)
   ##
   ## Query algorithm:
@@ -285,7 +287,7 @@ proc contains*(filter: XorFilter8, key: string): bool =
   ## 4. Compare with expected fingerprint
   ##
   ## Time: O(1) - exactly 3 memory accesses
-  let hash = hashToKey(key.toOpenArrayByte(0, key.len - 1), filter.seed)
+  let hash = filterHash(key, filter.seed)
 
   let h0 = getH0(hash, filter.blockLength)
   let h1 = getH1(hash, filter.blockLength)
@@ -297,15 +299,11 @@ proc contains*(filter: XorFilter8, key: string): bool =
 
   result = xorVal == fingerprint8(hash)
 
-proc contains*[T](filter: XorFilter8, key: T): bool =
-  ## Test if hashable key is in set
-  filter.contains($hash(key))
-
 # =============================================================================
 # Construction Algorithm (Xor Filter 16-bit)
 # =============================================================================
 
-proc buildXorFilter16*(keys: openArray[string], maxAttempts: int = MaxIterations): XorFilter16 =
+proc buildXorFilter16*[T](keys: openArray[T], maxAttempts: int = MaxIterations): XorFilter16 =
   ## Build Xor filter with 16-bit fingerprints
   ## Lower false positive rate (~0.0015%) than 8-bit version
   if keys.len == 0:
@@ -321,7 +319,7 @@ proc buildXorFilter16*(keys: openArray[string], maxAttempts: int = MaxIterations
     let seed = attempt.uint64 * 0x9e3779b97f4a7c15'u64
 
     for i in 0..<n:
-      hashes[i] = hashToKey(keys[i].toOpenArrayByte(0, keys[i].len - 1), seed)
+      hashes[i] = filterHash(keys[i], seed)
 
     var sets = newSeq[XorSet](3 * blockLength)
 
@@ -393,9 +391,9 @@ proc buildXorFilter16*(keys: openArray[string], maxAttempts: int = MaxIterations
 
   raise newException(ValueError, "Failed to construct Xor filter after " & $maxAttempts & " attempts")
 
-proc contains*(filter: XorFilter16, key: string): bool =
+proc contains*[T](filter: XorFilter16, key: T): bool =
   ## Test if key is in 16-bit filter
-  let hash = hashToKey(key.toOpenArrayByte(0, key.len - 1), filter.seed)
+  let hash = filterHash(key, filter.seed)
   let h0 = getH0(hash, filter.blockLength)
   let h1 = getH1(hash, filter.blockLength)
   let h2 = getH2(hash, filter.blockLength)
@@ -0,0 +1,214 @@
+## Hierarchical Timer Wheel
+## ========================
+##
+## O(1) scheduling and cancellation of deadlines for a fixed set of
+## integer ids (e.g. cache slots), with expiry driven by advancing the
+## clock instead of scanning every timer.
+##
+## Five levels of 64 buckets each. A timer `d` ticks away sits in level
+## `L` where `64^L <= d < 64^(L+1)`. Each time the wheel crosses a level-L
+## boundary, that level's current bucket is cascaded: its timers move to
+## finer levels. Only the level-0 bucket of the current tick is ever
+## expired, so `advance` touches each timer at most once per level.
+## Ticks with nothing scheduled in the lower levels are skipped in one
+## step, so a wheel left idle for hours catches up immediately.
+##
+## With the default 1 ms tick the levels span 64 ms, 4 s, 4.4 min, 4.7 h
+## and 12.4 days; timers further out wait in the top level and are
+## re-placed as the wheel approaches them.
+##
+## Timers are intrusive doubly-linked lists over per-id arrays that are
+## allocated once by `init`: scheduling never allocates.
+##
+## Usage:
+## ```nim
+## var wheel = TimerWheel.init(capacity = 1000, startNs = nowNs())
+## wheel.schedule(id = 7, deadlineNs = nowNs() + 5_000_000_000)   # in 5 s
+##
+## for id in wheel.advance(nowNs()):
+##   echo id, " expired"
+## ```
+##
+## Reference: G. Varghese, T. Lauck, "Hashed and Hierarchical Timing
+## Wheels" (SOSP 1987)
+
+import std/[monotimes, times]
+
+const
+  WheelBits = 6
+  WheelSlots* = 1 shl WheelBits          ## Buckets per level
+  WheelLevels* = 5
+  WheelSpan = 1'i64 shl (WheelBits * WheelLevels)   ## Ticks covered
+  DefaultWheelTick* = initDuration(milliseconds = 1)
+  Unlinked = -1'i32
+
+type
+  TimerWheel* = object
+    ## Deadlines for ids `0 ..< capacity`; at most one timer per id.
+    tickNs: int64
+    current: int64                       ## Last tick processed
+    heads: array[WheelLevels * WheelSlots, int32]
+    levelCount: array[WheelLevels, int]  ## Timers per level
+    next, prev: seq[int32]
+    bucket: seq[int32]                   ## Bucket an id is linked into
+    deadline: seq[int64]                 ## In ticks
+    count: int
+
+proc nowNs*(): int64 {.inline.} =
+  ## Monotonic clock in nanoseconds, the time base of `TimerWheel`.
+  getMonoTime().ticks
+
+# =============================================================================
+# Construction
+# =============================================================================
+
+proc init*(_: typedesc[TimerWheel], capacity: int, startNs: int64 = nowNs(),
+           tick: Duration = DefaultWheelTick): TimerWheel =
+  ## Create a wheel for ids `0 ..< capacity` starting at time `startNs`.
+  ## Deadlines are rounded up to whole ticks.
+  let tickNs = tick.inNanoseconds
+  if tickNs <= 0:
+    raise newException(ValueError, "timer wheel tick must be positive")
+  result.tickNs = tickNs
+  result.current = startNs div tickNs
+  for h in result.heads.mitems:
+    h = Unlinked
+  result.next = newSeq[int32](capacity)
+  result.prev = newSeq[int32](capacity)
+  result.bucket = newSeq[int32](capacity)
+  result.deadline = newSeq[int64](capacity)
+  for b in result.bucket.mitems:
+    b = Unlinked
+
+proc capacity*(w: TimerWheel): int {.inline.} =
+  ## Number of ids the wheel can hold.
+  w.bucket.len
+
+proc len*(w: TimerWheel): int {.inline.} =
+  ## Number of scheduled timers.
+  w.count
+
+# =============================================================================
+# Linking
+# =============================================================================
+
+proc link(w: var TimerWheel, id: int32, b: int32) {.inline.} =
+  let head = w.heads[b]
+  w.next[id] = head
+  w.prev[id] = Unlinked
+  if head != Unlinked:
+    w.prev[head] = id
+  w.heads[b] = id
+  w.bucket[id] = b
+  inc w.levelCount[b div WheelSlots]
+  inc w.count
+
+proc unlink(w: var TimerWheel, id: int32) {.inline.} =
+  let b = w.bucket[id]
+  let n = w.next[id]
+  let p = w.prev[id]
+  if p != Unlinked: w.next[p] = n else: w.heads[b] = n
+  if n != Unlinked: w.prev[n] = p
+  w.bucket[id] = Unlinked
+  dec w.levelCount[b div WheelSlots]
+  dec w.count
+
+proc place(w: var TimerWheel, id: int32) =
+  ## Link `id` into the bucket for its deadline relative to `current`.
+  var t = w.deadline[id]
+  if t <= w.current:
+    t = w.current + 1                    # Overdue: expire on the next tick
+  elif t - w.current >= WheelSpan:
+    t = w.current + WheelSpan - 1        # Beyond the top level: wait there
+  let delta = t - w.current
+  var level = 0
+  while level < WheelLevels - 1 and delta >= (1'i64 shl (WheelBits * (level + 1))):
+    inc level
+  let slot = int32((t shr (WheelBits * level)) and (WheelSlots - 1))
+  w.link(id, int32(level * WheelSlots) + slot)
+
+# =============================================================================
+# Scheduling
+# =============================================================================
+
+proc isScheduled*(w: TimerWheel, id: int32): bool {.inline.} =
+  ## True if `id` has a pending timer.
+  w.bucket[id] != Unlinked
+
+proc cancel*(w: var TimerWheel, id: int32) {.inline.} =
+  ## Drop `id`'s timer, if any.
+  if w.bucket[id] != Unlinked:
+    w.unlink(id)
+
+proc schedule*(w: var TimerWheel, id: int32, deadlineNs: int64) =
+  ## Fire `id` once the wheel is advanced to `deadlineNs` or later.
+  ## Replaces any timer `id` already had.
+  w.cancel(id)
+  w.deadline[id] = (deadlineNs + w.tickNs - 1) div w.tickNs
+  w.place(id)
+
+proc clear*(w: var TimerWheel) =
+  ## Cancel every timer.
+  for h in w.heads.mitems:
+    h = Unlinked
+  for b in w.bucket.mitems:
+    b = Unlinked
+  for c in w.levelCount.mitems:
+    c = 0
+  w.count = 0
+
+# =============================================================================
+# Expiry
+# =============================================================================
+
+proc cascade(w: var TimerWheel, level: int) =
+  ## Move the current bucket of `level` down to finer levels.
+  let b = int32(level * WheelSlots) +
+          int32((w.current shr (WheelBits * level)) and (WheelSlots - 1))
+  var id = w.heads[b]
+  while id != Unlinked:
+    let n = w.next[id]
+    w.unlink(id)
+    if w.deadline[id] <= w.current:
+      # Due this tick: the level-0 bucket is expired right after cascading
+      w.link(id, int32(w.current and (WheelSlots - 1)))
+    else:
+      w.place(id)
+    id = n
+
+iterator advance*(w: var TimerWheel, nowNs: int64): int32 =
+  ## Move the wheel to `nowNs` and yield every id whose deadline has
+  ## passed. Each id is unscheduled before it is yielded, so the loop body
+  ## may schedule or cancel timers (including the yielded id).
+  let target = nowNs div w.tickNs
+  while w.current < target:
+    if w.count == 0:
+      w.current = target
+      break
+    # With levels 0 ..< L empty nothing happens before the next level-L
+    # boundary, so jump to the tick just before it.
+    var level = 0
+    while level < WheelLevels - 1 and w.levelCount[level] == 0:
+      inc level
+    if level > 0:
+      let boundary = w.current or ((1'i64 shl (WheelBits * level)) - 1)
+      if boundary >= target:
+        w.current = target
+        break
+      w.current = boundary
+    inc w.current
+
+    for l in countdown(WheelLevels - 1, 1):
+      if (w.current and ((1'i64 shl (WheelBits * l)) - 1)) == 0:
+        w.cascade(l)
+
+    # Re-read the head each time: the loop body may cancel any timer in
+    # this bucket. `place` never links into it, so the loop terminates.
+    let b = int32(w.current and (WheelSlots - 1))
+    while w.heads[b] != Unlinked:
+      let id = w.heads[b]
+      w.unlink(id)
+      if w.deadline[id] <= w.current:
+        yield id
+      else:
+        w.place(id)                      # Clamped far-future timer
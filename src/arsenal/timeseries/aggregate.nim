@@ -0,0 +1,257 @@
+## Time Series Aggregation
+## =======================
+##
+## Count, sum, min, max, mean, rate and downsampling over Gorilla blocks
+## without materialising the points. Blocks decode in batches of 256
+## points into stack buffers, and each batch is reduced straight away
+## with an SSE2 kernel (scalar on other targets, or with
+## `-d:arsenalScalar`).
+##
+## Results are `Summary` values, which merge in time order. A chunk store
+## can keep one per chunk in its index and combine those with partial
+## decodes of the chunks that straddle a range or bucket edge (see
+## `summarize` and `downsample` in `store`).
+##
+## - `min`/`max` skip NaN values; `sum` and `mean` include them.
+## - `increase` reads the series as a counter: a drop is a reset, after
+##   which the new value counts in full (as Prometheus `increase`).
+##
+## Usage:
+## ```nim
+## import arsenal/timeseries/aggregate
+##
+## let s = summarize(gorillaBlock, numPoints, fromTime, toTime)
+## echo s.count, " ", s.mean, " ", s.min, " ", s.max, " ", s.rate
+##
+## let grid = BucketGrid.init(fromTime, toTime, 60)
+## for i, bucket in downsample(gorillaBlock, numPoints, grid):
+##   echo grid.bucketStart(i), " ", bucket.mean
+## ```
+##
+## Reference: Prometheus, "Query functions: increase(), rate()"
+
+import ./gorilla
+
+const
+  Batch = 256                            ## Points decoded per kernel call
+  X86Reduce = (defined(amd64) or defined(i386)) and not defined(arsenalScalar)
+
+when X86Reduce:
+  import ../simd/intrinsics
+
+type
+  Summary* = object
+    ## Aggregate of the points in a time range. Fields other than `count`
+    ## are meaningful only when `count > 0`.
+    count*: int
+    sum*: float64
+    min*, max*: float64                  ## +Inf / -Inf if every value is NaN
+    firstTime*, lastTime*: int64
+    first*, last*: float64               ## Values at `firstTime`/`lastTime`
+    increase*: float64                   ## Counter increase, allowing for resets
+
+  BucketGrid* = object
+    ## `buckets` time buckets of equal width covering [fromTime, toTime]
+    fromTime*, toTime*: int64
+    width*: uint64
+    buckets*: int
+
+# =============================================================================
+# Summaries
+# =============================================================================
+
+proc add*(s: var Summary, timestamp: int64, value: float64) =
+  ## Fold in one point, later than those already summarised
+  if s.count == 0:
+    s = Summary(count: 1, sum: value, min: Inf, max: -Inf,
+                firstTime: timestamp, lastTime: timestamp,
+                first: value, last: value)
+  else:
+    inc s.count
+    s.sum += value
+    s.increase += (if value < s.last: value else: value - s.last)
+    s.last = value
+    s.lastTime = timestamp
+  if value < s.min: s.min = value
+  if value > s.max: s.max = value
+
+proc merge*(a: var Summary, b: Summary) =
+  ## Combine with the summary of points that all follow `a`'s
+  if b.count == 0:
+    return
+  if a.count == 0:
+    a = b
+    return
+  a.count += b.count
+  a.sum += b.sum
+  a.min = min(a.min, b.min)
+  a.max = max(a.max, b.max)
+  a.increase += b.increase + (if b.first < a.last: b.first else: b.first - a.last)
+  a.last = b.last
+  a.lastTime = b.lastTime
+
+proc mean*(s: Summary): float64 {.inline.} =
+  ## Average value (NaN if empty)
+  s.sum / float64(s.count)
+
+proc rate*(s: Summary): float64 =
+  ## Counter increase per timestamp unit between the first and last point
+  ## (0 with fewer than two points)
+  if s.count < 2 or s.lastTime == s.firstTime: 0.0
+  else: s.increase / float64(s.lastTime - s.firstTime)
+
+# =============================================================================
+# Bucket Grids
+# =============================================================================
+
+proc init*(_: typedesc[BucketGrid], fromTime, toTime: int64,
+           buckets = 1): BucketGrid =
+  ## Split [fromTime, toTime] into `buckets` buckets of equal width,
+  ## ceil((toTime - fromTime + 1) / buckets); the last may be shorter.
+  if toTime < fromTime:
+    raise newException(ValueError, "empty time range")
+  if buckets < 1:
+    raise newException(ValueError, "need at least one bucket")
+  let span = cast[uint64](toTime) - cast[uint64](fromTime)
+  # The whole int64 range in one bucket wraps the width to 0
+  let width = span div uint64(buckets) + 1
+  BucketGrid(fromTime: fromTime, toTime: toTime,
+             width: (if width == 0: high(uint64) else: width), buckets: buckets)
+
+proc bucketOf*(g: BucketGrid, timestamp: int64): int {.inline.} =
+  ## Bucket of a timestamp inside the grid
+  min(int((cast[uint64](timestamp) - cast[uint64](g.fromTime)) div g.width),
+      g.buckets - 1)
+
+proc bucketStart*(g: BucketGrid, i: int): int64 {.inline.} =
+  ## First timestamp of bucket `i`
+  cast[int64](cast[uint64](g.fromTime) + uint64(i) * g.width)
+
+proc bucketEnd*(g: BucketGrid, i: int): int64 {.inline.} =
+  ## Last timestamp of bucket `i`
+  if i >= g.buckets - 1:
+    return g.toTime
+  let offset = uint64(i + 1) * g.width - 1
+  if offset >= cast[uint64](g.toTime) - cast[uint64](g.fromTime): g.toTime
+  else: cast[int64](cast[uint64](g.fromTime) + offset)
+
+# =============================================================================
+# Batch Kernel
+# =============================================================================
+
+type Values = ptr UncheckedArray[float64]
+
+proc reduceValues(v: Values, n: int, s: var Summary) =
+  ## Sum, min, max and increase of v[0 ..< n] into `s`
+  var sum = 0.0
+  var lo = Inf
+  var hi = -Inf
+  var increase = 0.0
+  var i = 0
+  var j = 1
+  when X86Reduce:
+    if n >= 8:
+      # Two accumulators per quantity to hide add latency. Min/max take
+      # the data as first operand, so NaN lanes keep the accumulator.
+      let zero = mm_set1_pd(0.0)
+      var s0 = zero
+      var s1 = zero
+      var lo0 = mm_set1_pd(Inf)
+      var lo1 = lo0
+      var hi0 = mm_set1_pd(-Inf)
+      var hi1 = hi0
+      while i + 4 <= n:
+        let a = mm_loadu_pd(addr v[i])
+        let b = mm_loadu_pd(addr v[i + 2])
+        s0 = mm_add_pd(s0, a)
+        s1 = mm_add_pd(s1, b)
+        lo0 = mm_min_pd(a, lo0)
+        lo1 = mm_min_pd(b, lo1)
+        hi0 = mm_max_pd(a, hi0)
+        hi1 = mm_max_pd(b, hi1)
+        i += 4
+      # Increase: v[j] - v[j-1], or v[j] where that is negative (a reset)
+      var inc0 = zero
+      while j + 2 <= n:
+        let cur = mm_loadu_pd(addr v[j])
+        let d = mm_sub_pd(cur, mm_loadu_pd(addr v[j - 1]))
+        let reset = mm_cmplt_pd(d, zero)
+        inc0 = mm_add_pd(inc0, mm_or_pd(mm_and_pd(reset, cur), mm_andnot_pd(reset, d)))
+        j += 2
+      var lanes {.noinit.}: array[2, float64]
+      mm_storeu_pd(addr lanes[0], mm_add_pd(s0, s1))
+      sum = lanes[0] + lanes[1]
+      mm_storeu_pd(addr lanes[0], mm_min_pd(lo0, lo1))
+      lo = min(lanes[0], lanes[1])
+      mm_storeu_pd(addr lanes[0], mm_max_pd(hi0, hi1))
+      hi = max(lanes[0], lanes[1])
+      mm_storeu_pd(addr lanes[0], inc0)
+      increase = lanes[0] + lanes[1]
+  for k in i ..< n:
+    sum += v[k]
+    if v[k] < lo: lo = v[k]
+    if v[k] > hi: hi = v[k]
+  for k in j ..< n:
+    increase += (if v[k] < v[k - 1]: v[k] else: v[k] - v[k - 1])
+  s.sum = sum
+  s.min = lo
+  s.max = hi
+  s.increase = increase
+
+proc spanSummary(ts: openArray[int64], vs: openArray[float64], a, b: int): Summary =
+  ## Summary of points a ..< b of a decoded batch
+  result.count = b - a
+  result.firstTime = ts[a]
+  result.lastTime = ts[b - 1]
+  result.first = vs[a]
+  result.last = vs[b - 1]
+  reduceValues(cast[Values](unsafeAddr vs[a]), b - a, result)
+
+# =============================================================================
+# Block Aggregation
+# =============================================================================
+
+proc summarizeInto*(data: seq[uint8], numPoints: int, grid: BucketGrid,
+                    into: var openArray[Summary]) =
+  ## Merge the points of a Gorilla block that fall in `grid` into `into`
+  ## (one summary per bucket). Blocks must come in time order, after any
+  ## points already merged. Decoding stops at the first point past the
+  ## grid.
+  assert into.len >= grid.buckets
+  var dec = newGorillaDecoder(data)
+  var ts {.noinit.}: array[Batch, int64]
+  var vs {.noinit.}: array[Batch, float64]
+  var left = numPoints
+  while left > 0:
+    let n = min(left, Batch)
+    for k in 0 ..< n:
+      let point = dec.decode()
+      ts[k] = point[0]
+      vs[k] = point[1]
+    left -= n
+    # Timestamps increase, so each bucket's points form one run
+    var i = 0
+    while i < n and ts[i] < grid.fromTime:
+      inc i
+    while i < n:
+      if ts[i] > grid.toTime:
+        return
+      let b = grid.bucketOf(ts[i])
+      let last = grid.bucketEnd(b)
+      var j = i + 1
+      while j < n and ts[j] <= last:
+        inc j
+      into[b].merge(spanSummary(ts, vs, i, j))
+      i = j
+
+proc summarize*(data: seq[uint8], numPoints: int, fromTime = low(int64),
+                toTime = high(int64)): Summary =
+  ## Summary of the points of a Gorilla block in [fromTime, toTime]
+  var one: array[1, Summary]
+  summarizeInto(data, numPoints, BucketGrid.init(fromTime, toTime), one)
+  one[0]
+
+proc downsample*(data: seq[uint8], numPoints: int, grid: BucketGrid): seq[Summary] =
+  ## One summary per bucket of `grid` (count 0 for empty buckets)
+  result = newSeq[Summary](grid.buckets)
+  summarizeInto(data, numPoints, grid, result)
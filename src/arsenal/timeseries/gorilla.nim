@@ -16,6 +16,10 @@
 ## - 51% values: 1 bit (identical to previous)
 ## - 30% values: ~26 bits (similar values)
 ## - 19% values: ~37 bits (different values)
+##
+## Bits are packed LSB-first through a 64-bit accumulator that is flushed
+## as little-endian words, so a code and its payload (up to 57 bits) are
+## written or read in one operation rather than bit by bit.
 
 import std/[bitops, math]
 
@@ -25,6 +29,8 @@ type
     data: seq[uint8]
     bitPos: int           # Current bit position for writing
     readBitPos: int       # Current bit position for reading
+    acc: uint64           # Written bits not yet past a byte boundary
+    accBits: int          # Bits in `acc` (0..7 between writes)
 
   GorillaEncoder* = object
     ## Encodes time series data points using Gorilla compression.
@@ -60,45 +66,83 @@ type
 # BitBuffer Operations
 # =============================================================================
 
+const MaxBitsPerOp* = 57
+  ## Widest field `writeBits`/`readBits` handle in a single step (wider
+  ## fields take two)
+
 proc newBitBuffer*(capacity: int = 256): BitBuffer =
   BitBuffer(
-    data: newSeq[uint8](capacity),
+    data: newSeq[uint8](max(capacity, 8)),
     bitPos: 0,
     readBitPos: 0
   )
 
-proc writeBit*(buf: var BitBuffer, bit: bool) =
-  ## Write a single bit
-  let byteIdx = buf.bitPos div 8
-  let bitIdx = 7 - (buf.bitPos mod 8)
-
-  if byteIdx >= buf.data.len:
-    buf.data.setLen(buf.data.len * 2)
-
-  if bit:
-    buf.data[byteIdx] = buf.data[byteIdx] or (1'u8 shl bitIdx)
+proc storeLE64(data: var seq[uint8], pos: int, v: uint64) {.inline.} =
+  when cpuEndian == littleEndian:
+    copyMem(addr data[pos], unsafeAddr v, 8)
   else:
-    buf.data[byteIdx] = buf.data[byteIdx] and not (1'u8 shl bitIdx)
-
-  inc buf.bitPos
-
-proc writeBits*(buf: var BitBuffer, value: uint64, numBits: int) =
-  ## Write multiple bits (MSB first)
-  for i in countdown(numBits - 1, 0):
-    buf.writeBit(((value shr i) and 1) == 1)
-
-proc readBit*(buf: var BitBuffer): bool =
+    for i in 0 ..< 8:
+      data[pos + i] = uint8((v shr (8 * i)) and 0xFF)
+
+proc loadLE64(data: seq[uint8], pos: int): uint64 {.inline.} =
+  ## 8 bytes at `pos`, zero past the end of `data`
+  if pos + 8 <= data.len:
+    when cpuEndian == littleEndian:
+      copyMem(addr result, unsafeAddr data[pos], 8)
+    else:
+      for i in 0 ..< 8:
+        result = result or (uint64(data[pos + i]) shl (8 * i))
+  else:
+    for i in 0 ..< max(0, data.len - pos):
+      result = result or (uint64(data[pos + i]) shl (8 * i))
+
+proc lowBits(n: int): uint64 {.inline.} =
+  ## Mask of the `n` (0..64) low bits
+  if n >= 64: high(uint64) else: (1'u64 shl n) - 1
+
+proc writeBits*(buf: var BitBuffer, value: uint64, numBits: int) {.inline.} =
+  ## Write the `numBits` (0..64) low bits of `value`, LSB first
+  if numBits > MaxBitsPerOp:
+    buf.writeBits(value and 0xFFFF_FFFF'u64, 32)
+    buf.writeBits(value shr 32, numBits - 32)
+    return
+  buf.acc = buf.acc or ((value and lowBits(numBits)) shl buf.accBits)
+  buf.accBits += numBits
+  buf.bitPos += numBits
+  # Store the whole accumulator, then keep only the partial byte
+  let pos = (buf.bitPos - buf.accBits) shr 3
+  if pos + 8 > buf.data.len:
+    buf.data.setLen(max(buf.data.len * 2, pos + 8))
+  buf.data.storeLE64(pos, buf.acc)
+  let flushed = buf.accBits and not 7
+  buf.acc = (buf.acc shr (flushed shr 1)) shr (flushed shr 1)   # shr 64 safe
+  buf.accBits = buf.accBits and 7
+
+proc writeBit*(buf: var BitBuffer, bit: bool) {.inline.} =
+  ## Write a single bit
+  buf.writeBits(uint64(ord(bit)), 1)
+
+proc peekBits*(buf: BitBuffer, numBits: int): uint64 {.inline.} =
+  ## The next `numBits` (0..57) bits without consuming them (zero past
+  ## the end of the data)
+  let word = buf.data.loadLE64(buf.readBitPos shr 3)
+  (word shr (buf.readBitPos and 7)) and lowBits(numBits)
+
+proc skipBits*(buf: var BitBuffer, numBits: int) {.inline.} =
+  ## Consume `numBits` bits
+  buf.readBitPos += numBits
+
+proc readBits*(buf: var BitBuffer, numBits: int): uint64 {.inline.} =
+  ## Read `numBits` (0..64) bits written by `writeBits`
+  if numBits > MaxBitsPerOp:
+    let lo = buf.readBits(32)
+    return lo or (buf.readBits(numBits - 32) shl 32)
+  result = buf.peekBits(numBits)
+  buf.readBitPos += numBits
+
+proc readBit*(buf: var BitBuffer): bool {.inline.} =
   ## Read a single bit
-  let byteIdx = buf.readBitPos div 8
-  let bitIdx = 7 - (buf.readBitPos mod 8)
-  inc buf.readBitPos
-  result = ((buf.data[byteIdx] shr bitIdx) and 1) == 1
-
-proc readBits*(buf: var BitBuffer, numBits: int): uint64 =
-  ## Read multiple bits (MSB first)
-  result = 0
-  for i in 0 ..< numBits:
-    result = (result shl 1) or (if buf.readBit(): 1'u64 else: 0'u64)
+  buf.readBits(1) == 1
 
 proc getData*(buf: BitBuffer): seq[uint8] =
   ## Get the buffer data (trimmed to actual size)
@@ -120,18 +164,26 @@ proc getData*(buf: BitBuffer): seq[uint8] =
 ## Encoding scheme:
 ## ----------------
 ## Case 1: D = 0           -> write '0'                (1 bit)
-## Case 2: D in [-63,64]   -> write '10' + D (7 bits)  (9 bits)
-## Case 3: D in [-255,256] -> write '110' + D (9 bits) (12 bits)
-## Case 4: D in [-2047,2048] -> write '1110' + D (12 bits) (16 bits)
+## Case 2: D in [-64,63]   -> write '10' + D (7 bits)  (9 bits)
+## Case 3: D in [-256,255] -> write '110' + D (9 bits) (12 bits)
+## Case 4: D in [-2048,2047] -> write '1110' + D (12 bits) (16 bits)
 ## Case 5: otherwise       -> write '1111' + D (32 bits) (36 bits)
 ##
+## D is zigzag-encoded in cases 2-4. Codes are written first-bit-lowest,
+## so '110' is the value 0b011 and a code plus its payload is one write.
+##
 ## Results: ~96% of timestamps compress to 1 bit
 
+proc zigzag(v: int64): uint64 {.inline.} =
+  uint64((v shl 1) xor (v shr 63))
+
+proc unzigzag(v: uint64): int64 {.inline.} =
+  int64(v shr 1) xor -int64(v and 1)
+
 proc encodeTimestamp(enc: var GorillaEncoder, timestamp: int64) =
   ## Encode a timestamp using delta-of-delta
   if enc.firstTimestamp:
-    # First timestamp: store as delta from block start (14 bits)
-    # Allows 1-second granularity in 2-hour window
+    # First timestamp: stored in full
     enc.buffer.writeBits(uint64(timestamp), 64)
     enc.prevTimestamp = timestamp
     enc.prevDelta = 0
@@ -143,49 +195,19 @@ proc encodeTimestamp(enc: var GorillaEncoder, timestamp: int64) =
 
   if deltaOfDelta == 0:
     # Case 1: Same interval as before - most common (96%)
-    enc.buffer.writeBit(false)  # '0'
-
-  elif deltaOfDelta >= -63 and deltaOfDelta <= 64:
-    # Case 2: Small change, 7 bits
-    enc.buffer.writeBit(true)   # '1'
-    enc.buffer.writeBit(false)  # '0'
-    # Use ZigZag encoding for signed -> unsigned
-    let zigzag = if deltaOfDelta >= 0:
-      uint64(deltaOfDelta * 2)
-    else:
-      uint64(-deltaOfDelta * 2 - 1)
-    enc.buffer.writeBits(zigzag, 7)
-
-  elif deltaOfDelta >= -255 and deltaOfDelta <= 256:
-    # Case 3: Medium change, 9 bits
-    enc.buffer.writeBit(true)   # '1'
-    enc.buffer.writeBit(true)   # '1'
-    enc.buffer.writeBit(false)  # '0'
-    let zigzag = if deltaOfDelta >= 0:
-      uint64(deltaOfDelta * 2)
-    else:
-      uint64(-deltaOfDelta * 2 - 1)
-    enc.buffer.writeBits(zigzag, 9)
-
-  elif deltaOfDelta >= -2047 and deltaOfDelta <= 2048:
-    # Case 4: Larger change, 12 bits
-    enc.buffer.writeBit(true)   # '1'
-    enc.buffer.writeBit(true)   # '1'
-    enc.buffer.writeBit(true)   # '1'
-    enc.buffer.writeBit(false)  # '0'
-    let zigzag = if deltaOfDelta >= 0:
-      uint64(deltaOfDelta * 2)
-    else:
-      uint64(-deltaOfDelta * 2 - 1)
-    enc.buffer.writeBits(zigzag, 12)
-
+    enc.buffer.writeBits(0b0, 1)
+  elif deltaOfDelta >= -64 and deltaOfDelta <= 63:
+    # Case 2: '10' + 7 bits
+    enc.buffer.writeBits(0b01 or (zigzag(deltaOfDelta) shl 2), 9)
+  elif deltaOfDelta >= -256 and deltaOfDelta <= 255:
+    # Case 3: '110' + 9 bits
+    enc.buffer.writeBits(0b011 or (zigzag(deltaOfDelta) shl 3), 12)
+  elif deltaOfDelta >= -2048 and deltaOfDelta <= 2047:
+    # Case 4: '1110' + 12 bits
+    enc.buffer.writeBits(0b0111 or (zigzag(deltaOfDelta) shl 4), 16)
   else:
-    # Case 5: Full 32-bit delta
-    enc.buffer.writeBit(true)   # '1'
-    enc.buffer.writeBit(true)   # '1'
-    enc.buffer.writeBit(true)   # '1'
-    enc.buffer.writeBit(true)   # '1'
-    enc.buffer.writeBits(cast[uint64](deltaOfDelta), 32)
+    # Case 5: '1111' + 32 bits
+    enc.buffer.writeBits(0b1111 or ((cast[uint64](deltaOfDelta) and 0xFFFF_FFFF'u64) shl 4), 36)
 
   enc.prevDelta = delta
   enc.prevTimestamp = timestamp
@@ -230,38 +252,38 @@ proc encodeValue(enc: var GorillaEncoder, value: float64) =
 
   if xored == 0:
     # Case 1: Identical value (51% of cases)
-    enc.buffer.writeBit(false)  # '0'
+    enc.buffer.writeBits(0b0, 1)
 
   else:
-    enc.buffer.writeBit(true)   # '1'
-
-    # Count leading and trailing zeros
+    # Count leading and trailing zeros (leading stored in 5 bits)
     let leadingZeros = countLeadingZeroBits(xored)
     let trailingZeros = countTrailingZeroBits(xored)
-    let meaningfulBits = 64 - leadingZeros - trailingZeros
 
     # Check if meaningful bits fit within previous window
     if leadingZeros >= enc.prevLeadingZeros and
        trailingZeros >= enc.prevTrailingZeros:
-      # Case 2: Reuse previous window (30% of cases)
-      enc.buffer.writeBit(false)  # '0'
-      # Extract and write only the meaningful bits using previous window
+      # Case 2: '10' + the bits of the previous window (30% of cases)
       let prevMeaningfulBits = 64 - enc.prevLeadingZeros - enc.prevTrailingZeros
       let shifted = xored shr enc.prevTrailingZeros
-      enc.buffer.writeBits(shifted, prevMeaningfulBits)
+      if prevMeaningfulBits <= MaxBitsPerOp - 2:
+        enc.buffer.writeBits(0b01 or (shifted shl 2), prevMeaningfulBits + 2)
+      else:
+        enc.buffer.writeBits(0b01, 2)
+        enc.buffer.writeBits(shifted, prevMeaningfulBits)
 
     else:
-      # Case 3: New window needed (19% of cases)
-      enc.buffer.writeBit(true)   # '1'
-      # Write leading zeros (5 bits, max 31)
-      enc.buffer.writeBits(uint64(min(leadingZeros, 31)), 5)
-      # Write meaningful bit count (6 bits, 1-64 stored as 0-63)
-      enc.buffer.writeBits(uint64(meaningfulBits - 1), 6)
-      # Write the meaningful bits
+      # Case 3: '11' + leading zeros (5) + length - 1 (6) + bits (19%)
+      let lz = min(leadingZeros, 31)
+      let meaningfulBits = 64 - lz - trailingZeros
+      let header = 0b11'u64 or (uint64(lz) shl 2) or (uint64(meaningfulBits - 1) shl 7)
       let shifted = xored shr trailingZeros
-      enc.buffer.writeBits(shifted, meaningfulBits)
+      if meaningfulBits <= MaxBitsPerOp - 13:
+        enc.buffer.writeBits(header or (shifted shl 13), meaningfulBits + 13)
+      else:
+        enc.buffer.writeBits(header, 13)
+        enc.buffer.writeBits(shifted, meaningfulBits)
 
-      enc.prevLeadingZeros = leadingZeros
+      enc.prevLeadingZeros = lz
       enc.prevTrailingZeros = trailingZeros
 
   enc.prevValue = valueBits
@@ -298,6 +320,25 @@ proc finish*(enc: GorillaEncoder): seq[uint8] =
   ## Finish encoding and return compressed data.
   enc.buffer.getData()
 
+proc reset*(enc: var GorillaEncoder, blockStartTime: int64 = 0) =
+  ## Start a new block, reusing the buffer of the previous one (as if
+  ## freshly created by `newGorillaEncoder`).
+  if enc.buffer.data.len == 0:
+    enc.buffer = newBitBuffer(1024)
+  else:
+    # Stale bytes past `bitPos` are overwritten before they are read
+    enc.buffer.bitPos = 0
+    enc.buffer.readBitPos = 0
+    enc.buffer.acc = 0
+    enc.buffer.accBits = 0
+  enc.prevTimestamp = blockStartTime
+  enc.prevDelta = 0
+  enc.firstTimestamp = true
+  enc.prevValue = 0
+  enc.prevLeadingZeros = 0
+  enc.prevTrailingZeros = 0
+  enc.firstValue = true
+
 proc newGorillaDecoder*(data: seq[uint8], blockStartTime: int64 = 0): GorillaDecoder =
   ## Create a decoder for Gorilla-compressed data.
   result = GorillaDecoder(
@@ -317,42 +358,21 @@ proc decodeTimestamp(dec: var GorillaDecoder): int64 =
     dec.prevTimestamp = int64(dec.buffer.readBits(64))
     return dec.prevTimestamp
 
-  # Read control bits to determine encoding
-  if not dec.buffer.readBit():
-    # '0' - same delta as before
-    dec.prevTimestamp += dec.prevDelta
-    return dec.prevTimestamp
-
-  # Determine which case based on prefix
+  # The code is the run of 1 bits before the first 0 (at most 4)
+  let code = dec.buffer.peekBits(4)
   var deltaOfDelta: int64
-
-  if not dec.buffer.readBit():
-    # '10' - 7 bit delta-of-delta
-    let zigzag = dec.buffer.readBits(7)
-    deltaOfDelta = if (zigzag and 1) == 0:
-      int64(zigzag div 2)
-    else:
-      -int64((zigzag + 1) div 2)
-
-  elif not dec.buffer.readBit():
-    # '110' - 9 bit
-    let zigzag = dec.buffer.readBits(9)
-    deltaOfDelta = if (zigzag and 1) == 0:
-      int64(zigzag div 2)
-    else:
-      -int64((zigzag + 1) div 2)
-
-  elif not dec.buffer.readBit():
-    # '1110' - 12 bit
-    let zigzag = dec.buffer.readBits(12)
-    deltaOfDelta = if (zigzag and 1) == 0:
-      int64(zigzag div 2)
-    else:
-      -int64((zigzag + 1) div 2)
-
+  case countTrailingZeroBits(not code)
+  of 0:
+    # '0' - same delta as before
+    dec.buffer.skipBits(1)
+  of 1:
+    deltaOfDelta = unzigzag(dec.buffer.readBits(9) shr 2)
+  of 2:
+    deltaOfDelta = unzigzag(dec.buffer.readBits(12) shr 3)
+  of 3:
+    deltaOfDelta = unzigzag(dec.buffer.readBits(16) shr 4)
   else:
-    # '1111' - 32 bit
-    deltaOfDelta = cast[int64](dec.buffer.readBits(32))
+    deltaOfDelta = int64(cast[int32](uint32(dec.buffer.readBits(36) shr 4)))
 
   dec.prevDelta += deltaOfDelta
   dec.prevTimestamp += dec.prevDelta
@@ -365,21 +385,25 @@ proc decodeValue(dec: var GorillaDecoder): float64 =
     dec.firstPoint = false
     return cast[float64](dec.prevValue)
 
-  if not dec.buffer.readBit():
+  let code = dec.buffer.peekBits(2)
+  if (code and 1) == 0:
     # '0' - same value
+    dec.buffer.skipBits(1)
     return cast[float64](dec.prevValue)
 
   var xored: uint64
 
-  if not dec.buffer.readBit():
+  if (code and 2) == 0:
     # '10' - reuse previous window
+    dec.buffer.skipBits(2)
     let meaningfulBits = 64 - dec.prevLeadingZeros - dec.prevTrailingZeros
     xored = dec.buffer.readBits(meaningfulBits) shl dec.prevTrailingZeros
 
   else:
     # '11' - new window
-    let leadingZeros = int(dec.buffer.readBits(5))
-    let meaningfulBits = int(dec.buffer.readBits(6)) + 1
+    let header = dec.buffer.readBits(13)
+    let leadingZeros = int((header shr 2) and 31)
+    let meaningfulBits = int(header shr 7) + 1
     let trailingZeros = 64 - leadingZeros - meaningfulBits
 
     xored = dec.buffer.readBits(meaningfulBits) shl trailingZeros
@@ -0,0 +1,533 @@
+## Chunked Time Series Store
+## =========================
+##
+## Many series of (timestamp, float64) points, stored as Gorilla blocks.
+## Each series has one open chunk taking appends; a point in a new time
+## window (`window` timestamp units, default two hours of seconds as in
+## the Gorilla paper) seals it. Sealed chunks wait in memory until
+## `segmentBytes` have collected, then go to a new immutable segment file
+## that stays memory-mapped.
+##
+## - Writes: one hash lookup and one Gorilla encode per point (batched
+##   appends to one series skip the lookup); sealing copies the chunk once.
+## - Reads: a series keeps its chunks in time order, so a range query
+##   binary-searches the first overlapping chunk and decodes only the
+##   chunks that overlap the range, plus the open chunk.
+## - Aggregates: every chunk carries a value summary (count, sum, min,
+##   max, first, last, counter increase) in its index record, so
+##   `summarize` and `downsample` use it for chunks that lie wholly in
+##   one bucket and decode only the chunks cut by a range or bucket edge.
+##   Buckets aligned to multiples of `window` never cut a chunk.
+## - Windows: Gorilla stores a timestamp delta-of-delta in at most 32
+##   bits, so `window` may not exceed `high(int32)` units (about 2.1 s of
+##   nanoseconds; use coarser timestamps or a smaller window).
+## - Durability: points reach disk with their chunk. `close` (or
+##   `flush(sealOpen = true)`) seals and writes the open chunks as well.
+##   There is no write-ahead log: unflushed points are lost on a crash.
+##   Segments are fsynced before they are renamed into place (on POSIX),
+##   so a written segment survives a power loss.
+##
+## Segment file layout (little-endian):
+##   "TSDB", version u32
+##   chunk data: Gorilla blocks, grouped by series
+##   index, per chunk: series u64, minTime i64, maxTime i64, offset u64,
+##     length u32, count u32, then f64 minValue, maxValue, sum,
+##     firstValue, lastValue, increase; sorted by series, then time
+##     (version 1 segments lack the f64 fields; they are computed on open)
+##   footer: index offset u64, chunk count u32, "TSDB"
+##
+## Usage:
+## ```nim
+## import arsenal/timeseries/store
+##
+## var db = TimeSeriesStore.init("metrics")
+## db.append(seriesId, timestamp, value)
+## for (ts, value) in db.query(seriesId, fromTime, toTime):
+##   echo ts, " ", value
+## echo db.summarize(seriesId, fromTime, toTime).mean
+## for bucket in db.downsample(seriesId, BucketGrid.init(fromTime, toTime, 24)):
+##   echo bucket.min, " ", bucket.max
+## db.close()
+## ```
+##
+## Reference: Pelkonen et al., "Gorilla: A Fast, Scalable, In-Memory Time
+## Series Database" (VLDB 2015), sections 4.1-4.3
+
+import std/[memfiles, os, algorithm, strutils, parseutils, endians, math, options]
+import ./gorilla
+import ./aggregate
+import ../datastructures/hashtables/swiss_table
+
+when defined(posix):
+  from std/posix import nil
+
+export aggregate
+
+const
+  DefaultWindow* = 7200'i64              ## Two hours, in seconds
+  DefaultSegmentBytes* = 16 shl 20
+  SegmentMagic = "TSDB"
+  SegmentVersion = 2'u32
+  SegmentHeaderSize = 8
+  IndexRecordSize = 88
+  V1IndexRecordSize = 40                 # Without value summaries
+  FooterSize = 16
+
+type
+  ChunkRef* = object
+    ## A sealed chunk: the time range it covers and where its bytes are
+    minTime*, maxTime*: int64
+    count*: int                          ## Points in the chunk
+    segment*: int                        ## Mapped segment, or -1 until flushed
+    offset*: int                         ## In the segment (or pending buffer)
+    length*: int
+    minValue*, maxValue*: float64        ## Of the non-NaN values
+    sum*: float64
+    firstValue*, lastValue*: float64
+    increase*: float64                   ## Counter increase within the chunk
+
+  Series = object
+    id: uint64
+    chunks: seq[ChunkRef]                # Sealed, in time order
+    head: GorillaEncoder                 # Open chunk
+    headStats: Summary                   # Of the open chunk
+    headWindow: int64
+    lastTime: int64
+    hasPoints: bool
+
+  TimeSeriesStore* = object
+    ## Series of Gorilla chunks backed by a directory of segment files
+    dir: string
+    window: int64
+    segmentBytes: int
+    index: SwissTable[uint64, int32]     # Series id -> slot in `series`
+    series: seq[Series]
+    segments: seq[MemFile]
+    nextSegment: int                     # Number of the next segment file
+    pending: seq[byte]                   # Sealed chunks not yet written
+    pendingChunks: seq[tuple[slot, chunk: int32]]
+    numPoints: int
+    numSealed: int
+    closed: bool                         # After `close`: no further use
+
+proc `=destroy`*(s: var TimeSeriesStore) =
+  ## Unmaps the segments; unlike `close`, does not write pending chunks
+  for m in s.segments.mitems:
+    m.close()
+  s.index.destroy()
+  `=destroy`(s.dir)
+  `=destroy`(s.series)
+  `=destroy`(s.segments)
+  `=destroy`(s.pending)
+  `=destroy`(s.pendingChunks)
+
+proc `=copy`*(dest: var TimeSeriesStore, src: TimeSeriesStore) {.error.}
+
+# =============================================================================
+# Helpers
+# =============================================================================
+
+type Bytes = ptr UncheckedArray[byte]
+
+proc putU32(buf: var seq[byte], pos: int, v: uint32) {.inline.} =
+  var x = v
+  littleEndian32(addr buf[pos], addr x)
+
+proc putU64(buf: var seq[byte], pos: int, v: uint64) {.inline.} =
+  var x = v
+  littleEndian64(addr buf[pos], addr x)
+
+proc getU32(p: Bytes, pos: int): uint32 {.inline.} =
+  littleEndian32(addr result, addr p[pos])
+
+proc getU64(p: Bytes, pos: int): uint64 {.inline.} =
+  littleEndian64(addr result, addr p[pos])
+
+proc hasMagic(p: Bytes, pos: int): bool =
+  for i in 0 ..< SegmentMagic.len:
+    if p[pos + i] != byte(SegmentMagic[i]):
+      return false
+  true
+
+template checkOpen(s: TimeSeriesStore) =
+  assert not s.closed, "TimeSeriesStore used after close"
+
+proc syncPath(path: string) =
+  ## fsync a file or directory (a no-op where POSIX fsync is unavailable)
+  when defined(posix):
+    let fd = posix.open(path.cstring, posix.O_RDONLY)
+    if fd < 0:
+      raiseOSError(osLastError(), path)
+    let failed = posix.fsync(fd) != 0
+    let err = osLastError()
+    discard posix.close(fd)
+    if failed:
+      raiseOSError(err, path)
+
+proc segmentPath(dir: string, number: int): string =
+  dir / ("segment-" & intToStr(number, 6) & ".tsdb")
+
+proc slotFor(s: var TimeSeriesStore, id: uint64): int {.inline.} =
+  ## Slot of series `id`, created empty if new
+  let next = int32(s.series.len)
+  result = int(s.index.mgetOrPut(id, next))
+  if result == next:
+    s.series.add Series(id: id)
+
+proc setSummary(c: var ChunkRef, stats: Summary) =
+  c.minValue = stats.min
+  c.maxValue = stats.max
+  c.sum = stats.sum
+  c.firstValue = stats.first
+  c.lastValue = stats.last
+  c.increase = stats.increase
+
+# =============================================================================
+# Segments
+# =============================================================================
+
+proc loadSegment(s: var TimeSeriesStore, path: string) =
+  ## Map a segment file and add its chunks to the series index
+  if getFileSize(path) < SegmentHeaderSize + FooterSize:
+    raise newException(IOError, path & ": not a segment file")
+  var m = memfiles.open(path, mode = fmRead)
+  let base = cast[Bytes](m.mem)
+  template fail(msg: string) =
+    m.close()
+    raise newException(IOError, path & ": " & msg)
+
+  if not hasMagic(base, 0) or not hasMagic(base, m.size - 4):
+    fail("not a segment file")
+  let version = getU32(base, 4)
+  if version notin [1'u32, SegmentVersion]:
+    fail("unsupported segment version " & $version)
+  let recordSize = if version == 1: V1IndexRecordSize else: IndexRecordSize
+  let indexOffset = getU64(base, m.size - FooterSize)
+  let count = int(getU32(base, m.size - 8))
+  if indexOffset < SegmentHeaderSize or
+     indexOffset + uint64(count * recordSize) != uint64(m.size - FooterSize):
+    fail("corrupt index")
+
+  let segment = s.segments.len
+  for i in 0 ..< count:
+    let r = int(indexOffset) + i * recordSize
+    var c = ChunkRef(
+      minTime: cast[int64](getU64(base, r + 8)),
+      maxTime: cast[int64](getU64(base, r + 16)),
+      offset: int(getU64(base, r + 24)),
+      length: int(getU32(base, r + 32)),
+      count: int(getU32(base, r + 36)),
+      segment: segment)
+    if c.offset < SegmentHeaderSize or c.offset + c.length > int(indexOffset) or
+       c.count == 0 or c.length == 0 or c.minTime > c.maxTime:
+      fail("corrupt chunk " & $i)
+    if version == 1:
+      var data = newSeq[uint8](c.length)
+      copyMem(addr data[0], addr base[c.offset], c.length)
+      c.setSummary(summarize(data, c.count))
+    else:
+      c.minValue = cast[float64](getU64(base, r + 40))
+      c.maxValue = cast[float64](getU64(base, r + 48))
+      c.sum = cast[float64](getU64(base, r + 56))
+      c.firstValue = cast[float64](getU64(base, r + 64))
+      c.lastValue = cast[float64](getU64(base, r + 72))
+      c.increase = cast[float64](getU64(base, r + 80))
+    let slot = s.slotFor(getU64(base, r))
+    if s.series[slot].hasPoints and c.minTime <= s.series[slot].lastTime:
+      fail("chunk " & $i & " overlaps an earlier chunk of series " & $s.series[slot].id)
+    s.series[slot].chunks.add c
+    s.series[slot].lastTime = c.maxTime
+    s.series[slot].hasPoints = true
+    s.numPoints += c.count
+    inc s.numSealed
+  s.segments.add m
+
+proc writeSegment(s: var TimeSeriesStore) =
+  ## Write the pending chunks to a new segment file and map it
+  if s.pendingChunks.len == 0:
+    return
+  var order = newSeqOfCap[(uint64, int64, int32, int32)](s.pendingChunks.len)
+  for (slot, chunk) in s.pendingChunks:
+    order.add (s.series[slot].id, s.series[slot].chunks[chunk].minTime, slot, chunk)
+  order.sort()
+
+  let indexOffset = SegmentHeaderSize + s.pending.len
+  var file = newSeq[byte](indexOffset + order.len * IndexRecordSize + FooterSize)
+  for i in 0 ..< 4:
+    file[i] = byte(SegmentMagic[i])
+    file[file.len - 4 + i] = byte(SegmentMagic[i])
+  file.putU32(4, SegmentVersion)
+  var offsets = newSeq[int](order.len)
+  var pos = SegmentHeaderSize
+  for i in 0 ..< order.len:
+    let (id, _, slot, chunk) = order[i]
+    let c = s.series[slot].chunks[chunk]
+    copyMem(addr file[pos], addr s.pending[c.offset], c.length)
+    offsets[i] = pos
+    let r = indexOffset + i * IndexRecordSize
+    file.putU64(r, id)
+    file.putU64(r + 8, cast[uint64](c.minTime))
+    file.putU64(r + 16, cast[uint64](c.maxTime))
+    file.putU64(r + 24, uint64(pos))
+    file.putU32(r + 32, uint32(c.length))
+    file.putU32(r + 36, uint32(c.count))
+    file.putU64(r + 40, cast[uint64](c.minValue))
+    file.putU64(r + 48, cast[uint64](c.maxValue))
+    file.putU64(r + 56, cast[uint64](c.sum))
+    file.putU64(r + 64, cast[uint64](c.firstValue))
+    file.putU64(r + 72, cast[uint64](c.lastValue))
+    file.putU64(r + 80, cast[uint64](c.increase))
+    pos += c.length
+  file.putU64(file.len - FooterSize, uint64(indexOffset))
+  file.putU32(file.len - 8, uint32(order.len))
+
+  # Written and synced under a temporary name, renamed, then the directory
+  # synced, so neither a crash nor a power loss leaves a partial segment
+  let path = segmentPath(s.dir, s.nextSegment)
+  let tmp = path & ".tmp"
+  writeFile(tmp, file)
+  syncPath(tmp)
+  moveFile(tmp, path)
+  syncPath(s.dir)
+  s.segments.add memfiles.open(path, mode = fmRead)
+  inc s.nextSegment
+
+  let segment = s.segments.high
+  for i in 0 ..< order.len:
+    let (_, _, slot, chunk) = order[i]
+    s.series[slot].chunks[chunk].segment = segment
+    s.series[slot].chunks[chunk].offset = offsets[i]
+  s.pending.setLen(0)
+  s.pendingChunks.setLen(0)
+
+# =============================================================================
+# Store
+# =============================================================================
+
+proc init*(_: typedesc[TimeSeriesStore], dir: string, window = DefaultWindow,
+           segmentBytes = DefaultSegmentBytes): TimeSeriesStore =
+  ## Open the store in `dir`, creating the directory if needed and
+  ## mapping every existing segment. `window` is the chunk length in
+  ## timestamp units; chunks are aligned to multiples of it. Sealed chunks
+  ## are written out once `segmentBytes` of them are pending.
+  ##
+  ## Raises ValueError if `window` is not in 1 .. high(int32), and IOError
+  ## if a segment file is corrupt.
+  if window <= 0:
+    raise newException(ValueError, "window must be positive")
+  # Deltas inside a chunk stay below `window`; their differences must fit
+  # Gorilla's 32-bit timestamp code
+  if window > high(int32):
+    raise newException(ValueError, "window exceeds the 32-bit Gorilla delta range")
+  createDir(dir)
+  result.dir = dir
+  result.window = window
+  result.segmentBytes = max(1, segmentBytes)
+  result.index = SwissTable[uint64, int32].init()
+
+  var numbers: seq[int]
+  for kind, path in walkDir(dir):
+    let name = extractFilename(path)
+    if kind != pcFile or not name.startsWith("segment-"):
+      continue
+    if name.endsWith(".tsdb.tmp"):
+      removeFile(path)                   # Left by a crash during a flush
+    elif name.endsWith(".tsdb"):
+      let digits = name["segment-".len ..< name.len - ".tsdb".len]
+      var n: int
+      if digits.len > 0 and parseInt(digits, n) == digits.len:
+        numbers.add n
+  numbers.sort()
+  for n in numbers:
+    result.loadSegment(segmentPath(dir, n))
+  result.nextSegment = if numbers.len > 0: numbers[^1] + 1 else: 1
+
+proc sealHead(s: var TimeSeriesStore, slot: int) =
+  ## Move the open chunk of `slot` to the pending buffer
+  template ser: untyped = s.series[slot]
+  let data = ser.head.finish()
+  var chunk = ChunkRef(minTime: ser.headStats.firstTime, maxTime: ser.lastTime,
+                       count: ser.headStats.count, segment: -1,
+                       offset: s.pending.len, length: data.len)
+  chunk.setSummary(ser.headStats)
+  ser.chunks.add chunk
+  s.pending.add data
+  s.pendingChunks.add (int32(slot), int32(ser.chunks.high))
+  ser.headStats = Summary()
+  inc s.numSealed
+
+proc appendAt(s: var TimeSeriesStore, slot: int, timestamp: int64,
+              value: float64) {.inline.} =
+  template ser: untyped = s.series[slot]
+  if ser.hasPoints and timestamp <= ser.lastTime:
+    raise newException(ValueError, "series " & $ser.id & ": timestamp " &
+                       $timestamp & " is not after " & $ser.lastTime)
+  let window = floorDiv(timestamp, s.window)
+  if ser.headStats.count > 0 and window != ser.headWindow:
+    s.sealHead(slot)
+    if s.pending.len >= s.segmentBytes:
+      s.writeSegment()
+  if ser.headStats.count == 0:
+    ser.head.reset()
+    ser.headWindow = window
+  ser.head.encode(timestamp, value)
+  ser.headStats.add(timestamp, value)
+  ser.lastTime = timestamp
+  ser.hasPoints = true
+  inc s.numPoints
+
+proc append*(s: var TimeSeriesStore, series: uint64, timestamp: int64,
+             value: float64) =
+  ## Add a point to `series`, creating the series if new. Timestamps must
+  ## increase within a series; raises ValueError otherwise.
+  s.checkOpen()
+  s.appendAt(s.slotFor(series), timestamp, value)
+
+proc append*(s: var TimeSeriesStore, series: uint64,
+             points: openArray[(int64, float64)]) =
+  ## Add several points to one series (a single index lookup)
+  s.checkOpen()
+  let slot = s.slotFor(series)
+  for (timestamp, value) in points:
+    s.appendAt(slot, timestamp, value)
+
+proc flush*(s: var TimeSeriesStore, sealOpen = false) =
+  ## Write the pending sealed chunks to a new segment. With `sealOpen`,
+  ## seal every open chunk first, so all points so far reach disk; later
+  ## appends in the same window then start a new chunk.
+  s.checkOpen()
+  if sealOpen:
+    for slot in 0 ..< s.series.len:
+      if s.series[slot].headStats.count > 0:
+        s.sealHead(slot)
+  s.writeSegment()
+
+proc close*(s: var TimeSeriesStore) =
+  ## Seal and write all points, then unmap the segments. The store cannot
+  ## be used afterwards (reopen the directory with `init`); calling
+  ## `close` again does nothing.
+  if s.closed:
+    return
+  s.flush(sealOpen = true)
+  for m in s.segments.mitems:
+    m.close()
+  s.segments.setLen(0)
+  s.closed = true
+
+# =============================================================================
+# Queries
+# =============================================================================
+
+proc seriesCount*(s: TimeSeriesStore): int {.inline.} = s.series.len
+proc chunkCount*(s: TimeSeriesStore): int {.inline.} =
+  ## Sealed chunks, flushed or not
+  s.numSealed
+proc pointCount*(s: TimeSeriesStore): int {.inline.} = s.numPoints
+
+proc contains*(s: TimeSeriesStore, series: uint64): bool {.inline.} =
+  series in s.index
+
+proc chunkData*(s: TimeSeriesStore, c: ChunkRef): seq[uint8] =
+  ## The Gorilla block of a sealed chunk
+  s.checkOpen()
+  result = newSeq[uint8](c.length)
+  if c.length > 0:
+    let src =
+      if c.segment < 0: unsafeAddr s.pending[c.offset]
+      else: addr cast[Bytes](s.segments[c.segment].mem)[c.offset]
+    copyMem(addr result[0], src, c.length)
+
+iterator overlapping*(s: TimeSeriesStore, series: uint64,
+                      fromTime, toTime: int64): ChunkRef =
+  ## Sealed chunks of `series` with points in [fromTime, toTime], in time
+  ## order (the open chunk is not included)
+  s.checkOpen()
+  let p = s.index.find(series)
+  if p.isSome:
+    let slot = int(p.get[])
+    var i = s.series[slot].chunks.lowerBound(fromTime,
+      proc (c: ChunkRef, t: int64): int = cmp(c.maxTime, t))
+    while i < s.series[slot].chunks.len and
+          s.series[slot].chunks[i].minTime <= toTime:
+      yield s.series[slot].chunks[i]
+      inc i
+
+iterator points*(s: TimeSeriesStore, series: uint64,
+                 fromTime, toTime: int64): (int64, float64) =
+  ## Points of `series` with timestamps in [fromTime, toTime], in order.
+  ## Decodes only the chunks that overlap the range.
+  s.checkOpen()
+  for c in s.overlapping(series, fromTime, toTime):
+    var dec = newGorillaDecoder(s.chunkData(c))
+    for _ in 0 ..< c.count:
+      let point = dec.decode()
+      if point[0] > toTime:
+        break
+      if point[0] >= fromTime:
+        yield point
+  let p = s.index.find(series)
+  if p.isSome:
+    let slot = int(p.get[])
+    let head = s.series[slot].headStats
+    if head.count > 0 and head.firstTime <= toTime and head.lastTime >= fromTime:
+      var dec = newGorillaDecoder(s.series[slot].head.finish())
+      for _ in 0 ..< head.count:
+        let point = dec.decode()
+        if point[0] > toTime:
+          break
+        if point[0] >= fromTime:
+          yield point
+
+proc query*(s: TimeSeriesStore, series: uint64,
+            fromTime, toTime: int64): seq[(int64, float64)] =
+  ## Points of `series` with timestamps in [fromTime, toTime], inclusive
+  for point in s.points(series, fromTime, toTime):
+    result.add point
+
+# =============================================================================
+# Aggregation
+# =============================================================================
+
+proc summary*(c: ChunkRef): Summary =
+  ## The value summary kept in the chunk's index record
+  Summary(count: c.count, sum: c.sum, min: c.minValue, max: c.maxValue,
+          firstTime: c.minTime, lastTime: c.maxTime,
+          first: c.firstValue, last: c.lastValue, increase: c.increase)
+
+proc summarizeInto(s: TimeSeriesStore, series: uint64, grid: BucketGrid,
+                   into: var openArray[Summary]) =
+  ## Merge the points of `series` in `grid` into `into`, decoding only
+  ## the chunks that a range or bucket edge cuts
+  template inOneBucket(first, last: int64): bool =
+    first >= grid.fromTime and last <= grid.toTime and
+      grid.bucketOf(first) == grid.bucketOf(last)
+
+  for c in s.overlapping(series, grid.fromTime, grid.toTime):
+    if inOneBucket(c.minTime, c.maxTime):
+      into[grid.bucketOf(c.minTime)].merge(c.summary)
+    else:
+      summarizeInto(s.chunkData(c), c.count, grid, into)
+  let p = s.index.find(series)
+  if p.isSome:
+    let slot = int(p.get[])
+    let head = s.series[slot].headStats
+    if head.count > 0 and head.firstTime <= grid.toTime and
+       head.lastTime >= grid.fromTime:
+      if inOneBucket(head.firstTime, head.lastTime):
+        into[grid.bucketOf(head.firstTime)].merge(head)
+      else:
+        summarizeInto(s.series[slot].head.finish(), head.count, grid, into)
+
+proc summarize*(s: TimeSeriesStore, series: uint64,
+                fromTime, toTime: int64): Summary =
+  ## Count, sum, min, max, first, last and increase of the points of
+  ## `series` in [fromTime, toTime], inclusive
+  var one: array[1, Summary]
+  s.summarizeInto(series, BucketGrid.init(fromTime, toTime), one)
+  one[0]
+
+proc downsample*(s: TimeSeriesStore, series: uint64,
+                 grid: BucketGrid): seq[Summary] =
+  ## One summary per bucket of `grid` (count 0 for empty buckets)
+  result = newSeq[Summary](grid.buckets)
+  s.summarizeInto(series, grid, result)
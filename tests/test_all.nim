@@ -22,6 +22,8 @@ include test_allocators
 include test_atomics
 include test_audio_media
 include test_bits
+include test_caching
+include test_compression
 include test_channels
 include test_coroutines
 include test_channels_simple
@@ -44,5 +46,6 @@ include test_nolibc
 include test_random
 include test_select
 include test_swiss_table
+include test_timeseries
 # Note: test_embedded_hal requires embedded hardware platform
 # include test_embedded_hal
\ No newline at end of file
@@ -4,6 +4,8 @@ import std/unittest
 import std/[times, strutils]
 import ../src/arsenal/memory/allocators/bump
 import ../src/arsenal/memory/allocators/pool
+import ../src/arsenal/memory/allocators/numa_local
+import ../src/arsenal/memory/allocators/hugepage
 
 suite "Bump Allocator":
   test "init creates allocator":
@@ -267,3 +269,87 @@ suite "Allocator Comparison":
     # No memory growth after first iteration
     check pool.capacity() > 0
     check pool.len() == 0
+
+suite "NUMA Allocator":
+  test "alloc returns aligned, writable memory":
+    var numaAlloc = NumaAllocator.init(node = 0)
+    let p = numaAlloc.alloc(1 shl 20, 64)
+    check p != nil
+    check (cast[int](p) and 63) == 0
+    zeroMem(p, 1 shl 20)
+    check numaAlloc.boundBytes() + numaAlloc.unboundBytes() >= 1 shl 20
+    numaAlloc.dealloc(p)
+    check numaAlloc.boundBytes() == 0
+    check numaAlloc.unboundBytes() == 0
+
+  test "bound pages land on the requested node":
+    when defined(linux):
+      var numaAlloc = NumaAllocator.init(node = 0)
+      let p = numaAlloc.alloc(4 * 4096)
+      cast[ptr byte](p)[] = 1
+      if isBound(p):
+        check nodeOfAddress(p) == 0
+      numaAlloc.dealloc(p)
+
+  test "realloc preserves contents":
+    var numaAlloc = NumaAllocator.initLocal()
+    let p = cast[ptr UncheckedArray[int]](numaAlloc.alloc(100 * sizeof(int)))
+    for i in 0..<100:
+      p[i] = i
+    let q = cast[ptr UncheckedArray[int]](numaAlloc.realloc(p, 100_000 * sizeof(int)))
+    check q != nil
+    for i in 0..<100:
+      check q[i] == i
+    numaAlloc.dealloc(q)
+
+  test "unknown node falls back to unbound memory":
+    var numaAlloc = NumaAllocator.init(node = 255)
+    let p = numaAlloc.alloc(4096)
+    check p != nil
+    cast[ptr byte](p)[] = 42
+    numaAlloc.dealloc(p)
+
+suite "Huge Page Allocator":
+  test "small allocations use the system heap":
+    var huge = HugePageAllocator.init()
+    let p = huge.alloc(1024)
+    check p != nil
+    check pageKind(p) == hpNone
+    check huge.heapBytes() > 0
+    huge.dealloc(p)
+    check huge.heapBytes() == 0
+
+  test "large allocations are mapped and aligned":
+    var huge = HugePageAllocator.init(threshold = 64 * 1024)
+    let size = 8 * 1024 * 1024
+    let p = huge.alloc(size, 4096)
+    check p != nil
+    check (cast[int](p) and 4095) == 0
+    zeroMem(p, size)
+    let mapped = huge.explicitBytes() + huge.transparentBytes() + huge.regularBytes()
+    when defined(linux):
+      check mapped >= size
+      check isHuge(p) == (huge.fallbacks() == 0)
+    huge.dealloc(p)
+    check huge.explicitBytes() + huge.transparentBytes() + huge.regularBytes() == 0
+
+  test "disabling huge pages reports a fallback":
+    var huge = HugePageAllocator.init(threshold = 0, useExplicit = false,
+                                      useTransparent = false)
+    let p = huge.alloc(4 * 1024 * 1024)
+    check p != nil
+    check pageKind(p) == hpNone
+    when defined(linux):
+      check huge.fallbacks() == 1
+    huge.dealloc(p)
+
+  test "realloc keeps contents":
+    var huge = HugePageAllocator.init(threshold = 4096)
+    let p = cast[ptr UncheckedArray[int]](huge.alloc(1000 * sizeof(int)))
+    for i in 0..<1000:
+      p[i] = i * 3
+    let q = cast[ptr UncheckedArray[int]](huge.realloc(p, 1_000_000 * sizeof(int)))
+    check q != nil
+    for i in 0..<1000:
+      check q[i] == i * 3
+    huge.dealloc(q)
@@ -0,0 +1,331 @@
+## Unit Tests for Caches
+## =====================
+
+import std/[unittest, options, times, os]
+import ../src/arsenal/caching/s3fifo
+import ../src/arsenal/caching/concurrent_s3fifo
+import ../src/arsenal/caching/simulation
+
+suite "S3-FIFO Cache":
+  test "put, get, update and remove":
+    var cache = initS3FIFOCache[int, int](100)
+    for i in 0..<50:
+      cache.put(i, i * 2)
+    check cache.size == 50
+    check cache.get(7) == some(14)
+    check cache.get(500).isNone
+    cache.put(7, 0)
+    check cache.get(7) == some(0)
+    check cache.remove(7)
+    check not cache.remove(7)
+    check cache.size == 49
+
+  test "never exceeds capacity":
+    var cache = initS3FIFOCache[int, int](100)
+    for i in 0..<10_000:
+      cache.put(i, i)
+    check cache.size <= 100
+
+  test "ghost hits go straight to the main queue":
+    var cache = initS3FIFOCache[int, int](100)
+    for i in 0..<100:
+      cache.put(i, i)
+    cache.put(100, 100)                # Evicts key 0 from small into ghost
+    check 0 notin cache
+    check cache.ghostLen == 1
+    let before = cache.mainLen
+    cache.put(0, 0)
+    check cache.mainLen == before + 1
+    check cache.get(0) == some(0)
+
+  test "get and put do not allocate once full":
+    var cache = initS3FIFOCache[int, int](1000)
+    for i in 0..<2000:
+      cache.put(i, i)
+    let before = getOccupiedMem()
+    for i in 0..<100_000:
+      if cache.get(i mod 3000).isNone:
+        cache.put(i mod 3000, i)
+    check getOccupiedMem() <= before
+
+  test "removed slots are reused":
+    var cache = initS3FIFOCache[string, string](20)
+    for i in 0..<20:
+      cache.put($i, $i)
+    for i in 0..<20:
+      check cache.remove($i)
+    for i in 20..<60:
+      cache.put($i, $i)
+    check cache.size == 20
+    for k, v in cache.pairs:
+      check k == v
+
+var fakeNowNs = 0'i64
+proc fakeClock(): int64 = fakeNowNs
+
+suite "S3-FIFO Cache: weights and expiry":
+  test "weighted budget holds and heavy entries are refused":
+    var cache = initS3FIFOCache[int, string](1000, maxWeight = 10_000,
+      weigher = proc (k: int, v: string): int = v.len)
+    for i in 0..<500:
+      cache.put(i, newString(100 + (i mod 7) * 150))
+      check cache.weight <= 10_000
+    check cache.size < 500
+    cache.put(-1, newString(20_000))
+    check -1 notin cache
+    cache.put(1_000_000, "small")
+    cache.put(1_000_000, newString(20_000))      # Oversized update drops it
+    check 1_000_000 notin cache
+
+  test "small hot entries survive a scan of large ones":
+    var cache = initS3FIFOCache[int, string](1000, maxWeight = 100_000,
+      weigher = proc (k: int, v: string): int = v.len)
+    for i in 0..<50:
+      cache.put(i, newString(10))
+    for round in 0..<2:
+      for i in 0..<50:
+        discard cache.get(i)
+    for i in 1000..<1200:                        # 2 MB of one-hit blobs
+      cache.put(i, newString(10_000))
+    check cache.weight <= 100_000
+    var hot = 0
+    for i in 0..<50:
+      if i in cache: inc hot
+    check hot == 50
+
+  test "entries expire via the timer wheel":
+    fakeNowNs = 1_000_000_000
+    var cache = initS3FIFOCache[int, int](100,
+      expireAfterWrite = initDuration(seconds = 10), clock = fakeClock)
+    for i in 0..<20:
+      cache.put(i, i)
+    cache.put(99, 99, initDuration(seconds = 1))
+    fakeNowNs += 2_000_000_000
+    check 99 notin cache
+    check cache.get(0) == some(0)
+    fakeNowNs += 9_000_000_000
+    cache.cleanUp()
+    check cache.size == 0
+    check cache.weight == 0
+    expect ValueError:
+      cache.put(1, 1, initDuration())
+
+  test "rewrites restart the TTL":
+    fakeNowNs = 0
+    var cache = initS3FIFOCache[int, int](100,
+      expireAfterWrite = initDuration(milliseconds = 100), clock = fakeClock)
+    cache.put(1, 1)
+    fakeNowNs += 80_000_000
+    cache.put(1, 2)
+    fakeNowNs += 80_000_000
+    check cache.get(1) == some(2)
+    fakeNowNs += 30_000_000
+    check cache.get(1).isNone
+
+  test "refresh after write reloads and survives loader failure":
+    fakeNowNs = 0
+    var cache = initS3FIFOCache[string, int](100,
+      refreshAfterWrite = initDuration(seconds = 1), clock = fakeClock)
+    var loads = 0
+    var failing = false
+    let loader = proc (key: string): int =
+      if failing:
+        raise newException(IOError, "backend down")
+      inc loads
+      loads
+    check cache.getOrLoad("a", loader) == 1
+    check cache.getOrLoad("a", loader) == 1       # Fresh: served cached
+    fakeNowNs += 2_000_000_000
+    check cache.getOrLoad("a", loader) == 2       # Stale: reloaded
+    fakeNowNs += 2_000_000_000
+    failing = true
+    check cache.getOrLoad("a", loader) == 2       # Reload failed: old value
+
+suite "Concurrent S3-FIFO Cache":
+  test "put, get, update and remove":
+    var cache = ConcurrentS3FIFOCache[int, int].init(1000, shards = 4, stats = true)
+    check cache.shardCount == 4
+    for i in 0..<500:
+      cache.put(i, i * 3)
+    check cache.len == 500
+    check cache.get(7) == some(21)
+    check cache.get(5000).isNone
+    check cache.getOrDefault(5000, -1) == -1
+    cache[7] = 0
+    check cache.get(7) == some(0)
+    check cache.remove(7)
+    check not cache.remove(7)
+    check 7 notin cache
+    check cache.len == 499
+    check cache.hits > 0
+    check cache.misses > 0
+    cache.destroy()
+
+  test "shard count shrinks to keep shards useful":
+    var cache = ConcurrentS3FIFOCache[int, int].init(64, shards = 64)
+    check cache.shardCount == 64 div MinShardCapacity
+    check cache.capacity == 64
+    cache.destroy()
+    expect ValueError:
+      discard ConcurrentS3FIFOCache[int, int].init(4)
+
+  test "evicts one-hit wonders and keeps hot keys":
+    var cache = ConcurrentS3FIFOCache[int, int].init(1000, shards = 1)
+    for i in 0..<100:                  # Hot set, read repeatedly
+      cache.put(i, i)
+    for round in 0..<3:
+      for i in 0..<100:
+        discard cache.get(i)
+    for i in 1000..<20_000:            # Scan of keys seen once
+      cache.put(i, i)
+    check cache.len <= 1000
+    var hot = 0
+    for i in 0..<100:
+      if i in cache: inc hot
+    check hot >= 90
+    cache.destroy()
+
+  test "removed slots are reused and capacity holds":
+    var cache = ConcurrentS3FIFOCache[int, int].init(100, shards = 1)
+    for i in 0..<100:
+      cache.put(i, i)
+    for i in 0..<100:
+      check cache.remove(i)
+    for i in 100..<300:
+      cache.put(i, i)
+    check cache.len == 100
+    cache.clear()
+    check cache.len == 0
+    cache.destroy()
+
+  test "string keys and values use locked lookups":
+    var cache = ConcurrentS3FIFOCache[string, string].init(64)
+    cache.put("alpha", "a")
+    cache.put("beta", "b")
+    check cache.get("alpha") == some("a")
+    check "gamma" notin cache
+    var seen = 0
+    for k, v in cache.pairs:
+      check v == k[0 .. 0]
+      inc seen
+    check seen == 2
+    cache.destroy()
+
+  test "concurrent writers and lock-free readers":
+    when compileOption("threads"):
+      var cache = ConcurrentS3FIFOCache[int, int].init(4096, shards = 8)
+      const perThread = 5000
+      const numWriters = 4
+
+      proc writer(id: int) {.thread.} =
+        for i in 0..<perThread:
+          let key = id * perThread + i
+          cache.put(key, key * 2)
+
+      proc reader(bad: ptr int) {.thread.} =
+        # Values are only ever key * 2, so any other result is a torn read
+        for round in 0..<4:
+          for key in 0..<perThread * numWriters:
+            let v = cache.get(key)
+            if v.isSome and v.get != key * 2:
+              inc bad[]
+
+      var writers: array[numWriters, Thread[int]]
+      var readThread: Thread[ptr int]
+      var bad = 0
+      for i in 0..<numWriters:
+        createThread(writers[i], writer, i)
+      createThread(readThread, reader, addr bad)
+      for i in 0..<numWriters:
+        joinThread(writers[i])
+      joinThread(readThread)
+
+      check bad == 0
+      check cache.len <= 4096
+      for k, v in cache.pairs:
+        check v == k * 2
+      cache.destroy()
+    else:
+      skip()
+
+suite "Cache Simulation":
+  test "LRU evicts the least recently used":
+    var lru = LruCache.init(10)
+    for k in 0'u64 ..< 10:
+      check not lru.access(k)
+    check lru.access(0)                # 1 is now the oldest
+    check not lru.access(100)
+    check not lru.access(1)
+    check lru.access(0)
+
+  test "CLOCK gives referenced entries a second chance":
+    var clock = ClockCache.init(10)
+    for k in 0'u64 ..< 10:
+      discard clock.access(k)
+    check clock.access(0)
+    check not clock.access(100)        # Evicts 1, skipping 0
+    check clock.access(0)
+    check not clock.access(1)
+
+  test "W-TinyLFU keeps popular keys through a scan":
+    var lfu = TinyLfuCache.init(100)
+    for round in 0 ..< 5:
+      for k in 0'u64 ..< 50:
+        discard lfu.access(k)
+    for k in 1000'u64 ..< 5000:
+      discard lfu.access(k)
+    var hits = 0
+    for k in 0'u64 ..< 50:
+      if lfu.access(k): inc hits
+    check hits >= 45
+
+  test "sweep is independent of thread count":
+    let trace = zipfTrace(50_000, 5_000, alpha = 0.9)
+    check trace.keys.len == 50_000
+    check trace.uniqueKeys <= 5_000
+    let caps = capacityPoints(trace.uniqueKeys, points = 4)
+    let serial = sweep(trace.keys, [pS3FIFO, pLRU, pCLOCK, pTinyLFU], caps, threads = 1)
+    let parallel = sweep(trace.keys, [pS3FIFO, pLRU, pCLOCK, pTinyLFU], caps, threads = 4)
+    check serial.len == 4 * caps.len
+    for i in 0 ..< serial.len:
+      check serial[i].policy == parallel[i].policy
+      check serial[i].misses == parallel[i].misses
+      check serial[i].missRatio > 0.0 and serial[i].missRatio < 1.0
+    # Bigger caches miss less
+    for i in 1 ..< caps.len:
+      check serial[i].misses <= serial[i - 1].misses
+
+  test "CSV and binary traces round-trip":
+    let dir = getTempDir()
+    let csv = dir / "arsenal_trace_test.csv"
+    writeFile(csv, "timestamp,key,size\n1,42,100\n2,abc,7\n3,42,100\n")
+    let t = loadTrace(csv)
+    check t.keys.len == 3
+    check t.keys[0] == 42
+    check t.keys[2] == 42
+    check t.uniqueKeys == 2
+    let bin = dir / "arsenal_trace_test.bin"
+    writeBinaryTrace(bin, t.keys)
+    check loadTrace(bin).keys == t.keys
+    removeFile(csv)
+    removeFile(bin)
+
+  test "oracleGeneral records are parsed":
+    # libCacheSim layout: u32 timestamp, u64 id, u32 size, i64 next access
+    proc le(v: uint64, bytes: int): string =
+      for i in 0 ..< bytes:
+        result.add char((v shr (8 * i)) and 0xFF)
+    let ids = [7'u64, 0x0123_4567_89AB_CDEF'u64, 7'u64]
+    var data = ""
+    for i, id in ids:
+      data.add le(uint64(i + 1), 4) & le(id, 8) & le(4096, 4) & le(high(uint64), 8)
+    check data.len == 3 * 24
+    let path = getTempDir() / "arsenal_trace_test.oracleGeneral"
+    writeFile(path, data)
+    defer: removeFile(path)
+    let t = readBinaryTrace(path, tfOracleGeneral)
+    check t.keys == @ids
+    check t.uniqueKeys == 2
+    check loadTrace(path).keys == @ids    # Detected from the extension
+
+echo "Cache tests completed successfully!"
@@ -0,0 +1,624 @@
+## Unit Tests for Compression
+## ==========================
+
+import std/[unittest, random, os, options, strutils]
+import ../src/arsenal/compression/streamvbyte
+import ../src/arsenal/compression/bitpacking
+import ../src/arsenal/compression/eliasfano
+import ../src/arsenal/compression/intblocks
+import ../src/arsenal/compression/compressor
+import ../src/arsenal/compression/parallel_frame
+import ../src/arsenal/compression/compressors/lz4_native
+
+proc mixedValues(n: int, seed = 1): seq[uint32] =
+  ## Values of every byte length, in random order
+  var r = initRand(seed)
+  for i in 0 ..< n:
+    let bits = [7, 15, 23, 32][r.rand(3)]
+    result.add uint32(r.rand(int((1'u64 shl bits) - 1)))
+
+suite "Stream VByte":
+  test "round-trips every byte length":
+    let values = [0'u32, 1, 255, 256, 65535, 65536, 16777215, 16777216, high(uint32)]
+    let (control, data) = encodeStreamVByte(values)
+    check control.len == 3
+    check decodeStreamVByte(control, data, values.len) == @values
+
+  test "every kernel matches the scalar reference":
+    for n in [0, 1, 3, 4, 5, 15, 16, 17, 63, 1000, 4099]:
+      let values = mixedValues(n, seed = n)
+      let reference = encodeStreamVByteScalar(values)
+      check decodeStreamVByteScalar(reference.control, reference.data, n) == values
+      for kernel in streamVByteKernels():
+        let (control, data) = encodeStreamVByte(values, kernel)
+        check control == reference.control
+        check data == reference.data
+        check decodeStreamVByte(control, data, n, kernel) == values
+
+  test "decoding into a buffer reports bytes consumed":
+    let values = mixedValues(257)
+    let (control, data) = encodeStreamVByte(values)
+    for kernel in streamVByteKernels():
+      var output = newSeq[uint32](values.len)
+      check decodeStreamVByte(control, data, output, kernel) == data.len
+      check output == values
+
+  test "SIMD decode never reads past the data stream":
+    # All-small values leave far fewer than 16 bytes after most blocks
+    var values = newSeq[uint32](64)
+    for i in 0 ..< values.len:
+      values[i] = uint32(i)
+    let (control, data) = encodeStreamVByte(values)
+    check data.len == 64
+    for kernel in streamVByteKernels():
+      check decodeStreamVByte(control, data, values.len, kernel) == values
+
+  test "unavailable kernels are rejected":
+    for kernel in StreamVByteKernel:
+      if kernel notin streamVByteKernels():
+        expect ValueError:
+          discard decodeStreamVByte(@[0'u8], @[0'u8], 1, kernel)
+    check streamVByteKernel() in streamVByteKernels()
+
+suite "Stream VByte: fused delta and zigzag":
+  proc sortedIds(n: int, seed = 1): seq[uint32] =
+    var r = initRand(seed)
+    var id = 0'u32
+    for i in 0 ..< n:
+      id += uint32(if r.rand(20) == 0: r.rand(1_000_000) else: r.rand(30))
+      result.add id
+
+  test "fused delta decode matches the two-pass path":
+    for n in [0, 1, 3, 4, 7, 33, 1000, 4097]:
+      let ids = sortedIds(n, seed = n)
+      let reference = encodeStreamVByte(deltaEncode(ids))
+      let (control, data) = encodeStreamVByteDelta(ids)
+      check control == reference.control
+      check data == reference.data
+      for kernel in streamVByteKernels():
+        check decodeStreamVByteDelta(control, data, n, kernel = kernel) == ids
+        var output = newSeq[uint32](n)
+        check decodeStreamVByteDelta(control, data, output, kernel = kernel) == data.len
+        check output == ids
+
+  test "blocks decode independently from a start value":
+    let ids = sortedIds(1000)
+    const blockLen = 128
+    var blocks: seq[tuple[control: seq[uint8], data: seq[uint8], prev: uint32]]
+    var prev = 0'u32
+    var i = 0
+    while i < ids.len:
+      let part = ids[i ..< min(i + blockLen, ids.len)]
+      let (control, data) = encodeStreamVByteDelta(part, prev)
+      blocks.add (control, data, prev)
+      prev = part[^1]
+      i += blockLen
+    for kernel in streamVByteKernels():
+      # Decode the blocks out of order
+      for b in countdown(blocks.high, 0):
+        let start = b * blockLen
+        var output = newSeq[uint32](min(blockLen, ids.len - start))
+        discard decodeStreamVByteDelta(blocks[b].control, blocks[b].data,
+                                       output, blocks[b].prev, kernel)
+        check output == ids[start ..< start + output.len]
+
+  test "deltas wrap around for unsorted input":
+    let values = [5'u32, 3, high(uint32), 0, 17, 16, 1, 2, 100]
+    let (control, data) = encodeStreamVByteDelta(values)
+    for kernel in streamVByteKernels():
+      check decodeStreamVByteDelta(control, data, values.len, kernel = kernel) == @values
+
+  test "fused zigzag decode, with and without delta":
+    var r = initRand(3)
+    var signed = newSeq[int32](999)
+    for v in signed.mitems:
+      v = int32(r.rand(-70_000 .. 70_000))
+    let codes = zigzagEncodeArray(signed)
+    let plain = encodeStreamVByte(codes)
+    let delta = encodeStreamVByteDelta(codes)
+    for kernel in streamVByteKernels():
+      var output = newSeq[int32](signed.len)
+      check decodeStreamVByteZigzag(plain.control, plain.data, output,
+                                    kernel = kernel) == plain.data.len
+      check output == signed
+      output.setLen(0)
+      output.setLen(signed.len)
+      check decodeStreamVByteZigzag(delta.control, delta.data, output, delta = true,
+                                    kernel = kernel) == delta.data.len
+      check output == signed
+
+suite "Bit Packing and PFOR":
+  test "pack128 matches the scalar reference at every width":
+    var r = initRand(11)
+    for bits in 0 .. 32:
+      var values: array[BlockSize, uint32]
+      for v in values.mitems:
+        v = uint32(r.rand(int(high(uint32)))) and
+            (if bits == 32: high(uint32) else: (1'u32 shl bits) - 1)
+      var packed = newSeq[byte](packedSize(bits))
+      var reference = newSeq[byte](packedSize(bits))
+      pack128(values, bits, packed)
+      pack128Scalar(values, bits, reference)
+      check packed == reference
+      var output: array[BlockSize, uint32]
+      unpack128(packed, bits, output)
+      check output == values
+      unpack128Scalar(packed, bits, output)
+      check output == values
+
+  test "BP128 and PFOR streams round-trip partial blocks":
+    for n in [0, 1, 127, 128, 129, 1000]:
+      let values = mixedValues(n, seed = n)
+      var output = newSeq[uint32](n)
+      let bp = encodeBP128(values)
+      check decodeBP128(bp, output) == bp.len
+      check output == values
+      let pfor = encodePFor(values)
+      check decodePFor(pfor, output) == pfor.len
+      check output == values
+
+  test "PFOR patches outliers instead of widening the block":
+    var values = newSeq[uint32](BlockSize)
+    for i in 0 ..< BlockSize:
+      values[i] = 1000 + uint32(i mod 8)
+    values[17] = 3_000_000_000'u32
+    values[90] = 70_000
+    check pforBlockSize(values) < bp128BlockSize(values) div 4
+    let pfor = encodePFor(values)
+    var output = newSeq[uint32](values.len)
+    discard decodePFor(pfor, output)
+    check output == values
+
+  test "corrupt blocks are rejected":
+    var output = newSeq[uint32](10)
+    expect ValueError:
+      discard decodeBP128([33'u8], output)
+    expect ValueError:
+      discard decodePFor([0'u8, 0, 0, 0, 4, 1, 8], output)
+    expect ValueError:                   # Exception position past the block
+      discard decodePFor([0'u8, 0, 0, 0, 0, 1, 8, 200, 5], output)
+
+suite "Elias-Fano":
+  proc sortedValues(n: int, gap: int, seed = 1): seq[uint32] =
+    var r = initRand(seed)
+    var v = 0'u32
+    for i in 0 ..< n:
+      v += uint32(r.rand(gap))
+      result.add v
+
+  test "select and iteration":
+    for (n, gap) in [(1, 10), (100, 0), (1000, 3), (5000, 1000), (3000, 100_000)]:
+      let values = sortedValues(n, gap, seed = n)
+      let ef = EliasFano.init(values)
+      check ef.len == n
+      for i in 0 ..< n:
+        check ef[i] == values[i]
+      var decoded = newSeq[uint32](n)
+      ef.decode(decoded)
+      check decoded == values
+
+  test "nextGEQ finds the first value not below x":
+    let values = sortedValues(2000, 50, seed = 5)
+    let ef = EliasFano.init(values)
+    var r = initRand(9)
+    for _ in 0 ..< 2000:
+      let x = uint32(r.rand(int(values[^1]) + 100))
+      var expected = 0
+      while expected < values.len and values[expected] < x:
+        inc expected
+      check ef.nextGEQ(x) == expected
+    check ef.nextGEQ(0) == 0
+    check ef.nextGEQ(values[^1] + 1) == values.len
+
+  test "non-monotone input and bad indices are rejected":
+    expect ValueError:
+      discard EliasFano.init([3'u32, 2])
+    let ef = EliasFano.init([1'u32, 2, 3])
+    expect ValueError:
+      discard ef[3]
+    expect ValueError:
+      discard ef[-1]
+    check eliasFanoBlockSize([3'u32, 2]) == -1
+
+  test "serialized blocks round-trip":
+    for n in [1, 2, 64, 128]:
+      let values = sortedValues(n, 5000, seed = n)
+      var bytes = @[0xAA'u8]                     # Blocks start mid-buffer
+      bytes.addEliasFanoBlock(values)
+      check bytes.len == 1 + eliasFanoBlockSize(values)
+      var output = newSeq[uint32](n)
+      check decodeEliasFanoBlock(bytes, 1, output) == bytes.len
+      check output == values
+
+suite "Integer Blocks":
+  test "every codec round-trips with and without delta":
+    var ids = newSeq[uint32](1000)
+    var r = initRand(4)
+    for i in 1 ..< ids.len:
+      ids[i] = ids[i - 1] + uint32(if r.rand(50) == 0: r.rand(100_000) else: r.rand(9))
+    for codec in BlockCodec:
+      for delta in [false, true]:
+        let packed = encodeBlocks(ids, codec, delta)
+        var output = newSeq[uint32](ids.len)
+        check decodeBlocks(packed, output, delta) == packed.len
+        check output == ids
+
+  test "auto picks the smallest codec per block":
+    var values: seq[uint32]
+    for i in 0 ..< 128: values.add uint32(i mod 4)             # BP128 territory
+    for i in 0 ..< 128: values.add uint32(i * 100_000)         # Sparse, sorted
+    for i in 0 ..< 128:                                        # Small + outliers
+      values.add(if i mod 50 == 7: 4_000_000_000'u32 else: uint32(i mod 16))
+    let packed = encodeBlocks(values, bcAuto)
+    var output = newSeq[uint32](values.len)
+    discard decodeBlocks(packed, output)
+    check output == values
+    let codecs = blockCodecs(packed, values.len)
+    check codecs.len == 3
+    check codecs[0] == bcBP128
+    check codecs[1] == bcEliasFano
+    check codecs[2] == bcPFor
+    for codec in [bcStreamVByte, bcBP128, bcPFor]:
+      check packed.len <= encodeBlocks(values, codec).len
+
+  test "truncated streams raise ValueError for every codec":
+    var values = newSeq[uint32](300)
+    var r = initRand(8)
+    for i in 1 ..< values.len:
+      values[i] = values[i - 1] + uint32(r.rand(1000))
+    for codec in BlockCodec:
+      let packed = encodeBlocks(values, codec)
+      var output = newSeq[uint32](values.len)
+      for cut in 0 ..< packed.len:
+        expect ValueError:
+          discard decodeBlocks(packed.toOpenArray(0, cut - 1), output)
+
+  test "Elias-Fano blocks refuse unsorted input":
+    expect ValueError:
+      discard encodeBlocks([5'u32, 1, 2], bcEliasFano)
+
+proc textLike(n: int, seed = 1): seq[byte] =
+  ## Compressible bytes: words from a small vocabulary
+  const words = ["alpha ", "beta ", "gamma ", "delta ", "epsilon\n"]
+  var r = initRand(seed)
+  while result.len < n:
+    for c in words[r.rand(words.high)]:
+      result.add byte(c)
+  result.setLen(n)
+
+suite "Parallel Frames":
+  test "round-trips with both codecs":
+    let data = textLike(300_000)
+    for codec in FrameCodec:
+      let frame = compressFrame(data, codec, blockSize = 16384)
+      check frame.len < data.len
+      check decompressFrame(frame) == data
+      check decompressFrame(frame, threads = 1) == data
+
+  test "output does not depend on the thread count":
+    let data = textLike(200_000, seed = 2)
+    let serial = compressFrame(data, blockSize = MinFrameBlockSize, threads = 1)
+    for threads in [2, 3, 8]:
+      check compressFrame(data, blockSize = MinFrameBlockSize, threads = threads) == serial
+
+  test "index locates every block":
+    let data = textLike(100_000, seed = 3)
+    let frame = compressFrame(data, fcZstd, blockSize = 8192)
+    let index = readFrameIndex(frame)
+    check index.codec == fcZstd
+    check index.originalSize == data.len
+    check index.blocks.len == 13
+    check index.blocks[^1].rawSize == data.len - 12 * 8192
+    for b in [0, 5, 12]:
+      let blk = index.blocks[b]
+      check decompressBlock(frame, index, b) ==
+        data[blk.rawOffset ..< blk.rawOffset + blk.rawSize]
+
+  test "reads byte ranges across blocks":
+    let data = textLike(100_000, seed = 4)
+    let frame = compressFrame(data, blockSize = 4096)
+    let index = readFrameIndex(frame)
+    for (offset, len) in [(0, 10), (4090, 20), (10_000, 30_000), (99_999, 1), (500, 0)]:
+      check readRange(frame, index, offset, len) == data[offset ..< offset + len]
+    for (offset, len) in [(99_990, 20), (-1, 5), (100_001, 0), (10, -1), (1, high(int))]:
+      expect ValueError:
+        discard readRange(frame, index, offset, len)
+    expect ValueError:
+      discard decompressBlock(frame, index, index.blocks.len)
+
+  test "stores incompressible blocks":
+    var r = initRand(5)
+    var data = newSeq[byte](50_000)
+    for b in data.mitems:
+      b = byte(r.rand(255))
+    let frame = compressFrame(data, blockSize = 8192)
+    let index = readFrameIndex(frame)
+    for blk in index.blocks:
+      check blk.stored
+    check decompressFrame(frame) == data
+
+  test "empty input":
+    let frame = compressFrame(newSeq[byte]())
+    check isBlockFrame(frame)
+    check readFrameIndex(frame).blocks.len == 0
+    check decompressFrame(frame).len == 0
+
+  test "rejects corrupt frames":
+    let data = textLike(40_000, seed = 6)
+    var frame = compressFrame(data, blockSize = 8192)
+    let index = readFrameIndex(frame)
+    frame[index.blocks[2].offset + 3] = frame[index.blocks[2].offset + 3] xor 0x40
+    expect IOError:
+      discard decompressFrame(frame)
+    check decompressBlock(frame, index, 1).len == 8192
+    expect ValueError:
+      discard readFrameIndex(frame[0 ..< frame.len - 1])
+    expect ValueError:
+      discard compressFrame(data, blockSize = 100)
+
+  test "older frame readers refuse block frames":
+    let frame = compressFrame(textLike(1000))
+    check decodeFrame(frame).isErr
+
+  test "compresses and decompresses files":
+    let data = textLike(150_000, seed = 7)
+    let src = getTempDir() / "arsenal_frame_src.bin"
+    let packed = getTempDir() / "arsenal_frame.arsl"
+    let restored = getTempDir() / "arsenal_frame_out.bin"
+    writeFile(src, cast[string](data))
+    defer:
+      removeFile(src)
+      removeFile(packed)
+      removeFile(restored)
+    let size = compressFile(src, packed, fcZstd, blockSize = 16384)
+    check size == getFileSize(packed)
+    check cast[seq[byte]](readFile(packed)) == compressFrame(data, fcZstd, blockSize = 16384)
+    check decompressFile(packed, restored) == data.len
+    check cast[seq[byte]](readFile(restored)) == data
+
+suite "Streaming Compressors":
+  test "compress into caller-owned buffers":
+    let data = textLike(50_000, seed = 8)
+    var packed = newSeq[byte](max(lz4Bound(data.len), zstdBound(data.len)))
+    var restored = newSeq[byte](data.len)
+
+    var lz = Lz4Compressor.init()
+    var lzd = Lz4Decompressor.init()
+    let n = lz.compressInto(data, packed)
+    check n > 0 and n < data.len
+    check lzd.decompressInto(packed.toOpenArray(0, n - 1), restored) == data.len
+    check restored == data
+
+    var zc = ZstdCompressor.init(3)
+    var zd = ZstdDecompressor.init()
+    let m = zc.compressInto(data, packed)
+    restored.setLen(data.len)
+    check zd.decompressInto(packed.toOpenArray(0, m - 1), restored) == data.len
+    check restored == data
+
+  test "too small output buffers raise":
+    let data = textLike(10_000, seed = 9)
+    var tiny = newSeq[byte](16)
+    var lz = Lz4Compressor.init()
+    expect IOError:
+      discard lz.compressInto(data, tiny)
+    var zc = ZstdCompressor.init()
+    expect IOError:
+      discard zc.compressInto(data, tiny)
+
+  test "LZ4 stream round-trips partial reads":
+    let data = textLike(400_000, seed = 10)
+    var c = Lz4StreamCompressor.init(blockSize = 16384)
+    var wire: seq[byte]
+    var buf = newSeq[byte](c.compressBound(30_000))
+    var r = initRand(11)
+    var i = 0
+    while i < data.len:
+      let n = min(1 + r.rand(29_999), data.len - i)
+      let written = c.compressInto(data.toOpenArray(i, i + n - 1), buf)
+      wire.add buf.toOpenArray(0, written - 1)
+      i += n
+    check wire.len < data.len div 2
+
+    # Feed the decoder 1000-byte "socket reads" through a fixed buffer
+    var d = Lz4StreamDecompressor.init(blockSize = 16384)
+    var pending: seq[byte]
+    var output = newSeq[byte](16384)
+    var restored: seq[byte]
+    var p = 0
+    while p < wire.len:
+      pending.add wire.toOpenArray(p, min(p + 1000, wire.len) - 1)
+      p += 1000
+      while true:
+        let (consumed, written) = d.decompressInto(pending, output)
+        restored.add output.toOpenArray(0, written - 1)
+        pending = pending[consumed .. ^1]
+        if consumed == 0:
+          break
+    check pending.len == 0
+    check restored == data
+
+  test "LZ4 stream blocks reference earlier blocks":
+    let message = textLike(4000, seed = 12)
+    var c = Lz4StreamCompressor.init()
+    let first = c.compress(message)
+    let second = c.compress(message)
+    check second.len < first.len div 10
+    c.reset()
+    check c.compress(message).len == first.len
+
+  test "Zstd stream round-trips through small buffers":
+    let data = textLike(300_000, seed = 13)
+    var c = ZstdStreamCompressor.init(3)
+    var buf = newSeq[byte](4096)
+    var wire: seq[byte]
+    var i = 0
+    while i < data.len:
+      let n = min(20_000, data.len - i)
+      var consumed = 0
+      while true:
+        let r = c.compressInto(data.toOpenArray(i + consumed, i + n - 1), buf)
+        wire.add buf.toOpenArray(0, r.written - 1)
+        consumed += r.consumed
+        if r.done:
+          break
+      i += n
+    while true:
+      let r = c.compressInto(newSeq[byte](), buf, zfEnd)
+      wire.add buf.toOpenArray(0, r.written - 1)
+      if r.done:
+        break
+
+    var zd = ZstdDecompressor.init()
+    check zd.decompress(wire, data.len) == data
+
+    var d = ZstdStreamDecompressor.init()
+    var restored: seq[byte]
+    var p = 0
+    var ended = false
+    while p < wire.len or not ended:
+      let r = d.decompressInto(wire.toOpenArray(p, wire.high), buf)
+      restored.add buf.toOpenArray(0, r.written - 1)
+      p += r.consumed
+      ended = r.frameEnd
+      if r.consumed == 0 and r.written == 0:
+        break
+    check ended
+    check restored == data
+
+  test "Zstd chunk API forms one frame":
+    let data = textLike(100_000, seed = 14)
+    var c = ZstdCompressor.initStream(3)
+    var frame: seq[byte]
+    for i in countup(0, data.len - 1, 10_000):
+      frame.add c.compressChunk(data.toOpenArray(i, i + 9_999), flush = i == 50_000)
+    frame.add c.finish()
+    var zd = ZstdDecompressor.init()
+    check zd.decompress(frame, data.len) == data
+
+proc rpcMessage(r: var Rand): seq[byte] =
+  ## A small JSON-like RPC payload
+  let methods = ["getUser", "listOrders", "updateCart", "checkout"]
+  let text = "{\"jsonrpc\":\"2.0\",\"method\":\"" & methods[r.rand(methods.high)] &
+    "\",\"id\":" & $r.rand(1_000_000) & ",\"params\":{\"userId\":" & $r.rand(99_999) &
+    ",\"session\":\"" & toHex(r.rand(int.high)) & "\",\"locale\":\"en-US\"," &
+    "\"items\":[" & $r.rand(500) & "," & $r.rand(500) & "],\"currency\":\"USD\"}}"
+  cast[seq[byte]](text)
+
+suite "Dictionaries":
+  var r = initRand(15)
+  var samples: seq[seq[byte]]
+  for _ in 0 ..< 2000:
+    samples.add rpcMessage(r)
+  let content = trainDictionary(samples, 8192)
+  var messages: seq[seq[byte]]
+  for _ in 0 ..< 100:
+    messages.add rpcMessage(r)
+
+  test "trained Zstd dictionary shrinks small messages":
+    let dict = ZstdDictionary.init(content, 3)
+    check dict.id != 0
+    var c = ZstdCompressor.init(3)
+    var d = ZstdDecompressor.init()
+    var plain, withDict = 0
+    for m in messages:
+      plain += c.compress(m).len
+      let packed = c.compress(dict, m)
+      withDict += packed.len
+      check frameDictionaryId(packed) == dict.id
+      check d.decompress(dict, packed, m.len) == m
+    check withDict * 2 < plain
+
+  test "Zstd frames need their dictionary":
+    let dict = ZstdDictionary.init(content)
+    var c = ZstdCompressor.init()
+    var d = ZstdDecompressor.init()
+    let packed = c.compress(dict, messages[0])
+    expect IOError:
+      discard d.decompress(packed, 4096)
+
+  test "LZ4 dictionary round-trips and shrinks messages":
+    let dict = Lz4Dictionary.init(content)
+    var c = Lz4Compressor.init()
+    var d = Lz4Decompressor.init()
+    var buf = newSeq[byte](4096)
+    var plain, withDict = 0
+    for m in messages:
+      plain += c.compress(m).len
+      let n = c.compressInto(dict, m, buf)
+      withDict += n
+      var output = newSeq[byte](m.len)
+      check d.decompressInto(dict, buf.toOpenArray(0, n - 1), output) == m.len
+      check output == m
+    check withDict < plain
+
+  test "frames record the dictionary ID":
+    let dict = ZstdDictionary.init(content)
+    var c = ZstdCompressor.init()
+    let packed = c.compress(dict, messages[1])
+    let frame = decodeFrame(encodeFrame(packed, messages[1].len.uint64, dictId = dict.id))
+    check frame.isOk
+    check frame.get.dictId == some(dict.id)
+    check frame.get.data == packed
+    check decodeFrame(encodeFrame(packed, 10)).get.dictId.isNone
+
+suite "Native LZ4":
+  proc samples(): seq[seq[byte]] =
+    var r = initRand(16)
+    var noise = newSeq[byte](20_000)
+    for b in noise.mitems:
+      b = byte(r.rand(255))
+    var runs: seq[byte]
+    for i in 0 ..< 30_000:
+      runs.add byte((i div 1000) mod 3)
+    @[newSeq[byte](), @[byte 7], cast[seq[byte]]("short text!"),
+      textLike(100_000, seed = 17), noise, runs, newSeq[byte](70_000)]
+
+  test "round-trips":
+    for data in samples():
+      let packed = nativeLz4Compress(data)
+      check nativeLz4Decompress(packed, data.len) == data
+      for accel in [2, 8]:
+        check nativeLz4Decompress(nativeLz4Compress(data, accel), data.len) == data
+
+  test "compatible with liblz4 both ways":
+    var c = Lz4Compressor.init()
+    var d = Lz4Decompressor.init()
+    for data in samples():
+      if data.len == 0:
+        continue
+      var output = newSeq[byte](data.len)
+      let native = nativeLz4Compress(data)
+      check d.decompressInto(native, output) == data.len
+      check output == data
+      let reference = c.compress(data)
+      check nativeLz4Decompress(reference, data.len) == data
+
+  test "compresses like liblz4":
+    var c = Lz4Compressor.init()
+    let data = textLike(200_000, seed = 18)
+    check nativeLz4Compress(data).len.float < c.compress(data).len.float * 1.1
+
+  test "reports small output buffers":
+    let data = textLike(10_000, seed = 19)
+    var tiny = newSeq[byte](100)
+    check nativeLz4Compress(data, tiny) == 0
+    let packed = nativeLz4Compress(data)
+    var short = newSeq[byte](data.len - 1)
+    check nativeLz4Decompress(packed, short) == -1
+
+  test "rejects malformed blocks":
+    let data = textLike(10_000, seed = 20)
+    let packed = nativeLz4Compress(data)
+    var output = newSeq[byte](data.len)
+    check nativeLz4Decompress(packed.toOpenArray(0, packed.len div 2), output) == -1
+    check nativeLz4Decompress([byte 0x10, 65, 0xFF, 0xFF], output) == -1   # offset past start
+    check nativeLz4Decompress([byte 0xF0], output) == -1                 # missing length
+    check nativeLz4Decompress(newSeq[byte](), output) == -1
+    var r = initRand(21)
+    for _ in 0 ..< 200:
+      var garbage = packed
+      garbage[r.rand(garbage.high)] = byte(r.rand(255))
+      discard nativeLz4Decompress(garbage, output)   # must not crash
+
+echo "Compression tests completed successfully!"
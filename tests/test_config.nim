@@ -3,6 +3,7 @@
 
 import std/unittest
 import ../src/arsenal/platform/config
+import ../src/arsenal/platform/numa
 
 suite "CPU Feature Detection":
 
@@ -33,4 +34,62 @@ suite "CPU Feature Detection":
     let f1 = detectCpuFeatures()
     let f2 = detectCpuFeatures()
     check f1.vendor == f2.vendor
-    check f1.brandString == f2.brandString
\ No newline at end of file
+    check f1.brandString == f2.brandString
+
+  test "bestVectorIsa stays within the compiled ISA":
+    let isa = bestVectorIsa(detectCpuFeatures())
+    check isa <= CompiledVectorIsa
+    when defined(i386) or defined(arsenalScalar):
+      check isa == viScalar
+    elif defined(amd64):
+      check isa >= viSSE2
+
+proc topoFirstCpu(t: NumaTopology): int =
+  for node in t.nodes:
+    if node.cpus.len > 0:
+      return node.cpus[0]
+  0
+
+suite "NUMA Topology":
+
+  test "parseCpuList handles ranges and singles":
+    check parseCpuList("0-3,8,10-11\n") == @[0, 1, 2, 3, 8, 10, 11]
+    check parseCpuList("") == newSeq[int]()
+    check parseCpuList("5") == @[5]
+
+  test "topology has at least one node with CPUs":
+    let topo = detectNumaTopology()
+    check topo.nodes.len >= 1
+    check topo.nodes.len == getPlatformInfo().numaNodeCount
+    var cpus = 0
+    for node in topo.nodes:
+      cpus += node.cpus.len
+      for cpu in node.cpus:
+        check topo.nodeOfCpu(cpu) == node.id
+    check cpus >= 1
+
+  test "local distance is smallest":
+    let topo = getNumaTopology()
+    let first = topo.nodes[0].id
+    if topo.nodes[0].distances.len > 0:
+      check topo.nearestNodes(first)[0] == first
+
+  test "planPlacement covers every worker":
+    let topo = getNumaTopology()
+    for policy in [ppCompact, ppScatter]:
+      let plan = topo.planPlacement(8, policy)
+      check plan.len == 8
+      for cpu in plan:
+        check topo.nodeOfCpu(cpu) >= 0
+
+  test "pinning to a CPU is reflected by currentCpu":
+    when defined(linux):
+      let topo = getNumaTopology()
+      let cpu = topoFirstCpu(topo)
+      if pinCurrentThread(cpu):
+        check currentCpu() == cpu
+        check currentNumaNode() == topo.nodeOfCpu(cpu)
+        var all: seq[int]
+        for node in topo.nodes:
+          all.add node.cpus
+        discard pinCurrentThreadToCpus(all)
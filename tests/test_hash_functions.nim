@@ -1,9 +1,17 @@
 ## Unit Tests for Hash Functions
 ## ==============================
 
-import std/unittest
+import std/[unittest, os, options, sets]
 import ../src/arsenal/hashing/hashers/xxhash64
 import ../src/arsenal/hashing/hashers/wyhash
+import ../src/arsenal/hashing/hasher
+import ../src/arsenal/hashing/hashers/xxh3
+import ../src/arsenal/hashing/tree_hash
+import ../src/arsenal/hashing/crc
+import ../src/arsenal/compression/compressor
+import ../src/arsenal/sketching/cardinality/hyperloglog
+import ../src/arsenal/sketching/membership/xorfilter
+import ../src/arsenal/sketching/membership/binary_fuse
 
 suite "XXHash64 - One-shot Hashing":
   test "hash produces consistent output":
@@ -297,4 +305,374 @@ suite "Hash Function Properties":
 
     check uniqueCount == 1000
 
+suite "Batch Hashing":
+  # Qualified: the hashers/wyhash and hashers/xxhash64 module names
+  # would otherwise clash with these type names.
+  proc leBytes(x: uint64, n: int): seq[byte] =
+    for i in 0 ..< n:
+      result.add byte((x shr (8 * i)) and 0xFF)
+
+  test "hashMany matches one-shot hash for integer keys":
+    # 37 keys: exercises the 4-lane vector body and the scalar tail
+    var keys64: seq[uint64]
+    var keys32: seq[uint32]
+    for i in 0 ..< 37:
+      keys64.add 0x9E3779B97F4A7C15'u64 * uint64(i + 1)
+      keys32.add uint32((keys64[^1] shr 16) and 0xFFFF_FFFF'u64)
+    var out64 = newSeq[uint64](keys64.len)
+    var out32 = newSeq[uint64](keys32.len)
+    for seed in [DefaultSeed, HashSeed(42)]:
+      hasher.wyhash.hashMany(keys64, out64, seed)
+      hasher.wyhash.hashMany(keys32, out32, seed)
+      for i in 0 ..< keys64.len:
+        check out64[i] == hasher.wyhash.hash(leBytes(keys64[i], 8), seed)
+        check out32[i] == hasher.wyhash.hash(leBytes(keys32[i].uint64, 4), seed)
+      hasher.xxHash64.hashMany(keys64, out64, seed)
+      hasher.xxHash64.hashMany(keys32, out32, seed)
+      for i in 0 ..< keys64.len:
+        check out64[i] == hasher.xxHash64.hash(leBytes(keys64[i], 8), seed)
+        check out32[i] == hasher.xxHash64.hash(leBytes(keys32[i].uint64, 4), seed)
+
+  test "hashMany matches one-shot hash for 16-byte keys":
+    var keys: seq[array[16, byte]]
+    for i in 0 ..< 11:
+      var k: array[16, byte]
+      for j in 0 ..< 16:
+        k[j] = byte((i * 31 + j * 7) and 0xFF)
+      keys.add k
+    var hashes = newSeq[uint64](keys.len)
+    hasher.wyhash.hashMany(keys, hashes, HashSeed(7))
+    for i in 0 ..< keys.len:
+      check hashes[i] == hasher.wyhash.hash(keys[i], HashSeed(7))
+    hasher.xxHash64.hashMany(keys, hashes, HashSeed(7))
+    for i in 0 ..< keys.len:
+      check hashes[i] == hasher.xxHash64.hash(keys[i], HashSeed(7))
+
+  test "hashMany matches one-shot hash for strings of every length":
+    var keys: seq[string]
+    for len in 0 .. 80:
+      var s = newString(len)
+      for j in 0 ..< len:
+        s[j] = char((len * 13 + j) and 0xFF)
+      keys.add s
+    var hashes = newSeq[uint64](keys.len)
+    hasher.wyhash.hashMany(keys, hashes)
+    for i in 0 ..< keys.len:
+      check hashes[i] == hasher.wyhash.hash(keys[i])
+    hasher.xxHash64.hashMany(keys, hashes)
+    for i in 0 ..< keys.len:
+      check hashes[i] == hasher.xxHash64.hash(keys[i])
+
+  test "hashMany keeps xxHash64 test vectors":
+    var hashes = newSeq[uint64](3)
+    hasher.xxHash64.hashMany(["", "abc", "hello world"], hashes)
+    check hashes[0] == 0xEF46DB3751D8E999'u64
+    check hashes[1] == 0x44BC2CF5AD770999'u64
+    check hashes[2] == 0x45AB6734B21E6968'u64
+
+suite "XXH3":
+  # Reference values from the xxHash C library (v0.8) over
+  # data[i] = (i * 131 + 7) mod 256, covering every length class
+  const Xxh3Vectors = [
+    (len: 0, seed: 0'u64, h64: 0x2D06800538D394C2'u64,
+     lo: 0x6001C324468D497F'u64, hi: 0x99AA06D3014798D8'u64),
+    (len: 0, seed: 42'u64, h64: 0xB029411FF43D84D2'u64,
+     lo: 0x3C1D09E9FE249164'u64, hi: 0x16C20ACD33F7AF2F'u64),
+    (len: 1, seed: 0'u64, h64: 0x4C5CCA45D0F4811F'u64,
+     lo: 0x4C5CCA45D0F4811F'u64, hi: 0x495B62073EF70CA4'u64),
+    (len: 1, seed: 42'u64, h64: 0xC72384329881F542'u64,
+     lo: 0xC72384329881F542'u64, hi: 0x8F345F94F33C2B82'u64),
+    (len: 3, seed: 0'u64, h64: 0x6E3E2670E61106AC'u64,
+     lo: 0x6E3E2670E61106AC'u64, hi: 0x390CDC5B4A895DD7'u64),
+    (len: 3, seed: 42'u64, h64: 0x06BE808A0F1E13D6'u64,
+     lo: 0x06BE808A0F1E13D6'u64, hi: 0x307572E8AE2FB3EB'u64),
+    (len: 4, seed: 0'u64, h64: 0x5C4C63133443D03F'u64,
+     lo: 0x3D668AF6F2A44D77'u64, hi: 0xAA6E2F274640A3F4'u64),
+    (len: 4, seed: 42'u64, h64: 0xCCA1C5C31699ED91'u64,
+     lo: 0x2D02187AB4C4FDA3'u64, hi: 0x64DCDEB0F7FC88F8'u64),
+    (len: 8, seed: 0'u64, h64: 0xF9FD4DD0B04D78F5'u64,
+     lo: 0x61DDBE7F31A6100D'u64, hi: 0x6A86A3BDA6AF4E3D'u64),
+    (len: 8, seed: 42'u64, h64: 0x859EE438A590E13D'u64,
+     lo: 0x93A3E4D1D6DB2F9C'u64, hi: 0xD57D3E54D7389077'u64),
+    (len: 9, seed: 0'u64, h64: 0x7C20DF9712C26EDF'u64,
+     lo: 0x8C7B67FD458A936B'u64, hi: 0x664C7CA18AFD6255'u64),
+    (len: 9, seed: 42'u64, h64: 0x18D8D7990EFDCE09'u64,
+     lo: 0xABC3FE63A0FD9753'u64, hi: 0x43343712AFE5B48B'u64),
+    (len: 16, seed: 0'u64, h64: 0x86ABF6BACCEA0858'u64,
+     lo: 0xE2CE54A7C19C730D'u64, hi: 0x7F9A218B0425449A'u64),
+    (len: 16, seed: 42'u64, h64: 0x3DFB7C5AE85844FE'u64,
+     lo: 0x6FBADFEB3524A71B'u64, hi: 0x68B3467254351145'u64),
+    (len: 17, seed: 0'u64, h64: 0xB58BF5DC5022D071'u64,
+     lo: 0x8D96EF110FCDEBB4'u64, hi: 0x66FC23F6439DBD77'u64),
+    (len: 17, seed: 42'u64, h64: 0x75BB843C3DF21312'u64,
+     lo: 0x024E4888A660FBB7'u64, hi: 0x230F3CEEC96BD7CC'u64),
+    (len: 100, seed: 0'u64, h64: 0x5DA67EAC6D4093D5'u64,
+     lo: 0x580B061A98A5A9B4'u64, hi: 0x76B536586DE98B82'u64),
+    (len: 100, seed: 42'u64, h64: 0xE58AF440EA2C90E3'u64,
+     lo: 0xFF98E0299D4AAE18'u64, hi: 0xDD187FF8D3F8F46F'u64),
+    (len: 128, seed: 0'u64, h64: 0x10D17F72C0CCBA41'u64,
+     lo: 0xFF361DEC1385710A'u64, hi: 0xAEC730751478556C'u64),
+    (len: 128, seed: 42'u64, h64: 0xA80975A8E9C98D88'u64,
+     lo: 0x171BB64B0ADFE7BF'u64, hi: 0x03CA45C0042EA13D'u64),
+    (len: 129, seed: 0'u64, h64: 0x1648BDC3DB49D1A2'u64,
+     lo: 0x4545B3A09738E31A'u64, hi: 0x98CD36CCBB557926'u64),
+    (len: 129, seed: 42'u64, h64: 0xB5978592DA15B4C3'u64,
+     lo: 0xED566543306953CE'u64, hi: 0x6B6BB77D4E61020E'u64),
+    (len: 240, seed: 0'u64, h64: 0xB6CFAF343FAB81E6'u64,
+     lo: 0x3F2C53E72293711F'u64, hi: 0x5293E17BF553903D'u64),
+    (len: 240, seed: 42'u64, h64: 0xD865D0B2178586A4'u64,
+     lo: 0xC367A4F83F189410'u64, hi: 0x3B33473FB0B4C8AA'u64),
+    (len: 241, seed: 0'u64, h64: 0x956CAE592C67279E'u64,
+     lo: 0x956CAE592C67279E'u64, hi: 0xB53840FE3FEDF161'u64),
+    (len: 241, seed: 42'u64, h64: 0xF10C69779CBA8524'u64,
+     lo: 0xF10C69779CBA8524'u64, hi: 0x58F5C060087C57E4'u64),
+    (len: 1024, seed: 0'u64, h64: 0x70BD377D9574F4BB'u64,
+     lo: 0x70BD377D9574F4BB'u64, hi: 0xF69630613F24324D'u64),
+    (len: 1024, seed: 42'u64, h64: 0x0052D93F0342F851'u64,
+     lo: 0x0052D93F0342F851'u64, hi: 0x233CBA2F58871CF5'u64),
+    (len: 1025, seed: 0'u64, h64: 0x66C4487C41E127A7'u64,
+     lo: 0x66C4487C41E127A7'u64, hi: 0x621AF7B8277EFFA4'u64),
+    (len: 1025, seed: 42'u64, h64: 0x8C0470D62FC408F6'u64,
+     lo: 0x8C0470D62FC408F6'u64, hi: 0xC7F11A62B998D8D6'u64),
+    (len: 5000, seed: 0'u64, h64: 0xE4007929540F095C'u64,
+     lo: 0xE4007929540F095C'u64, hi: 0x61BEDB627E4A5FDF'u64),
+    (len: 5000, seed: 42'u64, h64: 0xA25F97AFC34A44FA'u64,
+     lo: 0xA25F97AFC34A44FA'u64, hi: 0x335D228333A96DC1'u64)
+  ]
+
+  proc xxh3Data(n: int): seq[byte] =
+    for i in 0 ..< n:
+      result.add byte((i * 131 + 7) and 0xFF)
+
+  test "one-shot matches reference vectors":
+    for v in Xxh3Vectors:
+      let data = xxh3Data(v.len)
+      check Xxh3.hash(data, HashSeed(v.seed)) == v.h64
+      check Xxh3_128.hash(data, HashSeed(v.seed)) == Hash128(lo: v.lo, hi: v.hi)
+
+  test "hash strings":
+    check Xxh3.hash("") == 0x2D06800538D394C2'u64
+    check Xxh3.hash("hello world") == 0xD447B1EA40E6988B'u64
+    check $Xxh3_128.hash("") == "99aa06d3014798d86001c324468d497f"
+
+  test "streaming matches one-shot for any chunking":
+    let data = xxh3Data(5000)
+    for seed in [0'u64, 42'u64]:
+      for chunk in [1, 7, 64, 100, 255, 256, 257, 1000, 4096]:
+        for len in [0, 3, 17, 200, 240, 241, 256, 1024, 1025, 2048, 5000]:
+          var s64 = Xxh3.init(HashSeed(seed))
+          var s128 = Xxh3_128.init(HashSeed(seed))
+          var p = 0
+          while p < len:
+            let n = min(chunk, len - p)
+            s64.update(data.toOpenArray(p, p + n - 1))
+            s128.update(data.toOpenArray(p, p + n - 1))
+            p += n
+          check s64.finish() == Xxh3.hash(data.toOpenArray(0, len - 1), HashSeed(seed))
+          check s128.finish() == Xxh3_128.hash(data.toOpenArray(0, len - 1), HashSeed(seed))
+
+  test "finish does not consume the state":
+    var state = Xxh3.init()
+    state.update("hello ")
+    discard state.finish()
+    state.update("world")
+    check state.finish() == Xxh3.hash("hello world")
+    state.reset()
+    check state.finish() == Xxh3.hash("")
+
+  test "large input (vectorised path) matches streaming":
+    var data = newSeq[byte](1 shl 20)
+    for i in 0 ..< data.len:
+      data[i] = byte((i * 2654435761) shr 13 and 0xFF)
+    var state = Xxh3.init(HashSeed(7))
+    state.update(data)
+    check state.finish() == Xxh3.hash(data, HashSeed(7))
+
+suite "Tree Hashing":
+  var data = newSeq[byte](5 * MinTreeChunkSize + 123)   # Partial last chunk
+  for i in 0 ..< data.len:
+    data[i] = byte((i * 131 + 7) mod 256)
+
+  test "digest is leaf XXH3-128s hashed in order with a length trailer":
+    var root = Xxh3_128.init()
+    var buf: array[16, byte]
+    var p = 0
+    while p < data.len:
+      let n = min(MinTreeChunkSize, data.len - p)
+      let leaf = Xxh3_128.hash(data.toOpenArray(p, p + n - 1))
+      for i in 0 ..< 8:
+        buf[i] = byte((leaf.lo shr (8 * i)) and 0xFF)
+        buf[8 + i] = byte((leaf.hi shr (8 * i)) and 0xFF)
+      root.update(buf)
+      p += n
+    for i in 0 ..< 8:
+      buf[i] = byte((uint64(data.len) shr (8 * i)) and 0xFF)
+      buf[8 + i] = byte((uint64(MinTreeChunkSize) shr (8 * i)) and 0xFF)
+    root.update(buf)
+    check treeHash(data, MinTreeChunkSize, threads = 1) == root.finish()
+
+  test "result does not depend on thread count":
+    let expected = treeHash(data, MinTreeChunkSize, threads = 1)
+    for threads in [0, 2, 3, 4, 16]:
+      check treeHash(data, MinTreeChunkSize, threads) == expected
+
+  test "chunk size and seed are part of the digest":
+    let base = treeHash(data, MinTreeChunkSize)
+    check treeHash(data, 2 * MinTreeChunkSize) != base
+    check treeHash(data, MinTreeChunkSize, seed = HashSeed(1)) != base
+    check treeHash(data) != Xxh3_128.hash(data)
+
+  test "empty and single-chunk inputs":
+    check treeHash("") == treeHash(newSeq[byte]())
+    check treeHash("hello world", threads = 4) == treeHash("hello world", threads = 1)
+    check treeHash("") != treeHash("hello world")
+
+  test "file digest matches in-memory digest":
+    let path = getTempDir() / "arsenal_tree_hash_test.bin"
+    writeFile(path, data)
+    defer: removeFile(path)
+    check treeHashFile(path, MinTreeChunkSize, threads = 4) == treeHash(data, MinTreeChunkSize)
+    writeFile(path, "")
+    check treeHashFile(path) == treeHash("")
+
+  test "rejects tiny chunks":
+    expect ValueError:
+      discard treeHash(data, chunkSize = 64)
+
+suite "CRC":
+  # Reference values from zlib (CRC-32) and bit-at-a-time CRC-32C / CRC-64/XZ
+  # over data[i] = (i * 131 + 7) mod 256. Lengths straddle the 64-byte
+  # folding threshold and the 3 * 256 / 3 * 8192 interleaved blocks.
+  const CrcVectors = [
+    (len: 0, c32c: 0x00000000'u32, c32: 0x00000000'u32, c64: 0x0000000000000000'u64),
+    (len: 1, c32c: 0x86B737BA'u32, c32: 0x4C667A2E'u32, c64: 0x23D7181E300F9E5E'u64),
+    (len: 7, c32c: 0xF8078C71'u32, c32: 0xFF206B2E'u32, c64: 0xCE2C9254B5F2784F'u64),
+    (len: 63, c32c: 0x768E33DB'u32, c32: 0x337301C0'u32, c64: 0x08638599CB53AB9B'u64),
+    (len: 64, c32c: 0x9EB01D51'u32, c32: 0x38E4DBB5'u32, c64: 0x043F21F53BAD9F39'u64),
+    (len: 65, c32c: 0xE6EAF8B3'u32, c32: 0x6C311B46'u32, c64: 0x4C2A739FF69CF2F0'u64),
+    (len: 256, c32c: 0x82BAF106'u32, c32: 0x0D75AD75'u32, c64: 0xBF038715DFC632AF'u64),
+    (len: 773, c32c: 0x03D32DC7'u32, c32: 0xA3A673D5'u32, c64: 0xB582A5A042762F25'u64),
+    (len: 1000, c32c: 0x8DBA050D'u32, c32: 0x1ED57BB9'u32, c64: 0x4B6301B25AC3678B'u64),
+    (len: 24676, c32c: 0xF14B119B'u32, c32: 0xFF2D1498'u32, c64: 0x0D6FD4C358026FB5'u64),
+    (len: 60000, c32c: 0x6CC58D79'u32, c32: 0xE32B98D9'u32, c64: 0x5ACDAD87B80BB343'u64),
+  ]
+
+  var data = newSeq[byte](60000)
+  for i in 0 ..< data.len:
+    data[i] = byte((i * 131 + 7) mod 256)
+
+  test "check values":
+    check crc32c("123456789") == 0xE3069283'u32
+    check crc32("123456789") == 0xCBF43926'u32
+    check crc64("123456789") == 0x995DC9BBDF1939FA'u64
+
+  test "reference vectors (hardware and table paths)":
+    for v in CrcVectors:
+      let input = data.toOpenArray(0, v.len - 1)
+      check crc32c(input) == v.c32c
+      check crc32(input) == v.c32
+      check crc64(input) == v.c64
+      check crc32cPortable(input) == v.c32c
+      check crc32Portable(input) == v.c32
+      check crc64Portable(input) == v.c64
+
+  test "running CRC over pieces equals one shot":
+    for split in [0, 1, 13, 64, 1000, 30000, 60000]:
+      let a = data.toOpenArray(0, split - 1)
+      let b = data.toOpenArray(split, data.high)
+      check crc32c(b, crc32c(a)) == crc32c(data)
+      check crc32(b, crc32(a)) == crc32(data)
+      check crc64(b, crc64(a)) == crc64(data)
+
+  test "combine equals CRC of the concatenation":
+    for split in [0, 5, 777, 59999]:
+      let a = data.toOpenArray(0, split - 1)
+      let b = data.toOpenArray(split, data.high)
+      check crc32cCombine(crc32c(a), crc32c(b), b.len) == crc32c(data)
+      check crc32Combine(crc32(a), crc32(b), b.len) == crc32(data)
+      check crc64Combine(crc64(a), crc64(b), b.len) == crc64(data)
+
+  test "table implementation runs at compile time":
+    const c = crc32cPortable([byte 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39])
+    check c == 0xE3069283'u32
+
+  test "frame checksum is CRC-32C and detects corruption":
+    let payload = @(data.toOpenArray(0, 999))
+    var frame = encodeFrame(payload, 4000)
+    check frame[4] == FrameVersion
+    let decoded = decodeFrame(frame)
+    check decoded.isOk
+    check decoded.get.checksum.get == crc32c(payload)
+    frame[20] = frame[20] xor 0x10
+    check decodeFrame(frame).isErr
+
+  test "version 1 frames (XOR checksum) still decode":
+    var frame = encodeFrame(@[byte 1, 2, 4], 3)
+    frame[4] = LegacyFrameVersion
+    for i in 0 ..< 4:
+      frame[frame.len - 4 + i] = if i == 0: 1'u8 xor 2 xor 4 else: 0
+    check decodeFrame(frame).isOk
+
+suite "Fixed-Size Key Hashing":
+  test "integer keys take the single-multiply path":
+    check isFixedSizeKey(uint32)
+    check isFixedSizeKey(array[16, byte])
+    check not isFixedSizeKey(string)
+    check not isFixedSizeKey(seq[int])
+    check keyHash(42'u64) == hashFixed(42'u64)
+    check keyHash(42'u64) == keyHash(42'u64)
+    check keyHash(42'u64) != keyHash(42'u64, seed = 1)
+    check keyHash(0'u64) != 0
+
+  test "strings hash with wyhash":
+    check keyHash("user:42") == hasher.wyhash.hash("user:42")
+    check keyHash("user:42", seed = 7) == hasher.wyhash.hash("user:42", HashSeed(7))
+
+  test "array keys of every size class":
+    var a4: array[4, byte] = [1'u8, 2, 3, 4]
+    var a16, b16: array[16, byte]
+    var a32: array[32, byte]
+    b16[15] = 1
+    check keyHash(a4) != keyHash([1'u8, 2, 3, 5])
+    check keyHash(a16) != keyHash(b16)
+    check keyHash(a32) == hasher.wyhash.hash(a32)
+
+  test "no collisions over a dense integer range":
+    var seen = initHashSet[uint64]()
+    for i in 0'u64 ..< 100_000'u64:
+      seen.incl keyHash(i)
+    check seen.len == 100_000
+
+  test "HyperLogLog and xor filters accept integer keys directly":
+    var hll = initHyperLogLog(14)
+    for i in 0 ..< 10_000:
+      hll.add(i)
+      hll.add(i)
+    check abs(hll.cardinality() - 10_000) < 500
+
+    var keys = newSeq[uint64](1000)
+    for i in 0 ..< keys.len:
+      keys[i] = uint64(i) * 7919
+    let filter = buildXorFilter8(keys)
+    for k in keys:
+      check filter.contains(k)
+
+  test "string sketches and fuse filters hash with keyHash":
+    var a = initHyperLogLog(12)
+    var b = initHyperLogLog(12)
+    for i in 0 ..< 2000:
+      a.add("user:" & $i)
+      b.addHash(keyHash("user:" & $i))
+    check a.cardinality() == b.cardinality()
+
+    var words: seq[string]
+    for i in 0 ..< 1000:
+      words.add "key-" & $i
+    let fuse = construct(words)
+    let fuse16 = construct16(words)
+    for w in words:
+      check fuse.contains(w)
+      check fuse16.contains(w)
+      check fuse.contains(keyHash(w))      # The uint64 key the filter stores
+
 echo "Hash function tests completed successfully!"
@@ -105,6 +105,51 @@ proc testGorillaCompression() =
   assert compressionRatio > 2.0, "Should achieve at least 2x compression"
   echo "  PASSED"
 
+proc testGorillaEdgeCases() =
+  echo "\n=== Testing Gorilla Edge Cases ==="
+
+  # Field widths on both sides of the 57-bit single-step limit
+  var buf = newBitBuffer(8)
+  for width in [1, 7, 13, 56, 57, 58, 63, 64]:
+    buf.writeBits(high(uint64), width)
+    buf.writeBits(0x5A5A_5A5A_5A5A_5A5A'u64, width)
+  for width in [1, 7, 13, 56, 57, 58, 63, 64]:
+    let mask = if width == 64: high(uint64) else: (1'u64 shl width) - 1
+    assert buf.readBits(width) == mask, fmt"ones at width {width}"
+    assert buf.readBits(width) == (0x5A5A_5A5A_5A5A_5A5A'u64 and mask), fmt"pattern at width {width}"
+
+  # Irregular timestamps: every delta-of-delta case, both signs
+  var points: seq[(int64, float64)]
+  var t = int64(1_700_000_000)
+  for step in [60, 60, 0, 123, 60, -3, 300, 2_107, 60, 100_000, 59, -50_000, 64, 0, 255, 2047, 2048]:
+    t += step
+    points.add (t, 0.0)
+  # Values: repeats, small and large XORs, specials
+  let values = [1.0, 1.0, 1.5, -1.5, 1e300, 5e-324, 0.0, -0.0, Inf, NegInf,
+                123.456, 123.457, 123.457, 2.0, 3.0, 1e-10, 42.0]
+  for i in 0 ..< points.len:
+    points[i][1] = values[i]
+
+  var encoder = newGorillaEncoder()
+  for (ts, v) in points:
+    encoder.encode(ts, v)
+  let decoded = decodeAll(encoder.finish(), points.len)
+  for i in 0 ..< points.len:
+    assert decoded[i][0] == points[i][0], fmt"Timestamp mismatch at {i}"
+    assert cast[uint64](decoded[i][1]) == cast[uint64](points[i][1]), fmt"Value mismatch at {i}"
+
+  # Noisy values round-trip bit-exactly
+  var noisy = newGorillaEncoder()
+  var expected: seq[float64]
+  for i in 0 ..< 10_000:
+    let v = 20.0 + sin(float(i) * 0.01) * 5.0 + rand(0.5)
+    expected.add v
+    noisy.encode(int64(i * 10), v)
+  let back = decodeAll(noisy.finish(), expected.len)
+  for i in 0 ..< expected.len:
+    assert back[i][1] == expected[i], fmt"Noisy value mismatch at {i}"
+  echo "  PASSED"
+
 proc testH3Grid() =
   echo "\n=== Testing H3 Hexagonal Grid ==="
   
@@ -269,6 +314,7 @@ when isMainModule:
   testBinaryFuseFilter()
   testBinaryFuse16()
   testGorillaCompression()
+  testGorillaEdgeCases()
   testH3Grid()
   testSimdStringSearch()
   testDeltaSteppingSSSP()
@@ -3,7 +3,10 @@
 
 import std/unittest
 import std/options
+import std/os
 import ../src/arsenal/datastructures/hashtables/swiss_table
+import ../src/arsenal/datastructures/hashtables/concurrent_swiss_table
+import ../src/arsenal/datastructures/hashtables/flat_swiss_table
 
 suite "Swiss Table - Initialization":
   test "init creates empty table":
@@ -309,4 +312,277 @@ suite "Swiss Table - Edge Cases":
     check table.contains("zero")
     check table["zero"] == 0
 
+suite "Swiss Table - Group Matching":
+  proc groupOf(bytes: array[16, uint8]): Group =
+    # Groups are 16 bytes (SSE2/NEON) or 8 bytes (SWAR); tests only use
+    # the first 8 positions so they hold for both.
+    copyMem(addr result, unsafeAddr bytes[0], sizeof(Group))
+
+  test "match finds every equal control byte":
+    var bytes: array[16, uint8]
+    for i in 0..<16:
+      bytes[i] = 0x80  # Empty
+    bytes[1] = 0x25
+    bytes[6] = 0x25
+    bytes[7] = 0x11
+    let g = groupOf(bytes)
+    var hits: seq[int]
+    for i in match(g, 0x25).setBits:
+      hits.add i
+    # SWAR may add false positives, never misses
+    check 1 in hits
+    check 6 in hits
+    check 7 notin hits
+
+  test "matchEmpty and matchEmptyOrDeleted classify special bytes":
+    var bytes: array[16, uint8]
+    for i in 0..<16:
+      bytes[i] = 0x05  # Full
+    bytes[0] = 0x80  # Empty
+    bytes[2] = 0xFE  # Deleted
+    bytes[3] = 0xFF  # Sentinel
+    let g = groupOf(bytes)
+    var empty, free: seq[int]
+    for i in matchEmpty(g).setBits:
+      empty.add i
+    for i in matchEmptyOrDeleted(g).setBits:
+      free.add i
+    check empty == @[0]
+    check free == @[0, 2]
+
+suite "Swiss Table - Growth":
+  test "grows past initial capacity":
+    var table = SwissTable[int, int].init()
+    for i in 0..<10_000:
+      table[i] = i + 1
+    check table.len == 10_000
+    check table.capacity >= 10_000
+    for i in 0..<10_000:
+      check table[i] == i + 1
+    check not table.contains(10_000)
+
+  test "delete-heavy workload keeps working":
+    var table = SwissTable[int, int].init()
+    for round in 0..<20:
+      for i in 0..<500:
+        table[round * 1000 + i] = i
+      for i in 0..<500:
+        check table.delete(round * 1000 + i)
+    check table.len == 0
+
+suite "Swiss Table - Heterogeneous Lookup and Emplace":
+  test "char slices find string keys without allocating":
+    var table = SwissTable[string, int].init()
+    table["GET"] = 1
+    table["POST"] = 2
+    let buf = "xxPOST /index.html"
+    check hashKey(buf.toOpenArray(2, 5)) == hashKey("POST")
+    check buf.toOpenArray(2, 5) in table
+    check table[buf.toOpenArray(2, 5)] == 2
+    check table.find(buf.toOpenArray(2, 4)).isNone  # "POS"
+    check table.find(buf.toOpenArray(0, 1)).isNone
+
+  test "mgetOrPut inserts once and returns a mutable value":
+    var table = SwissTable[string, int].init()
+    for word in ["a", "b", "a", "c", "a"]:
+      inc table.mgetOrPut(word, 0)
+    check table["a"] == 3
+    check table["b"] == 1
+    check table.len == 3
+    let buf = "bb"
+    inc table.mgetOrPut(buf.toOpenArray(0, 0), 0)
+    inc table.mgetOrPut(buf.toOpenArray(0, 1), 10)
+    check table["b"] == 2
+    check table["bb"] == 11
+
+  test "emplace reports new entries":
+    var table = SwissTable[int, seq[int]].init()
+    var isNew: bool
+    table.emplace(1, isNew).add 10
+    check isNew
+    table.emplace(1, isNew).add 20
+    check not isNew
+    check table[1] == @[10, 20]
+
+  test "reserve avoids rehashing while filling":
+    var table = SwissTable[int, int].init()
+    table.reserve(5000)
+    let cap = table.capacity
+    check cap * 7 div 8 >= 5000
+    for i in 0..<5000:
+      table[i] = i
+    check table.capacity == cap
+
+  test "delete churn reuses slots instead of growing":
+    var table = SwissTable[int, int].init()
+    table.reserve(200)
+    let cap = table.capacity
+    for i in 0..<100_000:
+      table[i] = i
+      if i >= 100:
+        check table.delete(i - 100)
+    check table.len == 100
+    check table.capacity == cap
+    for i in 99_900..<100_000:
+      check table[i] == i
+
+suite "Flat Swiss Table":
+  test "separate key/value arrays behave like SwissTable":
+    var table = FlatSwissTable[int, float].init()
+    for i in 0..<5000:
+      table[i] = float(i) / 2
+    check table.len == 5000
+    check table[10] == 5.0
+    check 4999 in table
+    check 5000 notin table
+    check table.delete(10)
+    check 10 notin table
+    check table.getOrDefault(10, -1.0) == -1.0
+    table.mgetOrPut(10, 0.0) += 1.5
+    check table[10] == 1.5
+    var sum = 0
+    for k in table.keys:
+      sum += k
+    check sum == 4999 * 5000 div 2
+    table.destroy()
+
+  test "flat set has no values":
+    var s = FlatSwissSet[uint64].init()
+    for i in 0'u64..<1000'u64:
+      s.incl i * 3
+    check s.len == 1000
+    check 300'u64 in s
+    check 301'u64 notin s
+    check s.containsOrIncl(300)
+    check not s.containsOrIncl(301)
+    s.excl 301
+    check 301'u64 notin s
+    var n = 0
+    for k in s:
+      check k mod 3 == 0
+      inc n
+    check n == 1000
+    s.destroy()
+
+  test "save and load round-trip through a file mapping":
+    let path = getTempDir() / "arsenal_flat_table_test.flat"
+    var table = FlatSwissTable[int, int].init()
+    for i in 0..<20_000:
+      table[i] = i * 7
+    table.save(path)
+
+    var loaded = FlatSwissTable[int, int].load(path)
+    check loaded.isMapped
+    check loaded.len == 20_000
+    check loaded.capacity == table.capacity
+    for i in 0..<20_000:
+      check loaded[i] == i * 7
+    check 20_000 notin loaded
+
+    # First write detaches from the read-only mapping
+    loaded[20_000] = 1
+    check not loaded.isMapped
+    check loaded[20_000] == 1
+    check loaded[19_999] == 19_999 * 7
+
+    loaded.destroy()
+    table.destroy()
+    removeFile(path)
+
+  test "load rejects a file saved with other types":
+    let path = getTempDir() / "arsenal_flat_set_test.flat"
+    var s = FlatSwissSet[uint32].init()
+    s.incl 1
+    s.save(path)
+    expect IOError:
+      discard FlatSwissTable[uint32, int].load(path)
+    var again = FlatSwissSet[uint32].load(path)
+    check 1'u32 in again
+    again.destroy()
+    s.destroy()
+    removeFile(path)
+
+suite "Concurrent Swiss Table":
+  test "insert, lookup, update and delete":
+    var table = ConcurrentSwissTable[int, int].init(shards = 4)
+    check table.shardCount == 4
+    for i in 0..<1000:
+      table[i] = i * 3
+    check table.len == 1000
+    check table[7] == 21
+    check table.find(999) == some(2997)
+    check table.find(1000).isNone
+    check table.getOrDefault(5000, -1) == -1
+    table[7] = 0
+    check table[7] == 0
+    check table.delete(7)
+    check not table.delete(7)
+    check 7 notin table
+    check table.len == 999
+    table.destroy()
+
+  test "shards grow independently and retired tables are reclaimed":
+    var table = ConcurrentSwissTable[int, int].init(shards = 2)
+    let before = table.capacity
+    for i in 0..<20_000:
+      table[i] = i
+    check table.capacity > before
+    check table.reclaim() > 0
+    check table.reclaim() == 0
+    for i in 0..<20_000:
+      check table[i] == i
+    table.destroy()
+
+  test "string keys use locked lookups":
+    var table = ConcurrentSwissTable[string, string].init()
+    table["alpha"] = "a"
+    table["beta"] = "b"
+    check table["alpha"] == "a"
+    check "gamma" notin table
+    var seen = 0
+    for k, v in table.pairs:
+      check v == k[0 .. 0]
+      inc seen
+    check seen == 2
+    table.clear()
+    check table.len == 0
+    table.destroy()
+
+  test "concurrent writers and lock-free readers":
+    when compileOption("threads"):
+      var table = ConcurrentSwissTable[int, int].init(shards = 8)
+      const perThread = 5000
+      const numWriters = 4
+
+      proc writer(id: int) {.thread.} =
+        for i in 0..<perThread:
+          let key = id * perThread + i
+          table[key] = key * 2
+
+      proc reader(bad: ptr int) {.thread.} =
+        # Values are only ever key * 2, so any other result is a torn read
+        for round in 0..<4:
+          for key in 0..<perThread * numWriters:
+            let v = table.find(key)
+            if v.isSome and v.get != key * 2:
+              inc bad[]
+
+      var writers: array[numWriters, Thread[int]]
+      var readThread: Thread[ptr int]
+      var bad = 0
+      for i in 0..<numWriters:
+        createThread(writers[i], writer, i)
+      createThread(readThread, reader, addr bad)
+      for i in 0..<numWriters:
+        joinThread(writers[i])
+      joinThread(readThread)
+
+      check bad == 0
+      check table.len == perThread * numWriters
+      for key in 0..<perThread * numWriters:
+        check table[key] == key * 2
+      table.destroy()
+    else:
+      skip()
+
 echo "Swiss table tests completed successfully!"
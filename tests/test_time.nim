@@ -3,6 +3,7 @@
 
 import std/[unittest, monotimes, os, times]
 import ../src/arsenal/time/clock
+import ../src/arsenal/time/timer_wheel
 
 suite "High-Resolution Timer":
   test "timer initialization":
@@ -104,6 +105,71 @@ when defined(amd64) or defined(i386):
       check freq > 0.5
       check freq < 6.0
 
+suite "Timer Wheel":
+  proc collect(w: var TimerWheel, nowNs: int64): seq[int32] =
+    for id in w.advance(nowNs):
+      result.add id
+
+  test "timers fire at their deadline, not before":
+    var w = TimerWheel.init(16, startNs = 0)
+    w.schedule(1, 5_000_000)            # 5 ms
+    w.schedule(2, 200_000_000)          # 200 ms, starts in level 1
+    w.schedule(3, 3_600_000_000_000)    # 1 h, starts in level 3
+    check w.len == 3
+    check collect(w, 4_000_000).len == 0
+    check collect(w, 5_000_000) == @[1'i32]
+    check collect(w, 199_000_000).len == 0
+    check collect(w, 200_000_000) == @[2'i32]
+    check collect(w, 3_599_999_000_000).len == 0
+    check collect(w, 3_600_000_000_000) == @[3'i32]
+    check w.len == 0
+
+  test "cancel and reschedule":
+    var w = TimerWheel.init(4, startNs = 0)
+    w.schedule(0, 10_000_000)
+    w.schedule(1, 10_000_000)
+    w.cancel(0)
+    check not w.isScheduled(0)
+    w.schedule(1, 50_000_000)
+    check collect(w, 20_000_000).len == 0
+    check collect(w, 50_000_000) == @[1'i32]
+
+  test "the loop body may cancel timers due in the same tick":
+    var w = TimerWheel.init(4, startNs = 0)
+    for id in 0'i32 .. 2'i32:
+      w.schedule(id, 10_000_000)
+    var fired: seq[int32]
+    for id in w.advance(10_000_000):
+      fired.add id
+      for other in 0'i32 .. 2'i32:
+        w.cancel(other)                  # Including the one linked next
+    check fired.len == 1
+    check w.len == 0
+    w.schedule(3, 500_000_000)           # Level counts are still sound
+    check collect(w, 499_000_000).len == 0
+    check collect(w, 500_000_000) == @[3'i32]
+
+  test "far-future deadlines are clamped and still exact":
+    var w = TimerWheel.init(2, startNs = 0)
+    let deadline = 30 * 24 * 3600 * 1_000_000_000'i64    # Past 12.4 days
+    w.schedule(0, deadline)
+    check collect(w, deadline - 1_000_000).len == 0
+    check collect(w, deadline) == @[0'i32]
+
+  test "every tick offset expires exactly once":
+    var w = TimerWheel.init(5000, startNs = 0)
+    for i in 0..<5000:
+      w.schedule(int32(i), int64(i * 997 mod 300_000 + 1) * 1_000_000)
+    var seen = newSeq[int](5000)
+    var t = 0'i64
+    while w.len > 0:
+      t += 7_000_000
+      for id in w.advance(t):
+        check int64(int(id) * 997 mod 300_000 + 1) * 1_000_000 <= t
+        inc seen[id]
+    for s in seen:
+      check s == 1
+
 suite "Benchmark Template":
   test "benchmark template works":
     var executed = false
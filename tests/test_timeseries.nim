@@ -0,0 +1,265 @@
+## Unit Tests for the Time Series Store
+## ====================================
+
+import std/[unittest, os, random, math, strutils]
+import ../src/arsenal/timeseries/[gorilla, store]
+
+proc freshDir(name: string): string =
+  result = getTempDir() / name
+  removeDir(result)
+
+proc walkSeries(n: int, start = 0'i64, step = 10'i64, seed = 1): seq[(int64, float64)] =
+  ## Regular timestamps with a random-walk value
+  var r = initRand(seed)
+  var v = 100.0
+  for i in 0 ..< n:
+    v += r.rand(1.0) - 0.5
+    result.add (start + int64(i) * step, round(v * 100) / 100)
+
+proc between(points: seq[(int64, float64)], a, b: int64): seq[(int64, float64)] =
+  for p in points:
+    if p[0] >= a and p[0] <= b:
+      result.add p
+
+suite "Time Series Store":
+  test "round-trips points across windows and series":
+    let dir = freshDir("arsenal_tsdb_roundtrip")
+    defer: removeDir(dir)
+    var db = TimeSeriesStore.init(dir, window = 1000)
+    let a = walkSeries(500, seed = 1)
+    let b = walkSeries(300, start = 5, step = 7, seed = 2)
+    for i in 0 ..< 500:
+      db.append(1, a[i][0], a[i][1])
+      if i < b.len:
+        db.append(2, b[i][0], b[i][1])
+    check db.seriesCount == 2
+    check db.pointCount == 800
+    check db.chunkCount == 4 + 2            # Both open chunks not counted
+    check db.query(1, low(int64), high(int64)) == a
+    check db.query(2, low(int64), high(int64)) == b
+    check db.query(1, 990, 2010) == a.between(990, 2010)
+    check db.query(2, 12, 12).len == 1       # Inclusive bounds
+    check db.query(3, 0, 10_000).len == 0
+    check 3'u64 notin db
+
+  test "queries decode only overlapping chunks":
+    let dir = freshDir("arsenal_tsdb_overlap")
+    defer: removeDir(dir)
+    var db = TimeSeriesStore.init(dir, window = 100)
+    for t in 0'i64 ..< 1000:
+      db.append(7, t, float64(t))
+    var seen: seq[int64]
+    for c in db.overlapping(7, 250, 420):
+      seen.add c.minTime
+    check seen == @[200'i64, 300, 400]
+    check db.query(7, 250, 420).len == 171
+    check db.query(7, 950, 2000).len == 50  # Open chunk only
+
+  test "persists across close and reopen":
+    let dir = freshDir("arsenal_tsdb_reopen")
+    defer: removeDir(dir)
+    let points = walkSeries(2000)
+    block:
+      var db = TimeSeriesStore.init(dir, window = 3600)
+      db.append(42, points[0 ..< 1000])
+      db.close()
+    block:
+      var db = TimeSeriesStore.init(dir, window = 3600)
+      check db.query(42, low(int64), high(int64)) == points[0 ..< 1000]
+      db.append(42, points[1000 .. ^1])     # Continues after the last point
+      expect ValueError:
+        db.append(42, points[500][0], 1.0)
+      db.close()
+      db.close()                          # Idempotent
+      when compileOption("assertions"):
+        expect AssertionDefect:           # Chunks point at unmapped segments
+          discard db.query(42, 0, 100)
+    var db = TimeSeriesStore.init(dir, window = 3600)
+    check db.pointCount == 2000
+    check db.query(42, low(int64), high(int64)) == points
+    check db.query(42, 7000, 9000) == points.between(7000, 9000)
+
+  test "writes segments as chunks are sealed":
+    let dir = freshDir("arsenal_tsdb_segments")
+    defer: removeDir(dir)
+    var db = TimeSeriesStore.init(dir, window = 60, segmentBytes = 4096)
+    var expected: array[8, seq[(int64, float64)]]
+    var r = initRand(3)
+    for t in 0'i64 ..< 5000:
+      for series in 0 ..< 8:
+        let v = float64(r.rand(1000))
+        db.append(uint64(series), t * 10 + series, v)
+        expected[series].add (t * 10 + series, v)
+    var segments = 0
+    for _, path in walkDir(dir):
+      if path.endsWith(".tsdb"):
+        inc segments
+    check segments > 1
+    for series in 0 ..< 8:
+      check db.query(uint64(series), 0, high(int64)) == expected[series]
+    db.close()
+    var reopened = TimeSeriesStore.init(dir, window = 60)
+    for series in 0 ..< 8:
+      check reopened.query(uint64(series), 12_345, 23_456) ==
+            expected[series].between(12_345, 23_456)
+
+  test "windows align for negative timestamps":
+    let dir = freshDir("arsenal_tsdb_negative")
+    defer: removeDir(dir)
+    var db = TimeSeriesStore.init(dir, window = 100)
+    for t in -250'i64 .. 50:
+      db.append(1, t, 0.5)
+    var starts: seq[int64]
+    for c in db.overlapping(1, low(int64), high(int64)):
+      starts.add c.minTime
+    check starts == @[-250'i64, -200, -100]
+    check db.query(1, -260, -240).len == 11
+
+  test "nanosecond timestamps need a window within int32":
+    let dir = freshDir("arsenal_tsdb_nanos")
+    defer: removeDir(dir)
+    expect ValueError:
+      discard TimeSeriesStore.init(dir, window = 3_600_000_000_000)  # 1 h in ns
+    # Each window holds points at offsets 0, w - 2 and w - 1, so the
+    # delta-of-deltas in a chunk reach +-(w - 3)
+    let window = int64(high(int32))
+    var db = TimeSeriesStore.init(dir, window = window)
+    var points: seq[(int64, float64)]
+    let base = 1_700_000_000_000_000_000'i64 div window * window
+    for k in 0'i64 ..< 50:
+      for offset in [0'i64, window - 2, window - 1]:
+        let t = base + k * window + offset
+        points.add (t, float64(points.len))
+        db.append(5, t, float64(points.len - 1))
+    check db.query(5, low(int64), high(int64)) == points
+    db.close()
+    check TimeSeriesStore.init(dir, window = window).query(5, low(int64), high(int64)) == points
+
+  test "rejects out-of-order points and corrupt segments":
+    let dir = freshDir("arsenal_tsdb_corrupt")
+    defer: removeDir(dir)
+    block:
+      var db = TimeSeriesStore.init(dir)
+      db.append(1, 100, 1.0)
+      expect ValueError:
+        db.append(1, 100, 2.0)
+      db.close()
+    let path = dir / "segment-000001.tsdb"
+    var bytes = readFile(path)
+    bytes[^1] = 'X'
+    writeFile(path, bytes)
+    expect IOError:
+      discard TimeSeriesStore.init(dir)
+
+proc naive(points: seq[(int64, float64)], a, b: int64): Summary =
+  for (t, v) in points:
+    if t >= a and t <= b:
+      result.add(t, v)
+
+proc near(a, b: Summary): bool =
+  ## Same summary, up to rounding of the sums
+  template closeTo(x, y: float64): bool = abs(x - y) <= 1e-9 * max(1.0, abs(x) + abs(y))
+  a.count == b.count and (a.count == 0 or
+    (closeTo(a.sum, b.sum) and a.min == b.min and a.max == b.max and
+     a.firstTime == b.firstTime and a.lastTime == b.lastTime and
+     a.first == b.first and a.last == b.last and closeTo(a.increase, b.increase)))
+
+proc counterSeries(n: int, seed = 4): seq[(int64, float64)] =
+  ## A counter that occasionally resets to zero
+  var r = initRand(seed)
+  var c = 0.0
+  for i in 0 ..< n:
+    c = if r.rand(99) == 0: 0.0 else: c + float64(r.rand(10))
+    result.add (int64(i) * 15, c)
+
+proc encodeBlock(points: seq[(int64, float64)]): seq[uint8] =
+  var enc = newGorillaEncoder()
+  for (t, v) in points:
+    enc.encode(t, v)
+  enc.finish()
+
+suite "Time Series Aggregation":
+  test "block summaries match a point-by-point fold":
+    let points = counterSeries(3000)
+    let data = encodeBlock(points)
+    var r = initRand(5)
+    check summarize(data, points.len).near(naive(points, low(int64), high(int64)))
+    for _ in 0 ..< 200:
+      let a = int64(r.rand(50_000)) - 1000
+      let b = a + int64(r.rand(20_000))
+      check summarize(data, points.len, a, b).near(naive(points, a, b))
+    check summarize(data, points.len, 100_000, 200_000).count == 0
+
+  test "counter increase and rate allow for resets":
+    var s: Summary
+    for (t, v) in [(0'i64, 10.0), (10'i64, 15.0), (20'i64, 3.0), (30'i64, 8.0)]:
+      s.add(t, v)
+    check s.increase == 5.0 + 3.0 + 5.0
+    check s.rate == 13.0 / 30.0
+    var halves = naive(@[(0'i64, 10.0), (10'i64, 15.0)], 0, 100)
+    halves.merge(naive(@[(20'i64, 3.0), (30'i64, 8.0)], 0, 100))
+    check halves.near(s)
+
+  test "min and max skip NaN":
+    var points = walkSeries(100)
+    points[3][1] = NaN
+    points[40][1] = NaN
+    let s = summarize(encodeBlock(points), points.len)
+    check s.count == 100
+    check s.sum.isNaN
+    check s.min == naive(points, 0, high(int64)).min
+    check s.max == naive(points, 0, high(int64)).max
+
+  test "the whole int64 range fits one bucket":
+    let grid = BucketGrid.init(low(int64), high(int64))
+    check grid.width == high(uint64)
+    check grid.bucketOf(low(int64)) == 0
+    check grid.bucketOf(high(int64)) == 0
+    check grid.bucketEnd(0) == high(int64)
+    let points = walkSeries(300, start = -1500)
+    let data = encodeBlock(points)
+    let all = naive(points, low(int64), high(int64))
+    check summarize(data, points.len).near(all)
+    let sums = downsample(data, points.len, grid)
+    check sums.len == 1
+    check sums[0].near(all)
+
+  test "downsampling splits the range into equal buckets":
+    let grid = BucketGrid.init(0, 1000, 7)
+    check grid.width == 143
+    check grid.bucketStart(6) == 858
+    check grid.bucketEnd(5) == 857
+    check grid.bucketEnd(6) == 1000
+    check grid.bucketOf(857) == 5
+    let points = counterSeries(5000)
+    let data = encodeBlock(points)
+    for buckets in [1, 3, 24, 100]:
+      let g = BucketGrid.init(1234, 70_000, buckets)
+      let sums = downsample(data, points.len, g)
+      check sums.len == buckets
+      for i in 0 ..< buckets:
+        check sums[i].near(naive(points, g.bucketStart(i), g.bucketEnd(i)))
+
+  test "store aggregates match the points":
+    let dir = freshDir("arsenal_tsdb_aggregate")
+    defer: removeDir(dir)
+    let points = counterSeries(10_000)
+    block:
+      var db = TimeSeriesStore.init(dir, window = 3600, segmentBytes = 2048)
+      db.append(9, points[0 ..< 6000])
+      db.close()
+    var db = TimeSeriesStore.init(dir, window = 3600, segmentBytes = 2048)
+    db.append(9, points[6000 .. ^1])         # Flushed, pending and open chunks
+    for c in db.overlapping(9, low(int64), high(int64)):
+      check c.summary.near(summarize(db.chunkData(c), c.count))
+    var r = initRand(6)
+    for _ in 0 ..< 100:
+      let a = int64(r.rand(150_000))
+      let b = a + int64(r.rand(60_000))
+      check db.summarize(9, a, b).near(naive(points, a, b))
+    # Buckets of whole windows: every chunk is taken from its summary
+    let grid = BucketGrid.init(0, 36_000 * 5 - 1, 5)
+    let buckets = db.downsample(9, grid)
+    for i in 0 ..< 5:
+      check buckets[i].near(naive(points, grid.bucketStart(i), grid.bucketEnd(i)))
+    check db.summarize(10, 0, 100).count == 0